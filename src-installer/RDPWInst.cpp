@@ -26,6 +26,8 @@
 #include <string>
 #include <vector>
 
+#include "ini/parser.hpp"
+
 namespace {
 
 constexpr wchar_t kTermService[] = L"TermService";
@@ -1088,6 +1090,55 @@ bool iniDate(const std::wstring* filename, const std::string& content, int& date
     return false;
 }
 
+// Whether replacing the installed INI with `newContent` changes anything the
+// Wrapper reads for the local termsrv build: [Main] apart from its date,
+// [SLPolicy], [SLInit], the build's own sections, and the [PatchCodes]
+// entries either version of the build section names. The Wrapper reads its
+// INI only when TermService starts, so any other change can be saved in
+// place. Anything that cannot be compared counts as changed.
+bool termsrvConfigChanged(const std::wstring& iniPath, const std::string& newContent) {
+    FileVersion version;
+    const std::optional<std::string> oldContent = readValidatedIni(iniPath);
+    if (!oldContent || !getFileVersion(expandPath(termServicePath), version)) return true;
+    const std::string build = std::to_string(version.major) + '.' +
+        std::to_string(version.minor) + '.' + std::to_string(version.release) + '.' +
+        std::to_string(version.build);
+    ini::ParseOptions options;
+    options.strict = false;
+    options.interpolation = ini::InterpolationMode::None;
+    ini::Parser oldConfig(options), newConfig(options);
+    ini::ConfigDiff diff;
+    try {
+        oldConfig.read_string(*oldContent, "installed INI");
+        newConfig.read_string(newContent, "downloaded INI");
+        diff = oldConfig.diff(newConfig);
+    } catch (const ini::Error&) {
+        return true;
+    }
+    if (const ini::SectionChange* main = diff.find("Main")) {
+        for (const auto& change : main->options)
+            if (change.option != "updated") return true;
+    }
+    for (const std::string& section : {options.default_section, std::string("SLPolicy"),
+                                       std::string("SLInit"), build, build + "-SLInit"})
+        if (diff.find(section)) return true;
+    const ini::SectionChange* codes = diff.find("PatchCodes");
+    if (!codes) return false;
+    for (const ini::Parser* config : {&oldConfig, &newConfig}) {
+        if (!config->has_section(build)) continue;
+        for (const auto& [key, value] : config->items(build, true)) {
+            if (!value || key.find("code.") == std::string::npos) continue;
+            std::string code = *value;
+            std::transform(code.begin(), code.end(), code.begin(), [](unsigned char c) {
+                return static_cast<char>(std::tolower(c));
+            });
+            for (const auto& change : codes->options)
+                if (change.option == code) return true;
+        }
+    }
+    return false;
+}
+
 void checkUpdate(const std::wstring& source) {
     auto formattedDate = [](int date) {
         std::wostringstream text;
@@ -1115,6 +1166,14 @@ void checkUpdate(const std::wstring& source) {
         return;
     }
     std::wcout << L"[+] New update is available, updating...\n";
+    if (!termsrvConfigChanged(iniPath, content)) {
+        std::wcout << L"[*] The configuration of this termsrv version is unchanged.\n"
+                      L"[*] Saving new INI file to " << iniPath << L"\n";
+        if (!writeBytes(iniPath, content)) halt(ERROR_ACCESS_DENIED);
+        std::wcout << L"[+] INI file saved successfully, no service restart needed.\n"
+                      L"[+] Update completed.\n";
+        return;
+    }
     checkTermsrvProcess();
     std::wcout << L"[*] Terminating service...\n";
     addPrivilege(SE_DEBUG_NAME);
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ini_bench {
+
+// Number of operator new calls made by the process so far. The benchmark
+// executable replaces the global allocation functions to keep this count.
+std::uint64_t allocation_count() noexcept;
+// Total bytes requested through operator new so far.
+std::uint64_t allocated_bytes() noexcept;
+
+// Reads a file from the corpus directory (INI_BENCH_CORPUS_DIR, falling back
+// to the repository's res/ directory). Throws std::runtime_error on failure.
+std::string load_corpus(std::string_view name);
+std::string corpus_path(std::string_view name);
+
+// `copies` copies of a corpus file with every section header prefixed by
+// "copyN.", so no two copies share a section; one copy is the file as it is.
+// The text depends on nothing but the file, so runs on different commits
+// read the same input.
+std::string scaled_corpus(std::string_view name, int copies);
+
+// Peak resident set size of the process in KiB, or 0 where it cannot be read.
+std::size_t peak_rss_kib() noexcept;
+// Lowers that peak to the current resident size where the platform allows
+// it (Linux), so each timed workload reports its own high-water mark.
+void reset_peak_rss() noexcept;
+
+// Keeps the optimiser from discarding a computed value.
+template <class T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+enum class OutputFormat {
+    Text,  // aligned columns for reading
+    Json,  // one JSON object per workload and line, for comparing runs
+};
+
+class Runner {
+public:
+    explicit Runner(std::string filter, OutputFormat format = OutputFormat::Text)
+        : filter_(std::move(filter)), format_(format) {}
+
+    // Times `body` until the minimum run time has elapsed. `ops_per_call` is
+    // the number of logical operations one call of `body` performs, so the
+    // report is per lookup/parse/... rather than per call. `bytes_per_call`,
+    // when non-zero, adds a MB/s column.
+    void run(
+        std::string_view name,
+        std::size_t ops_per_call,
+        const std::function<void()>& body,
+        std::size_t bytes_per_call = 0);
+
+private:
+    std::string filter_;
+    OutputFormat format_;
+};
+
+using Workload = void (*)(Runner&);
+
+struct Registration {
+    Registration(const char* name, Workload fn);
+};
+
+const std::vector<std::pair<const char*, Workload>>& workloads();
+
+}  // namespace ini_bench
+
+#define INI_BENCH_CONCAT_INNER(a, b) a##b
+#define INI_BENCH_CONCAT(a, b) INI_BENCH_CONCAT_INNER(a, b)
+#define INI_BENCH_WORKLOAD(name, fn) \
+    static const ::ini_bench::Registration INI_BENCH_CONCAT(ini_bench_reg_, __LINE__)(name, fn)
@@ -0,0 +1,246 @@
+#include "bench.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+std::atomic<std::uint64_t> g_allocated_bytes{0};
+
+std::vector<std::pair<const char*, ini_bench::Workload>>& registry() {
+    static std::vector<std::pair<const char*, ini_bench::Workload>> r;
+    return r;
+}
+
+constexpr auto kMinRunTime = std::chrono::milliseconds(200);
+
+// Workload names are plain ASCII; quotes and backslashes are escaped anyway.
+std::string json_string(std::string_view text) {
+    std::string out = "\"";
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+    return out;
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace ini_bench {
+
+std::uint64_t allocation_count() noexcept {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+std::uint64_t allocated_bytes() noexcept {
+    return g_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+std::string corpus_path(std::string_view name) {
+    std::string dir;
+    if (const char* env = std::getenv("INI_BENCH_CORPUS_DIR")) {
+        dir = env;
+    } else {
+        dir = INI_CONFIGPARSER_CORPUS_DIR;
+    }
+    return dir + "/" + std::string(name);
+}
+
+std::string load_corpus(std::string_view name) {
+    const auto path = corpus_path(name);
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        throw std::runtime_error("cannot open corpus: " + path);
+    }
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+std::string scaled_corpus(std::string_view name, int copies) {
+    const auto text = load_corpus(name);
+    if (copies == 1) {
+        return text;
+    }
+    std::string out;
+    out.reserve((text.size() + 4096) * static_cast<std::size_t>(copies));
+    for (int i = 0; i < copies; ++i) {
+        const std::string prefix = "[copy" + std::to_string(i) + ".";
+        for (std::size_t line = 0; line < text.size();) {
+            auto end = text.find('\n', line);
+            end = end == std::string::npos ? text.size() : end + 1;
+            if (text[line] == '[') {
+                out += prefix;
+                out.append(text, line + 1, end - line - 1);
+            } else {
+                out.append(text, line, end - line);
+            }
+            line = end;
+        }
+    }
+    return out;
+}
+
+std::size_t peak_rss_kib() noexcept {
+#if defined(__linux__)
+    // VmHWM follows reset_peak_rss(); ru_maxrss never goes down.
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return static_cast<std::size_t>(std::strtoull(line.c_str() + 6, nullptr, 10));
+        }
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+        return static_cast<std::size_t>(usage.ru_maxrss) / 1024;  // bytes
+#else
+        return static_cast<std::size_t>(usage.ru_maxrss);
+#endif
+    }
+#endif
+    return 0;
+}
+
+void reset_peak_rss() noexcept {
+#if defined(__GLIBC__)
+    // Hand memory freed by earlier workloads back first, or it stays
+    // resident and counts towards every later peak.
+    malloc_trim(0);
+#endif
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+#endif
+}
+
+Registration::Registration(const char* name, Workload fn) {
+    registry().emplace_back(name, fn);
+}
+
+const std::vector<std::pair<const char*, Workload>>& workloads() {
+    return registry();
+}
+
+void Runner::run(
+    std::string_view name,
+    std::size_t ops_per_call,
+    const std::function<void()>& body,
+    std::size_t bytes_per_call) {
+    if (!filter_.empty() && name.find(filter_) == std::string_view::npos) {
+        return;
+    }
+
+    reset_peak_rss();
+    body();  // warm-up
+
+    using clock = std::chrono::steady_clock;
+    std::uint64_t calls = 0;
+    const auto allocs_before = allocation_count();
+    const auto bytes_before = allocated_bytes();
+    const auto start = clock::now();
+    auto elapsed = clock::duration::zero();
+    do {
+        body();
+        ++calls;
+        elapsed = clock::now() - start;
+    } while (elapsed < kMinRunTime);
+    const auto allocs = allocation_count() - allocs_before;
+    const auto alloc_bytes = allocated_bytes() - bytes_before;
+    const auto peak_rss = peak_rss_kib();
+
+    const double ops = static_cast<double>(calls) * static_cast<double>(ops_per_call);
+    const double ns = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    const double mb_per_s = bytes_per_call == 0
+        ? 0.0
+        : static_cast<double>(calls) * static_cast<double>(bytes_per_call) / (ns / 1e9) / (1024.0 * 1024.0);
+
+    if (format_ == OutputFormat::Json) {
+        std::printf("{\"name\":%s,\"ops\":%.0f,\"ns_per_op\":%.3f,\"allocs_per_op\":%.4f,"
+                    "\"bytes_allocated_per_op\":%.1f,\"peak_rss_kib\":%zu",
+                    json_string(name).c_str(), ops, ns / ops, static_cast<double>(allocs) / ops,
+                    static_cast<double>(alloc_bytes) / ops, peak_rss);
+        if (bytes_per_call != 0) {
+            std::printf(",\"mb_per_s\":%.1f", mb_per_s);
+        }
+        std::printf("}\n");
+    } else {
+        std::printf("%-44.*s %12.1f ns/op %14.0f ops/s %10.2f allocs/op %12.0f B/op %9zu KiB peak",
+                    static_cast<int>(name.size()), name.data(),
+                    ns / ops, ops * 1e9 / ns, static_cast<double>(allocs) / ops,
+                    static_cast<double>(alloc_bytes) / ops, peak_rss);
+        if (bytes_per_call != 0) {
+            std::printf(" %9.1f MB/s", mb_per_s);
+        }
+        std::printf("\n");
+    }
+    std::fflush(stdout);
+}
+
+}  // namespace ini_bench
+
+// ini_configparser_bench [--json] [filter]
+//
+// Runs every workload whose name contains `filter`. --json prints one object
+// per workload ({"name", "ops", "ns_per_op", "allocs_per_op",
+// "bytes_allocated_per_op", "peak_rss_kib" and, for workloads that read
+// input, "mb_per_s"}) so two commits' runs can be joined on "name".
+int main(int argc, char** argv) {
+    std::string filter;
+    auto format = ini_bench::OutputFormat::Text;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--json") {
+            format = ini_bench::OutputFormat::Json;
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "usage: " << argv[0] << " [--json] [filter]\n";
+            return 2;
+        } else {
+            filter = arg;
+        }
+    }
+    ini_bench::Runner runner(filter, format);
+    try {
+        for (const auto& w : ini_bench::workloads()) {
+            w.second(runner);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "benchmark failed: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
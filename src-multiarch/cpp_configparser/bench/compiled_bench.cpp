@@ -0,0 +1,65 @@
+#include "bench.hpp"
+
+#include <cstdlib>
+#include <string>
+
+#include "ini/compiled_config.hpp"
+#include "ini/mapped_file.hpp"
+#include "ini/parser.hpp"
+
+namespace {
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+    return opt;
+}
+
+// The last "[a.b.c.d]" section in the corpus, packed.
+std::uint64_t last_build(const std::string& text) {
+    ini::Parser p(wrapper_options());
+    p.read_string(text);
+    std::uint64_t out = 0;
+    for (const auto& name : p.sections()) {
+        if (const auto v = ini::parse_version(name)) {
+            out = *v;
+        }
+    }
+    return out;
+}
+
+// What Hook() does with a compiled blob next to the INI: map and hash the
+// INI, validate the blob and load one build into a parser. Compare with
+// parse/<corpus>/hook_lazy, which reads the INI itself.
+void compiled_corpus(ini_bench::Runner& r, const char* name) {
+    const auto path = ini_bench::corpus_path(name);
+    const auto text = ini_bench::load_corpus(name);
+    const auto opt = wrapper_options();
+    const auto blob = ini::compile_config(text, opt);
+    const auto version = last_build(text);
+
+    r.run(std::string("compiled/") + name + "/compile", 1, [&] {
+        ini_bench::do_not_optimize(ini::compile_config(text, opt));
+    }, text.size());
+    r.run(std::string("compiled/") + name + "/hook_blob", 1, [&] {
+        const ini::MappedFile ini_file(path);
+        const ini::CompiledConfig compiled(blob);
+        if (!compiled.matches_source(ini_file.view())) {
+            std::abort();
+        }
+        ini::Parser p(opt);
+        compiled.load(p, version, ini::TargetArch::X64);
+        ini_bench::do_not_optimize(p);
+    }, text.size());
+}
+
+void compiled_workloads(ini_bench::Runner& r) {
+    compiled_corpus(r, "rdpwrap.ini");
+    compiled_corpus(r, "rdpwrap-arm-kb.ini");
+}
+
+INI_BENCH_WORKLOAD("compiled", compiled_workloads);
+
+}  // namespace
@@ -0,0 +1,140 @@
+#include "bench.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ini/decode.hpp"
+#include "ini/parser.hpp"
+
+namespace {
+
+struct Values {
+    std::vector<std::string> offsets;
+    std::vector<std::string> codes;
+    std::size_t offset_bytes = 0;
+    std::size_t code_bytes = 0;
+};
+
+// Every "*Offset*" value and every "*Code*" or [PatchCodes] value that is a
+// byte array, from both shipped files.
+Values shipped_values() {
+    Values out;
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    for (const char* name : {"rdpwrap.ini", "rdpwrap-arm-kb.ini"}) {
+        ini::Parser p(opt);
+        p.read_string(ini_bench::load_corpus(name), name);
+        for (const auto& section : p.sections()) {
+            for (const auto& [key, value] : p.section(section).items()) {
+                if (!value.has_value() || value->empty()) {
+                    continue;
+                }
+                ini::ByteArray bytes;
+                if (key.find("offset") != std::string::npos) {
+                    out.offsets.push_back(*value);
+                    out.offset_bytes += value->size();
+                } else if ((section == "PatchCodes" || key.find("code") != std::string::npos) &&
+                           ini::decode_bytes(*value, bytes)) {
+                    out.codes.push_back(*value);
+                    out.code_bytes += value->size();
+                }
+            }
+        }
+    }
+    return out;
+}
+
+// INIReadDWordHex: a std::string copy handed to strtoull.
+bool strtoull_hex(std::string_view value, std::uint64_t& out) {
+    const std::string copy(value);
+    errno = 0;
+    char* end = nullptr;
+    const unsigned long long n = std::strtoull(copy.c_str(), &end, 16);
+    if (errno == ERANGE || *end != '\0') {
+        return false;
+    }
+    out = n;
+    return true;
+}
+
+int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// GetByteArrayFromIni: separators filtered into a string, then decoded
+// nibble by nibble.
+bool filtered_bytes(std::string_view value, ini::ByteArray& out) {
+    std::string hex;
+    for (const char c : value) {
+        if (c != ' ' && c != '\t' && c != ',' && c != '-') {
+            hex.push_back(c);
+        }
+    }
+    if (hex.size() % 2 != 0 || hex.size() > 2 * sizeof(out.data)) {
+        return false;
+    }
+    for (std::size_t i = 0; i < hex.size(); i += 2) {
+        const int hi = hex_nibble(hex[i]);
+        const int lo = hex_nibble(hex[i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out.data[i / 2] = static_cast<std::uint8_t>((hi << 4) | lo);
+    }
+    out.size = static_cast<std::uint8_t>(hex.size() / 2);
+    return true;
+}
+
+void decode_workloads(ini_bench::Runner& r) {
+    const auto values = shipped_values();
+
+    r.run("decode/shipped/offsets_strtoull", values.offsets.size(), [&] {
+        std::uint64_t sum = 0;
+        for (const auto& v : values.offsets) {
+            std::uint64_t n = 0;
+            sum += strtoull_hex(v, n) ? n : 0;
+        }
+        ini_bench::do_not_optimize(sum);
+    }, values.offset_bytes);
+    r.run("decode/shipped/offsets_decode_hex", values.offsets.size(), [&] {
+        std::uint64_t sum = 0;
+        for (const auto& v : values.offsets) {
+            std::uint64_t n = 0;
+            sum += ini::decode_hex(v, n) ? n : 0;
+        }
+        ini_bench::do_not_optimize(sum);
+    }, values.offset_bytes);
+
+    r.run("decode/shipped/codes_filtered", values.codes.size(), [&] {
+        std::size_t total = 0;
+        ini::ByteArray bytes;
+        for (const auto& v : values.codes) {
+            total += filtered_bytes(v, bytes) ? bytes.size : 0;
+        }
+        ini_bench::do_not_optimize(total);
+    }, values.code_bytes);
+    r.run("decode/shipped/codes_decode_bytes", values.codes.size(), [&] {
+        std::size_t total = 0;
+        ini::ByteArray bytes;
+        for (const auto& v : values.codes) {
+            total += ini::decode_bytes(v, bytes) ? bytes.size : 0;
+        }
+        ini_bench::do_not_optimize(total);
+    }, values.code_bytes);
+}
+
+INI_BENCH_WORKLOAD("decode", decode_workloads);
+
+}  // namespace
@@ -0,0 +1,64 @@
+#include "bench.hpp"
+
+#include <string>
+
+#include "ini/parser.hpp"
+
+namespace {
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+ini::Parser parsed(const std::string& text) {
+    ini::Parser p(wrapper_options());
+    p.read_string(text, "rdpwrap.ini");
+    return p;
+}
+
+// What a typical INI update looks like: [Main] gets a new date, one build
+// section is corrected and a new build is added among the old ones, which
+// shifts every section after it.
+std::string updated(std::string text) {
+    auto replace = [&](const std::string& from, const std::string& to) {
+        const auto pos = text.find(from);
+        if (pos != std::string::npos) {
+            text.replace(pos, from.size(), to);
+        }
+    };
+    replace("\nUpdated=", "\nUpdated=2099-01-01\nPrevious=");
+    replace("LocalOnlyOffset.x64=87611\n", "LocalOnlyOffset.x64=87612\n");
+    replace("\n[10.0.19041.1]\n", "\n[10.0.19040.1]\nLocalOnlyPatch.x64=1\nLocalOnlyOffset.x64=1\n\n[10.0.19041.1]\n");
+    return text;
+}
+
+// The installer's update check: both snapshots are parsed, then compared.
+void diff_workloads(ini_bench::Runner& r) {
+    const auto text = ini_bench::load_corpus("rdpwrap.ini");
+    const auto next = updated(text);
+    const auto before = parsed(text);
+    const auto same = parsed(text);
+    const auto after = parsed(next);
+    const auto sections = before.sections().size();
+
+    r.run("diff/rdpwrap.ini/identical", sections, [&] {
+        ini_bench::do_not_optimize(before.diff(same));
+    }, text.size() * 2);
+
+    r.run("diff/rdpwrap.ini/updated", sections, [&] {
+        ini_bench::do_not_optimize(before.diff(after));
+    }, text.size() + next.size());
+
+    r.run("diff/rdpwrap.ini/parse_and_diff", sections, [&] {
+        const auto old_config = parsed(text);
+        const auto new_config = parsed(next);
+        ini_bench::do_not_optimize(old_config.diff(new_config));
+    }, text.size() + next.size());
+}
+
+}  // namespace
+
+INI_BENCH_WORKLOAD("diff", diff_workloads);
@@ -0,0 +1,115 @@
+#include "bench.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ini/parser.hpp"
+
+namespace {
+
+constexpr ini::StorageMode kModes[] = {ini::StorageMode::Heap, ini::StorageMode::Arena, ini::StorageMode::Interned};
+
+const char* mode_name(ini::StorageMode mode) {
+    switch (mode) {
+    case ini::StorageMode::Heap:
+        return "heap";
+    case ini::StorageMode::Arena:
+        return "arena";
+    case ini::StorageMode::Interned:
+        return "interned";
+    }
+    return "?";
+}
+
+ini::ParseOptions wrapper_options(ini::StorageMode mode) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.storage = mode;
+    return opt;
+}
+
+// Parse-and-destroy per storage mode: B/op is what the parser holds once
+// loaded, which for the pool grows with distinct strings rather than lines.
+void memory_corpus(ini_bench::Runner& r, const char* name) {
+    const auto text = ini_bench::load_corpus(name);
+    for (const auto mode : kModes) {
+        const auto opt = wrapper_options(mode);
+        r.run(std::string("intern/") + name + "/parse_" + mode_name(mode), 1, [&] {
+            ini::Parser p(opt);
+            p.read_string(text, name);
+            ini_bench::do_not_optimize(p);
+        }, text.size());
+    }
+}
+
+// Code name keys of every build section, as Hook() reads them.
+std::vector<std::pair<std::string, std::string>> code_probes(const ini::Parser& p) {
+    std::vector<std::pair<std::string, std::string>> out;
+    for (const auto& section : p.sections()) {
+        if (section.empty() || section[0] < '0' || section[0] > '9') {
+            continue;
+        }
+        for (const char* key : {"LocalOnlyCode.x64", "SingleUserCode.x64", "DefPolicyCode.x64"}) {
+            if (p.has_option(section, key)) {
+                out.emplace_back(section, key);
+            }
+        }
+    }
+    return out;
+}
+
+void lookup_workloads(ini_bench::Runner& r) {
+    const auto text = ini_bench::load_corpus("rdpwrap.ini");
+    for (const auto mode : kModes) {
+        ini::Parser p(wrapper_options(mode));
+        p.read_string(text, "rdpwrap.ini");
+        const auto probes = code_probes(p);
+
+        r.run(std::string("intern/rdpwrap.ini/try_get_raw_") + mode_name(mode), probes.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& probe : probes) {
+                const auto v = p.try_get_raw(probe.first, probe.second);
+                bytes += v ? v->size() : 0;
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+
+        if (mode != ini::StorageMode::Interned) {
+            continue;
+        }
+        // Which builds use the same patch code as the last one: by content,
+        // and by address, which only the pool makes meaningful.
+        std::vector<std::string_view> codes;
+        for (const auto& probe : probes) {
+            codes.push_back(*p.try_get_raw(probe.first, probe.second));
+        }
+        const auto reference = codes.back();
+        r.run("intern/rdpwrap.ini/same_code_by_content", codes.size(), [&] {
+            std::size_t same = 0;
+            for (const auto code : codes) {
+                same += code == reference;
+            }
+            ini_bench::do_not_optimize(same);
+        });
+        r.run("intern/rdpwrap.ini/same_code_by_address", codes.size(), [&] {
+            std::size_t same = 0;
+            for (const auto code : codes) {
+                same += code.data() == reference.data();
+            }
+            ini_bench::do_not_optimize(same);
+        });
+    }
+}
+
+void intern_workloads(ini_bench::Runner& r) {
+    memory_corpus(r, "rdpwrap.ini");
+    memory_corpus(r, "rdpwrap-arm-kb.ini");
+    lookup_workloads(r);
+}
+
+}  // namespace
+
+INI_BENCH_WORKLOAD("intern", intern_workloads);
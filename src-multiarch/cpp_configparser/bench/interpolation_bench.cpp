@@ -0,0 +1,107 @@
+#include "bench.hpp"
+
+#include <string>
+#include <vector>
+
+#include "ini/parser.hpp"
+
+namespace {
+
+// A templated offset table: one base value built up through a chain of
+// references, and `count` offsets in one section that all refer to it.
+// Resolving an offset nests `depth` + 3 levels.
+std::string shared_table(int depth, int count) {
+    std::string text = "[Main]\nb0 = 0x1000\n";
+    for (int i = 1; i <= depth; ++i) {
+        text += "b" + std::to_string(i) + " = ${b" + std::to_string(i - 1) + "}\n";
+    }
+    text += "base = ${b" + std::to_string(depth) + "}\n[Offsets]\n";
+    for (int i = 0; i < count; ++i) {
+        text += "o" + std::to_string(i) + " = ${Main:base}+" + std::to_string(i * 16) + "\n";
+    }
+    return text;
+}
+
+// Each level refers to the one below twice, so resolving the top without
+// remembering values visits 2^levels leaves.
+std::string doubling_chain(int levels) {
+    std::string text = "[s]\nl0 = 0x10\n";
+    for (int i = 1; i <= levels; ++i) {
+        const std::string below = "${l" + std::to_string(i - 1) + "}";
+        text += "l" + std::to_string(i) + " = " + below + "," + below + "\n";
+    }
+    return text;
+}
+
+// Basic interpolation against [DEFAULT], as every build section would use it.
+std::string defaults_table(int sections) {
+    std::string text = "[DEFAULT]\narch = x64\nroot = 0x\nbase = %(root)s1000\npatch = %(base)s.%(arch)s\n";
+    for (int i = 0; i < sections; ++i) {
+        text += "[10.0." + std::to_string(19041 + i) + ".1]\noffset = %(patch)s+" + std::to_string(i) + "\n";
+    }
+    return text;
+}
+
+void interpolation_workloads(ini_bench::Runner& r) {
+    ini::ParseOptions extended;
+    extended.interpolation = ini::InterpolationMode::Extended;
+
+    {
+        constexpr int kOffsets = 1000;
+        ini::Parser p(extended);
+        p.read_string(shared_table(7, kOffsets));  // the default limit of 10
+        std::vector<std::string> names;
+        for (int i = 0; i < kOffsets; ++i) {
+            names.push_back("o" + std::to_string(i));
+        }
+        r.run("interpolation/extended/shared_base_10_levels", names.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& name : names) {
+                bytes += p.get("Offsets", name).size();
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+        r.run("interpolation/extended/shared_base_items", names.size(), [&] {
+            ini_bench::do_not_optimize(p.items("Offsets"));
+        });
+        // The same read after every change, so nothing is served twice.
+        r.run("interpolation/extended/shared_base_after_set", 1, [&] {
+            p.set("Main", "b0", std::string("0x2000"));
+            ini_bench::do_not_optimize(p.get("Offsets", "o0"));
+        });
+    }
+
+    for (const int levels : {6, 9}) {
+        ini::Parser p(extended);
+        p.read_string(doubling_chain(levels));
+        const std::string top = "l" + std::to_string(levels);
+        r.run("interpolation/extended/doubling_" + top, 1, [&] {
+            ini_bench::do_not_optimize(p.get("s", top));
+        });
+    }
+
+    {
+        constexpr int kSections = 500;
+        ini::Parser p;
+        p.read_string(defaults_table(kSections));
+        const auto sections = p.sections();
+        r.run("interpolation/basic/defaults_shared", sections.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& section : sections) {
+                bytes += p.get(section, "offset").size();
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+        r.run("interpolation/basic/plain_value", sections.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& section : sections) {
+                bytes += p.get(section, "arch").size();
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+    }
+}
+
+INI_BENCH_WORKLOAD("interpolation", interpolation_workloads);
+
+}  // namespace
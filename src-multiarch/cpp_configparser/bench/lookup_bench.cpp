@@ -0,0 +1,181 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ini/key_index.hpp"
+#include "ini/parser.hpp"
+
+namespace {
+
+// Keys the wrapper probes in every termsrv version section during Hook().
+const char* const kHookKeys[] = {
+    "LocalOnlyPatch.x64",   "LocalOnlyOffset.x64",   "LocalOnlyCode.x64",
+    "SingleUserPatch.x64",  "SingleUserOffset.x64",  "SingleUserCode.x64",
+    "DefPolicyPatch.x64",   "DefPolicyOffset.x64",   "DefPolicyCode.x64",
+    "SLPolicyInternal.x64", "SLInitHook.x64",        "SLInitOffset.x64",
+};
+
+struct Probe {
+    std::string section;
+    std::string option;
+};
+
+ini::Parser load_rdpwrap() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    ini::Parser p(opt);
+    p.read_string(ini_bench::load_corpus("rdpwrap.ini"), "rdpwrap.ini");
+    return p;
+}
+
+std::vector<Probe> hook_probes(const ini::Parser& p) {
+    std::vector<Probe> out;
+    for (const auto& s : p.sections()) {
+        if (s.empty() || s[0] < '0' || s[0] > '9') {
+            continue;
+        }
+        for (const char* key : kHookKeys) {
+            out.push_back({s, key});
+        }
+    }
+    return out;
+}
+
+// Reproduces the lookup strategy used before sections carried an index:
+// lower-case the probe into a fresh string, then scan the option list.
+const ini::OptionEntry* linear_find(const ini::SectionItems& items, std::string_view option) {
+    std::string needle(option);
+    std::transform(needle.begin(), needle.end(), needle.begin(), [](char c) {
+        return ini::OptionIndex::fold(c);
+    });
+    for (const auto& e : items) {
+        if (e.first == needle) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+void lookup_workloads(ini_bench::Runner& r) {
+    const auto parser = load_rdpwrap();
+    const auto probes = hook_probes(parser);
+
+    std::vector<ini::SectionItems> snapshots;
+    snapshots.reserve(probes.size());
+    for (const auto& probe : probes) {
+        snapshots.push_back(parser.items(probe.section, true));
+    }
+
+    r.run("lookup/rdpwrap.ini/linear_scan", probes.size(), [&] {
+        std::size_t hits = 0;
+        for (std::size_t i = 0; i < probes.size(); ++i) {
+            hits += linear_find(snapshots[i], probes[i].option) != nullptr;
+        }
+        ini_bench::do_not_optimize(hits);
+    });
+
+    r.run("lookup/rdpwrap.ini/has_option", probes.size(), [&] {
+        std::size_t hits = 0;
+        for (const auto& probe : probes) {
+            hits += parser.has_option(probe.section, probe.option);
+        }
+        ini_bench::do_not_optimize(hits);
+    });
+
+    r.run("lookup/rdpwrap.ini/section_view_at", probes.size(), [&] {
+        std::size_t hits = 0;
+        for (const auto& probe : probes) {
+            const auto view = parser.section(probe.section);
+            if (view.has_option(probe.option)) {
+                hits += view.at(probe.option).has_value();
+            }
+        }
+        ini_bench::do_not_optimize(hits);
+    });
+
+    // The wrapper's IniGetRaw pattern: has_section + has_option + get_raw.
+    r.run("lookup/rdpwrap.ini/ini_get_raw_pattern", probes.size(), [&] {
+        std::size_t bytes = 0;
+        for (const auto& probe : probes) {
+            if (parser.has_section(probe.section) &&
+                parser.has_option(probe.section, probe.option)) {
+                const auto v = parser.get_raw(probe.section, probe.option);
+                bytes += v ? v->size() : 0;
+            }
+        }
+        ini_bench::do_not_optimize(bytes);
+    });
+}
+
+// Hook() reads every key with its architecture suffix, so on one build most
+// probes miss; the miss path is measured on its own.
+std::vector<Probe> miss_probes(const ini::Parser& p) {
+    std::vector<Probe> out;
+    for (const auto& probe : hook_probes(p)) {
+        std::string option = probe.option;
+        option.replace(option.size() - 3, 3, "ARM64");
+        if (!p.has_option(probe.section, option)) {
+            out.push_back({probe.section, std::move(option)});
+        }
+    }
+    return out;
+}
+
+void hit_miss_workloads(ini_bench::Runner& r) {
+    const auto parser = load_rdpwrap();
+    std::vector<Probe> hits;
+    for (auto& probe : hook_probes(parser)) {
+        if (parser.has_option(probe.section, probe.option)) {
+            hits.push_back(std::move(probe));
+        }
+    }
+    const auto misses = miss_probes(parser);
+    const std::vector<Probe>* const sets[] = {&hits, &misses};
+
+    for (const auto* set : sets) {
+        const auto& probes = *set;
+        const std::string kind = set == &hits ? "hit" : "miss";
+
+        r.run("lookup/rdpwrap.ini/" + kind + "/get_raw_catch", probes.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& probe : probes) {
+                try {
+                    const auto v = parser.get_raw(probe.section, probe.option);
+                    bytes += v ? v->size() : 0;
+                } catch (const ini::Error&) {
+                    ++bytes;
+                }
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+
+        r.run("lookup/rdpwrap.ini/" + kind + "/ini_get_raw_pattern", probes.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& probe : probes) {
+                if (parser.has_section(probe.section) &&
+                    parser.has_option(probe.section, probe.option)) {
+                    const auto v = parser.get_raw(probe.section, probe.option);
+                    bytes += v ? v->size() : 0;
+                }
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+
+        r.run("lookup/rdpwrap.ini/" + kind + "/try_get_raw", probes.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& probe : probes) {
+                const auto v = parser.try_get_raw(probe.section, probe.option);
+                bytes += v ? v->size() : 0;
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+    }
+}
+
+INI_BENCH_WORKLOAD("lookup", lookup_workloads);
+INI_BENCH_WORKLOAD("lookup_hit_miss", hit_miss_workloads);
+
+}  // namespace
@@ -0,0 +1,132 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ini/decode.hpp"
+#include "ini/offset_table.hpp"
+#include "ini/parser.hpp"
+#include "ini/version_index.hpp"
+
+namespace {
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+struct Build {
+    std::uint64_t version;
+    std::string section;
+};
+
+// Build sections of `p` in version order, as a row-by-row reader walks them.
+std::vector<Build> builds_of(const ini::Parser& p) {
+    std::vector<Build> out;
+    for (const auto& name : p.sections()) {
+        if (const auto v = ini::parse_version(name)) {
+            out.push_back({*v, name});
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const Build& a, const Build& b) { return a.version < b.version; });
+    return out;
+}
+
+std::optional<std::uint64_t> read_offset(const ini::Parser& p, const std::string& section, const char* key) {
+    const auto raw = p.try_get_raw(section, key);
+    std::uint64_t n = 0;
+    if (raw && ini::decode_hex(*raw, n)) {
+        return n;
+    }
+    return std::nullopt;
+}
+
+// Queries over the x64 DefPolicyOffset column of rdpwrap.ini: answered by
+// reading each build section through the parser ("rows"), and by the
+// columnar table ("columns"). Both are per build scanned.
+void offset_table_workloads(ini_bench::Runner& r) {
+    ini::Parser parser(wrapper_options());
+    parser.read_string(ini_bench::load_corpus("rdpwrap.ini"), "rdpwrap.ini");
+    const auto builds = builds_of(parser);
+    const ini::OffsetTable table(parser);
+    const auto column = ini::OffsetTable::find_column("DefPolicyOffset");
+    const char* const key = "DefPolicyOffset.x64";
+
+    r.run("offset_table/rdpwrap.ini/build", table.size(), [&] {
+        const ini::OffsetTable t(parser);
+        ini_bench::do_not_optimize(t);
+    });
+
+    r.run("offset_table/rdpwrap.ini/changes_rows", builds.size(), [&] {
+        std::vector<std::size_t> out;
+        std::optional<std::uint64_t> previous;
+        for (std::size_t i = 0; i < builds.size(); ++i) {
+            const auto value = read_offset(parser, builds[i].section, key);
+            if (i > 0 && value != previous) {
+                out.push_back(i);
+            }
+            previous = value;
+        }
+        ini_bench::do_not_optimize(out);
+    });
+    r.run("offset_table/rdpwrap.ini/changes_columns", table.size(), [&] {
+        ini_bench::do_not_optimize(table.changes(ini::TargetArch::X64, column));
+    });
+
+    const std::uint64_t common = table.at(table.size() / 2, ini::TargetArch::X64, column).value_or(0);
+    r.run("offset_table/rdpwrap.ini/rows_with_rows", builds.size(), [&] {
+        std::vector<std::size_t> out;
+        for (std::size_t i = 0; i < builds.size(); ++i) {
+            if (read_offset(parser, builds[i].section, key) == common) {
+                out.push_back(i);
+            }
+        }
+        ini_bench::do_not_optimize(out);
+    });
+    r.run("offset_table/rdpwrap.ini/rows_with_columns", table.size(), [&] {
+        ini_bench::do_not_optimize(table.rows_with(ini::TargetArch::X64, column, common));
+    });
+    r.run("offset_table/rdpwrap.ini/count_present_columns", table.size(), [&] {
+        ini_bench::do_not_optimize(table.count_present(ini::TargetArch::X64, column));
+    });
+
+    // Nearest known build to versions that are not in the file: a walk over
+    // every section name against a binary search. Per query.
+    std::vector<std::uint64_t> queries;
+    for (std::size_t i = 0; i < builds.size(); i += 16) {
+        queries.push_back(builds[i].version + 1);
+    }
+    r.run("offset_table/rdpwrap.ini/nearest_rows", queries.size(), [&] {
+        std::size_t found = 0;
+        for (const auto q : queries) {
+            std::uint64_t best = 0;
+            std::uint64_t best_distance = ~std::uint64_t{0};
+            for (const auto& name : parser.sections()) {
+                if (const auto v = ini::parse_version(name)) {
+                    const auto d = *v > q ? *v - q : q - *v;
+                    if (d < best_distance) {
+                        best = *v;
+                        best_distance = d;
+                    }
+                }
+            }
+            found += best != 0;
+        }
+        ini_bench::do_not_optimize(found);
+    });
+    r.run("offset_table/rdpwrap.ini/nearest_columns", queries.size(), [&] {
+        std::size_t found = 0;
+        for (const auto q : queries) {
+            found += table.nearest(q) != ini::OffsetTable::npos;
+        }
+        ini_bench::do_not_optimize(found);
+    });
+}
+
+INI_BENCH_WORKLOAD("offset_table", offset_table_workloads);
+
+}  // namespace
@@ -0,0 +1,185 @@
+#include "bench.hpp"
+
+#include <string>
+#include <vector>
+
+#include "ini/parser.hpp"
+
+namespace {
+
+ini::ParseOptions wrapper_options() {
+    // Matches the options Hook() uses for the wrapper's configuration, except
+    // that sections load eagerly unless a workload says otherwise.
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+    return opt;
+}
+
+void parse_corpus(ini_bench::Runner& r, const char* name) {
+    const auto text = ini_bench::load_corpus(name);
+    const auto opt = wrapper_options();
+    r.run(std::string("parse/") + name + "/read_string", 1, [&] {
+        ini::Parser p(opt);
+        p.read_string(text, name);
+        ini_bench::do_not_optimize(p);
+    }, text.size());
+}
+
+// read_file in both modes; the B/op column shows the heap copies of the
+// input that the buffered path makes and the mapped path avoids.
+void read_file_corpus(ini_bench::Runner& r, const char* name) {
+    const auto path = ini_bench::corpus_path(name);
+    const auto size = ini_bench::load_corpus(name).size();
+    auto opt = wrapper_options();
+    for (const auto mode : {ini::FileReadMode::Buffered, ini::FileReadMode::Mapped}) {
+        opt.file_read_mode = mode;
+        const char* label = mode == ini::FileReadMode::Mapped ? "/read_file_mapped" : "/read_file_buffered";
+        r.run(std::string("parse/") + name + label, 1, [&] {
+            ini::Parser p(opt);
+            p.read_file(path);
+            ini_bench::do_not_optimize(p);
+        }, size);
+    }
+}
+
+// Parse-and-destroy with each storage backend.
+void storage_corpus(ini_bench::Runner& r, const char* name) {
+    const auto text = ini_bench::load_corpus(name);
+    auto opt = wrapper_options();
+    for (const auto mode : {ini::StorageMode::Heap, ini::StorageMode::Arena}) {
+        opt.storage = mode;
+        const char* label = mode == ini::StorageMode::Arena ? "/storage_arena" : "/storage_heap";
+        r.run(std::string("parse/") + name + label, 1, [&] {
+            ini::Parser p(opt);
+            p.read_string(text, name);
+            ini_bench::do_not_optimize(p);
+        }, text.size());
+    }
+}
+
+// The sections Hook() reads for one termsrv build: a fixed set plus the
+// "[<version>]" and "[<version>-SLInit]" pair, here the last one in the file.
+std::vector<std::string> hook_sections(const std::string& path) {
+    ini::Parser p(wrapper_options());
+    p.read_file(path);
+    std::vector<std::string> out = {"Main", "SLPolicy", "PatchCodes", "SLInit"};
+    const std::string suffix = "-SLInit";
+    const auto all = p.sections();
+    for (auto it = all.rbegin(); it != all.rend(); ++it) {
+        if (it->size() > suffix.size() && it->compare(it->size() - suffix.size(), suffix.size(), suffix) == 0) {
+            out.push_back(it->substr(0, it->size() - suffix.size()));
+            out.push_back(*it);
+            break;
+        }
+    }
+    return out;
+}
+
+// Eager vs lazy section loading: a bare load, and a load followed by the
+// lookups Hook() makes.
+void loading_corpus(ini_bench::Runner& r, const char* name) {
+    const auto path = ini_bench::corpus_path(name);
+    const auto size = ini_bench::load_corpus(name).size();
+    const auto touched = hook_sections(path);
+    auto opt = wrapper_options();
+    for (const auto loading : {ini::SectionLoading::Eager, ini::SectionLoading::Lazy}) {
+        opt.section_loading = loading;
+        const std::string mode = loading == ini::SectionLoading::Lazy ? "_lazy" : "_eager";
+        r.run(std::string("parse/") + name + "/load" + mode, 1, [&] {
+            ini::Parser p(opt);
+            p.read_file(path);
+            ini_bench::do_not_optimize(p);
+        }, size);
+        r.run(std::string("parse/") + name + "/hook" + mode, 1, [&] {
+            ini::Parser p(opt);
+            p.read_file(path);
+            for (const auto& sec : touched) {
+                if (p.has_section(sec)) {
+                    ini_bench::do_not_optimize(p.items(sec, true));
+                }
+            }
+        }, size);
+    }
+}
+
+// Tokenizer alone and a full parse into the arena, with the memchr/find
+// line scanning versus 64-byte SIMD blocks. The second pass enables inline
+// comments, which adds ';' and '#' to what every line is searched for.
+void scanning_corpus(ini_bench::Runner& r, const char* name) {
+    const auto text = ini_bench::load_corpus(name);
+    for (const bool inline_comments : {false, true}) {
+        auto opt = wrapper_options();
+        opt.storage = ini::StorageMode::Arena;
+        if (inline_comments) {
+            opt.inline_comment_prefixes = {";", "#"};
+        }
+        for (const auto mode : {ini::LineScanning::Scalar, ini::LineScanning::Vector}) {
+            opt.line_scanning = mode;
+            const std::string label = std::string(mode == ini::LineScanning::Vector ? ini::vector_scan_isa() : "scalar") +
+                                      (inline_comments ? "_inline_comments" : "");
+            r.run(std::string("scan/") + name + "/tokenize_" + label, 1, [&] {
+                ini::Tokenizer tokenizer(text, opt);
+                ini::Token tok;
+                std::size_t delimited = 0;
+                while (tokenizer.next(tok)) {
+                    delimited += tok.has_delimiter;
+                }
+                ini_bench::do_not_optimize(delimited);
+            }, text.size());
+            r.run(std::string("scan/") + name + "/parse_" + label, 1, [&] {
+                ini::Parser p(opt);
+                p.read_string(text, name);
+                ini_bench::do_not_optimize(p);
+            }, text.size());
+        }
+    }
+}
+
+void parse_workloads(ini_bench::Runner& r) {
+    parse_corpus(r, "rdpwrap.ini");
+    parse_corpus(r, "rdpwrap-arm-kb.ini");
+    read_file_corpus(r, "rdpwrap.ini");
+    read_file_corpus(r, "rdpwrap-arm-kb.ini");
+    storage_corpus(r, "rdpwrap.ini");
+    storage_corpus(r, "rdpwrap-arm-kb.ini");
+    loading_corpus(r, "rdpwrap.ini");
+    loading_corpus(r, "rdpwrap-arm-kb.ini");
+}
+
+// Eager read_string with parse_threads = 1, 2, 4 and 8 over a scaled
+// corpus, standing in for the merged multi-megabyte tables CI validates;
+// MB/s is the throughput to compare across thread counts.
+void parallel_corpus(ini_bench::Runner& r, const char* name, int copies) {
+    const auto text = ini_bench::scaled_corpus(name, copies);
+    auto opt = wrapper_options();
+    for (const auto mode : {ini::StorageMode::Heap, ini::StorageMode::Arena}) {
+        opt.storage = mode;
+        for (const unsigned threads : {1u, 2u, 4u, 8u}) {
+            opt.parse_threads = threads;
+            const std::string label = std::string(mode == ini::StorageMode::Arena ? "arena" : "heap") + "_threads_" +
+                                      std::to_string(threads);
+            r.run(std::string("parallel/") + name + "_x" + std::to_string(copies) + "/" + label, 1, [&] {
+                ini::Parser p(opt);
+                p.read_string(text, name);
+                ini_bench::do_not_optimize(p);
+            }, text.size());
+        }
+    }
+}
+
+void parallel_workloads(ini_bench::Runner& r) {
+    parallel_corpus(r, "rdpwrap.ini", 16);
+}
+
+void scan_workloads(ini_bench::Runner& r) {
+    scanning_corpus(r, "rdpwrap.ini");
+    scanning_corpus(r, "rdpwrap-arm-kb.ini");
+}
+
+INI_BENCH_WORKLOAD("parse", parse_workloads);
+INI_BENCH_WORKLOAD("scan", scan_workloads);
+INI_BENCH_WORKLOAD("parallel", parallel_workloads);
+
+}  // namespace
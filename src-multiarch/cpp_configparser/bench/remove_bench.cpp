@@ -0,0 +1,57 @@
+#include "bench.hpp"
+
+#include <string>
+#include <vector>
+
+#include "ini/parser.hpp"
+
+namespace {
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+// Build sections ("10.0.x.y" and "10.0.x.y-SLInit") other than those of
+// `build`, in file order.
+std::vector<std::string> other_builds(const ini::Parser& p, const std::string& build) {
+    std::vector<std::string> out;
+    for (const auto& section : p.sections()) {
+        if (!section.empty() && section[0] >= '0' && section[0] <= '9' && section.compare(0, build.size(), build) != 0) {
+            out.push_back(section);
+        }
+    }
+    return out;
+}
+
+// Trimming rdpwrap.ini down to the running build, front to back and back to
+// front. Each call works on a fresh copy; "copy" times that alone, per
+// removed section, so the difference is the cost of one removal.
+void remove_workloads(ini_bench::Runner& r) {
+    const auto text = ini_bench::load_corpus("rdpwrap.ini");
+    ini::Parser parsed(wrapper_options());
+    parsed.read_string(text, "rdpwrap.ini");
+    const auto doomed = other_builds(parsed, "10.0.19041.1");
+    const std::vector<std::string> reversed(doomed.rbegin(), doomed.rend());
+
+    r.run("remove/rdpwrap.ini/copy", doomed.size(), [&] {
+        ini::Parser p(parsed);
+        ini_bench::do_not_optimize(p);
+    });
+
+    for (const auto& [name, order] : {std::make_pair("prune_forward", &doomed), std::make_pair("prune_backward", &reversed)}) {
+        r.run(std::string("remove/rdpwrap.ini/copy_and_") + name, order->size(), [&] {
+            ini::Parser p(parsed);
+            for (const auto& section : *order) {
+                p.remove_section(section);
+            }
+            ini_bench::do_not_optimize(p);
+        });
+    }
+}
+
+}  // namespace
+
+INI_BENCH_WORKLOAD("remove", remove_workloads);
@@ -0,0 +1,127 @@
+#include "bench.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ini/parser.hpp"
+#include "ini/schema.hpp"
+#include "ini/version_index.hpp"
+#include "ini/wrapper_keys.hpp"
+
+namespace {
+
+struct Patch {
+    bool enabled = false;
+    std::uint64_t offset = 0;
+    std::string_view code;
+    ini::ByteArray code_bytes;
+};
+
+// IniGetRaw and the helpers built on it in rdpwrap_utils.cpp.
+std::string ini_get_raw(const ini::Parser& p, const std::string& sect, const char* key) {
+    try {
+        if (!p.has_section(sect) || !p.has_option(sect, key)) {
+            return "";
+        }
+        return p.get_raw(sect, key).value_or("");
+    } catch (...) {
+        return "";
+    }
+}
+
+bool get_bool(const ini::Parser& p, const std::string& sect, const char* key) {
+    const auto v = ini_get_raw(p, sect, key);
+    return !v.empty() && std::strtol(v.c_str(), nullptr, 10) != 0;
+}
+
+std::uint64_t read_hex(const ini::Parser& p, const std::string& sect, const char* key) {
+    const auto v = ini_get_raw(p, sect, key);
+    if (v.empty()) {
+        return 0;
+    }
+    errno = 0;
+    char* end = nullptr;
+    const auto n = std::strtoull(v.c_str(), &end, 16);
+    return errno == ERANGE || *end != '\0' ? 0 : n;
+}
+
+// The per-patch reads Hook() made before the schema API: flag, offset, code
+// name, then the code's bytes.
+void per_key(const ini::Parser& p, const std::string& sect, Patch& out) {
+    out.enabled = get_bool(p, sect, "LocalOnlyPatch.x64");
+    out.offset = read_hex(p, sect, "LocalOnlyOffset.x64");
+    const auto code = ini_get_raw(p, sect, "LocalOnlyCode.x64");
+    const auto bytes = ini_get_raw(p, sect, "LocalOnlyCode.x64");
+    ini::decode_bytes(bytes, out.code_bytes);
+    ini_bench::do_not_optimize(code);
+}
+
+void schema_workloads(ini_bench::Runner& r) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+    ini::Parser parser(opt);
+    parser.read_string(ini_bench::load_corpus("rdpwrap.ini"), "rdpwrap.ini");
+
+    std::vector<std::string> builds;
+    for (const auto& name : parser.sections()) {
+        if (ini::parse_version(name)) {
+            builds.push_back(name);
+        }
+    }
+
+    static const auto schema = ini::Schema<Patch>()
+        .flag("LocalOnlyPatch.x64", &Patch::enabled)
+        .hex("LocalOnlyOffset.x64", &Patch::offset)
+        .text("LocalOnlyCode.x64", &Patch::code)
+        .bytes("LocalOnlyCode.x64", &Patch::code_bytes);
+
+    r.run("schema/rdpwrap.ini/patch_per_key", builds.size(), [&] {
+        for (const auto& sect : builds) {
+            Patch patch;
+            per_key(parser, sect, patch);
+            ini_bench::do_not_optimize(patch);
+        }
+    });
+    r.run("schema/rdpwrap.ini/patch_schema", builds.size(), [&] {
+        for (const auto& sect : builds) {
+            Patch patch;
+            schema.resolve(parser, sect, patch);
+            ini_bench::do_not_optimize(patch);
+        }
+    });
+
+    // The raw lookups under the schema: names folded and hashed per call
+    // against keys done at compile time.
+    const std::string_view names[] = {"LocalOnlyPatch.x64", "LocalOnlyOffset.x64", "LocalOnlyCode.x64",
+                                      "SLPolicyInternal.x64"};
+    static constexpr ini::StaticKey kKeys[] = {
+        ini::arch_key<ini::TargetArch::X64>("LocalOnlyPatch"),
+        ini::arch_key<ini::TargetArch::X64>("LocalOnlyOffset"),
+        ini::arch_key<ini::TargetArch::X64>("LocalOnlyCode"),
+        ini::arch_key<ini::TargetArch::X64>("SLPolicyInternal"),
+    };
+    r.run("schema/rdpwrap.ini/batch_names", builds.size() * std::size(names), [&] {
+        std::optional<std::string_view> values[std::size(names)];
+        for (const auto& sect : builds) {
+            parser.get_raw_batch(sect, names, std::size(names), values);
+            ini_bench::do_not_optimize(values);
+        }
+    });
+    r.run("schema/rdpwrap.ini/batch_static_keys", builds.size() * std::size(kKeys), [&] {
+        std::optional<std::string_view> values[std::size(kKeys)];
+        for (const auto& sect : builds) {
+            parser.get_raw_batch(sect, kKeys, std::size(kKeys), values);
+            ini_bench::do_not_optimize(values);
+        }
+    });
+}
+
+INI_BENCH_WORKLOAD("schema", schema_workloads);
+
+}  // namespace
@@ -0,0 +1,173 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ini/parser.hpp"
+
+namespace {
+
+// The two shipped files at their own size and scaled up 10 and 100 times,
+// so a change that only shows on large tables is still caught. Names are
+// "suite/<file>[_x<copies>]/<operation>".
+const char* const kCorpora[] = {"rdpwrap.ini", "rdpwrap-arm-kb.ini"};
+const int kScales[] = {1, 10, 100};
+
+// Lookups sample at most this many options, evenly spread over the file.
+constexpr std::size_t kMaxProbes = 1 << 16;
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+struct Probe {
+    std::string section;
+    std::string option;
+};
+
+std::vector<Probe> sample_options(const ini::Parser& p) {
+    std::size_t total = 0;
+    for (const auto& section : p.sections()) {
+        total += p.options(section).size();
+    }
+    const std::size_t stride = std::max<std::size_t>(1, (total + kMaxProbes - 1) / kMaxProbes);
+    std::vector<Probe> out;
+    std::size_t i = 0;
+    for (const auto& section : p.sections()) {
+        for (auto& option : p.options(section)) {
+            if (i++ % stride == 0) {
+                out.push_back({section, std::move(option)});
+            }
+        }
+    }
+    return out;
+}
+
+// A chain of references per copy for the interpolation workload; the
+// shipped files have none. "v8" resolves through seven others to the base.
+std::string reference_sections(int copies) {
+    std::string out;
+    for (int i = 0; i < copies; ++i) {
+        out += "[vars" + std::to_string(i) + "]\nbase = 0x1000\n";
+        for (int v = 1; v <= 8; ++v) {
+            out += "v" + std::to_string(v) + " = %(" + (v == 1 ? std::string("base") : "v" + std::to_string(v - 1)) +
+                   ")s0\n";
+        }
+    }
+    return out;
+}
+
+void suite_corpus(ini_bench::Runner& r, const char* name, int copies) {
+    const std::string prefix =
+        std::string("suite/") + name + (copies == 1 ? "" : "_x" + std::to_string(copies)) + "/";
+    const auto text = ini_bench::scaled_corpus(name, copies);
+    const auto opt = wrapper_options();
+
+    r.run(prefix + "parse", 1, [&] {
+        ini::Parser p(opt);
+        p.read_string(text, name);
+        ini_bench::do_not_optimize(p);
+    }, text.size());
+
+    ini::Parser parser(opt);
+    parser.read_string(text, name);
+
+    const auto hits = sample_options(parser);
+    std::vector<Probe> misses = hits;
+    for (auto& probe : misses) {
+        probe.option += ".missing";
+    }
+    const std::vector<Probe>* const sets[] = {&hits, &misses};
+    for (const auto* set : sets) {
+        r.run(prefix + (set == &hits ? "lookup_hit" : "lookup_miss"), set->size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& probe : *set) {
+                const auto v = parser.try_get_raw(probe.section, probe.option);
+                bytes += v ? v->size() + 1 : 0;
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+    }
+
+    // get() with basic interpolation: the sampled plain values, which only
+    // need scanning for '%', and the reference chains.
+    {
+        auto interp_opt = opt;
+        interp_opt.interpolation = ini::InterpolationMode::Basic;
+        ini::Parser interp(interp_opt);
+        interp.read_string(text + reference_sections(copies), name);
+        r.run(prefix + "interpolate_plain", hits.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& probe : hits) {
+                bytes += interp.get(probe.section, probe.option).size();
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+        std::vector<std::string> chains;
+        for (int i = 0; i < copies; ++i) {
+            chains.push_back("vars" + std::to_string(i));
+        }
+        r.run(prefix + "interpolate_refs", chains.size(), [&] {
+            std::size_t bytes = 0;
+            for (const auto& section : chains) {
+                bytes += interp.get(section, "v8").size();
+            }
+            ini_bench::do_not_optimize(bytes);
+        });
+    }
+
+    // Every option of every section, in order; per option.
+    const auto sections = parser.sections();
+    std::size_t options = 0;
+    for (const auto& section : sections) {
+        options += parser.options(section).size();
+    }
+    r.run(prefix + "iterate", options, [&] {
+        std::size_t bytes = 0;
+        for (const auto& section : sections) {
+            for (const auto& [key, value] : parser.section(section).items()) {
+                bytes += key.size() + (value ? value->size() : 0);
+            }
+        }
+        ini_bench::do_not_optimize(bytes);
+    });
+
+    const auto written = parser.write_to_string().size();
+    r.run(prefix + "serialize", 1, [&] {
+        ini_bench::do_not_optimize(parser.write_to_string());
+    }, written);
+
+    // Every other section removed from a fresh copy; "copy" times the copy
+    // alone, per removed section, so the difference is one removal.
+    std::vector<std::string> doomed;
+    for (std::size_t i = 0; i < sections.size(); i += 2) {
+        doomed.push_back(sections[i]);
+    }
+    r.run(prefix + "copy", doomed.size(), [&] {
+        ini::Parser p(parser);
+        ini_bench::do_not_optimize(p);
+    });
+    r.run(prefix + "copy_and_remove", doomed.size(), [&] {
+        ini::Parser p(parser);
+        for (const auto& section : doomed) {
+            p.remove_section(section);
+        }
+        ini_bench::do_not_optimize(p);
+    });
+}
+
+void suite_workloads(ini_bench::Runner& r) {
+    for (const int copies : kScales) {
+        for (const char* name : kCorpora) {
+            suite_corpus(r, name, copies);
+        }
+    }
+}
+
+INI_BENCH_WORKLOAD("suite", suite_workloads);
+
+}  // namespace
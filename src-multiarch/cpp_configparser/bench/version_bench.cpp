@@ -0,0 +1,82 @@
+#include "bench.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ini/compiled_config.hpp"
+#include "ini/parser.hpp"
+#include "ini/version_index.hpp"
+#include "rdpwrap_versions.hpp"
+
+namespace {
+
+struct Version {
+    unsigned major, minor, release, build;
+};
+
+// Every build section version of rdpwrap.ini, then as many that are absent.
+std::vector<Version> probe_versions() {
+    std::vector<Version> out;
+    for (std::size_t slot = 0; slot < rdpwrap_versions::kVersionCount; ++slot) {
+        const auto v = rdpwrap_versions::kVersions[slot];
+        out.push_back({static_cast<unsigned>(v >> 48), static_cast<unsigned>((v >> 32) & 0xFFFF),
+                       static_cast<unsigned>((v >> 16) & 0xFFFF), static_cast<unsigned>(v & 0xFFFF)});
+    }
+    const auto present = out.size();
+    for (std::size_t i = 0; i < present; ++i) {
+        auto v = out[i];
+        v.build ^= 0x8000;
+        out.push_back(v);
+    }
+    return out;
+}
+
+std::uint64_t packed(const Version& v) {
+    return ini::pack_version(static_cast<std::uint16_t>(v.major), static_cast<std::uint16_t>(v.minor),
+                             static_cast<std::uint16_t>(v.release), static_cast<std::uint16_t>(v.build));
+}
+
+// Hook() finding the termsrv build: formatting the section name and asking
+// the parser, against the generated perfect hash and the compiled blob.
+void version_workloads(ini_bench::Runner& r) {
+    const auto text = ini_bench::load_corpus("rdpwrap.ini");
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+    opt.section_loading = ini::SectionLoading::Lazy;
+    ini::Parser parser(opt);
+    parser.read_string(text);
+    const auto blob = ini::compile_config(text, opt);
+    const ini::CompiledConfig compiled(blob);
+    const auto probes = probe_versions();
+
+    r.run("version/rdpwrap.ini/format_has_section", probes.size(), [&] {
+        std::size_t hits = 0;
+        for (const auto& v : probes) {
+            char sect[64];
+            std::snprintf(sect, sizeof(sect), "%u.%u.%u.%u", v.major, v.minor, v.release, v.build);
+            hits += parser.has_section(sect) ? 1 : 0;
+        }
+        ini_bench::do_not_optimize(hits);
+    });
+    r.run("version/rdpwrap.ini/perfect_hash", probes.size(), [&] {
+        std::size_t hits = 0;
+        for (const auto& v : probes) {
+            hits += rdpwrap_versions::kVersionIndex.find(packed(v)) != ini::VersionIndexView::npos ? 1 : 0;
+        }
+        ini_bench::do_not_optimize(hits);
+    });
+    r.run("version/rdpwrap.ini/compiled_blob", probes.size(), [&] {
+        std::size_t hits = 0;
+        for (const auto& v : probes) {
+            hits += compiled.has_version(packed(v)) ? 1 : 0;
+        }
+        ini_bench::do_not_optimize(hits);
+    });
+}
+
+INI_BENCH_WORKLOAD("version", version_workloads);
+
+}  // namespace
@@ -0,0 +1,60 @@
+#include "bench.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "ini/parser.hpp"
+
+namespace {
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+// The previous serialiser: one ostringstream, values copied to fold them.
+std::string ostream_write(const ini::Parser& p) {
+    std::ostringstream oss;
+    for (const auto& name : p.sections()) {
+        oss << '[' << name << "]\n";
+        for (const auto& [key, value] : p.section(name).items()) {
+            std::string v = value.value_or("");
+            std::string::size_type pos = 0;
+            while ((pos = v.find('\n', pos)) != std::string::npos) {
+                v.replace(pos, 1, "\n\t");
+                pos += 2;
+            }
+            oss << key << " = " << v << '\n';
+        }
+        oss << '\n';
+    }
+    return oss.str();
+}
+
+void write_workloads(ini_bench::Runner& r) {
+    const auto text = ini_bench::load_corpus("rdpwrap.ini");
+    ini::Parser p(wrapper_options());
+    p.read_string(text, "rdpwrap.ini");
+    const auto size = p.write_to_string().size();
+    const auto sections = p.sections().size();
+
+    r.run("write/rdpwrap.ini/ostringstream", sections, [&] {
+        ini_bench::do_not_optimize(ostream_write(p));
+    }, size);
+
+    r.run("write/rdpwrap.ini/write_to_string", sections, [&] {
+        ini_bench::do_not_optimize(p.write_to_string());
+    }, size);
+
+    r.run("write/rdpwrap.ini/write_sink", sections, [&] {
+        std::size_t bytes = 0;
+        p.write([&](std::string_view chunk) { bytes += chunk.size(); });
+        ini_bench::do_not_optimize(bytes);
+    }, size);
+}
+
+}  // namespace
+
+INI_BENCH_WORKLOAD("write", write_workloads);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "ini/parser.hpp"
+#include "ini/version_index.hpp"
+#include "ini/wrapper_keys.hpp"
+
+namespace ini {
+
+// Precompiled form of an RDP Wrapper configuration (rdpwrap.ini or
+// rdpwrap-arm-kb.ini). It keeps exactly what the wrapper's Hook() reads,
+// laid out so that the termsrv build is found with a perfect-hash lookup and
+// without parsing any text:
+//
+//   header       magic, format version, size and hash of the source INI,
+//                hash of everything after the header, table locations
+//   strings      every distinct string once, referenced as (offset, length)
+//   sections     all sections other than build sections and [PatchCodes],
+//                with their options verbatim
+//   patch codes  [PatchCodes], sorted by lower-cased name
+//   versions     one entry per "[a.b.c.d]" / "[a.b.c.d-SLInit]" pair, in
+//                the slot order of a VersionIndex over pack_version()
+//   displacements  that VersionIndex's per-bucket displacements
+//   records      fixed-width per-architecture values of one version
+//
+// Build-section keys that Hook() never reads are dropped, and the values it
+// does read are stored the way it interprets them (hex offsets as numbers,
+// flags as bits). All integers are little-endian.
+
+// Hash of a source INI as recorded in the blob header. Only meant to notice
+// that the INI changed since the blob was built.
+std::uint64_t config_source_hash(std::string_view text) noexcept;
+
+// Parses `text` with `options` and returns the compiled blob. Parse errors
+// propagate as from Parser::read_string.
+std::string compile_config(std::string_view text, const ParseOptions& options);
+
+// Read-only view of a compiled blob. The buffer must outlive the object.
+class CompiledConfig {
+public:
+    // Checks the header, the payload hash and that every table lies inside
+    // `blob`. Throws ini::Error with ErrorCode::InvalidCompiledConfig.
+    explicit CompiledConfig(std::string_view blob);
+
+    // True when the blob was compiled from exactly `text`.
+    bool matches_source(std::string_view text) const noexcept;
+
+    std::size_t version_count() const noexcept { return versions_.count; }
+    bool has_version(std::uint64_t version) const noexcept;
+
+    // Adds the shared sections to `out` and, when the blob knows `version`,
+    // that build's "[a.b.c.d]" and "[a.b.c.d-SLInit]" sections holding the
+    // `arch` keys, so that `out` answers every query Hook() makes the same
+    // way a parser that read the source INI would.
+    void load(Parser& out, std::uint64_t version, TargetArch arch) const;
+
+private:
+    struct Table {
+        std::size_t offset = 0;
+        std::size_t count = 0;
+    };
+
+    std::string_view string_at(std::size_t ref_offset) const;
+    std::size_t find_version(std::uint64_t version) const noexcept;
+    std::uint32_t displacement(std::size_t bucket) const noexcept;
+
+    std::string_view blob_;
+    std::uint64_t source_size_ = 0;
+    std::uint64_t source_hash_ = 0;
+    Table strings_;
+    Table sections_;
+    Table options_;
+    Table patch_codes_;
+    Table versions_;
+    Table records_;
+    Table displacements_;
+};
+
+}  // namespace ini
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "ini/parser.hpp"
+
+namespace ini {
+
+// Up to 255 bytes written as hex digit pairs, e.g. "B8 00 01 00 00".
+struct ByteArray {
+    std::uint8_t size = 0;
+    std::uint8_t data[255] = {};
+};
+
+// Value decoders with the semantics of RDP Wrapper's INI helpers. Each
+// returns false, leaving `out` untouched, when `value` does not decode.
+//
+// decode_flag: true when the leading decimal integer is non-zero, as
+//   strtol(value, nullptr, 10) != 0; never fails.
+// decode_decimal: the leading decimal integer as a 32-bit
+//   strtoul(value, nullptr, 10) reads it, negatives wrapping and overflow
+//   saturating; never fails.
+// decode_hex: the whole value read as strtoull(value, &end, 16) would,
+//   failing on overflow, trailing characters or no digits.
+// decode_bytes: hex digit pairs, ignoring ' ', '\t', ',' and '-'; fails on
+//   an odd digit count, a non-hex character or more than 255 bytes.
+bool decode_flag(std::string_view value, bool& out) noexcept;
+bool decode_decimal(std::string_view value, std::uint32_t& out) noexcept;
+bool decode_hex(std::string_view value, std::uint64_t& out) noexcept;
+bool decode_bytes(std::string_view value, ByteArray& out) noexcept;
+
+// Typed reads through Parser::try_get_raw(). An option that is missing, has
+// no value, is empty or does not decode gives nullopt (false for
+// read_bytes, with `out` untouched). None of them throws.
+std::optional<bool> read_flag(const Parser& parser, std::string_view section, std::string_view option) noexcept;
+std::optional<std::uint32_t> read_decimal(
+    const Parser& parser,
+    std::string_view section,
+    std::string_view option) noexcept;
+std::optional<std::uint64_t> read_hex(const Parser& parser, std::string_view section, std::string_view option) noexcept;
+bool read_bytes(const Parser& parser, std::string_view section, std::string_view option, ByteArray& out) noexcept;
+
+}  // namespace ini
@@ -18,6 +18,7 @@ enum class ErrorCode {
     InterpolationDepth,
     InvalidWrite,
     Parsing,
+    InvalidCompiledConfig,
 };
 
 class Error : public std::runtime_error {
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace ini {
+
+// Open-addressing hash index over an externally owned, insertion-ordered
+// entry list. The index only stores (hash, position) pairs; keys are read back
+// through a caller-supplied accessor, so the owning container keeps its order
+// and nothing on the lookup path allocates.
+//
+// With FoldCase the hash and comparison treat ASCII letters case-insensitively,
+// which matches how option names are normalised by Parser::option_xform.
+// Slots are allocated from the given memory resource so an index can live in
+// the same arena as the entries it describes.
+template <bool FoldCase>
+class BasicKeyIndex {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    BasicKeyIndex() = default;
+    explicit BasicKeyIndex(std::pmr::memory_resource* resource) : slots_(resource) {}
+
+    static constexpr char fold(char c) noexcept {
+        if constexpr (FoldCase) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        } else {
+            return c;
+        }
+    }
+
+    static constexpr std::uint32_t hash(std::string_view key) noexcept {
+        std::uint32_t h = 2166136261u;
+        for (char c : key) {
+            h ^= static_cast<unsigned char>(fold(c));
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    static constexpr bool equal(std::string_view a, std::string_view b) noexcept {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            if (fold(a[i]) != fold(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    void clear() noexcept {
+        slots_.clear();
+        size_ = 0;
+    }
+
+    // Returns the position of `key` in the indexed container, or npos.
+    template <class KeyAt>
+    std::size_t find(std::string_view key, KeyAt&& key_at) const noexcept {
+        return find(key, hash(key), key_at);
+    }
+
+    template <class KeyAt>
+    std::size_t find(std::string_view key, std::uint32_t h, KeyAt&& key_at) const noexcept {
+        if (slots_.empty()) {
+            return npos;
+        }
+        const std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots_[i];
+            if (slot.pos == kEmpty) {
+                return npos;
+            }
+            if (slot.hash == h && equal(key_at(slot.pos), key)) {
+                return slot.pos;
+            }
+        }
+    }
+
+    // find() for a key already passed through fold(), against entries whose
+    // keys are stored folded as well: names compare byte for byte.
+    template <class KeyAt>
+    std::size_t find_folded(std::string_view key, std::uint32_t h, KeyAt&& key_at) const noexcept {
+        if (slots_.empty()) {
+            return npos;
+        }
+        const std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots_[i];
+            if (slot.pos == kEmpty) {
+                return npos;
+            }
+            if (slot.hash == h && key_at(slot.pos) == key) {
+                return slot.pos;
+            }
+        }
+    }
+
+    // Records that the key hashing to `h` lives at `pos`. The caller is
+    // responsible for making sure the key is not already present.
+    void insert(std::uint32_t h, std::size_t pos) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            grow(slots_.empty() ? kMinCapacity : slots_.size() * 2);
+        }
+        place(h, static_cast<std::uint32_t>(pos));
+        ++size_;
+    }
+
+    void insert(std::string_view key, std::size_t pos) { insert(hash(key), pos); }
+
+    // Forgets the entry at `pos`, whose key hashes to `h`; other positions
+    // are unchanged. Entries after it in the probe run are shifted back so
+    // lookups never need tombstones.
+    void erase(std::uint32_t h, std::size_t pos) noexcept {
+        if (slots_.empty()) {
+            return;
+        }
+        const std::size_t mask = slots_.size() - 1;
+        std::size_t hole = h & mask;
+        while (slots_[hole].pos != static_cast<std::uint32_t>(pos)) {
+            if (slots_[hole].pos == kEmpty) {
+                return;
+            }
+            hole = (hole + 1) & mask;
+        }
+        for (std::size_t i = (hole + 1) & mask; slots_[i].pos != kEmpty; i = (i + 1) & mask) {
+            // An entry may fill the hole unless its home slot lies after the
+            // hole, up to where it sits now.
+            const std::size_t home = slots_[i].hash & mask;
+            const bool stays = hole < i ? (hole < home && home <= i) : (hole < home || home <= i);
+            if (!stays) {
+                slots_[hole] = slots_[i];
+                hole = i;
+            }
+        }
+        slots_[hole] = Slot{};
+        --size_;
+    }
+
+    // Re-creates the index for `count` entries; used after positions shift.
+    template <class KeyAt>
+    void rebuild(std::size_t count, KeyAt&& key_at) {
+        clear();
+        if (count == 0) {
+            return;
+        }
+        std::size_t capacity = kMinCapacity;
+        while (capacity < count * 2) {
+            capacity *= 2;
+        }
+        slots_.assign(capacity, Slot{});
+        for (std::size_t i = 0; i < count; ++i) {
+            place(hash(key_at(i)), static_cast<std::uint32_t>(i));
+        }
+        size_ = count;
+    }
+
+private:
+    static constexpr std::uint32_t kEmpty = 0xFFFFFFFFu;
+    static constexpr std::size_t kMinCapacity = 8;
+
+    struct Slot {
+        std::uint32_t hash = 0;
+        std::uint32_t pos = kEmpty;
+    };
+
+    void place(std::uint32_t h, std::uint32_t pos) noexcept {
+        const std::size_t mask = slots_.size() - 1;
+        std::size_t i = h & mask;
+        while (slots_[i].pos != kEmpty) {
+            i = (i + 1) & mask;
+        }
+        slots_[i] = Slot{h, pos};
+    }
+
+    void grow(std::size_t capacity) {
+        std::pmr::vector<Slot> old(capacity, Slot{}, slots_.get_allocator());
+        old.swap(slots_);
+        for (const Slot& slot : old) {
+            if (slot.pos != kEmpty) {
+                place(slot.hash, slot.pos);
+            }
+        }
+    }
+
+    std::pmr::vector<Slot> slots_;
+    std::size_t size_ = 0;
+};
+
+using OptionIndex = BasicKeyIndex<true>;
+using SectionIndex = BasicKeyIndex<false>;
+
+}  // namespace ini
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace ini {
+
+// Read-only view of a whole file backed by mmap (POSIX) or a file mapping
+// object (Windows). The contents stay valid until the object is destroyed.
+// Opening or mapping failures throw ini::Error with ErrorCode::Parsing.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(std::string_view path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const noexcept {
+        return {static_cast<const char*>(data_), size_};
+    }
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    void reset() noexcept;
+
+    const void* data_ = nullptr;
+    std::size_t size_ = 0;
+#if defined(_WIN32)
+    void* mapping_ = nullptr;
+#endif
+};
+
+}  // namespace ini
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "ini/parser.hpp"
+#include "ini/wrapper_keys.hpp"
+
+namespace ini {
+
+// The hex offsets of every build in a configuration as a dense table: the
+// build versions sorted ascending (pack_version() order), and for each
+// architecture and offset key one array holding that key's value for every
+// build. Columns are the build-section offsets (kWrapperOffsetKeys) followed
+// by the CSLQuery member offsets of "[a.b.c.d-SLInit]" (kWrapperSLInitKeys).
+//
+// The table is a snapshot: later changes to the parser are not seen.
+// Queries over a column are linear scans of one contiguous array.
+class OffsetTable {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    static constexpr std::size_t kArchCount = 4;
+    static constexpr std::size_t kColumnCount = std::size(kWrapperOffsetKeys) + std::size(kWrapperSLInitKeys);
+
+    OffsetTable() = default;
+
+    // Reads every "[a.b.c.d]" and "[a.b.c.d-SLInit]" section of `config`,
+    // with the same [DEFAULT] fallback Parser::get_raw() applies. A build
+    // with only one of the two sections has the other's columns absent.
+    explicit OffsetTable(const Parser& config);
+
+    std::size_t size() const noexcept { return versions_.size(); }
+    bool empty() const noexcept { return versions_.empty(); }
+
+    // Packed versions, one per row, ascending.
+    const std::vector<std::uint64_t>& versions() const noexcept { return versions_; }
+
+    // Key name of `column` without its architecture suffix, e.g.
+    // "DefPolicyOffset" or "bServerSku".
+    static std::string_view column_name(std::size_t column) noexcept;
+    // Column of a key name as column_name() gives it, compared the way
+    // option names are (ASCII case-insensitively); npos when unknown.
+    static std::size_t find_column(std::string_view name) noexcept;
+
+    // size() values of column `col` on `arch`, in row order. A key the
+    // build does not set, or sets to something that is not a hex number,
+    // reads as 0 here and as 0 in present().
+    const std::uint64_t* column(TargetArch arch, std::size_t col) const noexcept {
+        return values_.data() + cell(0, arch, col);
+    }
+    // size() flags of column `col` on `arch`, in row order: 1 where the
+    // build sets the key to a hex number, whatever its value.
+    const std::uint8_t* present(TargetArch arch, std::size_t col) const noexcept {
+        return present_.data() + cell(0, arch, col);
+    }
+    std::optional<std::uint64_t> at(std::size_t row, TargetArch arch, std::size_t col) const noexcept {
+        const std::size_t i = cell(row, arch, col);
+        return present_[i] ? std::optional<std::uint64_t>(values_[i]) : std::nullopt;
+    }
+
+    // Row of `version`, or npos.
+    std::size_t find(std::uint64_t version) const noexcept;
+    // Row of the newest build not newer than `version`, or npos when every
+    // build is newer.
+    std::size_t floor(std::uint64_t version) const noexcept;
+    // Row of the build closest to `version` in pack_version() order: the
+    // floor() or the next newer build, whichever is nearer, the older one
+    // on a tie. npos only when the table is empty.
+    std::size_t nearest(std::uint64_t version) const noexcept;
+
+    // Rows whose value of column `col` on `arch` differs from the row
+    // before; row 0 is never included. Appearing and disappearing count as
+    // changes.
+    std::vector<std::size_t> changes(TargetArch arch, std::size_t col) const;
+    // Rows where column `col` on `arch` is present and equals `value`.
+    std::vector<std::size_t> rows_with(TargetArch arch, std::size_t col, std::uint64_t value) const;
+    // Number of rows where column `col` on `arch` is present.
+    std::size_t count_present(TargetArch arch, std::size_t col) const noexcept;
+
+private:
+    std::size_t cell(std::size_t row, TargetArch arch, std::size_t col) const noexcept {
+        return (static_cast<std::size_t>(arch) * kColumnCount + col) * versions_.size() + row;
+    }
+
+    std::vector<std::uint64_t> versions_;
+    // kArchCount * kColumnCount columns of size() values each, arch-major,
+    // and beside them whether each cell is set. Every 64-bit value is a
+    // legitimate offset, so absence cannot be one of them.
+    std::vector<std::uint64_t> values_;
+    std::vector<std::uint8_t> present_;
+};
+
+}  // namespace ini
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "ini/error.hpp"
+#include "ini/static_key.hpp"
+#include "ini/tokenizer.hpp"
 
 namespace ini {
 
@@ -21,6 +25,22 @@ enum class InterpolationMode {
     Extended,
 };
 
+enum class FileReadMode {
+    Buffered,  // read the whole file into one heap buffer, then parse it
+    Mapped,    // parse straight out of a read-only mapping of the file
+};
+
+enum class StorageMode {
+    Heap,      // every section name, long key and long value is its own heap allocation
+    Arena,     // all stored text and tables share a few large blocks
+    Interned,  // Arena, with each distinct key and value text stored only once
+};
+
+enum class SectionLoading {
+    Eager,  // parse every section while reading
+    Lazy,   // index section headers while reading, parse a section on first use
+};
+
 struct ParseOptions {
     bool allow_no_value = false;
     bool strict = true;
@@ -35,12 +55,101 @@ struct ParseOptions {
 
     InterpolationMode interpolation = InterpolationMode::Basic;
     int max_interpolation_depth = kDefaultInterpolationDepth;
+
+    FileReadMode file_read_mode = FileReadMode::Mapped;
+
+    // With StorageMode::Arena and StorageMode::Interned, memory released by
+    // set()/remove_*() is only reclaimed by clear() or when the parser is
+    // destroyed. With StorageMode::Interned, the views find(), try_get_raw()
+    // and get_raw_batch() hand out point into the parser's string pool, so
+    // two of them are equal exactly when their data() pointers are.
+    StorageMode storage = StorageMode::Heap;
+
+    // With SectionLoading::Lazy, syntax errors and strict-mode duplicate
+    // options inside a section are reported by the first call that touches
+    // it rather than by read_string()/read_file(). Because that first touch
+    // fills the section in, const member functions are then no longer safe
+    // to call concurrently, unless every section they read has been touched
+    // first, e.g. through section(). Input whose layout depends on parser
+    // state (an indented "[header]", an empty "[]") is parsed eagerly.
+    SectionLoading section_loading = SectionLoading::Eager;
+
+    // How the tokenizer looks for line ends, delimiters and inline comments.
+    // Both settings produce identical results.
+    LineScanning line_scanning = LineScanning::Vector;
+
+    // Threads an eager read_string()/read_file() may spread a large input
+    // over; 0 means one per hardware thread. The input is cut at section
+    // headers, the pieces are parsed side by side and merged back in order,
+    // so the result and any error thrown are those of a sequential read.
+    // Inputs under a few hundred KiB are always read on the calling thread.
+    unsigned parse_threads = 1;
+};
+
+struct StorageStats {
+    std::size_t arena_bytes_used = 0;      // bytes handed out by the arena
+    std::size_t arena_bytes_reserved = 0;  // bytes the arena took from the heap
+    std::size_t arena_blocks = 0;
+    std::size_t interned_strings = 0;      // distinct texts in the string pool
+    std::size_t interned_bytes = 0;        // their total length
 };
 
+// Receives write() output, one chunk per call, in order.
+using WriteSink = std::function<void(std::string_view chunk)>;
+
 using OptionValue = std::optional<std::string>;
 using OptionEntry = std::pair<std::string, OptionValue>;
 using SectionItems = std::vector<OptionEntry>;
 
+enum class ChangeKind {
+    Added,     // only in the newer parser
+    Removed,   // only in the older parser
+    Modified,  // in both, with a different value or different options
+};
+
+struct OptionChange {
+    std::string option;
+    ChangeKind kind = ChangeKind::Modified;
+    OptionValue before;  // nullopt when added
+    OptionValue after;   // nullopt when removed
+};
+
+struct SectionChange {
+    std::string section;
+    ChangeKind kind = ChangeKind::Modified;
+    // Options that differ; every option of an added or removed section.
+    std::vector<OptionChange> options;
+};
+
+// Result of Parser::diff(). Sections and options are listed in the older
+// parser's order, followed by those only the newer one has in its order.
+struct ConfigDiff {
+    std::vector<SectionChange> sections;
+
+    bool empty() const noexcept { return sections.empty(); }
+
+    const SectionChange* find(std::string_view section) const noexcept {
+        for (const auto& change : sections) {
+            if (change.section == section) {
+                return &change;
+            }
+        }
+        return nullptr;
+    }
+};
+
+namespace detail {
+struct InterpolationFrame;
+struct OptionTable;
+struct SectionData;
+struct Storage;
+}  // namespace detail
+
+// Read-only handle to one section's own options (defaults are not merged in),
+// either one Parser::section() returns or one over caller-owned items.
+// Valid until the section is removed or the parser is cleared or destroyed.
+// The references at() and items() return into a parser's section stay
+// valid until that section is next modified.
 class SectionView {
 public:
     SectionView() = default;
@@ -51,13 +160,25 @@ public:
     const SectionItems& items() const;
 
 private:
+    friend class Parser;
+    explicit SectionView(const detail::OptionTable* table) : table_(table) {}
+
     const SectionItems* items_ = nullptr;
+    const detail::OptionTable* table_ = nullptr;
 };
 
 class Parser {
 public:
     explicit Parser(ParseOptions options = {});
+    ~Parser();
+
+    Parser(const Parser& other);
+    Parser& operator=(const Parser& other);
+    Parser(Parser&& other) noexcept;
+    Parser& operator=(Parser&& other) noexcept;
 
+    // Drops all sections and options. In arena mode this returns every arena
+    // block to the heap in one go.
     void clear();
 
     void add_section(std::string section);
@@ -65,6 +186,8 @@ public:
     bool has_section(std::string_view section) const;
     bool has_option(std::string_view section, std::string_view option) const;
 
+    SectionView section(std::string_view section) const;
+
     std::vector<std::string> sections() const;
     std::vector<std::string> options(std::string_view section) const;
 
@@ -79,60 +202,125 @@ public:
 
     SectionItems items(std::string_view section, bool raw = false) const;
 
+    // Exception-free lookups for probing options that may well be absent.
+    // find() reports whether get_raw() would find `option`, including the
+    // default section fallback, and stores a view of its value (nullopt for
+    // a no-value option) in `*value`. try_get_raw() returns that value,
+    // nullopt when the option is missing or has none. Nothing is found when
+    // the deferred parse of `section` fails. Views stay valid until the
+    // parser is next modified.
+    bool find(
+        std::string_view section,
+        std::string_view option,
+        std::optional<std::string_view>* value = nullptr) const noexcept;
+    std::optional<std::string_view> try_get_raw(std::string_view section, std::string_view option) const noexcept;
+
+    // Batch form of get_raw() for reading many options of one section, as
+    // ini::Schema does: the section is looked up once, and values[i] is set
+    // to a view of the stored value of options[i], or nullopt when that
+    // option is missing or has no value. Views stay valid until the parser
+    // is next modified. Returns false, with every value nullopt, when the
+    // section does not exist or its deferred parse fails. Never throws.
+    bool get_raw_batch(
+        std::string_view section,
+        const std::string_view* options,
+        std::size_t count,
+        std::optional<std::string_view>* values) const noexcept;
+    // The same for keys lower-cased and hashed ahead of time, such as those
+    // of ini/wrapper_keys.hpp: nothing is folded or hashed per lookup.
+    bool get_raw_batch(
+        std::string_view section,
+        const StaticKey* options,
+        std::size_t count,
+        std::optional<std::string_view>* values) const noexcept;
+
     void set(std::string_view section, std::string option, OptionValue value);
 
     bool remove_option(std::string_view section, std::string_view option);
     bool remove_section(std::string_view section);
 
+    // Serialises every section in INI syntax. The output is validated and
+    // sized before anything is written, so an InvalidWrite error leaves the
+    // sink untouched; write() hands it over in chunks of up to 64 KiB.
     std::string write_to_string(bool space_around_delimiters = true) const;
+    void write(const WriteSink& sink, bool space_around_delimiters = true) const;
+    void write_file(std::string_view path, bool space_around_delimiters = true) const;
+
+    // What changed from this parser's contents to `newer`'s. Sections are
+    // matched by name and options by their stored (lower-cased) key, and raw
+    // values are compared: nothing is interpolated and the default section
+    // is reported as a section of its own rather than merged into the
+    // others. Pending sections of either parser are parsed first, so their
+    // syntax errors are thrown here.
+    ConfigDiff diff(const Parser& newer) const;
 
     const ParseOptions& parse_options() const noexcept { return options_; }
 
+    // Arena and string pool usage; all zero in StorageMode::Heap.
+    StorageStats storage_stats() const noexcept;
+
+    // Sections still waiting to be parsed; always zero with SectionLoading::Eager.
+    std::size_t pending_section_count() const noexcept;
+
 private:
     std::string option_xform(std::string_view option) const;
-    std::string strip_comment(std::string_view line) const;
     void parse_line(
-        const std::string& original_line,
-        const std::string& cleaned_line,
+        const Token& tok,
         const std::string& source,
-        int line_no,
         std::string& current_section,
         std::string& current_option,
-        std::vector<std::string>& multiline_accum,
+        std::vector<std::string_view>& multiline_accum,
         bool& in_multiline,
         std::vector<ParsingError>& errors);
     void finish_multiline(
         const std::string& section,
         const std::string& option,
-        std::vector<std::string>& multiline_accum);
+        std::vector<std::string_view>& multiline_accum);
     void join_multiline_values();
-
+    void parse_text(
+        std::string_view text,
+        const std::string& source,
+        int first_line,
+        std::string current_section,
+        std::vector<ParsingError>& errors);
+    bool read_parallel(std::string_view text, const std::string& source, std::vector<ParsingError>& errors);
+    void read_lazy(std::shared_ptr<const std::string> text, std::string_view source);
+    void load_pending(detail::SectionData& sec) const;
+    void load_all_pending() const;
+
+    // Interpolates `value`, the raw value of `option` in `section`, met at
+    // nesting level `depth` while resolving the options in `chain`. Sets
+    // `*height` to the number of levels the resolution went through.
     std::string interpolate(
         std::string_view section,
         std::string_view option,
         std::string_view value,
-        int depth) const;
+        int depth,
+        const detail::InterpolationFrame* chain = nullptr,
+        int* height = nullptr) const;
 
-    std::string interpolate_basic(
+    void interpolate_basic(
         std::string_view section,
         std::string_view value,
-        int depth) const;
+        int depth,
+        const detail::InterpolationFrame& frame,
+        std::string& out,
+        int& height) const;
 
-    std::string interpolate_extended(
+    void interpolate_extended(
         std::string_view section,
         std::string_view value,
-        int depth) const;
+        int depth,
+        const detail::InterpolationFrame& frame,
+        std::string& out,
+        int& height) const;
 
-    const SectionItems* find_section_items(std::string_view section) const;
-    SectionItems* find_section_items_mut(std::string_view section);
+    const detail::OptionTable* find_section_items(std::string_view section) const;
+    detail::OptionTable* find_section_items_mut(std::string_view section);
 
 private:
     ParseOptions options_;
-
-    SectionItems defaults_;
-    std::vector<std::pair<std::string, SectionItems>> sections_;
-
-    std::unordered_map<std::string, std::size_t> section_index_;
+    std::unique_ptr<detail::Storage> store_;
 };
 
 }  // namespace ini
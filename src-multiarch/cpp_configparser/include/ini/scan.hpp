@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace ini {
+namespace detail {
+
+// Index of the lowest set bit; `m` must not be 0.
+inline unsigned lowest_bit(std::uint64_t m) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_IX86)
+    unsigned long i = 0;
+    if (static_cast<std::uint32_t>(m) != 0) {
+        _BitScanForward(&i, static_cast<unsigned long>(m));
+        return static_cast<unsigned>(i);
+    }
+    _BitScanForward(&i, static_cast<unsigned long>(m >> 32));
+    return static_cast<unsigned>(i) + 32;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i = 0;
+    _BitScanForward64(&i, m);
+    return static_cast<unsigned>(i);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(m));
+#endif
+}
+
+}  // namespace detail
+
+enum class LineScanning {
+    Vector,  // classify 64-byte blocks with SSE2/AVX2/NEON where the build has them
+    Scalar,  // look at one byte per step
+};
+
+// Small set of byte values looked for together, e.g. the first characters
+// of every delimiter. Sets of more than max_vector_bytes values are still
+// exact but are scanned one byte at a time.
+class ByteSet {
+public:
+    static constexpr std::size_t max_vector_bytes = 8;
+
+    void add(char c) noexcept {
+        const auto b = static_cast<unsigned char>(c);
+        if (!member_[b]) {
+            member_[b] = true;
+            if (size_ < max_vector_bytes) {
+                bytes_[size_] = b;
+            }
+            ++size_;
+        }
+    }
+    bool contains(char c) const noexcept { return member_[static_cast<unsigned char>(c)]; }
+    bool empty() const noexcept { return size_ == 0; }
+    std::size_t size() const noexcept { return size_; }
+    bool vectorizable() const noexcept { return size_ <= max_vector_bytes; }
+    const unsigned char* bytes() const noexcept { return bytes_; }
+
+private:
+    bool member_[256] = {};
+    unsigned char bytes_[max_vector_bytes] = {};
+    std::size_t size_ = 0;
+};
+
+// Offsets are relative to the start of the line.
+struct LineScan {
+    std::size_t length = 0;                                // bytes before '\n' or the end
+    std::size_t first_delimiter = std::string_view::npos;  // first byte of the delimiter set
+    std::size_t first_comment = std::string_view::npos;    // first byte of the comment set
+};
+
+// Splits a buffer into lines and reports, for each, where the first byte of
+// each of two ByteSets sits on it. In vector mode the buffer is classified
+// 64 bytes at a time into '\n', delimiter and comment bitmasks, and lines
+// are cut out of those with bit operations, so short lines share one
+// block's work and a line is looked at once however many sets there are.
+class LineScanner {
+public:
+    // '\n' must not be in either set.
+    LineScanner(std::string_view text, const ByteSet& delimiters, const ByteSet& comments, LineScanning mode) noexcept;
+
+    // Scans the line starting at `pos`; calls are expected in increasing
+    // order of `pos` but any order is correct.
+    LineScan scan(std::size_t pos) noexcept {
+        // Common case: the line ends inside the block already classified.
+        if (mode_ == LineScanning::Vector && pos >= block_ && pos < block_ + block_size_) {
+            const auto shift = static_cast<unsigned>(pos - block_);
+            const std::uint64_t newlines = newline_bits_ >> shift;
+            if (newlines != 0) {
+                const std::uint64_t before = (newlines & (~newlines + 1)) - 1;
+                const std::uint64_t delimiters = (delimiter_bits_ >> shift) & before;
+                const std::uint64_t comments = (comment_bits_ >> shift) & before;
+                LineScan out;
+                out.length = detail::lowest_bit(newlines);
+                if (delimiters != 0) {
+                    out.first_delimiter = detail::lowest_bit(delimiters);
+                }
+                if (comments != 0) {
+                    out.first_comment = detail::lowest_bit(comments);
+                }
+                return out;
+            }
+        }
+        return scan_blocks(pos);
+    }
+
+    LineScanning mode() const noexcept { return mode_; }
+
+private:
+    LineScan scan_blocks(std::size_t pos) noexcept;
+    void load_block(std::size_t pos) noexcept;
+
+    std::string_view text_;
+    ByteSet delimiters_;
+    ByteSet comments_;
+    LineScanning mode_;
+
+    // Bit i describes text_[block_ + i] for i < block_size_.
+    std::size_t block_ = 0;
+    std::size_t block_size_ = 0;
+    std::uint64_t newline_bits_ = 0;
+    std::uint64_t delimiter_bits_ = 0;
+    std::uint64_t comment_bits_ = 0;
+};
+
+// Position of the first byte of `marks` in `text` at or after `from`, or npos.
+std::size_t find_first_of(std::string_view text, std::size_t from, const ByteSet& marks, LineScanning mode) noexcept;
+
+// Instruction set LineScanning::Vector uses in this build: "avx2", "sse2",
+// "neon" or "scalar".
+const char* vector_scan_isa() noexcept;
+
+}  // namespace ini
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "ini/decode.hpp"
+#include "ini/key_index.hpp"
+#include "ini/parser.hpp"
+#include "ini/static_key.hpp"
+
+namespace ini {
+
+// Typed description of options read together from one section, resolved
+// with a single section lookup and without exceptions or string copies:
+//
+//   struct Patch { bool enabled = false; std::uint64_t offset = 0; };
+//   static const auto schema = ini::Schema<Patch>()
+//       .flag("LocalOnlyPatch.x64", &Patch::enabled)
+//       .hex("LocalOnlyOffset.x64", &Patch::offset);
+//   Patch patch;
+//   schema.resolve(parser, "10.0.19041.1", patch);
+//
+// A field whose option is missing, has no value, is empty or does not decode
+// keeps the value it had, so member initialisers act as defaults. Text
+// fields view the parser's storage and are valid until it is modified.
+// Keys may also be ini::StaticKey values from ini/wrapper_keys.hpp.
+template <class T>
+class Schema {
+public:
+    static constexpr std::size_t max_fields = 32;
+
+    // Keys are lower-cased and hashed here, once, so resolve() does neither.
+    Schema& flag(std::string_view key, bool T::*member) { return add(key, member); }
+    Schema& hex(std::string_view key, std::uint64_t T::*member) { return add(key, member); }
+    Schema& text(std::string_view key, std::string_view T::*member) { return add(key, member); }
+    Schema& bytes(std::string_view key, ByteArray T::*member) { return add(key, member); }
+
+    // Keys of ini/wrapper_keys.hpp, checked and hashed at compile time.
+    Schema& flag(const StaticKey& key, bool T::*member) { return add(key, member); }
+    Schema& hex(const StaticKey& key, std::uint64_t T::*member) { return add(key, member); }
+    Schema& text(const StaticKey& key, std::string_view T::*member) { return add(key, member); }
+    Schema& bytes(const StaticKey& key, ByteArray T::*member) { return add(key, member); }
+
+    std::size_t size() const noexcept { return fields_.size(); }
+
+    // Returns a mask with bit i set for each field i that was assigned.
+    std::uint32_t resolve(const Parser& parser, std::string_view section, T& out) const noexcept {
+        StaticKey keys[max_fields];
+        std::optional<std::string_view> values[max_fields];
+        for (std::size_t i = 0; i < fields_.size(); ++i) {
+            keys[i] = {fields_[i].key, fields_[i].hash};
+        }
+        if (!parser.get_raw_batch(section, keys, fields_.size(), values)) {
+            return 0;
+        }
+        std::uint32_t assigned = 0;
+        for (std::size_t i = 0; i < fields_.size(); ++i) {
+            if (values[i].has_value() && !values[i]->empty() && fields_[i].assign_to(*values[i], out)) {
+                assigned |= std::uint32_t{1} << i;
+            }
+        }
+        return assigned;
+    }
+
+private:
+    using Member = std::variant<bool T::*, std::uint64_t T::*, std::string_view T::*, ByteArray T::*>;
+
+    static bool decode_into(std::string_view value, bool& out) noexcept { return decode_flag(value, out); }
+    static bool decode_into(std::string_view value, std::uint64_t& out) noexcept { return decode_hex(value, out); }
+    static bool decode_into(std::string_view value, ByteArray& out) noexcept { return decode_bytes(value, out); }
+    static bool decode_into(std::string_view value, std::string_view& out) noexcept {
+        out = value;
+        return true;
+    }
+
+    // One instantiation per member type a schema actually uses, so no code
+    // is generated for the kinds of field it does not have.
+    template <class M>
+    static bool assign_member(const Member& member, std::string_view value, T& out) noexcept {
+        return decode_into(value, out.**std::get_if<M T::*>(&member));
+    }
+
+    struct Field {
+        std::string key;  // lower-case
+        std::uint32_t hash = 0;
+        Member member;
+        bool (*assign)(const Member& member, std::string_view value, T& out) noexcept = nullptr;
+
+        bool assign_to(std::string_view value, T& out) const noexcept { return assign(member, value, out); }
+    };
+
+    template <class M>
+    Schema& add(std::string_view key, M T::*member) {
+        std::string lowered(key);
+        for (auto& c : lowered) {
+            c = OptionIndex::fold(c);
+        }
+        return add(StaticKey{lowered, OptionIndex::hash(lowered)}, member);
+    }
+
+    template <class M>
+    Schema& add(const StaticKey& key, M T::*member) {
+        if (fields_.size() == max_fields) {
+            throw std::length_error("ini::Schema holds at most 32 fields");
+        }
+        fields_.push_back(Field{std::string(key.name), key.hash, Member(member), &assign_member<M>});
+        return *this;
+    }
+
+    std::vector<Field> fields_;
+};
+
+}  // namespace ini
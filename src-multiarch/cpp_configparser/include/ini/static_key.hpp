@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#include "ini/key_index.hpp"
+
+namespace ini {
+
+// An option name lower-cased and hashed ahead of time, the way OptionIndex
+// stores and hashes option names. Lookups through one (Parser's
+// get_raw_batch() overload, ini::Schema) neither fold nor hash the name.
+struct StaticKey {
+    std::string_view name;  // already lower-case
+    std::uint32_t hash = 0;
+};
+
+// Storage for the text of a StaticKey built at compile time from a name and
+// a suffix, e.g. "LocalOnlyPatch" and ".x64" give "localonlypatch.x64".
+// Keys made from it view its characters, so it must be a constexpr object
+// with static storage duration.
+template <std::size_t Capacity>
+class StaticKeyText {
+public:
+    constexpr StaticKeyText() = default;
+
+    // Throws std::length_error, which in a constant expression fails the
+    // build, when the result does not fit.
+    constexpr StaticKeyText(std::string_view name, std::string_view suffix = {}) {
+        if (name.size() + suffix.size() > Capacity) {
+            throw std::length_error("ini::StaticKeyText capacity exceeded");
+        }
+        for (const char c : name) {
+            chars_[size_++] = OptionIndex::fold(c);
+        }
+        for (const char c : suffix) {
+            chars_[size_++] = OptionIndex::fold(c);
+        }
+        hash_ = OptionIndex::hash(view());
+    }
+
+    constexpr std::string_view view() const noexcept { return {chars_, size_}; }
+    constexpr StaticKey key() const noexcept { return {view(), hash_}; }
+
+private:
+    char chars_[Capacity] = {};
+    std::size_t size_ = 0;
+    std::uint32_t hash_ = 0;
+};
+
+}  // namespace ini
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ini/scan.hpp"
+
+namespace ini {
+
+struct ParseOptions;
+
+enum class TokenKind {
+    Blank,    // empty, whitespace-only or comment-only line
+    Section,  // "[name]"; `name` holds the text between the brackets
+    Option,   // "key <delim> value"; `key` and `value` are trimmed
+    Bare,     // non-empty line without a delimiter (no-value key or continuation)
+};
+
+// One physical line of input. All views point into the buffer handed to the
+// Tokenizer and stay valid as long as that buffer does.
+struct Token {
+    TokenKind kind = TokenKind::Blank;
+    int line_no = 0;
+    bool indented = false;
+    bool has_delimiter = false;
+
+    std::string_view raw;      // line without its "\n" or "\r\n" terminator
+    std::string_view cleaned;  // comments stripped, surrounding blanks trimmed
+    std::string_view name;     // Section only
+    std::string_view key;      // Option: left of the delimiter; Bare: cleaned
+    std::string_view value;    // Option only
+};
+
+// Single-pass line tokenizer over an in-memory INI buffer. It splits lines
+// the way std::getline on a text-mode stream does (a "\r\n" terminator reads
+// as "\n"), strips full-line and inline comments according to ParseOptions
+// and locates the first delimiter, all without allocating. Whether a line
+// continues a multi-line value depends on parser state, so that decision is
+// left to the caller.
+class Tokenizer {
+public:
+    // `first_line` is the number of lines that precede `text` in its source,
+    // so tokens of a slice carry the line numbers of the whole file.
+    Tokenizer(std::string_view text, const ParseOptions& options, int first_line = 0);
+
+    bool next(Token& out);
+
+    // Skips ahead to the next section header without classifying the lines in
+    // between: a line that neither starts with '[' nor is indented cannot be
+    // one. Indented headers are returned too (with `indented` set), since only
+    // parser state can tell them apart from a continuation line.
+    bool next_header(Token& out);
+
+private:
+    // `first_comment` and `first_delimiter` are the offsets in the line of the
+    // first inline comment and delimiter character: npos when it has none, 0
+    // when that is not known.
+    std::string_view strip_comment(std::string_view line, std::size_t first_comment) const;
+    void classify(Token& tok, std::size_t first_delimiter) const;
+    // Fills in `scan` when given one.
+    std::string_view next_line(LineScan* scan);
+
+    std::string_view text_;
+    std::size_t pos_ = 0;
+    int line_no_ = 0;
+
+    // Views of the ParseOptions strings, collected once per tokenizer.
+    std::vector<std::string_view> comment_prefixes_;
+    std::vector<std::string_view> inline_comment_prefixes_;
+    std::vector<std::string_view> delimiters_;  // kept verbatim, as parse_line always did
+
+    // LineScanning::Vector narrows the comment and delimiter searches down to
+    // positions holding one of their first characters.
+    LineScanning scanning_ = LineScanning::Scalar;
+    LineScanner lines_{{}, {}, {}, LineScanning::Scalar};
+    ByteSet delimiter_starts_;
+    ByteSet inline_starts_;
+};
+
+}  // namespace ini
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ini {
+
+// termsrv.dll file version (major, minor, release, build) as one integer,
+// ordered the same way as the version itself.
+constexpr std::uint64_t pack_version(
+    std::uint16_t major,
+    std::uint16_t minor,
+    std::uint16_t release,
+    std::uint16_t build) noexcept {
+    return (static_cast<std::uint64_t>(major) << 48) |
+           (static_cast<std::uint64_t>(minor) << 32) |
+           (static_cast<std::uint64_t>(release) << 16) |
+           static_cast<std::uint64_t>(build);
+}
+
+// Parses a build section name "a.b.c.d" written the way Hook() formats it
+// ("%d.%d.%d.%d": decimal, no leading zeros, each part below 65536).
+std::optional<std::uint64_t> parse_version(std::string_view name);
+
+// Inverse of parse_version.
+std::string format_version(std::uint64_t version);
+
+// Minimal perfect hash over a fixed set of packed versions, in the
+// hash-and-displace style: a key picks a bucket, the bucket's displacement
+// picks the key's slot, and slots are numbered 0..size-1 without gaps. A
+// lookup is two hashes, two modulos and one compare, with no branches on the
+// key set. The tables are plain arrays so that a generated header can hold
+// them as constexpr data (see tools/gen_version_index.cpp).
+constexpr std::uint64_t version_hash(std::uint64_t x) noexcept {
+    // splitmix64 finaliser.
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+constexpr std::size_t version_slot(std::uint64_t version, std::uint32_t displacement, std::size_t size) noexcept {
+    return static_cast<std::size_t>(
+        version_hash(version ^ (0x9E3779B97F4A7C15ull * (static_cast<std::uint64_t>(displacement) + 1))) % size);
+}
+
+struct VersionIndexView {
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    const std::uint32_t* displacements = nullptr;
+    std::size_t bucket_count = 0;
+    const std::uint64_t* keys = nullptr;  // keys[slot]
+    std::size_t size = 0;
+
+    // Slot of `version`, or npos when it is not in the set.
+    constexpr std::size_t find(std::uint64_t version) const noexcept {
+        if (size == 0) {
+            return npos;
+        }
+        const auto bucket = static_cast<std::size_t>(version_hash(version) % bucket_count);
+        const auto slot = version_slot(version, displacements[bucket], size);
+        return keys[slot] == version ? slot : npos;
+    }
+};
+
+class VersionIndex {
+public:
+    VersionIndex() = default;
+
+    // Builds the index; duplicate versions are stored once.
+    explicit VersionIndex(std::vector<std::uint64_t> versions);
+
+    VersionIndexView view() const noexcept {
+        return {displacements_.data(), displacements_.size(), keys_.data(), keys_.size()};
+    }
+    std::size_t find(std::uint64_t version) const noexcept { return view().find(version); }
+    std::size_t size() const noexcept { return keys_.size(); }
+
+    const std::vector<std::uint32_t>& displacements() const noexcept { return displacements_; }
+    const std::vector<std::uint64_t>& keys() const noexcept { return keys_; }
+
+private:
+    std::vector<std::uint32_t> displacements_;
+    std::vector<std::uint64_t> keys_;
+};
+
+}  // namespace ini
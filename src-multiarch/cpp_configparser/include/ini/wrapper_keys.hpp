@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+#include "ini/static_key.hpp"
+
+namespace ini {
+
+enum class TargetArch : std::uint8_t {
+    X86,
+    X64,
+    Arm,
+    Arm64,
+};
+
+// Suffix of the build-section keys read on `arch`, e.g. ".x64".
+constexpr std::string_view arch_suffix(TargetArch arch) noexcept {
+    switch (arch) {
+    case TargetArch::X86:
+        return ".x86";
+    case TargetArch::X64:
+        return ".x64";
+    case TargetArch::Arm:
+        return ".arm";
+    case TargetArch::Arm64:
+        return ".arm64";
+    }
+    return {};
+}
+
+// Every option the wrapper reads. [Main] and [SLInit] keys are used as
+// they are; keys of "[a.b.c.d]" and "[a.b.c.d-SLInit]" carry the suffix of
+// the architecture, e.g. "LocalOnlyPatch.x64".
+inline constexpr const char* kWrapperMainKeys[] = {
+    "SLPolicyHookNT60", "SLPolicyHookNT61",
+};
+inline constexpr const char* kWrapperFlagKeys[] = {
+    "LocalOnlyPatch", "SingleUserPatch", "DefPolicyPatch", "SLPolicyInternal", "SLInitHook",
+};
+inline constexpr const char* kWrapperOffsetKeys[] = {
+    "LocalOnlyOffset", "SingleUserOffset", "DefPolicyOffset", "SLPolicyOffset", "SLInitOffset",
+};
+inline constexpr const char* kWrapperCodeKeys[] = {
+    "LocalOnlyCode", "SingleUserCode", "DefPolicyCode",
+};
+// CSLQuery members: values in [SLInit], offsets in "[a.b.c.d-SLInit]".
+inline constexpr const char* kWrapperSLInitKeys[] = {
+    "bServerSku", "bRemoteConnAllowed", "bFUSEnabled", "bAppServerAllowed",
+    "bMultimonAllowed", "lMaxUserSessions", "ulMaxDebugSessions", "bInitialized",
+};
+
+namespace detail {
+
+constexpr std::size_t kWrapperKeyCapacity = 32;
+
+template <std::size_t Count>
+class WrapperKeyTable {
+public:
+    template <std::size_t N>
+    constexpr void add(const char* const (&names)[N], std::string_view suffix) {
+        for (const char* name : names) {
+            names_[size_] = name;
+            keys_[size_] = StaticKeyText<kWrapperKeyCapacity>(name, suffix);
+            ++size_;
+        }
+    }
+
+    constexpr StaticKey find(std::string_view name) const {
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (names_[i] == name) {
+                return keys_[i].key();
+            }
+        }
+        throw std::invalid_argument("not an option the wrapper reads");
+    }
+
+private:
+    std::string_view names_[Count] = {};
+    StaticKeyText<kWrapperKeyCapacity> keys_[Count] = {};
+    std::size_t size_ = 0;
+};
+
+constexpr auto make_plain_keys() {
+    WrapperKeyTable<std::size(kWrapperMainKeys) + std::size(kWrapperSLInitKeys)> table;
+    table.add(kWrapperMainKeys, {});
+    table.add(kWrapperSLInitKeys, {});
+    return table;
+}
+
+template <TargetArch Arch>
+constexpr auto make_arch_keys() {
+    WrapperKeyTable<std::size(kWrapperFlagKeys) + std::size(kWrapperOffsetKeys) + std::size(kWrapperCodeKeys) +
+                    std::size(kWrapperSLInitKeys)>
+        table;
+    table.add(kWrapperFlagKeys, arch_suffix(Arch));
+    table.add(kWrapperOffsetKeys, arch_suffix(Arch));
+    table.add(kWrapperCodeKeys, arch_suffix(Arch));
+    table.add(kWrapperSLInitKeys, arch_suffix(Arch));
+    return table;
+}
+
+inline constexpr auto kPlainWrapperKeys = make_plain_keys();
+template <TargetArch Arch>
+inline constexpr auto kArchWrapperKeys = make_arch_keys<Arch>();
+
+}  // namespace detail
+
+// Keys of the tables above, lower-cased and hashed at compile time:
+//
+//   constexpr ini::StaticKey kPatch = ini::arch_key<ini::TargetArch::X64>("LocalOnlyPatch");
+//   constexpr ini::StaticKey kHook = ini::wrapper_key("SLPolicyHookNT60");
+//
+// wrapper_key() takes [Main] and [SLInit] names, arch_key() build-section
+// names without their suffix. Any other name throws std::invalid_argument,
+// so in a constant expression it does not compile.
+constexpr StaticKey wrapper_key(std::string_view name) {
+    return detail::kPlainWrapperKeys.find(name);
+}
+
+template <TargetArch Arch>
+constexpr StaticKey arch_key(std::string_view name) {
+    return detail::kArchWrapperKeys<Arch>.find(name);
+}
+
+}  // namespace ini
@@ -0,0 +1,544 @@
+#include "ini/compiled_config.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "ini/decode.hpp"
+#include "ini/key_index.hpp"
+
+namespace ini {
+namespace {
+
+constexpr char kMagic[8] = {'R', 'D', 'P', 'W', 'C', 'F', 'G', '\0'};
+constexpr std::uint32_t kFormatVersion = 2;
+
+// Header: magic, format version, flags, source size, source hash, payload
+// hash, then (offset, count) for each table in the order below.
+constexpr std::size_t kHeaderSize = 96;
+constexpr std::size_t kTableDescriptors = 40;
+
+constexpr std::uint32_t kHasPatchCodes = 1u << 0;
+
+// Entry sizes. A string reference is (u32 offset, u32 length) into the pool.
+constexpr std::size_t kSectionSize = 16;  // name, first option, option count
+constexpr std::size_t kOptionSize = 24;   // key, value, has value, unused
+constexpr std::size_t kVersionSize = 32;  // version, flags, record per arch, unused
+constexpr std::size_t kRecordSize = 136;  // present, flags, hex values, codes
+
+constexpr std::uint32_t kHasBuildSection = 1u << 0;
+constexpr std::uint32_t kHasSLInitSection = 1u << 1;
+constexpr std::uint32_t kNoRecord = 0xFFFFFFFFu;
+
+constexpr const char* kPatchCodesSection = "PatchCodes";
+constexpr const char* kSLInitSuffix = "-SLInit";
+constexpr std::size_t kArchCount = 4;
+
+// Record fields, in "present" bit order: flags, then hex values of the build
+// section, hex values of the SLInit section, then patch code names.
+constexpr const auto& kFlagKeys = kWrapperFlagKeys;
+constexpr const auto& kBuildHexKeys = kWrapperOffsetKeys;
+constexpr const auto& kSLInitHexKeys = kWrapperSLInitKeys;
+constexpr const auto& kCodeKeys = kWrapperCodeKeys;
+constexpr std::size_t kFlagCount = std::size(kFlagKeys);
+constexpr std::size_t kBuildHexCount = std::size(kBuildHexKeys);
+constexpr std::size_t kHexCount = kBuildHexCount + std::size(kSLInitHexKeys);
+constexpr std::size_t kCodeCount = std::size(kCodeKeys);
+constexpr std::size_t kHexBit = kFlagCount;
+constexpr std::size_t kCodeBit = kHexBit + kHexCount;
+static_assert(kCodeBit + kCodeCount <= 32, "present bits must fit in a u32");
+static_assert(8 + 8 * kHexCount + 8 * kCodeCount == kRecordSize, "record layout");
+
+[[noreturn]] void invalid(const char* what) {
+    throw Error(ErrorCode::InvalidCompiledConfig, std::string("invalid compiled config: ") + what);
+}
+
+std::uint32_t get_u32(std::string_view b, std::size_t at) noexcept {
+    std::uint32_t v = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        v |= static_cast<std::uint32_t>(static_cast<unsigned char>(b[at + i])) << (8 * i);
+    }
+    return v;
+}
+
+std::uint64_t get_u64(std::string_view b, std::size_t at) noexcept {
+    return static_cast<std::uint64_t>(get_u32(b, at)) |
+           (static_cast<std::uint64_t>(get_u32(b, at + 4)) << 32);
+}
+
+void put_u32(std::string& out, std::uint32_t v) {
+    for (std::size_t i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+}
+
+void put_u64(std::string& out, std::uint64_t v) {
+    put_u32(out, static_cast<std::uint32_t>(v));
+    put_u32(out, static_cast<std::uint32_t>(v >> 32));
+}
+
+void set_u32(std::string& out, std::size_t at, std::uint32_t v) {
+    for (std::size_t i = 0; i < 4; ++i) {
+        out[at + i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+    }
+}
+
+void set_u64(std::string& out, std::size_t at, std::uint64_t v) {
+    set_u32(out, at, static_cast<std::uint32_t>(v));
+    set_u32(out, at + 4, static_cast<std::uint32_t>(v >> 32));
+}
+
+std::uint64_t hash_bytes(std::string_view text) noexcept {
+    // Multiply-xorshift over little-endian 8-byte words, in four independent
+    // lanes so that the multiplies of neighbouring words overlap.
+    constexpr std::uint64_t kMul = 0x9E3779B97F4A7C15ull;
+    std::uint64_t lanes[4] = {
+        0xCBF29CE484222325ull ^ static_cast<std::uint64_t>(text.size()),
+        0x84222325CBF29CE4ull,
+        0x2545F4914F6CDD1Dull,
+        0x4F6CDD1D2545F491ull,
+    };
+    std::size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32) {
+        for (std::size_t k = 0; k < 4; ++k) {
+            lanes[k] = (lanes[k] ^ get_u64(text, i + 8 * k)) * kMul;
+            lanes[k] ^= lanes[k] >> 32;
+        }
+    }
+    std::uint64_t h = lanes[0];
+    for (std::size_t k = 1; k < 4; ++k) {
+        h = (h ^ lanes[k]) * kMul;
+        h ^= h >> 32;
+    }
+    for (; i + 8 <= text.size(); i += 8) {
+        h = (h ^ get_u64(text, i)) * kMul;
+        h ^= h >> 32;
+    }
+    std::uint64_t tail = 0;
+    for (std::size_t k = 0; i + k < text.size(); ++k) {
+        tail |= static_cast<std::uint64_t>(static_cast<unsigned char>(text[i + k])) << (8 * k);
+    }
+    h = (h ^ tail) * kMul;
+    return h ^ (h >> 29);
+}
+
+// The wrapper's reads: a missing section, missing option, no-value option
+// and empty value all mean "use the caller's default".
+std::optional<std::string> wrapper_value(const Parser& p, const std::string& section, const std::string& key) {
+    if (!p.has_section(section) || !p.has_option(section, key)) {
+        return std::nullopt;
+    }
+    auto v = p.get_raw(section, key);
+    if (!v.has_value() || v->empty()) {
+        return std::nullopt;
+    }
+    return v;
+}
+
+// INIReadDWordHex minus the platform range check, which the wrapper still
+// applies to the value it gets back.
+std::optional<std::uint64_t> wrapper_hex(std::string_view value) {
+    std::uint64_t v = 0;
+    if (!decode_hex(value, v)) {
+        return std::nullopt;
+    }
+    return v;
+}
+
+// GetBoolFromIni.
+bool wrapper_flag(std::string_view value) {
+    bool flag = false;
+    decode_flag(value, flag);
+    return flag;
+}
+
+std::string lower(std::string_view s) {
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](char c) {
+        return OptionIndex::fold(c);
+    });
+    return out;
+}
+
+class Writer {
+public:
+    std::uint32_t intern(std::string_view s) {
+        const auto it = offsets_.find(std::string(s));
+        if (it != offsets_.end()) {
+            return it->second;
+        }
+        const auto offset = static_cast<std::uint32_t>(pool_.size());
+        pool_.append(s.data(), s.size());
+        offsets_.emplace(std::string(s), offset);
+        return offset;
+    }
+
+    void put_ref(std::string& table, std::string_view s) {
+        put_u32(table, intern(s));
+        put_u32(table, static_cast<std::uint32_t>(s.size()));
+    }
+
+    void put_options(const SectionItems& items) {
+        for (const auto& e : items) {
+            put_ref(options, e.first);
+            put_ref(options, e.second.has_value() ? std::string_view(*e.second) : std::string_view());
+            put_u32(options, e.second.has_value() ? 1 : 0);
+            put_u32(options, 0);
+        }
+        option_count += items.size();
+    }
+
+    std::string sections;
+    std::string options;
+    std::string patch_codes;
+    std::string versions;
+    std::string records;
+    std::size_t section_count = 0;
+    std::size_t option_count = 0;
+    std::size_t record_count = 0;
+
+    const std::string& pool() const noexcept { return pool_; }
+
+private:
+    std::string pool_;
+    std::unordered_map<std::string, std::uint32_t> offsets_;
+};
+
+void pad8(std::string& out) {
+    out.resize((out.size() + 7) / 8 * 8, '\0');
+}
+
+}  // namespace
+
+std::uint64_t config_source_hash(std::string_view text) noexcept {
+    return hash_bytes(text);
+}
+
+std::string compile_config(std::string_view text, const ParseOptions& options) {
+    auto opt = options;
+    opt.section_loading = SectionLoading::Eager;
+    Parser p(opt);
+    p.read_string(text);
+
+    Writer w;
+    std::uint32_t flags = 0;
+    std::unordered_map<std::uint64_t, std::uint32_t> versions;  // version -> section flags
+
+    auto put_section = [&](std::string_view name, const SectionItems& items) {
+        w.put_ref(w.sections, name);
+        put_u32(w.sections, static_cast<std::uint32_t>(w.option_count));
+        put_u32(w.sections, static_cast<std::uint32_t>(items.size()));
+        w.put_options(items);
+        ++w.section_count;
+    };
+
+    const auto defaults = p.section(opt.default_section).items();
+    if (!defaults.empty()) {
+        put_section(opt.default_section, defaults);
+    }
+    for (const auto& name : p.sections()) {
+        if (name == kPatchCodesSection) {
+            flags |= kHasPatchCodes;
+            continue;
+        }
+        const std::string_view sv(name);
+        const std::string_view suffix(kSLInitSuffix);
+        if (const auto v = parse_version(sv)) {
+            versions[*v] |= kHasBuildSection;
+            continue;
+        }
+        if (sv.size() > suffix.size() && sv.substr(sv.size() - suffix.size()) == suffix) {
+            if (const auto v = parse_version(sv.substr(0, sv.size() - suffix.size()))) {
+                versions[*v] |= kHasSLInitSection;
+                continue;
+            }
+        }
+        put_section(name, p.section(name).items());
+    }
+
+    if ((flags & kHasPatchCodes) != 0) {
+        auto codes = p.section(kPatchCodesSection).items();
+        std::sort(codes.begin(), codes.end(), [](const OptionEntry& a, const OptionEntry& b) {
+            return a.first < b.first;
+        });
+        std::string saved;
+        saved.swap(w.options);
+        const auto saved_count = w.option_count;
+        w.put_options(codes);
+        w.patch_codes.swap(w.options);
+        w.options.swap(saved);
+        w.option_count = saved_count;
+    }
+
+    std::vector<std::uint64_t> keys;
+    keys.reserve(versions.size());
+    for (const auto& entry : versions) {
+        keys.push_back(entry.first);
+    }
+    const VersionIndex index(std::move(keys));
+    for (const auto version : index.keys()) {
+        const std::uint32_t section_flags = versions[version];
+        const std::string build = format_version(version);
+        const std::string slinit = build + kSLInitSuffix;
+
+        put_u64(w.versions, version);
+        put_u32(w.versions, section_flags);
+        for (std::size_t arch = 0; arch < kArchCount; ++arch) {
+            const std::string suffix(arch_suffix(static_cast<TargetArch>(arch)));
+            std::uint32_t present = 0;
+            std::uint32_t bits = 0;
+            std::uint64_t hex[kHexCount] = {};
+            std::string_view codes[kCodeCount];
+            std::optional<std::string> code_values[kCodeCount];
+
+            for (std::size_t i = 0; i < kFlagCount; ++i) {
+                if (const auto v = wrapper_value(p, build, kFlagKeys[i] + suffix)) {
+                    present |= 1u << i;
+                    bits |= wrapper_flag(*v) ? 1u << i : 0u;
+                }
+            }
+            for (std::size_t i = 0; i < kHexCount; ++i) {
+                const bool in_build = i < kBuildHexCount;
+                const auto v = in_build
+                    ? wrapper_value(p, build, kBuildHexKeys[i] + suffix)
+                    : wrapper_value(p, slinit, kSLInitHexKeys[i - kBuildHexCount] + suffix);
+                if (v.has_value()) {
+                    if (const auto n = wrapper_hex(*v)) {
+                        present |= 1u << (kHexBit + i);
+                        hex[i] = *n;
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < kCodeCount; ++i) {
+                code_values[i] = wrapper_value(p, build, kCodeKeys[i] + suffix);
+                if (code_values[i].has_value()) {
+                    present |= 1u << (kCodeBit + i);
+                    codes[i] = *code_values[i];
+                }
+            }
+
+            if (present == 0) {
+                put_u32(w.versions, kNoRecord);
+                continue;
+            }
+            put_u32(w.versions, static_cast<std::uint32_t>(w.record_count++));
+            put_u32(w.records, present);
+            put_u32(w.records, bits);
+            for (const auto n : hex) {
+                put_u64(w.records, n);
+            }
+            for (const auto code : codes) {
+                w.put_ref(w.records, code);
+            }
+        }
+        put_u32(w.versions, 0);
+    }
+
+    std::string out(kHeaderSize, '\0');
+    std::memcpy(out.data(), kMagic, sizeof(kMagic));
+    set_u32(out, 8, kFormatVersion);
+    set_u32(out, 12, flags);
+    set_u64(out, 16, static_cast<std::uint64_t>(text.size()));
+    set_u64(out, 24, hash_bytes(text));
+
+    std::size_t descriptor = kTableDescriptors;
+    auto append_table = [&](const std::string& table, std::size_t count) {
+        pad8(out);
+        set_u32(out, descriptor, static_cast<std::uint32_t>(out.size()));
+        set_u32(out, descriptor + 4, static_cast<std::uint32_t>(count));
+        descriptor += 8;
+        out += table;
+    };
+    append_table(w.pool(), w.pool().size());
+    append_table(w.sections, w.section_count);
+    append_table(w.options, w.option_count);
+    append_table(w.patch_codes, w.patch_codes.size() / kOptionSize);
+    append_table(w.versions, versions.size());
+    append_table(w.records, w.record_count);
+    std::string displacements;
+    for (const auto d : index.displacements()) {
+        put_u32(displacements, d);
+    }
+    append_table(displacements, index.displacements().size());
+    pad8(out);
+
+    set_u64(out, 32, hash_bytes(std::string_view(out).substr(kHeaderSize)));
+    return out;
+}
+
+CompiledConfig::CompiledConfig(std::string_view blob) : blob_(blob) {
+    if (blob.size() < kHeaderSize || std::memcmp(blob.data(), kMagic, sizeof(kMagic)) != 0) {
+        invalid("bad magic");
+    }
+    if (get_u32(blob, 8) != kFormatVersion) {
+        invalid("unsupported format version");
+    }
+    if (get_u64(blob, 32) != hash_bytes(blob.substr(kHeaderSize))) {
+        invalid("payload hash mismatch");
+    }
+    source_size_ = get_u64(blob, 16);
+    source_hash_ = get_u64(blob, 24);
+
+    Table* tables[] = {
+        &strings_, &sections_, &options_, &patch_codes_, &versions_, &records_, &displacements_,
+    };
+    const std::size_t widths[] = {1, kSectionSize, kOptionSize, kOptionSize, kVersionSize, kRecordSize, 4};
+    for (std::size_t i = 0; i < std::size(tables); ++i) {
+        const std::uint64_t offset = get_u32(blob, kTableDescriptors + 8 * i);
+        const std::uint64_t count = get_u32(blob, kTableDescriptors + 8 * i + 4);
+        if (offset < kHeaderSize || offset > blob.size() || count > (blob.size() - offset) / widths[i]) {
+            invalid("table out of range");
+        }
+        tables[i]->offset = static_cast<std::size_t>(offset);
+        tables[i]->count = static_cast<std::size_t>(count);
+    }
+    if (versions_.count != 0 && displacements_.count == 0) {
+        invalid("missing version index");
+    }
+}
+
+bool CompiledConfig::matches_source(std::string_view text) const noexcept {
+    return text.size() == source_size_ && hash_bytes(text) == source_hash_;
+}
+
+std::string_view CompiledConfig::string_at(std::size_t ref_offset) const {
+    const std::size_t offset = get_u32(blob_, ref_offset);
+    const std::size_t size = get_u32(blob_, ref_offset + 4);
+    if (offset > strings_.count || size > strings_.count - offset) {
+        invalid("string out of range");
+    }
+    return blob_.substr(strings_.offset + offset, size);
+}
+
+std::uint32_t CompiledConfig::displacement(std::size_t bucket) const noexcept {
+    return get_u32(blob_, displacements_.offset + 4 * bucket);
+}
+
+std::size_t CompiledConfig::find_version(std::uint64_t version) const noexcept {
+    // VersionIndexView::find over the little-endian tables.
+    if (versions_.count == 0) {
+        return versions_.count;
+    }
+    const auto bucket = static_cast<std::size_t>(version_hash(version) % displacements_.count);
+    const auto slot = version_slot(version, displacement(bucket), versions_.count);
+    return get_u64(blob_, versions_.offset + slot * kVersionSize) == version ? slot : versions_.count;
+}
+
+bool CompiledConfig::has_version(std::uint64_t version) const noexcept {
+    return find_version(version) != versions_.count;
+}
+
+void CompiledConfig::load(Parser& out, std::uint64_t version, TargetArch arch) const {
+    const auto& default_section = out.parse_options().default_section;
+    auto value_at = [this](std::size_t option) -> OptionValue {
+        if (get_u32(blob_, option + 16) == 0) {
+            return std::nullopt;
+        }
+        return std::string(string_at(option + 8));
+    };
+
+    for (std::size_t i = 0; i < sections_.count; ++i) {
+        const std::size_t at = sections_.offset + i * kSectionSize;
+        const std::string name(string_at(at));
+        const std::size_t first = get_u32(blob_, at + 8);
+        const std::size_t count = get_u32(blob_, at + 12);
+        if (first > options_.count || count > options_.count - first) {
+            invalid("section options out of range");
+        }
+        if (name != default_section && !out.has_section(name)) {
+            out.add_section(name);
+        }
+        for (std::size_t k = 0; k < count; ++k) {
+            const std::size_t option = options_.offset + (first + k) * kOptionSize;
+            out.set(name, std::string(string_at(option)), value_at(option));
+        }
+    }
+
+    const auto patch_codes = (get_u32(blob_, 12) & kHasPatchCodes) != 0;
+    if (patch_codes && !out.has_section(kPatchCodesSection)) {
+        out.add_section(kPatchCodesSection);
+    }
+
+    const std::size_t index = find_version(version);
+    if (index == versions_.count) {
+        return;
+    }
+    const std::size_t entry = versions_.offset + index * kVersionSize;
+    const std::uint32_t section_flags = get_u32(blob_, entry + 8);
+    const std::string build = format_version(version);
+    const std::string slinit = build + kSLInitSuffix;
+    if ((section_flags & kHasBuildSection) != 0 && !out.has_section(build)) {
+        out.add_section(build);
+    }
+    if ((section_flags & kHasSLInitSection) != 0 && !out.has_section(slinit)) {
+        out.add_section(slinit);
+    }
+
+    const auto arch_index = static_cast<std::size_t>(arch);
+    if (arch_index >= kArchCount) {
+        return;
+    }
+    const std::uint32_t record_index = get_u32(blob_, entry + 12 + 4 * arch_index);
+    if (record_index == kNoRecord) {
+        return;
+    }
+    if (record_index >= records_.count) {
+        invalid("record out of range");
+    }
+    const std::size_t record = records_.offset + record_index * kRecordSize;
+    const std::uint32_t present = get_u32(blob_, record);
+    const std::uint32_t bits = get_u32(blob_, record + 4);
+    const std::string suffix(arch_suffix(arch));
+
+    for (std::size_t i = 0; i < kFlagCount; ++i) {
+        if ((present & (1u << i)) != 0) {
+            out.set(build, kFlagKeys[i] + suffix, std::string((bits & (1u << i)) != 0 ? "1" : "0"));
+        }
+    }
+    for (std::size_t i = 0; i < kHexCount; ++i) {
+        if ((present & (1u << (kHexBit + i))) == 0) {
+            continue;
+        }
+        char buf[17];
+        const auto res = std::to_chars(buf, buf + sizeof(buf), get_u64(blob_, record + 8 + 8 * i), 16);
+        std::string value(buf, res.ptr);
+        if (i < kBuildHexCount) {
+            out.set(build, kBuildHexKeys[i] + suffix, std::move(value));
+        } else {
+            out.set(slinit, kSLInitHexKeys[i - kBuildHexCount] + suffix, std::move(value));
+        }
+    }
+    for (std::size_t i = 0; i < kCodeCount; ++i) {
+        if ((present & (1u << (kCodeBit + i))) == 0) {
+            continue;
+        }
+        const auto code = string_at(record + 8 + 8 * kHexCount + 8 * i);
+        out.set(build, kCodeKeys[i] + suffix, std::string(code));
+
+        // Patch codes are sorted by their lower-cased names; Hook() looks the
+        // name up in [PatchCodes] first.
+        const std::string key = lower(code);
+        std::size_t lo = 0;
+        std::size_t hi = patch_codes_.count;
+        while (lo < hi) {
+            const std::size_t mid = lo + (hi - lo) / 2;
+            const std::size_t option = patch_codes_.offset + mid * kOptionSize;
+            const auto name = string_at(option);
+            if (name == key) {
+                out.set(kPatchCodesSection, key, value_at(option));
+                break;
+            }
+            if (name < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+    }
+}
+
+}  // namespace ini
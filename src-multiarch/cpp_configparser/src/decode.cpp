@@ -0,0 +1,211 @@
+#include "ini/decode.hpp"
+
+#include <cstring>
+
+namespace ini {
+namespace {
+
+// std::isspace in the "C" locale, which is what strtol and strtoull skip.
+constexpr bool is_space(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Byte classes for the hex decoders: a digit's value, or one of these.
+constexpr std::uint8_t kSeparator = 0x10;  // ' ', '\t', ',' and '-'
+constexpr std::uint8_t kNotHex = 0xFF;
+
+struct HexTable {
+    std::uint8_t value[256];
+};
+
+constexpr HexTable make_hex_table() {
+    HexTable t{};
+    for (int c = 0; c < 256; ++c) {
+        t.value[c] = kNotHex;
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+        t.value[c] = static_cast<std::uint8_t>(c - '0');
+    }
+    for (int c = 'a'; c <= 'f'; ++c) {
+        t.value[c] = static_cast<std::uint8_t>(c - 'a' + 10);
+        t.value[c - 'a' + 'A'] = static_cast<std::uint8_t>(c - 'a' + 10);
+    }
+    for (const char c : {' ', '\t', ',', '-'}) {
+        t.value[static_cast<unsigned char>(c)] = kSeparator;
+    }
+    return t;
+}
+
+constexpr HexTable kHex = make_hex_table();
+
+constexpr std::uint8_t hex_class(char c) noexcept {
+    return kHex.value[static_cast<unsigned char>(c)];
+}
+
+constexpr bool is_hex_digit(char c) noexcept {
+    return hex_class(c) < 16;
+}
+
+}  // namespace
+
+bool decode_flag(std::string_view value, bool& out) noexcept {
+    // strtol's result is non-zero exactly when its digit run holds a non-zero
+    // digit; an overflow saturates, which is non-zero as well.
+    std::size_t i = 0;
+    while (i < value.size() && is_space(value[i])) {
+        ++i;
+    }
+    if (i < value.size() && (value[i] == '+' || value[i] == '-')) {
+        ++i;
+    }
+    bool non_zero = false;
+    for (; i < value.size() && value[i] >= '0' && value[i] <= '9'; ++i) {
+        non_zero = non_zero || value[i] != '0';
+    }
+    out = non_zero;
+    return true;
+}
+
+bool decode_decimal(std::string_view value, std::uint32_t& out) noexcept {
+    std::size_t i = 0;
+    while (i < value.size() && is_space(value[i])) {
+        ++i;
+    }
+    bool negative = false;
+    if (i < value.size() && (value[i] == '+' || value[i] == '-')) {
+        negative = value[i] == '-';
+        ++i;
+    }
+    std::uint64_t magnitude = 0;
+    for (; i < value.size() && value[i] >= '0' && value[i] <= '9'; ++i) {
+        magnitude = magnitude * 10 + static_cast<std::uint64_t>(value[i] - '0');
+        if (magnitude > UINT32_MAX) {
+            out = UINT32_MAX;  // ERANGE, whatever the sign
+            return true;
+        }
+    }
+    const auto v = static_cast<std::uint32_t>(magnitude);
+    out = negative ? 0u - v : v;
+    return true;
+}
+
+bool decode_hex(std::string_view value, std::uint64_t& out) noexcept {
+    std::size_t i = 0;
+    while (i < value.size() && is_space(value[i])) {
+        ++i;
+    }
+    bool negative = false;
+    if (i < value.size() && (value[i] == '+' || value[i] == '-')) {
+        negative = value[i] == '-';
+        ++i;
+    }
+    // strtoull takes "0x" as a prefix only when a hex digit follows it.
+    if (i + 2 < value.size() && value[i] == '0' && (value[i + 1] == 'x' || value[i + 1] == 'X') &&
+        is_hex_digit(value[i + 2])) {
+        i += 2;
+    }
+    if (i == value.size()) {
+        return false;  // no conversion
+    }
+    // Leading zeros never overflow; after them at most 16 digits fit.
+    while (i < value.size() && value[i] == '0') {
+        ++i;
+    }
+    if (value.size() - i > 16) {
+        return false;  // ERANGE, or a trailing character
+    }
+    std::uint64_t v = 0;
+    for (; i < value.size(); ++i) {
+        const std::uint8_t d = hex_class(value[i]);
+        if (d > 15) {
+            return false;
+        }
+        v = (v << 4) | d;
+    }
+    out = negative ? 0 - v : v;
+    return true;
+}
+
+bool decode_bytes(std::string_view value, ByteArray& out) noexcept {
+    // Decoded into a scratch buffer so that `out` stays untouched on
+    // failure, which ini::Schema's defaults rely on.
+    std::uint8_t data[sizeof(out.data)];
+    std::size_t size = 0;
+    const char* p = value.data();
+    const char* const end = p + value.size();
+    int high = -1;  // first digit of a pair split by separators
+    while (p != end) {
+        // The common case: two adjacent digits.
+        if (high < 0 && end - p >= 2) {
+            const std::uint8_t a = hex_class(p[0]);
+            const std::uint8_t b = hex_class(p[1]);
+            if ((a | b) < 16) {
+                if (size == sizeof(data)) {
+                    return false;
+                }
+                data[size++] = static_cast<std::uint8_t>((a << 4) | b);
+                p += 2;
+                continue;
+            }
+        }
+        const std::uint8_t d = hex_class(*p++);
+        if (d == kSeparator) {
+            continue;
+        }
+        if (d > 15) {
+            return false;
+        }
+        if (high < 0) {
+            high = d;
+            continue;
+        }
+        if (size == sizeof(data)) {
+            return false;
+        }
+        data[size++] = static_cast<std::uint8_t>((high << 4) | d);
+        high = -1;
+    }
+    if (high >= 0) {
+        return false;
+    }
+    out.size = static_cast<std::uint8_t>(size);
+    std::memcpy(out.data, data, size);
+    return true;
+}
+
+std::optional<bool> read_flag(const Parser& parser, std::string_view section, std::string_view option) noexcept {
+    const auto value = parser.try_get_raw(section, option);
+    bool out = false;
+    if (!value.has_value() || value->empty() || !decode_flag(*value, out)) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+std::optional<std::uint32_t> read_decimal(
+    const Parser& parser,
+    std::string_view section,
+    std::string_view option) noexcept {
+    const auto value = parser.try_get_raw(section, option);
+    std::uint32_t out = 0;
+    if (!value.has_value() || value->empty() || !decode_decimal(*value, out)) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+std::optional<std::uint64_t> read_hex(const Parser& parser, std::string_view section, std::string_view option) noexcept {
+    const auto value = parser.try_get_raw(section, option);
+    std::uint64_t out = 0;
+    if (!value.has_value() || value->empty() || !decode_hex(*value, out)) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+bool read_bytes(const Parser& parser, std::string_view section, std::string_view option, ByteArray& out) noexcept {
+    const auto value = parser.try_get_raw(section, option);
+    return value.has_value() && !value->empty() && decode_bytes(*value, out);
+}
+
+}  // namespace ini
@@ -0,0 +1,132 @@
+#include "ini/parser.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "storage.hpp"
+
+namespace ini {
+namespace {
+
+using detail::OptionTable;
+using detail::StoredOption;
+using detail::to_option_value;
+using detail::view_of;
+
+bool same_value(const StoredOption& a, const StoredOption& b) noexcept {
+    if (a.value.has_value() != b.value.has_value()) {
+        return false;
+    }
+    return !a.value.has_value() || view_of(*a.value) == view_of(*b.value);
+}
+
+OptionChange option_change(ChangeKind kind, const StoredOption* before, const StoredOption* after) {
+    const auto& named = before != nullptr ? *before : *after;
+    OptionChange change;
+    change.option.assign(view_of(named.key));
+    change.kind = kind;
+    if (before != nullptr) {
+        change.before = to_option_value(before->value);
+    }
+    if (after != nullptr) {
+        change.after = to_option_value(after->value);
+    }
+    return change;
+}
+
+// Appends to `out` what changed from `before` to `after`.
+void diff_options(const OptionTable& before, const OptionTable& after, std::vector<OptionChange>& out) {
+    // Two snapshots of one file usually hold the same keys in the same
+    // order: walk them side by side and only look keys up past the first
+    // place they part. Keys are unique, so a key of `before` from there on
+    // can only match one of `after` from there on too.
+    const auto common = std::min(before.items.size(), after.items.size());
+    std::size_t aligned = 0;
+    for (; aligned < common && view_of(before.items[aligned].key) == view_of(after.items[aligned].key); ++aligned) {
+        if (!same_value(before.items[aligned], after.items[aligned])) {
+            out.push_back(option_change(ChangeKind::Modified, &before.items[aligned], &after.items[aligned]));
+        }
+    }
+    for (auto i = aligned; i < before.items.size(); ++i) {
+        const auto& entry = before.items[i];
+        const auto* match = after.find(view_of(entry.key));
+        if (match == nullptr) {
+            out.push_back(option_change(ChangeKind::Removed, &entry, nullptr));
+        } else if (!same_value(entry, *match)) {
+            out.push_back(option_change(ChangeKind::Modified, &entry, match));
+        }
+    }
+    for (auto i = aligned; i < after.items.size(); ++i) {
+        const auto& entry = after.items[i];
+        if (before.find(view_of(entry.key)) == nullptr) {
+            out.push_back(option_change(ChangeKind::Added, nullptr, &entry));
+        }
+    }
+}
+
+// Records `name` as changed from `before` to `after` (either may be null)
+// unless the two tables hold the same options.
+void diff_section(
+    std::string_view name,
+    const OptionTable* before,
+    const OptionTable* after,
+    std::vector<SectionChange>& out) {
+    SectionChange change;
+    if (before != nullptr && after != nullptr) {
+        diff_options(*before, *after, change.options);
+        if (change.options.empty()) {
+            return;
+        }
+        change.kind = ChangeKind::Modified;
+    } else if (before != nullptr) {
+        change.kind = ChangeKind::Removed;
+        change.options.reserve(before->items.size());
+        for (const auto& entry : before->items) {
+            change.options.push_back(option_change(ChangeKind::Removed, &entry, nullptr));
+        }
+    } else {
+        change.kind = ChangeKind::Added;
+        change.options.reserve(after->items.size());
+        for (const auto& entry : after->items) {
+            change.options.push_back(option_change(ChangeKind::Added, nullptr, &entry));
+        }
+    }
+    change.section.assign(name);
+    out.push_back(std::move(change));
+}
+
+}  // namespace
+
+ConfigDiff Parser::diff(const Parser& newer) const {
+    load_all_pending();
+    newer.load_all_pending();
+
+    const auto& before = *store_;
+    const auto& after = *newer.store_;
+    ConfigDiff out;
+
+    if (!before.defaults.items.empty() || !after.defaults.items.empty()) {
+        diff_section(options_.default_section, &before.defaults, &after.defaults, out.sections);
+    }
+
+    // Same side-by-side walk as diff_options(), over whole sections.
+    auto b = before.sections.begin();
+    auto a = after.sections.begin();
+    for (; b != before.sections.end() && a != after.sections.end() && b->name == a->name; ++b, ++a) {
+        diff_section(view_of(b->name), &b->options, &a->options, out.sections);
+    }
+    for (auto i = b; i != before.sections.end(); ++i) {
+        const auto slot = after.find_section(view_of(i->name));
+        const auto* match = slot == SectionIndex::npos ? nullptr : &after.sections[slot].options;
+        diff_section(view_of(i->name), &i->options, match, out.sections);
+    }
+    for (auto i = a; i != after.sections.end(); ++i) {
+        if (before.find_section(view_of(i->name)) == SectionIndex::npos) {
+            diff_section(view_of(i->name), nullptr, &i->options, out.sections);
+        }
+    }
+    return out;
+}
+
+}  // namespace ini
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "ini/key_index.hpp"
+
+namespace ini {
+namespace detail {
+
+// One option being interpolated, linked to the option whose value referred
+// to it. Walking the links finds a reference back into the chain however
+// large max_interpolation_depth is.
+struct InterpolationFrame {
+    std::string_view section;
+    std::string_view option;
+    const InterpolationFrame* parent = nullptr;
+};
+
+// Interpolated values by (section, option), so that a value many others
+// refer to is resolved once rather than once per reference. `height` is the
+// number of nesting levels its resolution went through (1 when it refers to
+// nothing), which lets a cached value be checked against
+// max_interpolation_depth exactly as resolving it again would be.
+//
+// Option names compare as OptionIndex compares them and section names byte
+// for byte. The parser clears the cache whenever its contents change; a
+// mutex keeps concurrent const calls safe.
+class InterpolationCache {
+public:
+    // Calls `f(value, height)` under the lock when (section, option) is cached.
+    template <class F>
+    bool visit(std::string_view section, std::string_view option, F&& f) const {
+        const std::size_t h = hash(section, option);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const Entry* e = find(h, section, option)) {
+            f(e->value, e->height);
+            return true;
+        }
+        return false;
+    }
+
+    void insert(std::string_view section, std::string_view option, const std::string& value, int height) {
+        const std::size_t h = hash(section, option);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (find(h, section, option) == nullptr) {  // or another thread got there first
+            entries_.emplace(h, Entry{std::string(section), std::string(option), value, height});
+        }
+    }
+
+    void clear() noexcept {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+private:
+    struct Entry {
+        std::string section;
+        std::string option;
+        std::string value;
+        int height = 1;
+    };
+
+    static std::size_t hash(std::string_view section, std::string_view option) noexcept {
+        const std::size_t s = std::hash<std::string_view>()(section);
+        return s ^ (OptionIndex::hash(option) + 0x9e3779b9u + (s << 6) + (s >> 2));
+    }
+
+    const Entry* find(std::size_t h, std::string_view section, std::string_view option) const noexcept {
+        const auto [first, last] = entries_.equal_range(h);
+        for (auto it = first; it != last; ++it) {
+            if (it->second.section == section && OptionIndex::equal(it->second.option, option)) {
+                return &it->second;
+            }
+        }
+        return nullptr;
+    }
+
+    mutable std::mutex mutex_;
+    std::unordered_multimap<std::size_t, Entry> entries_;
+};
+
+}  // namespace detail
+}  // namespace ini
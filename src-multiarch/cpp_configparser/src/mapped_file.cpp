@@ -0,0 +1,144 @@
+#include "ini/mapped_file.hpp"
+
+#include <string>
+#include <utility>
+
+#include "ini/error.hpp"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ini {
+namespace {
+
+[[noreturn]] void fail(std::string_view what, std::string_view path) {
+    throw Error(ErrorCode::Parsing, std::string(what) + std::string(path));
+}
+
+}  // namespace
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(std::string_view path) {
+    HANDLE file = CreateFileA(std::string(path).c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        fail("cannot open file: ", path);
+    }
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        fail("cannot stat file: ", path);
+    }
+    if (size.QuadPart == 0) {
+        // Zero-length files cannot be mapped; an empty view is equivalent.
+        CloseHandle(file);
+        return;
+    }
+    mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping_ == nullptr) {
+        fail("cannot map file: ", path);
+    }
+    data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (data_ == nullptr) {
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+        fail("cannot map file: ", path);
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+}
+
+void MappedFile::reset() noexcept {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+    }
+    data_ = nullptr;
+    mapping_ = nullptr;
+    size_ = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      mapping_(std::exchange(other.mapping_, nullptr)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile(std::string_view path) {
+    const int fd = ::open(std::string(path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fail("cannot open file: ", path);
+    }
+    struct stat st = {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        fail("cannot stat file: ", path);
+    }
+    if (st.st_size == 0) {
+        // Zero-length files cannot be mapped; an empty view is equivalent.
+        ::close(fd);
+        return;
+    }
+    void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        fail("cannot map file: ", path);
+    }
+    data_ = p;
+    size_ = static_cast<std::size_t>(st.st_size);
+}
+
+void MappedFile::reset() noexcept {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<void*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        reset();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    reset();
+}
+
+}  // namespace ini
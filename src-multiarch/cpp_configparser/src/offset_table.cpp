@@ -0,0 +1,210 @@
+#include "ini/offset_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <string>
+
+#include "ini/decode.hpp"
+#include "ini/key_index.hpp"
+#include "ini/scan.hpp"
+#include "ini/version_index.hpp"
+
+namespace ini {
+namespace {
+
+constexpr std::size_t kSectionColumns = std::size(kWrapperOffsetKeys);
+constexpr std::size_t kSLInitColumns = std::size(kWrapperSLInitKeys);
+constexpr std::string_view kSLInitSuffix = "-SLInit";
+
+template <TargetArch Arch>
+constexpr std::array<StaticKey, OffsetTable::kColumnCount> make_column_keys() {
+    std::array<StaticKey, OffsetTable::kColumnCount> keys{};
+    for (std::size_t i = 0; i < kSectionColumns; ++i) {
+        keys[i] = arch_key<Arch>(kWrapperOffsetKeys[i]);
+    }
+    for (std::size_t i = 0; i < kSLInitColumns; ++i) {
+        keys[kSectionColumns + i] = arch_key<Arch>(kWrapperSLInitKeys[i]);
+    }
+    return keys;
+}
+
+template <TargetArch Arch>
+constexpr auto kColumnKeys = make_column_keys<Arch>();
+
+const StaticKey* column_keys(TargetArch arch) noexcept {
+    switch (arch) {
+    case TargetArch::X86:
+        return kColumnKeys<TargetArch::X86>.data();
+    case TargetArch::X64:
+        return kColumnKeys<TargetArch::X64>.data();
+    case TargetArch::Arm:
+        return kColumnKeys<TargetArch::Arm>.data();
+    case TargetArch::Arm64:
+        return kColumnKeys<TargetArch::Arm64>.data();
+    }
+    return nullptr;
+}
+
+constexpr TargetArch kArchs[] = {TargetArch::X86, TargetArch::X64, TargetArch::Arm, TargetArch::Arm64};
+static_assert(std::size(kArchs) == OffsetTable::kArchCount, "one column set per architecture");
+
+// Calls `emit(row)` for every row in [first, last) where `hit(row)` holds.
+// Rows are tested 64 at a time into a mask with no branch on the data, a
+// loop compilers turn into vector compares.
+template <class Hit, class Emit>
+void scan_rows(std::size_t first, std::size_t last, Hit&& hit, Emit&& emit) {
+    std::size_t row = first;
+    for (; row + 64 <= last; row += 64) {
+        std::uint64_t mask = 0;
+        for (unsigned j = 0; j < 64; ++j) {
+            mask |= static_cast<std::uint64_t>(hit(row + j)) << j;
+        }
+        while (mask != 0) {
+            emit(row + detail::lowest_bit(mask));
+            mask &= mask - 1;
+        }
+    }
+    for (; row < last; ++row) {
+        if (hit(row)) {
+            emit(row);
+        }
+    }
+}
+
+}  // namespace
+
+OffsetTable::OffsetTable(const Parser& config) {
+    struct Section {
+        std::uint64_t version;
+        bool slinit;
+        std::string name;
+    };
+    std::vector<Section> sections;
+    for (auto& name : config.sections()) {
+        std::string_view build = name;
+        const bool slinit = build.size() > kSLInitSuffix.size() &&
+                            build.substr(build.size() - kSLInitSuffix.size()) == kSLInitSuffix;
+        if (slinit) {
+            build.remove_suffix(kSLInitSuffix.size());
+        }
+        if (const auto version = parse_version(build)) {
+            sections.push_back({*version, slinit, std::move(name)});
+        }
+    }
+    std::sort(sections.begin(), sections.end(), [](const Section& a, const Section& b) {
+        return a.version < b.version;
+    });
+
+    for (const auto& s : sections) {
+        if (versions_.empty() || versions_.back() != s.version) {
+            versions_.push_back(s.version);
+        }
+    }
+    values_.assign(kArchCount * kColumnCount * versions_.size(), 0);
+    present_.assign(values_.size(), 0);
+
+    std::size_t row = 0;
+    std::optional<std::string_view> raw[kColumnCount];
+    for (std::size_t i = 0; i < sections.size(); ++i) {
+        if (i > 0 && sections[i].version != sections[i - 1].version) {
+            ++row;
+        }
+        const std::size_t first = sections[i].slinit ? kSectionColumns : 0;
+        const std::size_t count = sections[i].slinit ? kSLInitColumns : kSectionColumns;
+        for (const TargetArch arch : kArchs) {
+            if (!config.get_raw_batch(sections[i].name, column_keys(arch) + first, count, raw)) {
+                continue;
+            }
+            for (std::size_t c = 0; c < count; ++c) {
+                std::uint64_t n = 0;
+                if (raw[c].has_value() && decode_hex(*raw[c], n)) {
+                    const std::size_t i = cell(row, arch, first + c);
+                    values_[i] = n;
+                    present_[i] = 1;
+                }
+            }
+        }
+    }
+}
+
+std::string_view OffsetTable::column_name(std::size_t column) noexcept {
+    if (column < kSectionColumns) {
+        return kWrapperOffsetKeys[column];
+    }
+    if (column < kColumnCount) {
+        return kWrapperSLInitKeys[column - kSectionColumns];
+    }
+    return {};
+}
+
+std::size_t OffsetTable::find_column(std::string_view name) noexcept {
+    for (std::size_t c = 0; c < kColumnCount; ++c) {
+        if (OptionIndex::equal(column_name(c), name)) {
+            return c;
+        }
+    }
+    return npos;
+}
+
+std::size_t OffsetTable::find(std::uint64_t version) const noexcept {
+    const auto it = std::lower_bound(versions_.begin(), versions_.end(), version);
+    return it != versions_.end() && *it == version ? static_cast<std::size_t>(it - versions_.begin()) : npos;
+}
+
+std::size_t OffsetTable::floor(std::uint64_t version) const noexcept {
+    const auto it = std::upper_bound(versions_.begin(), versions_.end(), version);
+    return it == versions_.begin() ? npos : static_cast<std::size_t>(it - versions_.begin()) - 1;
+}
+
+std::size_t OffsetTable::nearest(std::uint64_t version) const noexcept {
+    if (versions_.empty()) {
+        return npos;
+    }
+    const std::size_t older = floor(version);
+    const std::size_t newer = older == npos ? 0 : older + 1;
+    if (older == npos) {
+        return newer;
+    }
+    if (newer == versions_.size()) {
+        return older;
+    }
+    return version - versions_[older] <= versions_[newer] - version ? older : newer;
+}
+
+std::vector<std::size_t> OffsetTable::changes(TargetArch arch, std::size_t col) const {
+    std::vector<std::size_t> out;
+    if (versions_.size() < 2) {
+        return out;
+    }
+    const std::uint64_t* values = column(arch, col);
+    const std::uint8_t* set = present(arch, col);
+    // Absent cells all hold 0, so two absent rows compare equal on value.
+    scan_rows(1, versions_.size(),
+              [values, set](std::size_t row) {
+                  return (set[row] != set[row - 1]) | (values[row] != values[row - 1]);
+              },
+              [&out](std::size_t row) { out.push_back(row); });
+    return out;
+}
+
+std::vector<std::size_t> OffsetTable::rows_with(TargetArch arch, std::size_t col, std::uint64_t value) const {
+    std::vector<std::size_t> out;
+    const std::uint64_t* values = column(arch, col);
+    const std::uint8_t* set = present(arch, col);
+    scan_rows(0, versions_.size(),
+              [values, set, value](std::size_t row) { return (set[row] != 0) & (values[row] == value); },
+              [&out](std::size_t row) { out.push_back(row); });
+    return out;
+}
+
+std::size_t OffsetTable::count_present(TargetArch arch, std::size_t col) const noexcept {
+    const std::uint8_t* set = present(arch, col);
+    std::size_t n = 0;
+    for (std::size_t row = 0; row < versions_.size(); ++row) {
+        n += set[row];
+    }
+    return n;
+}
+
+}  // namespace ini
@@ -1,57 +1,69 @@
 #include "ini/parser.hpp"
 
+#include "ini/mapped_file.hpp"
+#include "storage.hpp"
+
 #include <algorithm>
-#include <cctype>
+#include <atomic>
 #include <charconv>
+#include <climits>
 #include <cstdlib>
+#include <exception>
 #include <fstream>
-#include <sstream>
+#include <system_error>
+#include <thread>
+#include <utility>
 
 namespace ini {
 namespace {
 
-std::string trim_copy(std::string_view sv) {
-    std::size_t start = 0;
-    while (start < sv.size() && std::isspace(static_cast<unsigned char>(sv[start])) != 0) {
-        ++start;
-    }
-    std::size_t end = sv.size();
-    while (end > start && std::isspace(static_cast<unsigned char>(sv[end - 1])) != 0) {
-        --end;
-    }
-    return std::string(sv.substr(start, end - start));
+std::string to_lower(std::string_view s) {
+    std::string out(s);
+    std::transform(out.begin(), out.end(), out.begin(), [](char c) {
+        return OptionIndex::fold(c);
+    });
+    return out;
 }
 
-bool starts_with(std::string_view s, std::string_view prefix) {
-    return s.size() >= prefix.size() && s.substr(0, prefix.size()) == prefix;
-}
+// Parallel reads cut the input into pieces of at least this many bytes,
+// about this many per thread so that uneven pieces even out.
+constexpr std::size_t kMinParallelChunk = 128 * 1024;
+constexpr std::size_t kChunksPerThread = 4;
 
-std::string join_lines(const std::vector<std::string>& lines) {
-    std::ostringstream oss;
-    for (std::size_t i = 0; i < lines.size(); ++i) {
-        if (i != 0) {
-            oss << '\n';
-        }
-        oss << lines[i];
+using detail::OptionTable;
+using detail::SectionData;
+using detail::StoredOption;
+using detail::view_of;
+
+// Throws the errors collected over a whole read as one ParsingError.
+void throw_if_errors(const std::vector<ParsingError>& errors) {
+    if (errors.empty()) {
+        return;
     }
-    std::string out = oss.str();
-    while (!out.empty() && std::isspace(static_cast<unsigned char>(out.back())) != 0) {
-        out.pop_back();
+    ParsingError combined(errors.front().source(), errors.front().line(), errors.front().entries().front().text);
+    for (std::size_t i = 1; i < errors.size(); ++i) {
+        for (const auto& e : errors[i].entries()) {
+            combined.append(e.line, e.text);
+        }
     }
-    return out;
+    throw combined;
 }
 
-std::string to_lower(std::string_view s) {
-    std::string out(s);
-    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) {
-        return static_cast<char>(std::tolower(c));
-    });
+SectionItems to_section_items(const OptionTable& table) {
+    SectionItems out;
+    out.reserve(table.items.size());
+    for (const auto& e : table.items) {
+        out.emplace_back(std::string(view_of(e.key)), detail::to_option_value(e.value));
+    }
     return out;
 }
 
 }  // namespace
 
 bool SectionView::has_option(std::string_view option) const {
+    if (table_ != nullptr) {
+        return table_->find(option) != nullptr;
+    }
     if (items_ == nullptr) {
         return false;
     }
@@ -62,6 +74,14 @@ bool SectionView::has_option(std::string_view option) const {
 }
 
 const OptionValue& SectionView::at(std::string_view option) const {
+    if (table_ != nullptr) {
+        const auto* e = table_->find(option);
+        if (e == nullptr) {
+            throw Error(ErrorCode::NoOption, "option not found");
+        }
+        // The index finds the entry; section_items() lists them in the same order.
+        return table_->section_items()[static_cast<std::size_t>(e - table_->items.data())].second;
+    }
     if (items_ == nullptr) {
         throw Error(ErrorCode::NoSection, "section not found");
     }
@@ -75,18 +95,61 @@ const OptionValue& SectionView::at(std::string_view option) const {
 }
 
 const SectionItems& SectionView::items() const {
+    if (table_ != nullptr) {
+        return table_->section_items();
+    }
     if (items_ == nullptr) {
         throw Error(ErrorCode::NoSection, "section not found");
     }
     return *items_;
 }
 
-Parser::Parser(ParseOptions options) : options_(std::move(options)) {}
+Parser::Parser(ParseOptions options)
+    : options_(std::move(options)),
+      store_(std::make_unique<detail::Storage>(options_.storage)) {}
+
+Parser::~Parser() = default;
+
+Parser::Parser(const Parser& other)
+    : options_(other.options_),
+      store_(std::make_unique<detail::Storage>(options_.storage)) {
+    store_->copy_from(*other.store_);
+}
+
+Parser& Parser::operator=(const Parser& other) {
+    if (this != &other) {
+        Parser copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+// A moved-from parser is left empty and usable: it keeps its options and
+// gets storage of its own.
+Parser::Parser(Parser&& other) noexcept
+    : options_(other.options_), store_(std::move(other.store_)) {
+    other.store_ = std::make_unique<detail::Storage>(other.options_.storage);
+}
+
+Parser& Parser::operator=(Parser&& other) noexcept {
+    if (this != &other) {
+        options_ = other.options_;
+        store_ = std::move(other.store_);
+        other.store_ = std::make_unique<detail::Storage>(other.options_.storage);
+    }
+    return *this;
+}
 
 void Parser::clear() {
-    defaults_.clear();
-    sections_.clear();
-    section_index_.clear();
+    store_ = std::make_unique<detail::Storage>(options_.storage);
+}
+
+StorageStats Parser::storage_stats() const noexcept {
+    return store_->stats();
+}
+
+std::size_t Parser::pending_section_count() const noexcept {
+    return store_->pending_sections;
 }
 
 std::string Parser::option_xform(std::string_view option) const {
@@ -97,41 +160,65 @@ void Parser::add_section(std::string section) {
     if (section == options_.default_section) {
         throw Error(ErrorCode::DuplicateSection, "invalid section name: default section");
     }
-    if (section_index_.find(section) != section_index_.end()) {
+    if (store_->find_section(section) != SectionIndex::npos) {
         throw Error(ErrorCode::DuplicateSection, "duplicate section: " + section);
     }
-    const std::size_t idx = sections_.size();
-    sections_.push_back({std::move(section), {}});
-    section_index_.insert({sections_[idx].first, idx});
+    store_->interpolated.clear();
+    store_->append_section(section);
 }
 
 bool Parser::has_section(std::string_view section) const {
     if (section == options_.default_section) {
         return true;
     }
-    return section_index_.find(std::string(section)) != section_index_.end();
+    return store_->find_section(section) != SectionIndex::npos;
 }
 
-const SectionItems* Parser::find_section_items(std::string_view section) const {
+const OptionTable* Parser::find_section_items(std::string_view section) const {
     if (section == options_.default_section) {
-        return &defaults_;
+        return &store_->defaults;
     }
-    auto it = section_index_.find(std::string(section));
-    if (it == section_index_.end()) {
+    const auto pos = store_->find_section(section);
+    if (pos == SectionIndex::npos) {
         return nullptr;
     }
-    return &sections_[it->second].second;
+    auto& sec = store_->sections[pos];
+    if (!sec.pending.empty()) {
+        load_pending(sec);
+    }
+    return &sec.options;
 }
 
-SectionItems* Parser::find_section_items_mut(std::string_view section) {
-    if (section == options_.default_section) {
-        return &defaults_;
+OptionTable* Parser::find_section_items_mut(std::string_view section) {
+    return const_cast<OptionTable*>(std::as_const(*this).find_section_items(section));
+}
+
+namespace {
+
+// Looks `option` up in `sec`, falling back to the defaults for any section
+// other than the default section itself.
+template <class Key>
+const StoredOption* find_option(
+    const detail::Storage& store,
+    const OptionTable* sec,
+    std::string_view section,
+    const Key& option,
+    std::string_view default_section) noexcept {
+    if (sec != nullptr) {
+        if (const auto* e = sec->find(option)) {
+            return e;
+        }
     }
-    auto it = section_index_.find(std::string(section));
-    if (it == section_index_.end()) {
-        return nullptr;
+    if (section != default_section) {
+        return store.defaults.find(option);
     }
-    return &sections_[it->second].second;
+    return nullptr;
+}
+
+}  // namespace
+
+SectionView Parser::section(std::string_view section) const {
+    return SectionView(find_section_items(section));
 }
 
 bool Parser::has_option(std::string_view section, std::string_view option) const {
@@ -139,27 +226,14 @@ bool Parser::has_option(std::string_view section, std::string_view option) const
     if (sec == nullptr) {
         return false;
     }
-    const auto needle = option_xform(option);
-    for (const auto& e : *sec) {
-        if (e.first == needle) {
-            return true;
-        }
-    }
-    if (section != options_.default_section) {
-        for (const auto& e : defaults_) {
-            if (e.first == needle) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return find_option(*store_, sec, section, option, options_.default_section) != nullptr;
 }
 
 std::vector<std::string> Parser::sections() const {
     std::vector<std::string> out;
-    out.reserve(sections_.size());
-    for (const auto& sec : sections_) {
-        out.push_back(sec.first);
+    out.reserve(store_->sections.size());
+    for (const auto& sec : store_->sections) {
+        out.emplace_back(view_of(sec.name));
     }
     return out;
 }
@@ -170,97 +244,82 @@ std::vector<std::string> Parser::options(std::string_view section) const {
         throw Error(ErrorCode::NoSection, "No section: " + std::string(section));
     }
     std::vector<std::string> out;
-    for (const auto& e : *sec) {
-        out.push_back(e.first);
+    for (const auto& e : sec->items) {
+        out.emplace_back(view_of(e.key));
     }
     if (section != options_.default_section) {
-        for (const auto& e : defaults_) {
-            if (std::find(out.begin(), out.end(), e.first) == out.end()) {
-                out.push_back(e.first);
+        for (const auto& e : store_->defaults.items) {
+            if (sec->find(view_of(e.key)) == nullptr) {
+                out.emplace_back(view_of(e.key));
             }
         }
     }
     return out;
 }
 
-std::string Parser::strip_comment(std::string_view line) const {
-    auto t = trim_copy(line);
-    if (t.empty()) {
-        return t;
-    }
-
-    for (const auto& prefix : options_.comment_prefixes) {
-        if (!prefix.empty() && starts_with(t, prefix)) {
-            return "";
-        }
-    }
-
-    std::string out = std::string(line);
-    for (const auto& prefix : options_.inline_comment_prefixes) {
-        if (prefix.empty()) {
-            continue;
-        }
-        std::size_t pos = out.find(prefix);
-        while (pos != std::string::npos) {
-            const bool at_start = (pos == 0);
-            const bool has_space_before = !at_start && std::isspace(static_cast<unsigned char>(out[pos - 1])) != 0;
-            if (at_start || has_space_before) {
-                out.erase(pos);
-                break;
-            }
-            pos = out.find(prefix, pos + 1);
-        }
-    }
-
-    return trim_copy(out);
-}
-
 void Parser::finish_multiline(
     const std::string& section,
     const std::string& option,
-    std::vector<std::string>& multiline_accum) {
+    std::vector<std::string_view>& multiline_accum) {
     if (option.empty()) {
         multiline_accum.clear();
         return;
     }
+
+    // Trailing blank lines never make it into the value. When only the first
+    // line is left, the value stored by parse_line is already final.
+    std::size_t last = multiline_accum.size();
+    while (last > 0 && multiline_accum[last - 1].empty()) {
+        --last;
+    }
+    if (last <= 1) {
+        multiline_accum.clear();
+        return;
+    }
+
     auto* sec = find_section_items_mut(section);
     if (sec == nullptr) {
         throw Error(ErrorCode::NoSection, "No section: " + section);
     }
-    for (auto& e : *sec) {
-        if (e.first == option) {
-            e.second = join_lines(multiline_accum);
-            multiline_accum.clear();
-            return;
+    // The stored value holds the first line; store the joined lines once.
+    auto* e = sec->find(option);
+    if (e != nullptr && e->value.has_value()) {
+        std::size_t size = e->value->size();
+        for (std::size_t i = 1; i < last; ++i) {
+            size += 1 + multiline_accum[i].size();
+        }
+        std::string joined;
+        joined.reserve(size);
+        joined.append(view_of(*e->value));
+        for (std::size_t i = 1; i < last; ++i) {
+            joined.push_back('\n');
+            joined.append(multiline_accum[i].data(), multiline_accum[i].size());
         }
+        sec->assign(*e, joined);
     }
     multiline_accum.clear();
 }
 
 void Parser::parse_line(
-    const std::string& original_line,
-    const std::string& cleaned_line,
+    const Token& tok,
     const std::string& source,
-    int line_no,
     std::string& current_section,
     std::string& current_option,
-    std::vector<std::string>& multiline_accum,
+    std::vector<std::string_view>& multiline_accum,
     bool& in_multiline,
     std::vector<ParsingError>& errors) {
 
-    const bool indented = !original_line.empty() && std::isspace(static_cast<unsigned char>(original_line[0])) != 0;
-
-    if (cleaned_line.empty()) {
+    if (tok.kind == TokenKind::Blank) {
         if (in_multiline && options_.empty_lines_in_values) {
-            multiline_accum.push_back("");
+            multiline_accum.push_back({});
         } else {
             in_multiline = false;
         }
         return;
     }
 
-    if (in_multiline && indented && !current_option.empty()) {
-        multiline_accum.push_back(cleaned_line);
+    if (in_multiline && tok.indented && !current_option.empty()) {
+        multiline_accum.push_back(tok.cleaned);
         return;
     }
 
@@ -269,23 +328,21 @@ void Parser::parse_line(
         in_multiline = false;
     }
 
-    if (cleaned_line.front() == '[' && cleaned_line.back() == ']') {
-        current_section = cleaned_line.substr(1, cleaned_line.size() - 2);
+    if (tok.kind == TokenKind::Section) {
+        current_section.assign(tok.name);
         current_option.clear();
         if (current_section.empty()) {
-            errors.emplace_back(source, line_no, original_line);
+            errors.emplace_back(source, tok.line_no, std::string(tok.raw));
             return;
         }
-        if (current_section != options_.default_section && section_index_.find(current_section) == section_index_.end()) {
-            const std::size_t idx = sections_.size();
-            sections_.push_back({current_section, {}});
-            section_index_.insert({current_section, idx});
+        if (current_section != options_.default_section && store_->find_section(current_section) == SectionIndex::npos) {
+            store_->append_section(current_section);
         } else if (current_section != options_.default_section && options_.strict) {
             throw LocatedError(
                 ErrorCode::DuplicateSection,
                 "duplicate section: " + current_section,
                 source,
-                line_no);
+                tok.line_no);
         }
         return;
     }
@@ -293,48 +350,25 @@ void Parser::parse_line(
     if (current_section.empty()) {
         if (options_.allow_unnamed_section) {
             current_section = kUnnamedSectionName;
-            if (section_index_.find(current_section) == section_index_.end()) {
-                const std::size_t idx = sections_.size();
-                sections_.push_back({current_section, {}});
-                section_index_.insert({current_section, idx});
+            if (store_->find_section(current_section) == SectionIndex::npos) {
+                store_->append_section(current_section);
             }
         } else {
             throw LocatedError(
                 ErrorCode::MissingSectionHeader,
                 "File contains no section headers",
                 source,
-                line_no);
-        }
-    }
-
-    std::size_t found_at = std::string::npos;
-    std::string used_delim;
-    for (const auto& d : options_.delimiters) {
-        auto pos = cleaned_line.find(d);
-        if (pos != std::string::npos && (found_at == std::string::npos || pos < found_at)) {
-            found_at = pos;
-            used_delim = d;
+                tok.line_no);
         }
     }
 
-    std::string key;
-    OptionValue value;
-
-    if (found_at == std::string::npos) {
-        if (!options_.allow_no_value) {
-            errors.emplace_back(source, line_no, original_line);
-            return;
-        }
-        key = trim_copy(cleaned_line);
-        value = std::nullopt;
-    } else {
-        key = trim_copy(cleaned_line.substr(0, found_at));
-        std::string right = trim_copy(cleaned_line.substr(found_at + used_delim.size()));
-        value = right;
+    if (tok.kind == TokenKind::Bare && !options_.allow_no_value) {
+        errors.emplace_back(source, tok.line_no, std::string(tok.raw));
+        return;
     }
 
-    if (key.empty()) {
-        errors.emplace_back(source, line_no, original_line);
+    if (tok.key.empty()) {
+        errors.emplace_back(source, tok.line_no, std::string(tok.raw));
         return;
     }
 
@@ -343,28 +377,28 @@ void Parser::parse_line(
         throw Error(ErrorCode::NoSection, "No section: " + current_section);
     }
 
-    key = option_xform(key);
+    std::optional<std::string_view> value;
+    if (tok.has_delimiter) {
+        value = tok.value;
+    }
 
-    auto it = std::find_if(sec->begin(), sec->end(), [&](const OptionEntry& e) {
-        return e.first == key;
-    });
-    if (it != sec->end()) {
+    if (auto* existing = sec->find(tok.key)) {
         if (options_.strict) {
             throw LocatedError(
                 ErrorCode::DuplicateOption,
-                "duplicate option: " + key,
+                "duplicate option: " + option_xform(tok.key),
                 source,
-                line_no);
+                tok.line_no);
         }
-        it->second = value;
+        sec->assign(*existing, value);
+        current_option.assign(view_of(existing->key));
     } else {
-        sec->push_back({key, value});
+        current_option.assign(view_of(sec->append(tok.key, value).key));
     }
 
-    current_option = key;
     multiline_accum.clear();
-    if (value.has_value()) {
-        multiline_accum.push_back(*value);
+    if (tok.has_delimiter) {
+        multiline_accum.push_back(tok.value);
         in_multiline = true;
     } else {
         in_multiline = false;
@@ -374,25 +408,23 @@ void Parser::parse_line(
 void Parser::join_multiline_values() {
 }
 
-void Parser::read_string(std::string_view text, std::string_view source) {
-    std::istringstream iss{std::string(text)};
-    std::string line;
+void Parser::parse_text(
+    std::string_view text,
+    const std::string& source,
+    int first_line,
+    std::string current_section,
+    std::vector<ParsingError>& errors) {
+    Tokenizer tokenizer(text, options_, first_line);
+    Token tok;
 
-    std::string current_section;
     std::string current_option;
-    std::vector<std::string> multiline_accum;
+    std::vector<std::string_view> multiline_accum;
     bool in_multiline = false;
-    std::vector<ParsingError> errors;
 
-    int line_no = 0;
-    while (std::getline(iss, line)) {
-        ++line_no;
-        std::string cleaned = strip_comment(line);
+    while (tokenizer.next(tok)) {
         parse_line(
-            line,
-            cleaned,
-            std::string(source),
-            line_no,
+            tok,
+            source,
             current_section,
             current_option,
             multiline_accum,
@@ -403,48 +435,392 @@ void Parser::read_string(std::string_view text, std::string_view source) {
     if (in_multiline && !current_option.empty()) {
         finish_multiline(current_section, current_option, multiline_accum);
     }
+}
+
+void Parser::read_string(std::string_view text, std::string_view source) {
+    store_->interpolated.clear();
+    if (options_.section_loading == SectionLoading::Lazy) {
+        read_lazy(std::make_shared<const std::string>(text), source);
+        return;
+    }
 
-    if (!errors.empty()) {
-        ParsingError combined(errors.front().source(), errors.front().line(), errors.front().entries().front().text);
-        for (std::size_t i = 1; i < errors.size(); ++i) {
-            for (const auto& e : errors[i].entries()) {
-                combined.append(e.line, e.text);
+    const std::string source_name(source);
+    std::vector<ParsingError> errors;
+    if (!read_parallel(text, source_name, errors)) {
+        parse_text(text, source_name, 0, std::string(), errors);
+    }
+    throw_if_errors(errors);
+
+    join_multiline_values();
+}
+
+bool Parser::read_parallel(std::string_view text, const std::string& source, std::vector<ParsingError>& errors) {
+    unsigned threads = options_.parse_threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads < 2 || text.size() < 2 * kMinParallelChunk) {
+        return false;
+    }
+
+    struct Header {
+        std::string_view name;
+        std::size_t begin;  // offset of the header line
+        int line_no;
+    };
+    std::vector<Header> headers;
+    std::size_t default_headers = 0;
+    Tokenizer scanner(text, options_);
+    Token tok;
+    while (scanner.next_header(tok)) {
+        if (tok.indented || tok.name.empty()) {
+            // Depends on the lines before it; see read_lazy().
+            return false;
+        }
+        default_headers += tok.name == options_.default_section;
+        headers.push_back({tok.name, static_cast<std::size_t>(tok.raw.data() - text.data()), tok.line_no});
+    }
+    // A strict duplicate option in the default section can span pieces, and
+    // only a sequential read knows on which line it sits.
+    if (options_.strict && default_headers > 0 && (default_headers > 1 || !store_->defaults.items.empty())) {
+        return false;
+    }
+
+    // Each piece starts at a header line (the first one also takes whatever
+    // precedes the first header), so it opens with a known section and no
+    // multi-line value runs into it.
+    struct Chunk {
+        std::size_t begin;
+        std::size_t end;
+        std::size_t first_header;  // headers[first_header, last_header) fall inside
+        std::size_t last_header;
+        int first_line;            // lines before the piece
+    };
+    const std::size_t target = std::max(kMinParallelChunk, text.size() / (threads * kChunksPerThread));
+    std::vector<Chunk> chunks;
+    chunks.push_back({0, text.size(), 0, headers.size(), 0});
+    for (std::size_t i = 0; i < headers.size(); ++i) {
+        auto& last = chunks.back();
+        if (headers[i].begin - last.begin >= target && text.size() - headers[i].begin >= target) {
+            last.end = headers[i].begin;
+            last.last_header = i;
+            chunks.push_back({headers[i].begin, text.size(), i, headers.size(), headers[i].line_no - 1});
+        }
+    }
+    if (chunks.size() < 2) {
+        return false;
+    }
+
+    struct Result {
+        explicit Result(const ParseOptions& options) : parser(options) {}
+
+        Parser parser;
+        std::vector<ParsingError> errors;
+        std::exception_ptr failure;
+        int failed_at = INT_MAX;  // line of a located failure, 0 for any other
+    };
+    auto piece_options = options_;
+    piece_options.section_loading = SectionLoading::Eager;
+    piece_options.parse_threads = 1;
+    std::vector<Result> results;
+    results.reserve(chunks.size());
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        results.emplace_back(piece_options);
+    }
+
+    std::atomic<std::size_t> next{0};
+    const auto work = [&] {
+        for (std::size_t i = next++; i < chunks.size(); i = next++) {
+            auto& r = results[i];
+            const auto& c = chunks[i];
+            try {
+                r.parser.parse_text(text.substr(c.begin, c.end - c.begin), source, c.first_line, std::string(), r.errors);
+            } catch (const LocatedError& e) {
+                r.failure = std::current_exception();
+                r.failed_at = e.line();
+            } catch (...) {
+                r.failure = std::current_exception();
+                r.failed_at = 0;
             }
         }
-        throw combined;
+    };
+    std::vector<std::thread> pool;
+    try {
+        for (std::size_t t = 1; t < std::min<std::size_t>(threads, chunks.size()); ++t) {
+            pool.emplace_back(work);
+        }
+    } catch (const std::system_error&) {
+        // Fewer threads than asked for; the calling thread picks up the rest.
+    }
+    work();
+    for (auto& t : pool) {
+        t.join();
     }
 
-    join_multiline_values();
+    // Merge in input order, stopping where a sequential read would have
+    // thrown: at the first duplicate of a section from an earlier piece or
+    // at the piece's own failure, whichever comes first.
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        auto& r = results[i];
+        if (options_.strict) {
+            for (std::size_t h = chunks[i].first_header; h < chunks[i].last_header; ++h) {
+                const auto& header = headers[h];
+                if (header.line_no >= r.failed_at) {
+                    break;
+                }
+                if (header.name != options_.default_section && store_->find_section(header.name) != SectionIndex::npos) {
+                    throw LocatedError(
+                        ErrorCode::DuplicateSection,
+                        "duplicate section: " + std::string(header.name),
+                        source,
+                        header.line_no);
+                }
+            }
+        }
+        if (r.failure) {
+            std::rethrow_exception(r.failure);
+        }
+
+        // New sections move over as they are; in arena mode together with
+        // the arena holding them.
+        auto& piece = *r.parser.store_;
+        if (piece.arena) {
+            store_->adopted_arenas.push_back(std::move(piece.arena));
+        }
+        store_->defaults.merge_from(piece.defaults);
+        for (auto& sec : piece.sections) {
+            const auto pos = store_->find_section(view_of(sec.name));
+            if (pos != SectionIndex::npos) {
+                store_->sections[pos].options.merge_from(sec.options);
+            } else {
+                store_->adopt_section(std::move(sec));
+            }
+        }
+        errors.insert(errors.end(), std::make_move_iterator(r.errors.begin()), std::make_move_iterator(r.errors.end()));
+    }
+    return true;
+}
+
+void Parser::read_lazy(std::shared_ptr<const std::string> owned, std::string_view source) {
+    store_->interpolated.clear();
+    const std::string_view text(*owned);
+    const std::string source_name(source);
+
+    struct Header {
+        std::string_view name;
+        std::size_t begin;  // offset of the header line
+        std::size_t body;   // offset of the line after it
+        int line_no;
+    };
+    std::vector<Header> headers;
+    std::vector<ParsingError> errors;
+
+    Tokenizer scanner(text, options_);
+    Token tok;
+    while (scanner.next_header(tok)) {
+        if (tok.indented || tok.name.empty()) {
+            // Whether this line opens a section depends on the lines before
+            // it, which only a full parse knows.
+            parse_text(text, source_name, 0, std::string(), errors);
+            throw_if_errors(errors);
+            return;
+        }
+        const auto begin = static_cast<std::size_t>(tok.raw.data() - text.data());
+        const auto nl = text.find('\n', begin);
+        headers.push_back({tok.name, begin, nl == std::string_view::npos ? text.size() : nl + 1, tok.line_no});
+    }
+
+    // Lines before the first header and the default section are needed by
+    // every lookup, so they are parsed right away.
+    parse_text(text.substr(0, headers.empty() ? text.size() : headers.front().begin), source_name, 0, std::string(), errors);
+
+    const std::size_t source_index = store_->sources.size();
+    store_->sources.push_back({std::move(owned), source_name});
+
+    for (std::size_t i = 0; i < headers.size(); ++i) {
+        const auto& h = headers[i];
+        const auto end = i + 1 < headers.size() ? headers[i + 1].begin : text.size();
+        const auto body = text.substr(h.body, end - h.body);
+
+        if (h.name == options_.default_section) {
+            parse_text(body, source_name, h.line_no, std::string(h.name), errors);
+            continue;
+        }
+
+        const auto slot = store_->find_section(h.name);
+        auto* sec = slot == SectionIndex::npos ? &store_->append_section(h.name) : &store_->sections[slot];
+        if (slot != SectionIndex::npos && options_.strict) {
+            throw LocatedError(
+                ErrorCode::DuplicateSection,
+                "duplicate section: " + std::string(h.name),
+                source_name,
+                h.line_no);
+        }
+        if (body.empty()) {
+            continue;
+        }
+        if (sec->pending.empty()) {
+            ++store_->pending_sections;
+        }
+        sec->pending.push_back({body, h.line_no, source_index});
+    }
+
+    throw_if_errors(errors);
+}
+
+void Parser::load_pending(detail::SectionData& sec) const {
+    // Filling a deferred section in changes nothing a caller can observe
+    // apart from the errors it may raise, so const accessors are allowed to.
+    auto* self = const_cast<Parser*>(this);
+    std::pmr::vector<detail::PendingSpan> spans(std::move(sec.pending));
+    sec.pending.clear();
+    --store_->pending_sections;
+
+    const std::string name(view_of(sec.name));
+    std::vector<ParsingError> errors;
+    for (const auto& span : spans) {
+        self->parse_text(span.text, store_->sources[span.source].name, span.first_line, name, errors);
+    }
+    throw_if_errors(errors);
+}
+
+void Parser::load_all_pending() const {
+    if (store_->pending_sections == 0) {
+        return;
+    }
+    for (auto& sec : store_->sections) {
+        if (!sec.pending.empty()) {
+            load_pending(sec);
+        }
+    }
 }
 
 void Parser::read_file(std::string_view path) {
-    std::ifstream ifs{std::string(path)};
+    if (options_.file_read_mode == FileReadMode::Mapped) {
+        // Everything read_string stores is copied out of the input, so the
+        // mapping only has to outlive the parse itself. Lazy loading keeps a
+        // private copy instead of the mapping, which on Windows would stop
+        // the file from being rewritten while the parser is alive.
+        const MappedFile file(path);
+        read_string(file.view(), path);
+        return;
+    }
+
+    std::ifstream ifs(std::string(path), std::ios::binary);
     if (!ifs) {
         throw Error(ErrorCode::Parsing, "cannot open file: " + std::string(path));
     }
-    std::ostringstream oss;
-    oss << ifs.rdbuf();
-    read_string(oss.str(), path);
+    ifs.seekg(0, std::ios::end);
+    const auto size = ifs.tellg();
+    ifs.seekg(0, std::ios::beg);
+    std::string text(size > 0 ? static_cast<std::size_t>(size) : 0, '\0');
+    if (!text.empty() && !ifs.read(text.data(), static_cast<std::streamsize>(text.size()))) {
+        throw Error(ErrorCode::Parsing, "cannot read file: " + std::string(path));
+    }
+    if (options_.section_loading == SectionLoading::Lazy) {
+        read_lazy(std::make_shared<const std::string>(std::move(text)), path);
+        return;
+    }
+    read_string(text, path);
 }
 
-OptionValue Parser::get_raw(std::string_view section, std::string_view option) const {
-    const auto* sec = find_section_items(section);
-    const auto key = option_xform(option);
+bool Parser::find(
+    std::string_view section,
+    std::string_view option,
+    std::optional<std::string_view>* value) const noexcept {
+    if (value != nullptr) {
+        value->reset();
+    }
+    const OptionTable* sec = nullptr;
+    try {
+        sec = find_section_items(section);
+    } catch (...) {
+        return false;
+    }
+    const auto* e = find_option(*store_, sec, section, option, options_.default_section);
+    if (e == nullptr) {
+        return false;
+    }
+    if (value != nullptr && e->value.has_value()) {
+        *value = view_of(*e->value);
+    }
+    return true;
+}
 
-    if (sec != nullptr) {
-        for (const auto& e : *sec) {
-            if (e.first == key) {
-                return e.second;
-            }
+std::optional<std::string_view> Parser::try_get_raw(std::string_view section, std::string_view option) const noexcept {
+    std::optional<std::string_view> value;
+    find(section, option, &value);
+    return value;
+}
+
+namespace {
+
+// get_raw_batch() once `sec` is known, for either kind of key.
+template <class Key>
+void batch_values(
+    const detail::Storage& store,
+    const OptionTable* sec,
+    std::string_view section,
+    const Key* options,
+    std::size_t count,
+    std::optional<std::string_view>* values,
+    std::string_view default_section) noexcept {
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto* e = find_option(store, sec, section, options[i], default_section);
+        if (e != nullptr && e->value.has_value()) {
+            values[i] = view_of(*e->value);
         }
     }
+}
 
-    if (section != options_.default_section) {
-        for (const auto& e : defaults_) {
-            if (e.first == key) {
-                return e.second;
-            }
-        }
+}  // namespace
+
+bool Parser::get_raw_batch(
+    std::string_view section,
+    const std::string_view* options,
+    std::size_t count,
+    std::optional<std::string_view>* values) const noexcept {
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i].reset();
+    }
+    const OptionTable* sec = nullptr;
+    try {
+        sec = find_section_items(section);
+    } catch (...) {
+        return false;
+    }
+    if (sec == nullptr) {
+        return false;
+    }
+    batch_values(*store_, sec, section, options, count, values, options_.default_section);
+    return true;
+}
+
+bool Parser::get_raw_batch(
+    std::string_view section,
+    const StaticKey* options,
+    std::size_t count,
+    std::optional<std::string_view>* values) const noexcept {
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i].reset();
+    }
+    const OptionTable* sec = nullptr;
+    try {
+        sec = find_section_items(section);
+    } catch (...) {
+        return false;
+    }
+    if (sec == nullptr) {
+        return false;
+    }
+    batch_values(*store_, sec, section, options, count, values, options_.default_section);
+    return true;
+}
+
+OptionValue Parser::get_raw(std::string_view section, std::string_view option) const {
+    const auto* sec = find_section_items(section);
+    if (const auto* e = find_option(*store_, sec, section, option, options_.default_section)) {
+        return detail::to_option_value(e->value);
     }
 
     if (sec == nullptr && section != options_.default_section) {
@@ -458,7 +834,14 @@ std::string Parser::interpolate(
     std::string_view section,
     std::string_view option,
     std::string_view value,
-    int depth) const {
+    int depth,
+    const detail::InterpolationFrame* chain,
+    int* height) const {
+    int levels = 1;
+    if (height == nullptr) {
+        height = &levels;
+    }
+    *height = 1;
     if (options_.interpolation == InterpolationMode::None) {
         return std::string(value);
     }
@@ -467,22 +850,60 @@ std::string Parser::interpolate(
             ErrorCode::InterpolationDepth,
             "Recursion limit exceeded in value substitution for option '" + std::string(option) + "' in section '" + std::string(section) + "'");
     }
-    if (options_.interpolation == InterpolationMode::Basic) {
-        return interpolate_basic(section, value, depth);
+    const bool basic = options_.interpolation == InterpolationMode::Basic;
+    if (value.find(basic ? '%' : '$') == std::string_view::npos) {
+        return std::string(value);
+    }
+    for (const auto* frame = chain; frame != nullptr; frame = frame->parent) {
+        if (frame->section == section && OptionIndex::equal(frame->option, option)) {
+            throw Error(
+                ErrorCode::InterpolationDepth,
+                "Interpolation cycle: option '" + std::string(option) + "' in section '" + std::string(section) + "' refers to itself");
+        }
+    }
+
+    std::string out;
+    bool cached = false;
+    store_->interpolated.visit(section, option, [&](const std::string& resolved, int resolved_height) {
+        // A value too deep to use at this level is resolved again, so the
+        // error names the option an uncached call would have named.
+        if (depth + resolved_height - 1 <= options_.max_interpolation_depth) {
+            out = resolved;
+            *height = resolved_height;
+            cached = true;
+        }
+    });
+    if (cached) {
+        return out;
+    }
+
+    const detail::InterpolationFrame frame{section, option, chain};
+    int below = 0;
+    if (basic) {
+        interpolate_basic(section, value, depth, frame, out, below);
+    } else {
+        interpolate_extended(section, value, depth, frame, out, below);
     }
-    return interpolate_extended(section, value, depth);
+    *height = below + 1;
+    store_->interpolated.insert(section, option, out, *height);
+    return out;
 }
 
-std::string Parser::interpolate_basic(
+void Parser::interpolate_basic(
     std::string_view section,
     std::string_view value,
-    int depth) const {
-    std::string out;
+    int depth,
+    const detail::InterpolationFrame& frame,
+    std::string& out,
+    int& height) const {
     for (std::size_t i = 0; i < value.size();) {
-        if (value[i] != '%') {
-            out.push_back(value[i++]);
-            continue;
+        const auto percent = value.find('%', i);
+        if (percent == std::string_view::npos) {
+            out.append(value.data() + i, value.size() - i);
+            break;
         }
+        out.append(value.data() + i, percent - i);
+        i = percent;
         if (i + 1 >= value.size()) {
             throw Error(ErrorCode::InterpolationSyntax, "'%' must be followed by '%' or '(' ");
         }
@@ -505,22 +926,28 @@ std::string Parser::interpolate_basic(
             i = close + 2;
             continue;
         }
-        out += interpolate(section, key, *replacement, depth + 1);
+        int h = 0;
+        out += interpolate(section, key, *replacement, depth + 1, &frame, &h);
+        height = std::max(height, h);
         i = close + 2;
     }
-    return out;
 }
 
-std::string Parser::interpolate_extended(
+void Parser::interpolate_extended(
     std::string_view section,
     std::string_view value,
-    int depth) const {
-    std::string out;
+    int depth,
+    const detail::InterpolationFrame& frame,
+    std::string& out,
+    int& height) const {
     for (std::size_t i = 0; i < value.size();) {
-        if (value[i] != '$') {
-            out.push_back(value[i++]);
-            continue;
+        const auto dollar = value.find('$', i);
+        if (dollar == std::string_view::npos) {
+            out.append(value.data() + i, value.size() - i);
+            break;
         }
+        out.append(value.data() + i, dollar - i);
+        i = dollar;
         if (i + 1 >= value.size()) {
             throw Error(ErrorCode::InterpolationSyntax, "'$' must be followed by '$' or '{'");
         }
@@ -554,10 +981,11 @@ std::string Parser::interpolate_extended(
             i = close + 1;
             continue;
         }
-        out += interpolate(ref_section, ref_option, *replacement, depth + 1);
+        int h = 0;
+        out += interpolate(ref_section, ref_option, *replacement, depth + 1, &frame, &h);
+        height = std::max(height, h);
         i = close + 1;
     }
-    return out;
 }
 
 std::string Parser::get(std::string_view section, std::string_view option) const {
@@ -605,14 +1033,11 @@ SectionItems Parser::items(std::string_view section, bool raw) const {
         throw Error(ErrorCode::NoSection, "No section: " + std::string(section));
     }
 
-    SectionItems out = *sec;
+    SectionItems out = to_section_items(*sec);
     if (section != options_.default_section) {
-        for (const auto& d : defaults_) {
-            auto it = std::find_if(out.begin(), out.end(), [&](const OptionEntry& e) {
-                return e.first == d.first;
-            });
-            if (it == out.end()) {
-                out.push_back(d);
+        for (const auto& d : store_->defaults.items) {
+            if (sec->find(view_of(d.key)) == nullptr) {
+                out.emplace_back(std::string(view_of(d.key)), detail::to_option_value(d.value));
             }
         }
     }
@@ -634,9 +1059,9 @@ void Parser::set(std::string_view section, std::string option, OptionValue value
         sec_name = options_.default_section;
     }
 
-    SectionItems* sec = nullptr;
+    OptionTable* sec = nullptr;
     if (sec_name == options_.default_section) {
-        sec = &defaults_;
+        sec = &store_->defaults;
     } else {
         sec = find_section_items_mut(sec_name);
     }
@@ -645,21 +1070,19 @@ void Parser::set(std::string_view section, std::string option, OptionValue value
         throw Error(ErrorCode::NoSection, "No section: " + sec_name);
     }
 
+    store_->interpolated.clear();
     option = option_xform(option);
-    auto it = std::find_if(sec->begin(), sec->end(), [&](const OptionEntry& e) {
-        return e.first == option;
-    });
-    if (it == sec->end()) {
-        sec->push_back({option, std::move(value)});
+    if (auto* existing = sec->find(option)) {
+        sec->assign(*existing, detail::to_view(value));
     } else {
-        it->second = std::move(value);
+        sec->append(option, detail::to_view(value));
     }
 }
 
 bool Parser::remove_option(std::string_view section, std::string_view option) {
-    SectionItems* sec = nullptr;
+    OptionTable* sec = nullptr;
     if (section.empty() || section == options_.default_section) {
-        sec = &defaults_;
+        sec = &store_->defaults;
     } else {
         sec = find_section_items_mut(section);
     }
@@ -667,86 +1090,23 @@ bool Parser::remove_option(std::string_view section, std::string_view option) {
         throw Error(ErrorCode::NoSection, "No section: " + std::string(section));
     }
 
-    const auto key = option_xform(option);
-    auto old_size = sec->size();
-    sec->erase(std::remove_if(sec->begin(), sec->end(), [&](const OptionEntry& e) {
-        return e.first == key;
-    }), sec->end());
-    return sec->size() != old_size;
-}
-
-bool Parser::remove_section(std::string_view section) {
-    auto it = section_index_.find(std::string(section));
-    if (it == section_index_.end()) {
+    const auto* e = sec->find(option);
+    if (e == nullptr) {
         return false;
     }
-    const std::size_t idx = it->second;
-    sections_.erase(sections_.begin() + static_cast<std::ptrdiff_t>(idx));
-
-    section_index_.clear();
-    for (std::size_t i = 0; i < sections_.size(); ++i) {
-        section_index_.insert({sections_[i].first, i});
-    }
+    store_->interpolated.clear();
+    sec->remove(*e);
     return true;
 }
 
-std::string Parser::write_to_string(bool space_around_delimiters) const {
-    std::ostringstream oss;
-    const std::string delim = space_around_delimiters
-        ? (" " + options_.delimiters.front() + " ")
-        : options_.delimiters.front();
-
-    if (!defaults_.empty()) {
-        oss << '[' << options_.default_section << "]\n";
-        for (const auto& e : defaults_) {
-            if (e.second.has_value() || !options_.allow_no_value) {
-                const std::string v = e.second.has_value() ? *e.second : "";
-                if (e.first.find('[') == 0) {
-                    throw Error(ErrorCode::InvalidWrite, "Cannot write key; begins with section pattern");
-                }
-                for (const auto& d : options_.delimiters) {
-                    if (e.first.find(d) != std::string::npos) {
-                        throw Error(ErrorCode::InvalidWrite, "Cannot write key; contains delimiter");
-                    }
-                }
-                oss << e.first << delim << v << '\n';
-            } else {
-                oss << e.first << '\n';
-            }
-        }
-        oss << '\n';
-    }
-
-    for (const auto& sec : sections_) {
-        if (sec.first != kUnnamedSectionName) {
-            oss << '[' << sec.first << "]\n";
-        }
-        for (const auto& e : sec.second) {
-            if (e.second.has_value() || !options_.allow_no_value) {
-                const std::string v = e.second.has_value() ? *e.second : "";
-                if (e.first.find('[') == 0) {
-                    throw Error(ErrorCode::InvalidWrite, "Cannot write key; begins with section pattern");
-                }
-                for (const auto& d : options_.delimiters) {
-                    if (e.first.find(d) != std::string::npos) {
-                        throw Error(ErrorCode::InvalidWrite, "Cannot write key; contains delimiter");
-                    }
-                }
-                std::string folded = v;
-                std::string::size_type p = 0;
-                while ((p = folded.find('\n', p)) != std::string::npos) {
-                    folded.replace(p, 1, "\n\t");
-                    p += 2;
-                }
-                oss << e.first << delim << folded << '\n';
-            } else {
-                oss << e.first << '\n';
-            }
-        }
-        oss << '\n';
+bool Parser::remove_section(std::string_view section) {
+    const auto slot = store_->find_section(section);
+    if (slot == SectionIndex::npos) {
+        return false;
     }
-
-    return oss.str();
+    store_->interpolated.clear();
+    store_->remove_section(slot);
+    return true;
 }
 
 }  // namespace ini
@@ -0,0 +1,369 @@
+#include "ini/scan.hpp"
+
+#include <cstring>
+
+// x86 builds with SSE2 classify blocks with SSE2 and switch to AVX2 at run
+// time when the CPU has it; ARM64 builds use NEON.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INI_SCAN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define INI_SCAN_TARGET_AVX2
+#else
+#define INI_SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define INI_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(INI_SCAN_X86) || defined(INI_SCAN_NEON)
+#define INI_SCAN_VECTOR 1
+#endif
+
+namespace ini {
+namespace {
+
+using detail::lowest_bit;
+
+constexpr auto npos = std::string_view::npos;
+constexpr std::size_t kBlock = 64;
+
+std::size_t find_newline(const char* p, std::size_t n) noexcept {
+    const auto* nl = static_cast<const char*>(std::memchr(p, '\n', n));
+    return nl != nullptr ? static_cast<std::size_t>(nl - p) : n;
+}
+
+LineScan scan_line_scalar(
+    std::string_view text,
+    std::size_t pos,
+    const ByteSet& delimiters,
+    const ByteSet& comments) noexcept {
+    LineScan out;
+    std::size_t i = pos;
+    for (; i < text.size(); ++i) {
+        const char c = text[i];
+        if (c == '\n') {
+            break;
+        }
+        if (out.first_delimiter == npos && delimiters.contains(c)) {
+            out.first_delimiter = i - pos;
+        }
+        if (out.first_comment == npos && comments.contains(c)) {
+            out.first_comment = i - pos;
+        }
+        if ((out.first_delimiter != npos || delimiters.empty()) && (out.first_comment != npos || comments.empty())) {
+            i += find_newline(text.data() + i, text.size() - i);
+            break;
+        }
+    }
+    out.length = i - pos;
+    return out;
+}
+
+std::size_t find_first_of_scalar(std::string_view text, std::size_t from, const ByteSet& marks) noexcept {
+    for (std::size_t i = from; i < text.size(); ++i) {
+        if (marks.contains(text[i])) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+#if defined(INI_SCAN_VECTOR)
+
+// Bit i of each mask describes byte i of a 64-byte block.
+struct BlockBits {
+    std::uint64_t newlines = 0;
+    std::uint64_t first = 0;   // bytes in the first set
+    std::uint64_t second = 0;  // bytes in the second set
+};
+
+using ClassifyBlock = BlockBits (*)(const char* p, const ByteSet& first, const ByteSet& second);
+
+#if defined(INI_SCAN_X86)
+BlockBits classify_block_sse2(const char* p, const ByteSet& first, const ByteSet& second) {
+    __m128i v[4];
+    for (int j = 0; j < 4; ++j) {
+        v[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * j));
+    }
+    const auto matches = [&v](const ByteSet& set, int j) {
+        __m128i hit = _mm_setzero_si128();
+        for (std::size_t k = 0; k < set.size(); ++k) {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v[j], _mm_set1_epi8(static_cast<char>(set.bytes()[k]))));
+        }
+        return static_cast<std::uint64_t>(_mm_movemask_epi8(hit));
+    };
+    const __m128i nl = _mm_set1_epi8('\n');
+    BlockBits bits;
+    for (int j = 0; j < 4; ++j) {
+        const auto shift = 16 * j;
+        bits.newlines |= static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[j], nl))) << shift;
+        bits.first |= matches(first, j) << shift;
+        bits.second |= matches(second, j) << shift;
+    }
+    return bits;
+}
+
+INI_SCAN_TARGET_AVX2
+std::uint64_t movemask64_avx2(const __m256i& lo, const __m256i& hi) noexcept {
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(lo))) |
+           (static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(hi))) << 32);
+}
+
+INI_SCAN_TARGET_AVX2
+std::uint64_t matches_avx2(const __m256i& lo, const __m256i& hi, const ByteSet& set) noexcept {
+    __m256i hit_lo = _mm256_setzero_si256();
+    __m256i hit_hi = _mm256_setzero_si256();
+    for (std::size_t k = 0; k < set.size(); ++k) {
+        const __m256i b = _mm256_set1_epi8(static_cast<char>(set.bytes()[k]));
+        hit_lo = _mm256_or_si256(hit_lo, _mm256_cmpeq_epi8(lo, b));
+        hit_hi = _mm256_or_si256(hit_hi, _mm256_cmpeq_epi8(hi, b));
+    }
+    return movemask64_avx2(hit_lo, hit_hi);
+}
+
+INI_SCAN_TARGET_AVX2
+BlockBits classify_block_avx2(const char* p, const ByteSet& first, const ByteSet& second) {
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    const __m256i nl = _mm256_set1_epi8('\n');
+    BlockBits bits;
+    bits.newlines = movemask64_avx2(_mm256_cmpeq_epi8(lo, nl), _mm256_cmpeq_epi8(hi, nl));
+    bits.first = matches_avx2(lo, hi, first);
+    bits.second = matches_avx2(lo, hi, second);
+    return bits;
+}
+
+bool cpu_has_avx2() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) {
+        return false;
+    }
+    __cpuid(r, 1);
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    const bool avx = (r[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {  // OS saves XMM and YMM state
+        return false;
+    }
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+ClassifyBlock block_classifier() noexcept {
+    static const ClassifyBlock fn = cpu_has_avx2() ? classify_block_avx2 : classify_block_sse2;
+    return fn;
+}
+#else
+// NEON has no movemask: weight each lane by its bit, then fold the four
+// vectors together with pairwise adds.
+std::uint64_t movemask64(const uint8x16_t (&eq)[4]) noexcept {
+    static const std::uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t w = vld1q_u8(weights);
+    uint8x16_t a = vpaddq_u8(vandq_u8(eq[0], w), vandq_u8(eq[1], w));
+    const uint8x16_t b = vpaddq_u8(vandq_u8(eq[2], w), vandq_u8(eq[3], w));
+    a = vpaddq_u8(a, b);
+    a = vpaddq_u8(a, a);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(a), 0);
+}
+
+BlockBits classify_block_neon(const char* p, const ByteSet& first, const ByteSet& second) {
+    uint8x16_t v[4];
+    for (int j = 0; j < 4; ++j) {
+        v[j] = vld1q_u8(reinterpret_cast<const std::uint8_t*>(p) + 16 * j);
+    }
+    const auto matches = [&v](const ByteSet& set) {
+        uint8x16_t hit[4];
+        for (int j = 0; j < 4; ++j) {
+            hit[j] = vdupq_n_u8(0);
+        }
+        for (std::size_t k = 0; k < set.size(); ++k) {
+            const uint8x16_t b = vdupq_n_u8(set.bytes()[k]);
+            for (int j = 0; j < 4; ++j) {
+                hit[j] = vorrq_u8(hit[j], vceqq_u8(v[j], b));
+            }
+        }
+        return movemask64(hit);
+    };
+    uint8x16_t nl[4];
+    for (int j = 0; j < 4; ++j) {
+        nl[j] = vceqq_u8(v[j], vdupq_n_u8('\n'));
+    }
+    BlockBits bits;
+    bits.newlines = movemask64(nl);
+    bits.first = matches(first);
+    bits.second = matches(second);
+    return bits;
+}
+
+ClassifyBlock block_classifier() noexcept {
+    return classify_block_neon;
+}
+#endif
+
+// Classifies the `n` < kBlock bytes at `p` through a padded copy, so that
+// nothing past the end is read. Bits at and above `n` are clear.
+BlockBits classify_partial_block(const char* p, std::size_t n, const ByteSet& first, const ByteSet& second) noexcept {
+    char block[kBlock];
+    std::memset(block, '\n', kBlock);
+    std::memcpy(block, p, n);
+    auto bits = block_classifier()(block, first, second);
+    const std::uint64_t valid = (std::uint64_t{1} << n) - 1;
+    bits.newlines &= valid;
+    bits.first &= valid;
+    bits.second &= valid;
+    return bits;
+}
+
+std::size_t find_first_of_vector(std::string_view text, std::size_t from, const ByteSet& marks) noexcept {
+    static const ByteSet none;
+    const auto classify_block = block_classifier();
+    std::size_t i = from;
+    for (; i + kBlock <= text.size(); i += kBlock) {
+        const auto hit = classify_block(text.data() + i, marks, none).first;
+        if (hit != 0) {
+            return i + lowest_bit(hit);
+        }
+    }
+    if (i >= text.size()) {
+        return npos;
+    }
+    std::uint64_t hit = 0;
+    if (text.size() >= kBlock) {
+        // Re-read the last full block and drop the bytes already searched.
+        const std::size_t last = text.size() - kBlock;
+        hit = classify_block(text.data() + last, marks, none).first >> (i - last);
+    } else {
+        hit = classify_partial_block(text.data() + i, text.size() - i, marks, none).first;
+    }
+    return hit != 0 ? i + lowest_bit(hit) : npos;
+}
+
+#endif
+
+}  // namespace
+
+LineScanner::LineScanner(
+    std::string_view text,
+    const ByteSet& delimiters,
+    const ByteSet& comments,
+    LineScanning mode) noexcept
+    : text_(text), delimiters_(delimiters), comments_(comments), mode_(mode) {
+#if defined(INI_SCAN_VECTOR)
+    if (delimiters_.size() + comments_.size() > ByteSet::max_vector_bytes) {
+        mode_ = LineScanning::Scalar;
+    }
+#else
+    mode_ = LineScanning::Scalar;
+#endif
+}
+
+void LineScanner::load_block(std::size_t pos) noexcept {
+    block_ = pos;
+    block_size_ = text_.size() - pos < kBlock ? text_.size() - pos : kBlock;
+#if defined(INI_SCAN_VECTOR)
+    const auto bits = block_size_ == kBlock
+        ? block_classifier()(text_.data() + pos, delimiters_, comments_)
+        : classify_partial_block(text_.data() + pos, block_size_, delimiters_, comments_);
+    newline_bits_ = bits.newlines;
+    delimiter_bits_ = bits.first;
+    comment_bits_ = bits.second;
+#endif
+}
+
+LineScan LineScanner::scan_blocks(std::size_t pos) noexcept {
+    if (mode_ == LineScanning::Scalar) {
+        return scan_line_scalar(text_, pos, delimiters_, comments_);
+    }
+    LineScan out;
+    if (pos < block_ || pos >= block_ + block_size_) {
+        load_block(pos);
+    }
+    // Rest of the cached block, then whole blocks from where it ends.
+    const auto shift = static_cast<unsigned>(pos - block_);
+    std::uint64_t newlines = newline_bits_ >> shift;
+    std::uint64_t delimiters = delimiter_bits_ >> shift;
+    std::uint64_t comments = comment_bits_ >> shift;
+    std::size_t at = pos;
+    std::size_t next = block_ + block_size_;
+#if defined(INI_SCAN_VECTOR)
+    const auto classify_block = block_classifier();
+#endif
+    for (;;) {
+        const std::uint64_t before = newlines != 0 ? (newlines & (~newlines + 1)) - 1 : ~std::uint64_t{0};
+        delimiters &= before;
+        comments &= before;
+        if (out.first_delimiter == npos && delimiters != 0) {
+            out.first_delimiter = at - pos + lowest_bit(delimiters);
+        }
+        if (out.first_comment == npos && comments != 0) {
+            out.first_comment = at - pos + lowest_bit(comments);
+        }
+        if (newlines != 0) {
+            out.length = at - pos + lowest_bit(newlines);
+            return out;
+        }
+        at = next;
+        if (at >= text_.size()) {
+            break;
+        }
+        if ((out.first_delimiter != npos || delimiters_.empty()) && (out.first_comment != npos || comments_.empty())) {
+            // Only the end of the line is left to find.
+            at += find_newline(text_.data() + at, text_.size() - at);
+            break;
+        }
+#if defined(INI_SCAN_VECTOR)
+        if (text_.size() - at >= kBlock) {
+            const auto bits = classify_block(text_.data() + at, delimiters_, comments_);
+            newlines = bits.newlines;
+            delimiters = bits.first;
+            comments = bits.second;
+            next = at + kBlock;
+            if (newlines != 0) {
+                // The next line starts in this block.
+                block_ = at;
+                block_size_ = kBlock;
+                newline_bits_ = newlines;
+                delimiter_bits_ = delimiters;
+                comment_bits_ = comments;
+            }
+            continue;
+        }
+#endif
+        load_block(at);
+        newlines = newline_bits_;
+        delimiters = delimiter_bits_;
+        comments = comment_bits_;
+        next = at + block_size_;
+    }
+    out.length = (at < text_.size() ? at : text_.size()) - pos;
+    return out;
+}
+
+std::size_t find_first_of(std::string_view text, std::size_t from, const ByteSet& marks, LineScanning mode) noexcept {
+#if defined(INI_SCAN_VECTOR)
+    if (mode == LineScanning::Vector && !marks.empty() && marks.vectorizable()) {
+        return find_first_of_vector(text, from, marks);
+    }
+#else
+    (void)mode;
+#endif
+    return find_first_of_scalar(text, from, marks);
+}
+
+const char* vector_scan_isa() noexcept {
+#if defined(INI_SCAN_X86)
+    return block_classifier() == classify_block_avx2 ? "avx2" : "sse2";
+#elif defined(INI_SCAN_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+}  // namespace ini
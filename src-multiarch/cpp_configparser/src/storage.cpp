@@ -0,0 +1,416 @@
+#include "storage.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace ini {
+namespace detail {
+namespace {
+
+constexpr std::size_t kArenaInitialBlock = 64 * 1024;
+
+// Plain operator new/delete, as std::string uses. new_delete_resource() goes
+// through the aligned overloads instead, which would change what a program
+// that replaces the global allocation functions gets to see.
+class HeapResource final : public std::pmr::memory_resource {
+    void* do_allocate(std::size_t n, std::size_t alignment) override {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return std::pmr::new_delete_resource()->allocate(n, alignment);
+        }
+        return ::operator new(n);
+    }
+
+    void do_deallocate(void* p, std::size_t n, std::size_t alignment) override {
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            std::pmr::new_delete_resource()->deallocate(p, n, alignment);
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+}  // namespace
+
+std::pmr::memory_resource* heap_resource() noexcept {
+    static HeapResource resource;
+    return &resource;
+}
+
+void* Arena::BlockSource::do_allocate(std::size_t n, std::size_t alignment) {
+    bytes += n;
+    ++blocks;
+    return heap_resource()->allocate(n, alignment);
+}
+
+void Arena::BlockSource::do_deallocate(void* p, std::size_t n, std::size_t alignment) {
+    heap_resource()->deallocate(p, n, alignment);
+}
+
+bool Arena::BlockSource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+Arena::Arena() : buffer_(kArenaInitialBlock, &source_) {}
+
+StorageStats Arena::stats() const noexcept {
+    StorageStats out;
+    out.arena_bytes_used = used_;
+    out.arena_bytes_reserved = source_.bytes;
+    out.arena_blocks = source_.blocks;
+    return out;
+}
+
+void* Arena::do_allocate(std::size_t n, std::size_t alignment) {
+    used_ += n;
+    return buffer_.allocate(n, alignment);
+}
+
+void Arena::do_deallocate(void*, std::size_t, std::size_t) {
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+std::string_view StringPool::intern(std::string_view text, bool fold) {
+    if (fold) {
+        folded_.assign(text.data(), text.size());
+        std::transform(folded_.begin(), folded_.end(), folded_.begin(), [](char c) {
+            return OptionIndex::fold(c);
+        });
+        text = folded_;
+    }
+    const auto h = SectionIndex::hash(text);
+    const auto pos = index_.find(text, h, [this](std::size_t i) {
+        return entries_[i];
+    });
+    if (pos != SectionIndex::npos) {
+        return entries_[pos];
+    }
+    // Even the empty string gets a byte of its own, so that every entry has
+    // a distinct address.
+    auto* bytes = static_cast<char*>(resource_->allocate(std::max<std::size_t>(text.size(), 1), 1));
+    std::copy(text.begin(), text.end(), bytes);
+    bytes_ += text.size();
+    entries_.emplace_back(bytes, text.size());
+    index_.insert(h, entries_.size() - 1);
+    return entries_.back();
+}
+
+OptionTable::~OptionTable() {
+    release_all();
+    drop_section_items();
+}
+
+OptionTable::OptionTable(OptionTable&& other) noexcept
+    : items(std::move(other.items)),
+      index(std::move(other.index)),
+      pool(other.pool),
+      section_items_(other.section_items_.exchange(nullptr)) {}
+
+OptionTable& OptionTable::operator=(OptionTable&& other) noexcept {
+    if (this != &other) {
+        release_all();
+        drop_section_items();
+        items = std::move(other.items);
+        index = std::move(other.index);
+        pool = other.pool;
+        section_items_.store(other.section_items_.exchange(nullptr));
+        // Whatever `other` still holds now belongs to this table.
+        other.items.clear();
+        other.index.clear();
+    }
+    return *this;
+}
+
+const SectionItems& OptionTable::section_items() const {
+    if (const auto* built = section_items_.load(std::memory_order_acquire)) {
+        return *built;
+    }
+    auto fresh = std::make_unique<SectionItems>();
+    fresh->reserve(items.size());
+    for (const auto& e : items) {
+        fresh->emplace_back(std::string(view_of(e.key)), to_option_value(e.value));
+    }
+    SectionItems* expected = nullptr;
+    if (section_items_.compare_exchange_strong(expected, fresh.get(), std::memory_order_acq_rel)) {
+        return *fresh.release();
+    }
+    return *expected;  // another thread built it first
+}
+
+void OptionTable::drop_section_items() noexcept {
+    delete section_items_.exchange(nullptr);
+}
+
+StoredText OptionTable::make_text(std::string_view text, bool fold) {
+    if (text.size() > UINT32_MAX) {
+        throw std::length_error("option text too long");
+    }
+    StoredText out;
+    out.size_ = static_cast<std::uint32_t>(text.size());
+    if (pool != nullptr) {
+        out.external_ = pool->intern(text, fold).data();
+        return out;
+    }
+    char* bytes = out.inline_;
+    if (text.size() > StoredText::kInlineSize) {
+        bytes = static_cast<char*>(resource()->allocate(text.size(), 1));
+        out.external_ = bytes;
+    }
+    if (fold) {
+        std::transform(text.begin(), text.end(), bytes, [](char c) {
+            return OptionIndex::fold(c);
+        });
+    } else {
+        std::copy(text.begin(), text.end(), bytes);
+    }
+    return out;
+}
+
+void OptionTable::release(const StoredText& text) noexcept {
+    // Pooled text and arena memory are only given back all at once.
+    if (text.external_ != nullptr && pool == nullptr) {
+        resource()->deallocate(const_cast<char*>(text.external_), text.size_, 1);
+    }
+}
+
+void OptionTable::release_all() noexcept {
+    if (pool != nullptr || resource() != heap_resource()) {
+        return;
+    }
+    for (const auto& e : items) {
+        release(e.key);
+        if (e.value.has_value()) {
+            release(*e.value);
+        }
+    }
+}
+
+const StoredOption* OptionTable::find(std::string_view option) const noexcept {
+    const auto pos = index.find(option, [this](std::size_t i) {
+        return view_of(items[i].key);
+    });
+    return pos == OptionIndex::npos ? nullptr : &items[pos];
+}
+
+StoredOption* OptionTable::find(std::string_view option) noexcept {
+    return const_cast<StoredOption*>(std::as_const(*this).find(option));
+}
+
+const StoredOption* OptionTable::find(const StaticKey& option) const noexcept {
+    const auto pos = index.find_folded(option.name, option.hash, [this](std::size_t i) {
+        return view_of(items[i].key);
+    });
+    return pos == OptionIndex::npos ? nullptr : &items[pos];
+}
+
+StoredOption& OptionTable::append(std::string_view key, std::optional<std::string_view> value) {
+    StoredOption entry{make_text(key, true), std::nullopt};
+    if (value.has_value()) {
+        try {
+            entry.value = make_text(*value, false);
+        } catch (...) {
+            release(entry.key);
+            throw;
+        }
+    }
+    const auto h = OptionIndex::hash(view_of(entry.key));
+    try {
+        items.push_back(entry);
+    } catch (...) {
+        release(entry.key);
+        if (entry.value.has_value()) {
+            release(*entry.value);
+        }
+        throw;
+    }
+    index.insert(h, items.size() - 1);
+    drop_section_items();
+    return items.back();
+}
+
+void OptionTable::assign(StoredOption& entry, std::optional<std::string_view> value) {
+    std::optional<StoredText> text;
+    if (value.has_value()) {
+        text = make_text(*value, false);
+    }
+    if (entry.value.has_value()) {
+        release(*entry.value);
+    }
+    entry.value = text;
+    drop_section_items();
+}
+
+void OptionTable::remove(const StoredOption& entry) {
+    release(entry.key);
+    if (entry.value.has_value()) {
+        release(*entry.value);
+    }
+    items.erase(items.begin() + (&entry - items.data()));
+    reindex();
+    drop_section_items();
+}
+
+void OptionTable::merge_from(const OptionTable& other) {
+    for (const auto& e : other.items) {
+        std::optional<std::string_view> v;
+        if (e.value.has_value()) {
+            v = view_of(*e.value);
+        }
+        if (auto* existing = find(view_of(e.key))) {
+            assign(*existing, v);
+        } else {
+            append(view_of(e.key), v);
+        }
+    }
+}
+
+void OptionTable::reintern(StringPool& strings) {
+    pool = &strings;
+    for (auto& e : items) {
+        e.key.external_ = strings.intern(view_of(e.key)).data();
+        if (e.value.has_value()) {
+            e.value->external_ = strings.intern(view_of(*e.value)).data();
+        }
+    }
+}
+
+void OptionTable::reindex() {
+    index.rebuild(items.size(), [this](std::size_t i) {
+        return view_of(items[i].key);
+    });
+}
+
+Storage::Storage(StorageMode mode)
+    : arena(mode != StorageMode::Heap ? std::make_unique<Arena>() : nullptr),
+      resource(arena ? static_cast<std::pmr::memory_resource*>(arena.get())
+                     : heap_resource()),
+      pool(mode == StorageMode::Interned ? std::make_unique<StringPool>(resource) : nullptr),
+      defaults(resource, pool.get()),
+      sections(resource),
+      section_index(resource) {}
+
+std::size_t Storage::find_section(std::string_view section) const noexcept {
+    return section_index.find(section, [this](std::size_t i) {
+        return view_of(sections[i].name);
+    });
+}
+
+SectionData& Storage::append_section(std::string_view section) {
+    make_section_room();
+    const auto h = SectionIndex::hash(section);
+    auto& sec = sections.emplace_back(section, resource, pool.get());
+    section_index.insert(h, sections.slot_count() - 1);
+    return sec;
+}
+
+SectionData& Storage::adopt_section(SectionData&& section) {
+    if (pool) {
+        section.options.reintern(*pool);
+    }
+    make_section_room();
+    const auto h = SectionIndex::hash(view_of(section.name));
+    auto& sec = sections.emplace_back(std::move(section));
+    section_index.insert(h, sections.slot_count() - 1);
+    return sec;
+}
+
+void Storage::remove_section(std::size_t slot) {
+    auto& sec = sections[slot];
+    if (!sec.pending.empty()) {
+        --pending_sections;
+    }
+    section_index.erase(SectionIndex::hash(view_of(sec.name)), slot);
+    sections.remove(slot);
+}
+
+void Storage::make_section_room() {
+    if (!sections.full() || sections.removed_count() == 0 || sections.removed_count() * 2 < sections.slot_count()) {
+        return;
+    }
+    sections.compact();
+    section_index.rebuild(sections.slot_count(), [this](std::size_t i) {
+        return view_of(sections[i].name);
+    });
+}
+
+SectionList::~SectionList() {
+    for (auto* sec : slots_) {
+        destroy(sec);
+    }
+}
+
+void SectionList::destroy(SectionData* sec) noexcept {
+    sec->~SectionData();
+    std::pmr::polymorphic_allocator<SectionData>(slots_.get_allocator().resource()).deallocate(sec, 1);
+}
+
+void SectionList::remove(std::size_t slot) noexcept {
+    auto& sec = *slots_[slot];
+    sec.options = OptionTable(sec.options.resource(), sec.options.pool);
+    sec.name.clear();
+    sec.name.shrink_to_fit();
+    sec.pending.clear();
+    sec.pending.shrink_to_fit();
+    sec.removed = true;
+    ++removed_;
+}
+
+void SectionList::compact() {
+    const auto live = std::remove_if(slots_.begin(), slots_.end(), [this](SectionData* sec) {
+        if (!sec->removed) {
+            return false;
+        }
+        destroy(sec);
+        return true;
+    });
+    slots_.erase(live, slots_.end());
+    removed_ = 0;
+}
+
+StorageStats Storage::stats() const noexcept {
+    StorageStats out = arena ? arena->stats() : StorageStats{};
+    if (pool) {
+        out.interned_strings = pool->size();
+        out.interned_bytes = pool->bytes();
+    }
+    for (const auto& a : adopted_arenas) {
+        const auto more = a->stats();
+        out.arena_bytes_used += more.arena_bytes_used;
+        out.arena_bytes_reserved += more.arena_bytes_reserved;
+        out.arena_blocks += more.arena_blocks;
+    }
+    return out;
+}
+
+void Storage::copy_from(const Storage& other) {
+    auto copy_options = [](const OptionTable& from, OptionTable& to) {
+        for (const auto& e : from.items) {
+            std::optional<std::string_view> v;
+            if (e.value.has_value()) {
+                v = view_of(*e.value);
+            }
+            to.append(view_of(e.key), v);
+        }
+    };
+    copy_options(other.defaults, defaults);
+    sections.reserve(other.sections.size());
+    for (const auto& sec : other.sections) {
+        auto& copy = append_section(view_of(sec.name));
+        copy_options(sec.options, copy.options);
+        copy.pending.assign(sec.pending.begin(), sec.pending.end());
+    }
+    sources = other.sources;
+    pending_sections = other.pending_sections;
+}
+
+}  // namespace detail
+}  // namespace ini
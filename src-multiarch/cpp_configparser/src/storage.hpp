@@ -0,0 +1,319 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ini/key_index.hpp"
+#include "ini/parser.hpp"
+#include "ini/static_key.hpp"
+#include "interpolation_cache.hpp"
+
+namespace ini {
+namespace detail {
+
+// Memory resource behind StorageMode::Heap.
+std::pmr::memory_resource* heap_resource() noexcept;
+
+// Memory resource behind StorageMode::Arena: a monotonic buffer that hands
+// out memory from a few large blocks and gives all of it back at once when
+// destroyed. Individual deallocations are no-ops.
+class Arena final : public std::pmr::memory_resource {
+public:
+    Arena();
+
+    StorageStats stats() const noexcept;
+
+private:
+    // Heap source for the arena's blocks; counts what the arena reserves.
+    class BlockSource final : public std::pmr::memory_resource {
+    public:
+        std::size_t bytes = 0;
+        std::size_t blocks = 0;
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    BlockSource source_;
+    std::pmr::monotonic_buffer_resource buffer_;
+    std::size_t used_ = 0;
+};
+
+// Text of a stored key or value. Up to kInlineSize bytes sit in the object
+// itself; longer text lives in memory the OptionTable holding it allocated,
+// and in StorageMode::Interned all text is a handle into the StringPool.
+// Copies are shallow: only the owning table releases the memory.
+class StoredText {
+public:
+    static constexpr std::size_t kInlineSize = 12;
+
+    const char* data() const noexcept { return external_ != nullptr ? external_ : inline_; }
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    friend struct OptionTable;
+
+    const char* external_ = nullptr;  // nullptr: the text is in inline_
+    std::uint32_t size_ = 0;
+    char inline_[kInlineSize] = {};
+};
+
+inline std::string_view view_of(const StoredText& s) noexcept {
+    return {s.data(), s.size()};
+}
+
+// Text store of StorageMode::Interned: each distinct string is kept once in
+// the storage's arena, so two pooled texts are equal exactly when their
+// data() pointers are.
+class StringPool {
+public:
+    explicit StringPool(std::pmr::memory_resource* resource)
+        : resource_(resource), entries_(resource), index_(resource) {}
+
+    // The pooled copy of `text`, lower-cased first when `fold` is set.
+    std::string_view intern(std::string_view text, bool fold = false);
+
+    std::size_t size() const noexcept { return entries_.size(); }
+    std::size_t bytes() const noexcept { return bytes_; }
+
+private:
+    std::pmr::memory_resource* resource_;
+    std::pmr::vector<std::string_view> entries_;
+    SectionIndex index_;   // case-sensitive
+    std::string folded_;   // scratch buffer for fold
+    std::size_t bytes_ = 0;
+};
+
+struct StoredOption {
+    StoredText key;
+    std::optional<StoredText> value;
+};
+
+// Option list of one section plus its lookup index. Entries keep their
+// insertion order so write_to_string() output is unchanged.
+struct OptionTable {
+    explicit OptionTable(std::pmr::memory_resource* resource, StringPool* strings = nullptr)
+        : items(resource), index(resource), pool(strings) {}
+    ~OptionTable();
+
+    OptionTable(OptionTable&& other) noexcept;
+    OptionTable& operator=(OptionTable&& other) noexcept;
+    OptionTable(const OptionTable&) = delete;
+    OptionTable& operator=(const OptionTable&) = delete;
+
+    std::pmr::vector<StoredOption> items;
+    OptionIndex index;
+    StringPool* pool;  // set in StorageMode::Interned
+
+    std::pmr::memory_resource* resource() const noexcept {
+        return items.get_allocator().resource();
+    }
+
+    const StoredOption* find(std::string_view option) const noexcept;
+    StoredOption* find(std::string_view option) noexcept;
+    const StoredOption* find(const StaticKey& option) const noexcept;
+
+    // Appends `key` lower-cased; the caller has checked it is not present.
+    StoredOption& append(std::string_view key, std::optional<std::string_view> value);
+    void assign(StoredOption& entry, std::optional<std::string_view> value);
+    void remove(const StoredOption& entry);
+    // Copies every option of `other` in order; keys already present keep
+    // their position and take the new value.
+    void merge_from(const OptionTable& other);
+    // Moves every text of a table adopted from another storage into `strings`.
+    void reintern(StringPool& strings);
+    void reindex();
+
+    // The options as SectionItems, for the references SectionView::at() and
+    // items() return. Built by the first call, which may race with other
+    // const calls, and dropped by every change to the table.
+    const SectionItems& section_items() const;
+
+private:
+    StoredText make_text(std::string_view text, bool fold);
+    void release(const StoredText& text) noexcept;
+    void release_all() noexcept;
+    void drop_section_items() noexcept;
+
+    mutable std::atomic<SectionItems*> section_items_{nullptr};
+};
+
+// Body of one "[section]" block that SectionLoading::Lazy has not parsed yet.
+struct PendingSpan {
+    std::string_view text;    // lines after the header, up to the next header
+    int first_line = 0;       // line number of the header itself
+    std::size_t source = 0;   // index into Storage::sources
+};
+
+struct SectionData {
+    SectionData(std::string_view section, std::pmr::memory_resource* resource, StringPool* pool = nullptr)
+        : name(section, resource), options(resource, pool), pending(resource) {}
+
+    std::pmr::string name;
+    OptionTable options;
+    std::pmr::vector<PendingSpan> pending;  // parsed, in order, on first access
+    bool removed = false;
+};
+
+// Sections in insertion order. Each section is allocated on its own, so its
+// address, and with it every SectionView of it, holds until the section is
+// removed, however many sections are added later. Removing one leaves an
+// empty tombstone in its slot, so the positions SectionIndex holds never
+// shift and remove() costs the same for the first section as for the last.
+// Iteration skips tombstones; Storage drops them when the slots would
+// otherwise grow.
+class SectionList {
+public:
+    template <class Slot>
+    class Iterator {
+    public:
+        Iterator(SectionData* const* at, SectionData* const* end) noexcept : at_(at), end_(end) { skip(); }
+
+        Slot& operator*() const noexcept { return **at_; }
+        Slot* operator->() const noexcept { return *at_; }
+        Iterator& operator++() noexcept {
+            ++at_;
+            skip();
+            return *this;
+        }
+        bool operator==(const Iterator& other) const noexcept { return at_ == other.at_; }
+        bool operator!=(const Iterator& other) const noexcept { return at_ != other.at_; }
+
+    private:
+        void skip() noexcept {
+            while (at_ != end_ && (*at_)->removed) {
+                ++at_;
+            }
+        }
+
+        SectionData* const* at_;
+        SectionData* const* end_;
+    };
+
+    explicit SectionList(std::pmr::memory_resource* resource) : slots_(resource) {}
+    ~SectionList();
+
+    SectionList(const SectionList&) = delete;
+    SectionList& operator=(const SectionList&) = delete;
+
+    Iterator<SectionData> begin() noexcept { return {slots_.data(), slots_.data() + slots_.size()}; }
+    Iterator<SectionData> end() noexcept { return {slots_.data() + slots_.size(), slots_.data() + slots_.size()}; }
+    Iterator<const SectionData> begin() const noexcept { return {slots_.data(), slots_.data() + slots_.size()}; }
+    Iterator<const SectionData> end() const noexcept {
+        return {slots_.data() + slots_.size(), slots_.data() + slots_.size()};
+    }
+
+    // Live sections; slot_count() includes tombstones.
+    std::size_t size() const noexcept { return slots_.size() - removed_; }
+    std::size_t slot_count() const noexcept { return slots_.size(); }
+    std::size_t removed_count() const noexcept { return removed_; }
+    bool full() const noexcept { return slots_.size() == slots_.capacity(); }
+
+    SectionData& operator[](std::size_t slot) noexcept { return *slots_[slot]; }
+    const SectionData& operator[](std::size_t slot) const noexcept { return *slots_[slot]; }
+
+    void reserve(std::size_t count) { slots_.reserve(count + removed_); }
+    template <class... Args>
+    SectionData& emplace_back(Args&&... args) {
+        slots_.reserve(slots_.size() + 1);  // nothing below throws once the section exists
+        std::pmr::polymorphic_allocator<SectionData> alloc(slots_.get_allocator().resource());
+        SectionData* sec = alloc.allocate(1);
+        try {
+            ::new (static_cast<void*>(sec)) SectionData(std::forward<Args>(args)...);
+        } catch (...) {
+            alloc.deallocate(sec, 1);
+            throw;
+        }
+        slots_.push_back(sec);
+        return *sec;
+    }
+    // Frees what the section at `slot` holds and marks the slot removed.
+    void remove(std::size_t slot) noexcept;
+    // Drops every tombstone; slots after the first one move down, the
+    // sections themselves stay where they are.
+    void compact();
+
+private:
+    void destroy(SectionData* sec) noexcept;
+
+    std::pmr::vector<SectionData*> slots_;
+    std::size_t removed_ = 0;
+};
+
+// Input kept alive for pending spans. Shared so that copies of a parser can
+// defer the same sections.
+struct Source {
+    std::shared_ptr<const std::string> text;
+    std::string name;
+};
+
+// Everything a Parser stores. Lives behind a pointer so that clear() and
+// moves can swap the whole arena together with the containers using it.
+struct Storage {
+    explicit Storage(StorageMode mode);
+
+    std::unique_ptr<Arena> arena;  // declared first: destroyed last
+    // Arenas of parallel-read pieces whose sections were moved in.
+    std::vector<std::unique_ptr<Arena>> adopted_arenas;
+    std::pmr::memory_resource* resource;
+    std::unique_ptr<StringPool> pool;  // StorageMode::Interned only
+
+    OptionTable defaults;
+    SectionList sections;
+    SectionIndex section_index;  // slot of each live section
+    std::vector<Source> sources;
+    std::size_t pending_sections = 0;
+    // Values get() and items() interpolated; not copied by copy_from().
+    InterpolationCache interpolated;
+
+    std::size_t find_section(std::string_view section) const noexcept;
+    SectionData& append_section(std::string_view section);
+    // Appends `section` by moving it in, without copying an option. Its
+    // memory must come from the heap or from an arena this storage owns;
+    // with a pool its texts are re-pooled here.
+    SectionData& adopt_section(SectionData&& section);
+    void remove_section(std::size_t slot);
+    StorageStats stats() const noexcept;
+    void copy_from(const Storage& other);
+
+private:
+    // Called before a section is appended: when the slots are full and at
+    // least half of them are tombstones, compacts them instead of letting
+    // the vector grow.
+    void make_section_room();
+};
+
+inline std::string_view view_of(const std::pmr::string& s) noexcept {
+    return {s.data(), s.size()};
+}
+
+inline OptionValue to_option_value(const std::optional<StoredText>& v) {
+    if (!v.has_value()) {
+        return std::nullopt;
+    }
+    return std::string(v->data(), v->size());
+}
+
+inline std::optional<std::string_view> to_view(const OptionValue& v) noexcept {
+    if (!v.has_value()) {
+        return std::nullopt;
+    }
+    return std::string_view(*v);
+}
+
+}  // namespace detail
+}  // namespace ini
@@ -0,0 +1,215 @@
+#include "ini/tokenizer.hpp"
+
+#include "ini/parser.hpp"
+
+#include <cstring>
+
+namespace ini {
+namespace {
+
+// Same set as std::isspace in the "C" locale.
+constexpr bool is_space(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+std::string_view trim(std::string_view sv) noexcept {
+    std::size_t start = 0;
+    while (start < sv.size() && is_space(sv[start])) {
+        ++start;
+    }
+    std::size_t end = sv.size();
+    while (end > start && is_space(sv[end - 1])) {
+        --end;
+    }
+    return sv.substr(start, end - start);
+}
+
+bool starts_with(std::string_view s, std::string_view prefix) noexcept {
+    return s.size() >= prefix.size() && s.substr(0, prefix.size()) == prefix;
+}
+
+}  // namespace
+
+Tokenizer::Tokenizer(std::string_view text, const ParseOptions& options, int first_line)
+    : text_(text), line_no_(first_line) {
+    for (const auto& p : options.comment_prefixes) {
+        if (!p.empty()) {
+            comment_prefixes_.push_back(p);
+        }
+    }
+    for (const auto& p : options.inline_comment_prefixes) {
+        if (!p.empty()) {
+            inline_comment_prefixes_.push_back(p);
+        }
+    }
+    for (const auto& d : options.delimiters) {
+        delimiters_.push_back(d);
+    }
+
+    // An empty delimiter matches at offset 0 of every line, which the byte
+    // search would not find; such option sets always scan scalar.
+    scanning_ = options.line_scanning;
+    for (const auto d : delimiters_) {
+        if (d.empty()) {
+            scanning_ = LineScanning::Scalar;
+        } else if (d.front() != '\n') {
+            delimiter_starts_.add(d.front());
+        }
+    }
+    for (const auto prefix : inline_comment_prefixes_) {
+        if (prefix.front() != '\n') {
+            inline_starts_.add(prefix.front());
+        }
+    }
+    lines_ = LineScanner(text_, delimiter_starts_, inline_starts_, scanning_);
+    scanning_ = lines_.mode();  // too many distinct first bytes, or no vector unit
+}
+
+std::string_view Tokenizer::strip_comment(std::string_view line, std::size_t first_comment) const {
+    const auto t = trim(line);
+    if (t.empty()) {
+        return t;
+    }
+    for (const auto prefix : comment_prefixes_) {
+        if (starts_with(t, prefix)) {
+            return {};
+        }
+    }
+
+    if (first_comment == std::string_view::npos) {
+        return t;
+    }
+
+    // An inline prefix only starts a comment at the beginning of the line or
+    // after whitespace; everything from there on is dropped.
+    auto out = line;
+    for (const auto prefix : inline_comment_prefixes_) {
+        auto pos = out.find(prefix);
+        while (pos != std::string_view::npos) {
+            if (pos == 0 || is_space(out[pos - 1])) {
+                out = out.substr(0, pos);
+                break;
+            }
+            pos = out.find(prefix, pos + 1);
+        }
+    }
+    return trim(out);
+}
+
+void Tokenizer::classify(Token& tok, std::size_t first_delimiter) const {
+    const auto c = tok.cleaned;
+    if (c.empty()) {
+        tok.kind = TokenKind::Blank;
+        return;
+    }
+    if (c.front() == '[' && c.back() == ']') {
+        tok.kind = TokenKind::Section;
+        tok.name = c.substr(1, c.size() - 2);
+        return;
+    }
+
+    std::size_t found_at = std::string_view::npos;
+    std::size_t delim_size = 0;
+    if (scanning_ == LineScanning::Scalar) {
+        for (const auto d : delimiters_) {
+            const auto pos = c.find(d);
+            if (pos != std::string_view::npos && (found_at == std::string_view::npos || pos < found_at)) {
+                found_at = pos;
+                delim_size = d.size();
+            }
+        }
+    } else if (first_delimiter != std::string_view::npos) {
+        // The leftmost match wins, and at equal offsets the delimiter listed
+        // first, exactly as with one find() per delimiter above.
+        const auto offset = static_cast<std::size_t>(c.data() - tok.raw.data());
+        auto pos = first_delimiter > offset ? first_delimiter - offset : 0;
+        if (pos >= c.size() || !delimiter_starts_.contains(c[pos])) {
+            pos = find_first_of(c, pos, delimiter_starts_, scanning_);
+        }
+        while (pos != std::string_view::npos) {
+            for (const auto d : delimiters_) {
+                if (c.compare(pos, d.size(), d) == 0) {
+                    found_at = pos;
+                    delim_size = d.size();
+                    break;
+                }
+            }
+            if (found_at != std::string_view::npos) {
+                break;
+            }
+            pos = find_first_of(c, pos + 1, delimiter_starts_, scanning_);
+        }
+    }
+
+    if (found_at == std::string_view::npos) {
+        tok.kind = TokenKind::Bare;
+        tok.key = c;
+        return;
+    }
+    tok.kind = TokenKind::Option;
+    tok.has_delimiter = true;
+    tok.key = trim(c.substr(0, found_at));
+    tok.value = trim(c.substr(found_at + delim_size));
+}
+
+std::string_view Tokenizer::next_line(LineScan* scan) {
+    const char* begin = text_.data() + pos_;
+    std::size_t len = 0;
+    if (scan != nullptr && scanning_ == LineScanning::Vector) {
+        *scan = lines_.scan(pos_);
+        len = scan->length;
+    } else {
+        const auto* nl = static_cast<const char*>(std::memchr(begin, '\n', text_.size() - pos_));
+        len = nl != nullptr ? static_cast<std::size_t>(nl - begin) : text_.size() - pos_;
+        if (scan != nullptr) {
+            scan->first_delimiter = 0;
+            scan->first_comment = 0;
+        }
+    }
+    ++line_no_;
+    pos_ += len + 1;
+    // CRLF input reads the way a text-mode stream hands it to std::getline.
+    if (len > 0 && begin[len - 1] == '\r') {
+        --len;
+    }
+    return {begin, len};
+}
+
+bool Tokenizer::next(Token& out) {
+    if (pos_ >= text_.size()) {
+        return false;
+    }
+    out = Token{};
+    LineScan scan;
+    out.raw = next_line(&scan);
+    out.line_no = line_no_;
+    out.indented = !out.raw.empty() && is_space(out.raw.front());
+    out.cleaned = strip_comment(out.raw, scan.first_comment);
+    classify(out, scan.first_delimiter);
+    return true;
+}
+
+bool Tokenizer::next_header(Token& out) {
+    while (pos_ < text_.size()) {
+        const auto line = next_line(nullptr);
+        std::size_t first = 0;
+        while (first < line.size() && is_space(line[first])) {
+            ++first;
+        }
+        if (first == line.size() || line[first] != '[') {
+            continue;
+        }
+        out = Token{};
+        out.raw = line;
+        out.line_no = line_no_;
+        out.indented = first != 0;
+        out.cleaned = strip_comment(line, 0);
+        classify(out, 0);
+        if (out.kind == TokenKind::Section) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace ini
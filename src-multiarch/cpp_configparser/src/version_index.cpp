@@ -0,0 +1,106 @@
+#include "ini/version_index.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace ini {
+
+std::optional<std::uint64_t> parse_version(std::string_view name) {
+    std::uint16_t parts[4] = {};
+    const char* p = name.data();
+    const char* end = name.data() + name.size();
+    for (std::size_t i = 0; i < 4; ++i) {
+        if (i > 0) {
+            if (p == end || *p != '.') {
+                return std::nullopt;
+            }
+            ++p;
+        }
+        if (p == end || (*p == '0' && p + 1 != end && p[1] != '.')) {
+            return std::nullopt;  // no leading zeros: "01" would never be looked up
+        }
+        const auto [next, ec] = std::from_chars(p, end, parts[i]);
+        if (ec != std::errc()) {
+            return std::nullopt;
+        }
+        p = next;
+    }
+    if (p != end) {
+        return std::nullopt;
+    }
+    return pack_version(parts[0], parts[1], parts[2], parts[3]);
+}
+
+std::string format_version(std::uint64_t version) {
+    std::string out;
+    for (int shift = 48; shift >= 0; shift -= 16) {
+        if (shift != 48) {
+            out.push_back('.');
+        }
+        out += std::to_string((version >> shift) & 0xFFFF);
+    }
+    return out;
+}
+
+VersionIndex::VersionIndex(std::vector<std::uint64_t> versions) {
+    std::sort(versions.begin(), versions.end());
+    versions.erase(std::unique(versions.begin(), versions.end()), versions.end());
+    const std::size_t n = versions.size();
+    if (n == 0) {
+        return;
+    }
+
+    // About two keys per bucket. Buckets are placed largest first, each with
+    // the first displacement that sends all of its keys to free slots; with
+    // every slot eventually taken that is a minimal perfect hash.
+    const std::size_t bucket_count = n / 2 + 1;
+    std::vector<std::vector<std::uint64_t>> buckets(bucket_count);
+    for (const auto v : versions) {
+        buckets[static_cast<std::size_t>(version_hash(v) % bucket_count)].push_back(v);
+    }
+    std::vector<std::size_t> order(bucket_count);
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    displacements_.assign(bucket_count, 0);
+    keys_.assign(n, 0);
+    std::vector<bool> taken(n, false);
+    std::vector<std::size_t> slots;
+    for (const auto b : order) {
+        const auto& keys = buckets[b];
+        if (keys.empty()) {
+            break;
+        }
+        for (std::uint32_t d = 0;; ++d) {
+            if (d == UINT32_MAX) {
+                throw std::runtime_error("version index: no displacement found");
+            }
+            slots.clear();
+            bool ok = true;
+            for (const auto v : keys) {
+                const auto slot = version_slot(v, d, n);
+                if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    ok = false;
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (!ok) {
+                continue;
+            }
+            displacements_[b] = d;
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                taken[slots[i]] = true;
+                keys_[slots[i]] = keys[i];
+            }
+            break;
+        }
+    }
+}
+
+}  // namespace ini
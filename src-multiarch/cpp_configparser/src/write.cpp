@@ -0,0 +1,233 @@
+#include "ini/parser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "storage.hpp"
+
+namespace ini {
+namespace {
+
+using detail::OptionTable;
+using detail::Storage;
+using detail::StoredOption;
+using detail::view_of;
+
+constexpr std::size_t kSinkChunk = 64 * 1024;
+
+// Writes straight into a buffer sized by Layout::measure().
+class BufferOut {
+public:
+    explicit BufferOut(char* out) : out_(out) {}
+
+    void append(std::string_view s) noexcept {
+        std::memcpy(out_, s.data(), s.size());
+        out_ += s.size();
+    }
+    void put(char c) noexcept { *out_++ = c; }
+
+private:
+    char* out_;
+};
+
+// Collects output into chunks of up to kSinkChunk bytes for a WriteSink.
+class SinkOut {
+public:
+    explicit SinkOut(const WriteSink& sink) : sink_(sink) { buffer_.reserve(kSinkChunk); }
+
+    void append(std::string_view s) {
+        if (buffer_.size() + s.size() > kSinkChunk) {
+            flush();
+            if (s.size() >= kSinkChunk) {
+                sink_(s);
+                return;
+            }
+        }
+        buffer_.append(s.data(), s.size());
+    }
+    void put(char c) {
+        if (buffer_.size() == kSinkChunk) {
+            flush();
+        }
+        buffer_.push_back(c);
+    }
+    void flush() {
+        if (!buffer_.empty()) {
+            sink_(buffer_);
+            buffer_.clear();
+        }
+    }
+
+private:
+    const WriteSink& sink_;
+    std::string buffer_;
+};
+
+// How a parser's contents are laid out as text. Values of named sections
+// continue on lines indented by a tab; those of the default section are
+// written as stored.
+class Layout {
+public:
+    Layout(const ParseOptions& options, bool space_around_delimiters)
+        : options_(options),
+          delimiter_(space_around_delimiters ? " " + options.delimiters.front() + " " : options.delimiters.front()) {
+        for (const auto& d : options.delimiters) {
+            if (d.empty()) {
+                empty_delimiter_ = true;
+            } else {
+                delimiter_start_[static_cast<unsigned char>(d.front())] = true;
+            }
+        }
+    }
+
+    // Exact size of the output; throws InvalidWrite for the first key that
+    // could not be read back.
+    std::size_t measure(const Storage& store) const {
+        std::size_t size = 0;
+        if (!store.defaults.items.empty()) {
+            size += options_.default_section.size() + 3 + measure_options(store.defaults, false) + 1;
+        }
+        for (const auto& sec : store.sections) {
+            if (sec.name != kUnnamedSectionName) {
+                size += sec.name.size() + 3;
+            }
+            size += measure_options(sec.options, true) + 1;
+        }
+        return size;
+    }
+
+    template <class Out>
+    void emit(const Storage& store, Out& out) const {
+        if (!store.defaults.items.empty()) {
+            out.put('[');
+            out.append(options_.default_section);
+            out.append("]\n");
+            emit_options(store.defaults, false, out);
+            out.put('\n');
+        }
+        for (const auto& sec : store.sections) {
+            if (sec.name != kUnnamedSectionName) {
+                out.put('[');
+                out.append(view_of(sec.name));
+                out.append("]\n");
+            }
+            emit_options(sec.options, true, out);
+            out.put('\n');
+        }
+    }
+
+private:
+    bool writes_value(const StoredOption& e) const noexcept {
+        return e.value.has_value() || !options_.allow_no_value;
+    }
+
+    // One pass over `key`, stopping only on bytes that start a delimiter.
+    void check_key(std::string_view key) const {
+        if (!key.empty() && key.front() == '[') {
+            throw Error(ErrorCode::InvalidWrite, "Cannot write key; begins with section pattern");
+        }
+        if (empty_delimiter_) {
+            throw Error(ErrorCode::InvalidWrite, "Cannot write key; contains delimiter");
+        }
+        for (std::size_t i = 0; i < key.size(); ++i) {
+            if (!delimiter_start_[static_cast<unsigned char>(key[i])]) {
+                continue;
+            }
+            for (const auto& d : options_.delimiters) {
+                if (key.compare(i, d.size(), d) == 0) {
+                    throw Error(ErrorCode::InvalidWrite, "Cannot write key; contains delimiter");
+                }
+            }
+        }
+    }
+
+    std::size_t measure_options(const OptionTable& table, bool fold) const {
+        std::size_t size = 0;
+        for (const auto& e : table.items) {
+            const auto key = view_of(e.key);
+            size += key.size() + 1;
+            if (writes_value(e)) {
+                check_key(key);
+                size += delimiter_.size();
+                if (e.value.has_value()) {
+                    const auto v = view_of(*e.value);
+                    size += v.size();
+                    if (fold) {
+                        size += static_cast<std::size_t>(std::count(v.begin(), v.end(), '\n'));
+                    }
+                }
+            }
+        }
+        return size;
+    }
+
+    template <class Out>
+    void emit_options(const OptionTable& table, bool fold, Out& out) const {
+        for (const auto& e : table.items) {
+            out.append(view_of(e.key));
+            if (writes_value(e)) {
+                out.append(delimiter_);
+                if (e.value.has_value()) {
+                    auto v = view_of(*e.value);
+                    for (auto nl = fold ? v.find('\n') : v.npos; nl != v.npos; nl = v.find('\n')) {
+                        out.append(v.substr(0, nl + 1));
+                        out.put('\t');
+                        v.remove_prefix(nl + 1);
+                    }
+                    out.append(v);
+                }
+            }
+            out.put('\n');
+        }
+    }
+
+    const ParseOptions& options_;
+    std::string delimiter_;
+    bool delimiter_start_[256] = {};
+    bool empty_delimiter_ = false;
+};
+
+}  // namespace
+
+std::string Parser::write_to_string(bool space_around_delimiters) const {
+    load_all_pending();
+    const Layout layout(options_, space_around_delimiters);
+    std::string out(layout.measure(*store_), '\0');
+    BufferOut buffer(out.data());
+    layout.emit(*store_, buffer);
+    return out;
+}
+
+void Parser::write(const WriteSink& sink, bool space_around_delimiters) const {
+    load_all_pending();
+    const Layout layout(options_, space_around_delimiters);
+    layout.measure(*store_);
+    SinkOut out(sink);
+    layout.emit(*store_, out);
+    out.flush();
+}
+
+void Parser::write_file(std::string_view path, bool space_around_delimiters) const {
+    load_all_pending();
+    const Layout layout(options_, space_around_delimiters);
+    layout.measure(*store_);  // before the file is truncated
+
+    std::ofstream ofs(std::string(path), std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        throw Error(ErrorCode::InvalidWrite, "cannot open file: " + std::string(path));
+    }
+    const WriteSink sink = [&ofs](std::string_view chunk) {
+        ofs.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    };
+    SinkOut out(sink);
+    layout.emit(*store_, out);
+    out.flush();
+    ofs.flush();
+    if (!ofs) {
+        throw Error(ErrorCode::InvalidWrite, "cannot write file: " + std::string(path));
+    }
+}
+
+}  // namespace ini
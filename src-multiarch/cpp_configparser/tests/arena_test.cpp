@@ -0,0 +1,116 @@
+#include "ini/parser.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations{0};
+
+std::string slurp(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+ini::ParseOptions options_for(ini::StorageMode mode) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.storage = mode;
+    return opt;
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main() {
+    const std::string text = slurp(std::string(INI_CONFIGPARSER_CORPUS_DIR) + "/rdpwrap.ini");
+    assert(!text.empty());
+
+    ini::Parser heap(options_for(ini::StorageMode::Heap));
+    auto before = g_allocations.load();
+    heap.read_string(text);
+    const auto heap_allocs = g_allocations.load() - before;
+
+    ini::Parser arena(options_for(ini::StorageMode::Arena));
+    before = g_allocations.load();
+    arena.read_string(text);
+    const auto arena_allocs = g_allocations.load() - before;
+
+    // Heap mode allocates per key and value; the arena only per block.
+    assert(arena_allocs * 10 < heap_allocs);
+    assert(heap.write_to_string() == arena.write_to_string());
+    assert(heap.storage_stats().arena_blocks == 0);
+
+    const auto stats = arena.storage_stats();
+    assert(stats.arena_bytes_used > 0);
+    assert(stats.arena_blocks > 0);
+    assert(stats.arena_bytes_reserved >= stats.arena_bytes_used);
+
+    // Copies get their own arena; moves keep the original one.
+    ini::Parser copy(arena);
+    assert(copy.write_to_string() == heap.write_to_string());
+    copy.set("SLPolicy", "Extra", std::string("1"));
+    assert(!arena.has_option("SLPolicy", "Extra"));
+
+    ini::Parser moved(std::move(copy));
+    assert(moved.get("SLPolicy", "extra") == "1");
+    // The moved-from parser is empty and still usable.
+    assert(copy.sections().empty() && !copy.has_section("SLPolicy"));
+    copy.read_string("[a]\nx = 1\n");
+    assert(copy.get("a", "x") == "1");
+    moved = std::move(copy);
+    assert(moved.sections().size() == 1 && copy.sections().empty());
+    moved = ini::Parser(arena);
+
+    // Section views hand out references, into the parser's section or into
+    // caller-owned items, as they did over std::string storage.
+    const auto view = arena.section("SLPolicy");
+    const ini::SectionItems& listed = view.items();
+    assert(listed.size() == heap.section("SLPolicy").items().size());
+    const ini::OptionValue& first = view.at(listed.front().first);
+    assert(&first == &listed.front().second && &view.items() == &listed);
+    const ini::SectionItems own = {{"key", std::string("value")}, {"bare", std::nullopt}};
+    const ini::SectionView over(&own);
+    assert(&over.items() == &own && &over.at("KEY") == &own[0].second);
+    assert(over.has_option("bare") && !over.at("bare").has_value());
+
+    // Updates and removals on arena storage behave like the heap backend.
+    arena.set("Main", "LogFile", std::string("0"));
+    heap.set("Main", "LogFile", std::string("0"));
+    assert(arena.remove_section("SLPolicy"));
+    assert(heap.remove_section("SLPolicy"));
+    assert(arena.write_to_string() == heap.write_to_string());
+
+    arena.clear();
+    const auto cleared = arena.storage_stats();
+    assert(cleared.arena_bytes_used == 0);
+    assert(cleared.arena_blocks == 0);
+    assert(arena.sections().empty());
+
+    arena.read_string("[a]\nx = 1\n");
+    assert(arena.get("a", "x") == "1");
+
+    std::cout << "arena_test passed (heap " << heap_allocs << " allocs, arena "
+              << arena_allocs << " allocs)\n";
+    return 0;
+}
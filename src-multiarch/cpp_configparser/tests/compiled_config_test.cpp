@@ -0,0 +1,200 @@
+#include "ini/compiled_config.hpp"
+#include "ini/error.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+    return opt;
+}
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// IniGetRaw: anything missing or empty reads as the caller's default.
+std::optional<std::string> wrapper_read(const ini::Parser& p, const std::string& section, const std::string& key) {
+    if (!p.has_section(section) || !p.has_option(section, key)) {
+        return std::nullopt;
+    }
+    auto v = p.get_raw(section, key);
+    if (!v.has_value() || v->empty()) {
+        return std::nullopt;
+    }
+    return v;
+}
+
+std::optional<unsigned long long> wrapper_hex(const std::optional<std::string>& v) {
+    if (!v.has_value()) {
+        return std::nullopt;
+    }
+    errno = 0;
+    char* end = nullptr;
+    const auto n = std::strtoull(v->c_str(), &end, 16);
+    if (errno == ERANGE || *end != '\0') {
+        return std::nullopt;
+    }
+    return n;
+}
+
+std::optional<bool> wrapper_flag(const std::optional<std::string>& v) {
+    if (!v.has_value()) {
+        return std::nullopt;
+    }
+    return std::strtol(v->c_str(), nullptr, 10) != 0;
+}
+
+bool throws_invalid(std::string_view blob) {
+    try {
+        ini::CompiledConfig c(blob);
+    } catch (const ini::Error& e) {
+        return e.code() == ini::ErrorCode::InvalidCompiledConfig;
+    }
+    return false;
+}
+
+const char* const kArchSuffixes[] = {".x86", ".x64", ".arm", ".arm64"};
+const ini::TargetArch kArches[] = {
+    ini::TargetArch::X86, ini::TargetArch::X64, ini::TargetArch::Arm, ini::TargetArch::Arm64,
+};
+
+void check_build(const ini::Parser& ref, const ini::CompiledConfig& compiled, const std::string& build,
+                 std::uint64_t version) {
+    for (std::size_t a = 0; a < 4; ++a) {
+        ini::Parser got(wrapper_options());
+        compiled.load(got, version, kArches[a]);
+        const std::string sfx = kArchSuffixes[a];
+        const std::string slinit = build + "-SLInit";
+
+        assert(got.has_section(build) == ref.has_section(build));
+        assert(got.has_section(slinit) == ref.has_section(slinit));
+        for (const char* key : {"LocalOnlyPatch", "SingleUserPatch", "DefPolicyPatch", "SLPolicyInternal",
+                                "SLInitHook"}) {
+            assert(wrapper_flag(wrapper_read(got, build, key + sfx)) ==
+                   wrapper_flag(wrapper_read(ref, build, key + sfx)));
+        }
+        for (const char* key : {"LocalOnlyOffset", "SingleUserOffset", "DefPolicyOffset", "SLPolicyOffset",
+                                "SLInitOffset"}) {
+            assert(wrapper_hex(wrapper_read(got, build, key + sfx)) ==
+                   wrapper_hex(wrapper_read(ref, build, key + sfx)));
+        }
+        for (const char* key : {"bServerSku", "bRemoteConnAllowed", "bFUSEnabled", "bAppServerAllowed",
+                                "bMultimonAllowed", "lMaxUserSessions", "ulMaxDebugSessions", "bInitialized"}) {
+            assert(wrapper_hex(wrapper_read(got, slinit, key + sfx)) ==
+                   wrapper_hex(wrapper_read(ref, slinit, key + sfx)));
+        }
+        for (const char* key : {"LocalOnlyCode", "SingleUserCode", "DefPolicyCode"}) {
+            const auto code = wrapper_read(ref, build, key + sfx);
+            assert(wrapper_read(got, build, key + sfx) == code);
+            if (code.has_value()) {
+                assert(wrapper_read(got, "PatchCodes", *code) == wrapper_read(ref, "PatchCodes", *code));
+            }
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    for (const char* name : {"rdpwrap.ini", "rdpwrap-arm-kb.ini"}) {
+        const std::string text = read_all(corpus + "/" + name);
+        const std::string blob = ini::compile_config(text, wrapper_options());
+        const ini::CompiledConfig compiled(blob);
+        assert(blob.size() < text.size());
+        assert(compiled.matches_source(text));
+        assert(!compiled.matches_source(text + "\n"));
+        std::string edited = text;
+        edited[edited.size() / 2] ^= 1;
+        assert(!compiled.matches_source(edited));
+
+        ini::Parser ref(wrapper_options());
+        ref.read_string(text);
+
+        // Shared sections come back verbatim whatever the build.
+        ini::Parser shared(wrapper_options());
+        compiled.load(shared, ini::pack_version(1, 2, 3, 4), ini::TargetArch::X64);
+        assert(!compiled.has_version(ini::pack_version(1, 2, 3, 4)));
+        for (const char* section : {"Main", "SLPolicy"}) {
+            assert(shared.items(section) == ref.items(section));
+        }
+
+        std::size_t builds = 0;
+        for (const auto& section : ref.sections()) {
+            const auto parsed = ini::parse_version(section);
+            if (!parsed) {
+                continue;
+            }
+            const auto version = *parsed;
+            assert(compiled.has_version(version));
+            check_build(ref, compiled, section, version);
+            ++builds;
+        }
+        assert(builds > 0);
+        assert(compiled.version_count() >= builds);
+    }
+
+    // Keys the wrapper reads are normalised; unknown keys are dropped.
+    {
+        const std::string text =
+            "[Main]\nUpdated = 2024-01-01\n"
+            "[PatchCodes]\nNop = 90\nJmp = EB\n"
+            "[10.0.1.1]\n"
+            "LocalOnlyPatch.x64 = 2\nLocalOnlyOffset.x64 = 0x1F\nLocalOnlyCode.x64 = Jmp\n"
+            "SingleUserOffset.x64 = zz\nDefPolicyOffset.x64 =\nComment.x64 = ignored\n"
+            "[10.0.1.1-SLInit]\nbServerSku.x64 = 10\n";
+        const auto blob = ini::compile_config(text, wrapper_options());
+        const ini::CompiledConfig compiled(blob);
+        ini::Parser p(wrapper_options());
+        compiled.load(p, ini::pack_version(10, 0, 1, 1), ini::TargetArch::X64);
+        assert(p.get_raw("10.0.1.1", "LocalOnlyPatch.x64") == std::string("1"));
+        assert(p.get_raw("10.0.1.1", "LocalOnlyOffset.x64") == std::string("1f"));
+        assert(p.get_raw("10.0.1.1", "LocalOnlyCode.x64") == std::string("Jmp"));
+        assert(p.get_raw("PatchCodes", "jmp") == std::string("EB"));
+        assert(!p.has_option("PatchCodes", "nop"));
+        assert(!p.has_option("10.0.1.1", "SingleUserOffset.x64"));
+        assert(!p.has_option("10.0.1.1", "Comment.x64"));
+        assert(p.get_raw("10.0.1.1-SLInit", "bServerSku.x64") == std::string("10"));
+
+        ini::Parser other_arch(wrapper_options());
+        compiled.load(other_arch, ini::pack_version(10, 0, 1, 1), ini::TargetArch::X86);
+        assert(other_arch.has_section("10.0.1.1"));
+        assert(other_arch.options("10.0.1.1").empty());
+    }
+
+    // Corrupt blobs are rejected up front.
+    {
+        const auto blob = ini::compile_config("[Main]\nx = 1\n[1.0.0.1]\nLocalOnlyPatch.x86 = 1\n", wrapper_options());
+        assert(!throws_invalid(blob));
+        assert(throws_invalid(""));
+        assert(throws_invalid(blob.substr(0, blob.size() - 8)));
+        std::string bad_magic = blob;
+        bad_magic[0] = 'X';
+        assert(throws_invalid(bad_magic));
+        std::string flipped = blob;
+        flipped[flipped.size() - 1] ^= 0x40;
+        assert(throws_invalid(flipped));
+        std::string format = blob;
+        format[8] = 9;
+        assert(throws_invalid(format));
+    }
+
+    std::cout << "ini_configparser_compiled_config_test passed\n";
+    return 0;
+}
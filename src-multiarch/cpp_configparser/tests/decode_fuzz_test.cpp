@@ -0,0 +1,184 @@
+#include "ini/decode.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// INIReadDWordHex without the platform range check.
+bool reference_hex(const std::string& v, std::uint64_t& out) {
+    if (v.empty()) {
+        return false;  // the wrapper never decodes an empty value
+    }
+    if (v.find('\0') != std::string::npos) {
+        return false;  // strtoull would stop there; the whole view is the value
+    }
+    errno = 0;
+    char* end = nullptr;
+    const unsigned long long n = std::strtoull(v.c_str(), &end, 16);
+    if (errno == ERANGE || end == nullptr || *end != '\0') {
+        return false;
+    }
+    out = n;
+    return true;
+}
+
+// The nibble-at-a-time decode_bytes these decoders replaced.
+bool reference_bytes(const std::string& value, ini::ByteArray& out) {
+    auto digit = [](char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    };
+    std::uint8_t data[sizeof(out.data)];
+    std::size_t nibbles = 0;
+    for (const char c : value) {
+        if (c == ' ' || c == '\t' || c == ',' || c == '-') {
+            continue;
+        }
+        const int d = digit(c);
+        if (d < 0 || nibbles == 2 * sizeof(data)) {
+            return false;
+        }
+        if (nibbles % 2 == 0) {
+            data[nibbles / 2] = static_cast<std::uint8_t>(d << 4);
+        } else {
+            data[nibbles / 2] |= static_cast<std::uint8_t>(d);
+        }
+        ++nibbles;
+    }
+    if (nibbles % 2 != 0) {
+        return false;
+    }
+    out.size = static_cast<std::uint8_t>(nibbles / 2);
+    std::memcpy(out.data, data, out.size);
+    return true;
+}
+
+void check(const std::string& s) {
+    std::uint64_t want = 0x5A5A;
+    std::uint64_t got = 0x5A5A;
+    const bool ok = reference_hex(s, want);
+    const bool decoded = ini::decode_hex(s, got);
+    assert(decoded == ok && got == want);
+
+    ini::ByteArray ref;
+    ini::ByteArray dec;
+    std::memset(ref.data, 0xA5, sizeof(ref.data));
+    std::memset(dec.data, 0xA5, sizeof(dec.data));
+    ref.size = dec.size = 9;
+    const bool ref_ok = reference_bytes(s, ref);
+    const bool dec_ok = ini::decode_bytes(s, dec);
+    // On failure both leave the array as it was.
+    assert(dec_ok == ref_ok && dec.size == ref.size);
+    assert(std::memcmp(dec.data, ref.data, sizeof(dec.data)) == 0);
+}
+
+std::string random_string(std::mt19937& rng, const std::string& alphabet, std::size_t max_len) {
+    std::string s(rng() % (max_len + 1), '\0');
+    for (auto& c : s) {
+        c = alphabet[rng() % alphabet.size()];
+    }
+    return s;
+}
+
+// Every value of the shipped files whose key names an offset or a code,
+// plus [PatchCodes].
+std::vector<std::string> corpus_values() {
+    std::vector<std::string> out;
+    for (const char* name : {"/rdpwrap.ini", "/rdpwrap-arm-kb.ini"}) {
+        std::ifstream in(std::string(INI_CONFIGPARSER_CORPUS_DIR) + name, std::ios::binary);
+        std::ostringstream text;
+        text << in.rdbuf();
+        ini::ParseOptions opt;
+        opt.interpolation = ini::InterpolationMode::None;
+        opt.strict = false;
+        ini::Parser p(opt);
+        p.read_string(text.str());
+        for (const auto& section : p.sections()) {
+            for (const auto& [key, value] : p.section(section).items()) {
+                const bool wanted = section == "PatchCodes" || key.find("offset") != std::string::npos ||
+                                    key.find("code") != std::string::npos;
+                if (wanted && value.has_value()) {
+                    out.push_back(*value);
+                }
+            }
+        }
+    }
+    return out;
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng(20240917);
+
+    // Short strings over everything strtoull and the separators care about.
+    std::string mixed = "0123456789abcdefABCDEFxX+- \t,g\n\v\r";
+    mixed.push_back('\0');
+    for (int n = 0; n < 100000; ++n) {
+        check(random_string(rng, mixed, 24));
+    }
+
+    // Mostly digits with some separators, long enough to cross the 255-byte
+    // limit of a ByteArray and the 16-digit limit of a u64.
+    const std::string pairs = "0123456789abcdefABCDEF0000000000 ,-\t";
+    for (int n = 0; n < 20000; ++n) {
+        check(random_string(rng, pairs, n % 10 == 0 ? 700 : 40));
+    }
+    check(std::string(510, 'f'));
+    check(std::string(511, 'f'));
+    check(std::string(512, 'f'));
+    check(std::string(510, 'f') + " - ,\t");
+    check(std::string(40, '0') + "1");
+    check(std::string(40, '0') + "FFFFFFFFFFFFFFFF");
+    check(std::string(40, '0') + "10000000000000000");
+    check("0x" + std::string(17, '0') + "1");
+
+    // The shipped values, and each one with a byte changed, dropped or added.
+    const auto values = corpus_values();
+    assert(values.size() > 1000);
+    std::size_t decoded = 0;
+    for (const auto& v : values) {
+        check(v);
+        ini::ByteArray bytes;
+        std::uint64_t n = 0;
+        decoded += ini::decode_bytes(v, bytes) || ini::decode_hex(v, n) ? 1 : 0;
+        for (int k = 0; k < 4 && !v.empty(); ++k) {
+            std::string m = v;
+            const auto at = rng() % m.size();
+            switch (k) {
+            case 0:
+                m[at] = mixed[rng() % mixed.size()];
+                break;
+            case 1:
+                m.erase(at, 1);
+                break;
+            default:
+                m.insert(at, 1, pairs[rng() % pairs.size()]);
+                break;
+            }
+            check(m);
+        }
+    }
+    // Offsets and [PatchCodes] decode; code names such as "jmpshort" do not.
+    assert(decoded > values.size() / 2);
+
+    std::cout << "decode_fuzz_test passed\n";
+    return 0;
+}
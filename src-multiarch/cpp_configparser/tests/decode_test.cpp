@@ -0,0 +1,103 @@
+#include "ini/decode.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+
+namespace {
+
+ini::ParseOptions wrapper_options(ini::SectionLoading loading = ini::SectionLoading::Eager) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.allow_no_value = true;
+    opt.section_loading = loading;
+    return opt;
+}
+
+std::uint32_t decimal(const char* s) {
+    std::uint32_t out = 7;
+    assert(ini::decode_decimal(s, out));
+    return out;
+}
+
+}  // namespace
+
+int main() {
+    // decode_decimal follows a 32-bit strtoul: blanks, a sign, then digits.
+    assert(decimal("") == 0);
+    assert(decimal("abc") == 0);
+    assert(decimal("0") == 0);
+    assert(decimal(" \t42xyz") == 42);
+    assert(decimal("+17") == 17);
+    assert(decimal("-1") == 0xFFFFFFFFu);
+    assert(decimal("-4294967295") == 1);
+    assert(decimal("4294967295") == 0xFFFFFFFFu);
+    assert(decimal("4294967296") == 0xFFFFFFFFu);
+    assert(decimal("-4294967296") == 0xFFFFFFFFu);
+    assert(decimal("99999999999999999999999") == 0xFFFFFFFFu);
+    assert(decimal("0x10") == 0);
+
+    const std::string text =
+        "[DEFAULT]\n"
+        "inherited = 5\n"
+        "[SLPolicy]\n"
+        "TerminalServices-RemoteConnectionManager-AllowRemoteConnections = 1\n"
+        "Kernel-MUI-Number-Allowed = 1000\n"
+        "offset = 0x1F\n"
+        "code = B8 00 01\n"
+        "bad = zz\n"
+        "empty =\n"
+        "novalue\n";
+    ini::Parser p(wrapper_options());
+    p.read_string(text);
+
+    // find / try_get_raw: hits, misses, options without a value and the
+    // default-section fallback, including for a missing section.
+    std::optional<std::string_view> v;
+    assert(p.find("SLPolicy", "offset", &v) && v == "0x1F");
+    assert(p.find("SLPolicy", "OFFSET"));
+    assert(!p.find("slpolicy", "offset"));
+    assert(p.find("SLPolicy", "novalue", &v) && !v.has_value());
+    assert(!p.find("SLPolicy", "missing", &v) && !v.has_value());
+    assert(p.try_get_raw("SLPolicy", "empty") == "");
+    assert(!p.try_get_raw("SLPolicy", "missing").has_value());
+    assert(!p.try_get_raw("SLPolicy", "novalue").has_value());
+    assert(p.try_get_raw("SLPolicy", "inherited") == "5");
+    assert(p.try_get_raw("NoSuchSection", "inherited") == "5");
+    assert(!p.try_get_raw("NoSuchSection", "offset").has_value());
+    assert(p.try_get_raw("SLPolicy", "offset") == p.get_raw("SLPolicy", "offset"));
+
+    // Typed reads: nullopt for missing, valueless, empty and malformed.
+    assert(ini::read_decimal(p, "SLPolicy", "Kernel-MUI-Number-Allowed") == 1000u);
+    assert(ini::read_decimal(p, "SLPolicy", "bad") == 0u);
+    assert(!ini::read_decimal(p, "SLPolicy", "empty").has_value());
+    assert(!ini::read_decimal(p, "SLPolicy", "missing").has_value());
+    assert(ini::read_flag(p, "SLPolicy", "TerminalServices-RemoteConnectionManager-AllowRemoteConnections") == true);
+    assert(ini::read_flag(p, "SLPolicy", "bad") == false);
+    assert(!ini::read_flag(p, "SLPolicy", "novalue").has_value());
+    assert(ini::read_hex(p, "SLPolicy", "offset") == 0x1Fu);
+    assert(!ini::read_hex(p, "SLPolicy", "bad").has_value());
+    assert(!ini::read_hex(p, "SLPolicy", "empty").has_value());
+    assert(!ini::read_hex(p, "Nowhere", "offset").has_value());
+
+    ini::ByteArray bytes;
+    assert(ini::read_bytes(p, "SLPolicy", "code", bytes) && bytes.size == 3 && bytes.data[0] == 0xB8);
+    assert(!ini::read_bytes(p, "SLPolicy", "bad", bytes) && bytes.size == 3);
+    assert(!ini::read_bytes(p, "SLPolicy", "missing", bytes));
+
+    // A section whose deferred parse fails finds nothing, without throwing;
+    // once the error has been reported the valid part is readable.
+    {
+        auto opt = wrapper_options(ini::SectionLoading::Lazy);
+        opt.allow_no_value = false;
+        ini::Parser lazy(opt);
+        lazy.read_string("[a]\nk = 12\nbroken line\n[b]\nk = 3\n");
+        assert(ini::read_decimal(lazy, "b", "k") == 3u);
+        assert(!lazy.find("a", "k"));
+        assert(ini::read_decimal(lazy, "a", "k") == 12u);
+    }
+
+    std::cout << "decode_test passed\n";
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "ini/parser.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// The corpus with LF line endings, however it was checked out, so that the
+// edits below can match whole lines.
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    std::string text = ss.str();
+    text.erase(std::remove(text.begin(), text.end(), '\r'), text.end());
+    return text;
+}
+
+std::string replaced(std::string text, const std::string& from, const std::string& to) {
+    const auto pos = text.find(from);
+    assert(pos != std::string::npos);
+    return text.replace(pos, from.size(), to);
+}
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+ini::Parser parsed(const std::string& text, ini::ParseOptions opt = wrapper_options()) {
+    ini::Parser p(opt);
+    p.read_string(text);
+    return p;
+}
+
+const ini::OptionChange* find_option(const ini::SectionChange& change, const std::string& option) {
+    for (const auto& entry : change.options) {
+        if (entry.option == option) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    const auto rdpwrap = read_all(corpus + "/rdpwrap.ini");
+
+    // Identical snapshots, however each side was stored or loaded.
+    {
+        const auto base = parsed(rdpwrap);
+        assert(base.diff(base).empty());
+        auto opt = wrapper_options();
+        opt.storage = ini::StorageMode::Arena;
+        assert(base.diff(parsed(rdpwrap, opt)).empty());
+        opt.section_loading = ini::SectionLoading::Lazy;
+        const auto lazy = parsed(rdpwrap, opt);
+        assert(lazy.pending_section_count() > 0);
+        assert(lazy.diff(base).empty());
+        assert(lazy.pending_section_count() == 0);
+    }
+
+    // An update touching one build section, one patch code and [Main], plus
+    // a new build and a dropped one.
+    {
+        auto next = replaced(rdpwrap, "LocalOnlyOffset.x64=87611\n", "LocalOnlyOffset.x64=87612\n");
+        next = replaced(next, "\nnop_2=9090\n", "\nnop_2=6690\n");
+        next = replaced(next, "\n[6.0.6001.18000]\n", "\n[6.0.6001.18000-gone]\n");
+        next = replaced(next, "\n[Main]\n", "\n[Main]\nExtra=1\n");
+        next += "\n[99.0.1.1]\nLocalOnlyPatch.x64=1\nLocalOnlyCode.x64=nop\n";
+
+        const auto before = parsed(rdpwrap);
+        const auto after = parsed(next);
+        const auto diff = before.diff(after);
+        assert(diff.sections.size() == 6);
+
+        const auto* main = diff.find("Main");
+        assert(main != nullptr && main->kind == ini::ChangeKind::Modified && main->options.size() == 1);
+        assert(main->options[0].option == "extra" && main->options[0].kind == ini::ChangeKind::Added);
+        assert(!main->options[0].before.has_value() && main->options[0].after == "1");
+
+        const auto* codes = diff.find("PatchCodes");
+        assert(codes != nullptr && codes->options.size() == 1);
+        assert(codes->options[0].option == "nop_2" && codes->options[0].kind == ini::ChangeKind::Modified);
+        assert(codes->options[0].before == "9090" && codes->options[0].after == "6690");
+
+        const auto* build = diff.find("10.0.19041.1");
+        assert(build != nullptr && build->options.size() == 1);
+        const auto* offset = find_option(*build, "localonlyoffset.x64");
+        assert(offset != nullptr && offset->before == "87611" && offset->after == "87612");
+
+        const auto* gone = diff.find("6.0.6001.18000");
+        assert(gone != nullptr && gone->kind == ini::ChangeKind::Removed);
+        assert(gone->options.size() == before.options("6.0.6001.18000").size());
+        assert(diff.find("6.0.6001.18000-gone")->kind == ini::ChangeKind::Added);
+
+        const auto* added = diff.find("99.0.1.1");
+        assert(added != nullptr && added->kind == ini::ChangeKind::Added && added->options.size() == 2);
+        assert(find_option(*added, "localonlycode.x64")->after == "nop");
+        assert(diff.find("10.0.19041.84") == nullptr);
+
+        // Older order first, then what only the newer parser has.
+        assert(diff.sections.front().section == "Main");
+        assert(diff.sections.back().section == "99.0.1.1");
+
+        // The reverse diff mirrors it.
+        const auto back = after.diff(before);
+        assert(back.sections.size() == 6);
+        assert(back.find("99.0.1.1")->kind == ini::ChangeKind::Removed);
+        assert(back.find("Main")->options[0].kind == ini::ChangeKind::Removed);
+        assert(back.find("PatchCodes")->options[0].after == "9090");
+    }
+
+    // Order alone is not a change; the default section, no-value options and
+    // case-folded keys are compared like any other.
+    {
+        auto opt = wrapper_options();
+        opt.allow_no_value = true;
+        const auto a = parsed("[DEFAULT]\nd = 1\n[a]\nx = 1\ny = 2\nflag\n[b]\nz = 3\n", opt);
+        const auto b = parsed("[b]\nZ = 3\n[a]\nflag\ny = 2\nX = 1\n[DEFAULT]\nd = 1\n", opt);
+        assert(a.diff(b).empty());
+
+        const auto c = parsed("[DEFAULT]\nd = 2\n[a]\nx = 1\ny = 2\nflag = set\n[b]\nz = 3\n", opt);
+        const auto diff = a.diff(c);
+        assert(diff.sections.size() == 2);
+        assert(diff.sections[0].section == "DEFAULT" && diff.sections[0].options[0].after == "2");
+        const auto* flag = find_option(*diff.find("a"), "flag");
+        assert(flag != nullptr && flag->kind == ini::ChangeKind::Modified);
+        assert(!flag->before.has_value() && flag->after == "set");
+
+        const auto empty = parsed("", opt);
+        assert(a.diff(empty).sections.size() == 3);
+        assert(empty.diff(a).find("DEFAULT")->kind == ini::ChangeKind::Modified);
+        assert(empty.diff(empty).empty());
+
+        // An empty section is still a section.
+        assert(empty.diff(parsed("[new]\n", opt)).find("new")->options.empty());
+    }
+
+    // Deferred sections are parsed first, and their errors surface here.
+    {
+        auto opt = wrapper_options();
+        opt.section_loading = ini::SectionLoading::Lazy;
+        const auto broken = parsed("[a]\nx = 1\n[b]\nno delimiter\n", opt);
+        bool threw = false;
+        try {
+            broken.diff(parsed("[a]\nx = 1\n"));
+        } catch (const ini::ParsingError&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    std::cout << "diff_test passed\n";
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "ini/parser.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+
+int main() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+
+    ini::Parser p(opt);
+    p.read_string(R"ini(
+[DEFAULT]
+Shared = base
+
+[10.0.19041.1]
+LocalOnlyPatch.x64=1
+LocalOnlyOffset.x64=88F41
+LocalOnlyCode.x64=jmpshort
+localonlyoffset.x64=88F42
+)ini");
+
+    assert(p.has_section("10.0.19041.1"));
+    assert(!p.has_section("10.0.19041.2"));
+    assert(p.has_option("10.0.19041.1", "LOCALONLYPATCH.X64"));
+    assert(p.has_option("10.0.19041.1", "shared"));
+    assert(!p.has_option("10.0.19041.1", "SingleUserPatch.x64"));
+    assert(p.get_raw("10.0.19041.1", "LocalOnlyOffset.x64") == std::string("88F42"));
+
+    const auto view = p.section("10.0.19041.1");
+    assert(view.has_option("localonlycode.X64"));
+    assert(view.at("LocalOnlyCode.x64") == std::string("jmpshort"));
+    assert(!view.has_option("Shared"));
+    assert(!p.section("missing").has_option("LocalOnlyCode.x64"));
+
+    // Enough inserts to force several index resizes.
+    for (int i = 0; i < 100; ++i) {
+        p.set("10.0.19041.1", "Key" + std::to_string(i), std::to_string(i));
+    }
+    for (int i = 0; i < 100; ++i) {
+        assert(p.get_raw("10.0.19041.1", "KEY" + std::to_string(i)) == std::to_string(i));
+    }
+
+    // Removal shifts positions; remaining keys must still resolve.
+    assert(p.remove_option("10.0.19041.1", "LocalOnlyPatch.x64"));
+    assert(!p.remove_option("10.0.19041.1", "LocalOnlyPatch.x64"));
+    assert(!p.has_option("10.0.19041.1", "LocalOnlyPatch.x64"));
+    assert(p.get_raw("10.0.19041.1", "key99") == std::string("99"));
+    assert(p.get_raw("10.0.19041.1", "LocalOnlyCode.x64") == std::string("jmpshort"));
+
+    // Output keeps insertion order.
+    const auto out = p.write_to_string(false);
+    const auto offset_pos = out.find("localonlyoffset.x64=88F42");
+    const auto code_pos = out.find("localonlycode.x64=jmpshort");
+    const auto key0_pos = out.find("key0=0");
+    assert(offset_pos != std::string::npos);
+    assert(offset_pos < code_pos && code_pos < key0_pos);
+
+    p.add_section("extra");
+    assert(p.remove_section("10.0.19041.1"));
+    assert(p.has_section("extra"));
+    assert(!p.has_section("10.0.19041.1"));
+
+    std::cout << "ini_configparser_index_test passed\n";
+    return 0;
+}
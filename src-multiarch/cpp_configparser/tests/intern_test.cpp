@@ -0,0 +1,144 @@
+#include "ini/parser.hpp"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+
+std::string slurp(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+ini::ParseOptions options_for(ini::StorageMode mode) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.storage = mode;
+    return opt;
+}
+
+std::string_view raw(const ini::Parser& p, std::string_view section, std::string_view option) {
+    const auto value = p.try_get_raw(section, option);
+    assert(value.has_value());
+    return *value;
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    for (const char* name : {"/rdpwrap.ini", "/rdpwrap-arm-kb.ini"}) {
+        const std::string text = slurp(corpus + name);
+        ini::Parser heap(options_for(ini::StorageMode::Heap));
+        heap.read_string(text);
+        ini::Parser interned(options_for(ini::StorageMode::Interned));
+        interned.read_string(text);
+        assert(interned.write_to_string() == heap.write_to_string());
+        assert(heap.diff(interned).empty());
+
+        // The pool holds each distinct text once.
+        std::set<std::string> distinct;
+        std::size_t distinct_bytes = 0;
+        std::size_t total_bytes = 0;
+        for (const auto& section : heap.sections()) {
+            for (const auto& [key, value] : heap.section(section).items()) {
+                for (const auto& s : {std::optional<std::string>(key), value}) {
+                    if (s.has_value()) {
+                        total_bytes += s->size();
+                        distinct_bytes += distinct.insert(*s).second ? s->size() : 0;
+                    }
+                }
+            }
+        }
+        const auto stats = interned.storage_stats();
+        assert(stats.interned_strings == distinct.size());
+        assert(stats.interned_bytes == distinct_bytes);
+        assert(stats.arena_blocks > 0);
+        if (std::string_view(name) == "/rdpwrap.ini") {
+            // Thousands of builds repeat the same keys and code names.
+            assert(stats.interned_bytes * 10 < total_bytes);
+        }
+        assert(heap.storage_stats().interned_strings == 0);
+    }
+
+    const std::string text = slurp(corpus + "/rdpwrap.ini");
+    ini::Parser p(options_for(ini::StorageMode::Interned));
+    p.read_string(text);
+
+    // Equal text, one address; different text, different addresses.
+    const auto a = raw(p, "10.0.19041.1", "LocalOnlyCode.x64");
+    const auto b = raw(p, "10.0.19041.84", "LocalOnlyCode.x64");
+    assert(a == b && a.data() == b.data());
+    const auto c = raw(p, "10.0.19041.1", "SingleUserCode.x64");
+    assert(a != c && a.data() != c.data());
+
+    std::string_view keys[] = {"SLInitHook.x64", "SLInitOffset.x64"};
+    std::optional<std::string_view> first[2];
+    std::optional<std::string_view> second[2];
+    assert(p.get_raw_batch("10.0.19041.1", keys, 2, first));
+    assert(p.get_raw_batch("10.0.19041.84", keys, 2, second));
+    assert(first[0]->data() == second[0]->data());
+
+    // Keys are pooled lower-cased; updates go through the pool as well.
+    p.set("Main", "NewKey", std::string("jmpshort"));
+    assert(a == "jmpshort" && raw(p, "Main", "newkey").data() == a.data());
+    const auto before = p.storage_stats().interned_strings;
+    p.set("Main", "NewKey", std::string("1"));
+    assert(p.storage_stats().interned_strings == before);
+    p.set("Main", "NewKey", std::string("a value nobody else has"));
+    assert(p.storage_stats().interned_strings == before + 1);
+    assert(p.remove_option("Main", "newkey"));
+    assert(!p.has_option("Main", "NewKey"));
+
+    // Multi-line values, no-value options and the empty string.
+    {
+        auto opt = options_for(ini::StorageMode::Interned);
+        opt.allow_no_value = true;
+        ini::Parser q(opt);
+        q.read_string("[a]\nx = one\n  two\nflag\nempty =\n[b]\nX = one\n  two\nempty =\nflag\n");
+        assert(q.get("a", "x") == "one\ntwo");
+        assert(raw(q, "a", "x").data() == raw(q, "b", "x").data());
+        assert(raw(q, "a", "empty").data() == raw(q, "b", "empty").data());
+        assert(!q.get_raw("a", "flag").has_value());
+        assert(raw(q, "a", "empty").data() != raw(q, "a", "x").data());
+    }
+
+    // Copies, moves and parallel reads keep one pool per parser.
+    {
+        ini::Parser copy(p);
+        assert(copy.write_to_string() == p.write_to_string());
+        assert(raw(copy, "10.0.19041.1", "LocalOnlyCode.x64").data() ==
+               raw(copy, "10.0.19041.84", "LocalOnlyCode.x64").data());
+        assert(raw(copy, "10.0.19041.1", "LocalOnlyCode.x64").data() != a.data());
+        ini::Parser moved(std::move(copy));
+        assert(raw(moved, "10.0.19041.1", "LocalOnlyCode.x64") == a);
+
+        auto opt = options_for(ini::StorageMode::Interned);
+        opt.parse_threads = 4;
+        ini::Parser parallel(opt);
+        parallel.read_string(text + "\n" + text);
+        assert(parallel.write_to_string() == p.write_to_string());
+        ini::Parser sequential(options_for(ini::StorageMode::Interned));
+        sequential.read_string(text);
+        assert(parallel.storage_stats().interned_strings == sequential.storage_stats().interned_strings);
+        assert(raw(parallel, "10.0.19041.1", "LocalOnlyCode.x64").data() ==
+               raw(parallel, "10.0.19041.84", "LocalOnlyCode.x64").data());
+    }
+
+    p.clear();
+    assert(p.sections().empty());
+    p.read_string("[s]\nk = v\n");
+    assert(p.storage_stats().interned_strings == 2);
+
+    std::cout << "intern_test passed\n";
+    return 0;
+}
@@ -0,0 +1,359 @@
+#include "ini/parser.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string lower(std::string_view s) {
+    std::string out(s);
+    for (auto& c : out) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return out;
+}
+
+// The resolver get() used before values were cached: every reference
+// resolved again, recursively, on every call.
+std::string reference_interpolate(
+    const ini::Parser& p,
+    const std::string& section,
+    const std::string& option,
+    const std::string& value,
+    int depth) {
+    const auto& opt = p.parse_options();
+    if (depth > opt.max_interpolation_depth) {
+        throw ini::Error(ini::ErrorCode::InterpolationDepth, "Recursion limit exceeded in value substitution for option '" +
+                                                                 option + "' in section '" + section + "'");
+    }
+    const bool basic = opt.interpolation == ini::InterpolationMode::Basic;
+    const char marker = basic ? '%' : '$';
+    std::string out;
+    for (std::size_t i = 0; i < value.size();) {
+        if (value[i] != marker) {
+            out.push_back(value[i++]);
+            continue;
+        }
+        if (i + 1 >= value.size()) {
+            throw ini::Error(ini::ErrorCode::InterpolationSyntax, "syntax");
+        }
+        if (value[i + 1] == marker) {
+            out.push_back(marker);
+            i += 2;
+            continue;
+        }
+        if (value[i + 1] != (basic ? '(' : '{')) {
+            throw ini::Error(ini::ErrorCode::InterpolationSyntax, "syntax");
+        }
+        const auto close = value.find(basic ? ")s" : "}", i + 2);
+        if (close == std::string::npos) {
+            throw ini::Error(ini::ErrorCode::InterpolationSyntax, "syntax");
+        }
+        const std::string token = value.substr(i + 2, close - (i + 2));
+        std::string ref_section = section;
+        std::string ref_option = lower(token);
+        const auto colon = token.find(':');
+        if (!basic && colon != std::string::npos) {
+            ref_section = token.substr(0, colon);
+            ref_option = lower(token.substr(colon + 1));
+        }
+        const auto replacement = p.get_raw(ref_section, ref_option);
+        if (replacement.has_value()) {
+            out += reference_interpolate(p, ref_section, ref_option, *replacement, depth + 1);
+        }
+        i = close + (basic ? 2 : 1);
+    }
+    return out;
+}
+
+std::string outcome(const std::function<std::string()>& get) {
+    try {
+        return get();
+    } catch (const ini::Error& e) {
+        return "error " + std::to_string(static_cast<int>(e.code()));
+    }
+}
+
+std::string expected(const ini::Parser& p, const std::string& section, const std::string& option) {
+    return outcome([&] {
+        const auto raw = p.get_raw(section, option);
+        return raw ? reference_interpolate(p, section, option, *raw, 1) : std::string();
+    });
+}
+
+// get() and items() agree with the reference for every option, asked for in
+// a random order so that any of them may be the first one resolved.
+void check_all(const ini::Parser& p, std::mt19937& rng) {
+    std::vector<std::pair<std::string, std::string>> all;
+    for (const auto& section : p.sections()) {
+        for (const auto& option : p.options(section)) {
+            all.emplace_back(section, option);
+        }
+    }
+    std::shuffle(all.begin(), all.end(), rng);
+    for (const auto& [section, option] : all) {
+        assert(outcome([&] { return p.get(section, option); }) == expected(p, section, option));
+    }
+    for (const auto& section : p.sections()) {
+        std::string mine;
+        std::string theirs;
+        try {
+            for (const auto& [key, value] : p.items(section)) {
+                mine += key + "=" + value.value_or("<none>") + "\n";
+            }
+        } catch (const ini::Error&) {
+            mine = "error";
+        }
+        try {
+            for (const auto& [key, value] : p.items(section, true)) {
+                const auto resolved = value ? reference_interpolate(p, section, key, *value, 1) : std::string("<none>");
+                theirs += key + "=" + resolved + "\n";
+            }
+        } catch (const ini::Error&) {
+            theirs = "error";
+        }
+        assert(mine == theirs);
+    }
+}
+
+std::string random_value(std::mt19937& rng, bool basic, int options) {
+    std::string v;
+    const int parts = static_cast<int>(rng() % 4);
+    for (int i = 0; i < parts; ++i) {
+        switch (rng() % 5) {
+        case 0:
+            v += basic ? "%%" : "$$";
+            break;
+        case 1:
+        case 2: {
+            const std::string name = "o" + std::to_string(rng() % options);
+            if (basic) {
+                v += "%(" + name + ")s";
+            } else if (rng() % 2 == 0) {
+                v += "${" + name + "}";
+            } else {
+                v += "${s" + std::to_string(rng() % 3) + ":" + name + "}";
+            }
+            break;
+        }
+        default:
+            v += "x" + std::to_string(rng() % 100);
+        }
+    }
+    return v;
+}
+
+ini::Parser random_parser(std::mt19937& rng, ini::InterpolationMode mode) {
+    ini::ParseOptions opt;
+    opt.interpolation = mode;
+    opt.allow_no_value = true;
+    opt.max_interpolation_depth = 1 + static_cast<int>(rng() % 10);
+    ini::Parser p(opt);
+    const bool basic = mode == ini::InterpolationMode::Basic;
+    std::string text = "[DEFAULT]\no0 = base\n";
+    for (int s = 0; s < 3; ++s) {
+        text += "[s" + std::to_string(s) + "]\n";
+        for (int o = 0; o < 6; ++o) {
+            if (rng() % 8 == 0) {
+                text += "o" + std::to_string(o) + "\n";  // no value
+            } else {
+                text += "o" + std::to_string(o) + " = " + random_value(rng, basic, 6) + "\n";
+            }
+        }
+    }
+    p.read_string(text);
+    return p;
+}
+
+}  // namespace
+
+int main() {
+    // Basic references within a section and its defaults.
+    {
+        ini::ParseOptions opt;
+        opt.strict = false;  // "[app]" is read twice
+        ini::Parser p(opt);
+        p.read_string("[DEFAULT]\nbase = /tmp\n[app]\nname = demo\npath = %(base)s/%(name)s\npct = 100%%\n");
+        assert(p.get("app", "path") == "/tmp/demo");
+        assert(p.get("app", "PATH") == "/tmp/demo");
+        assert(p.get("app", "pct") == "100%");
+
+        // Changes are seen by the next get().
+        p.set("app", "name", std::string("other"));
+        assert(p.get("app", "path") == "/tmp/other");
+        p.set("DEFAULT", "base", std::string("/var"));
+        assert(p.get("app", "path") == "/var/other");
+        p.set("app", "base", std::string("/opt"));
+        assert(p.get("app", "path") == "/opt/other");
+        const bool removed = p.remove_option("app", "base");
+        assert(removed);
+        assert(p.get("app", "path") == "/var/other");
+        p.read_string("[more]\nx = 1\n[app]\nname = reread\n");
+        assert(p.get("app", "path") == "/var/reread");
+
+        // A missing reference is an error until the option appears.
+        p.set("app", "broken", std::string("%(nope)s"));
+        try {
+            p.get("app", "broken");
+            assert(false);
+        } catch (const ini::Error& e) {
+            assert(e.code() == ini::ErrorCode::NoOption);
+        }
+        p.set("app", "nope", std::string("fixed"));
+        assert(p.get("app", "broken") == "fixed");
+
+        // A copy has its own values.
+        ini::Parser copy(p);
+        copy.set("app", "nope", std::string("copied"));
+        assert(copy.get("app", "broken") == "copied");
+        assert(p.get("app", "broken") == "fixed");
+    }
+
+    // Extended references across sections, and section removal.
+    {
+        ini::ParseOptions opt;
+        opt.interpolation = ini::InterpolationMode::Extended;
+        ini::Parser p(opt);
+        p.read_string("[Main]\nbase = 0x10\nnext = ${base}00\n[a]\nx = ${Main:next}+${Main:base}\ncost = $$5\n");
+        assert(p.get("a", "x") == "0x1000+0x10");
+        assert(p.get("a", "cost") == "$5");
+        const bool removed = p.remove_section("Main");
+        assert(removed);
+        try {
+            p.get("a", "x");
+            assert(false);
+        } catch (const ini::Error& e) {
+            assert(e.code() == ini::ErrorCode::NoSection);
+        }
+        p.add_section("Main");
+        p.set("Main", "next", std::string("n"));
+        p.set("Main", "base", std::string("b"));
+        assert(p.get("a", "x") == "n+b");
+    }
+
+    // Cycles are found however deep references may nest.
+    {
+        ini::ParseOptions opt;
+        opt.interpolation = ini::InterpolationMode::Extended;
+        opt.max_interpolation_depth = 1 << 30;
+        ini::Parser p(opt);
+        p.read_string("[s]\nself = ${self}\na = ${b}\nb = ${t:c}\nd = 1\n[t]\nc = ${s:a}\nok = ${s:d}\n");
+        for (const char* option : {"self", "a", "b"}) {
+            try {
+                p.get("s", option);
+                assert(false);
+            } catch (const ini::Error& e) {
+                assert(e.code() == ini::ErrorCode::InterpolationDepth);
+            }
+        }
+        assert(p.get("t", "ok") == "1");
+    }
+
+    // The depth limit gives the same result whether or not the inner
+    // values were resolved before: v9 nests ten levels, v10 eleven.
+    {
+        std::string text = "[s]\nv0 = base\n";
+        for (int i = 1; i <= 12; ++i) {
+            text += "v" + std::to_string(i) + " = <%(v" + std::to_string(i - 1) + ")s>\n";
+        }
+        ini::Parser cold;
+        cold.read_string(text);
+        ini::Parser warm;
+        warm.read_string(text);
+        for (int i = 0; i <= 8; ++i) {
+            warm.get("s", "v" + std::to_string(i));
+        }
+        for (auto* p : {&warm, &cold}) {
+            assert(p->get("s", "v9").size() == 4 + 2 * 9);
+            std::string message;
+            try {
+                p->get("s", "v12");
+                assert(false);
+            } catch (const ini::Error& e) {
+                assert(e.code() == ini::ErrorCode::InterpolationDepth);
+                message = e.what();
+            }
+            assert(message.find("'v2'") != std::string::npos);
+        }
+    }
+
+    // Widely shared references: each level refers to the one below twice.
+    {
+        ini::ParseOptions opt;
+        opt.interpolation = ini::InterpolationMode::Extended;
+        std::string text = "[s]\nl0 = ab\n";
+        for (int i = 1; i <= 9; ++i) {
+            const std::string below = "${l" + std::to_string(i - 1) + "}";
+            text += "l" + std::to_string(i) + " = " + below + below + "\n";
+        }
+        ini::Parser p(opt);
+        p.read_string(text);
+        const auto v = p.get("s", "l9");
+        assert(v.size() == 2u << 9);
+        assert(v.find_first_not_of("ab") == std::string::npos);
+    }
+
+    // Random configurations against the uncached resolver, with changes
+    // between rounds.
+    std::mt19937 rng(1234);
+    for (int round = 0; round < 300; ++round) {
+        const auto mode = round % 2 == 0 ? ini::InterpolationMode::Basic : ini::InterpolationMode::Extended;
+        auto p = random_parser(rng, mode);
+        check_all(p, rng);
+        for (int change = 0; change < 4; ++change) {
+            const std::string section = "s" + std::to_string(rng() % 3);
+            const std::string option = "o" + std::to_string(rng() % 6);
+            switch (rng() % 3) {
+            case 0:
+                p.set(section, option, random_value(rng, mode == ini::InterpolationMode::Basic, 6));
+                break;
+            case 1:
+                p.remove_option(section, option);
+                break;
+            default:
+                p.remove_section(section);
+                p.add_section(section);
+            }
+            check_all(p, rng);
+        }
+    }
+
+    // Concurrent readers see the same values.
+    {
+        ini::ParseOptions opt;
+        opt.interpolation = ini::InterpolationMode::Extended;
+        ini::Parser p(opt);
+        std::string text = "[Main]\nbase = 0x1000\n[o]\n";
+        for (int i = 0; i < 200; ++i) {
+            text += "k" + std::to_string(i) + " = ${Main:base}+" + std::to_string(i) + "\n";
+        }
+        p.read_string(text);
+        std::vector<std::thread> threads;
+        std::vector<int> good(4, 0);
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 200; ++i) {
+                    const int k = (i * 7 + t * 13) % 200;
+                    good[t] += p.get("o", "k" + std::to_string(k)) == "0x1000+" + std::to_string(k);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const int n : good) {
+            assert(n == 200);
+        }
+    }
+
+    std::cout << "interpolation_test passed\n";
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include "ini/parser.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+ini::ParseOptions options_for(ini::SectionLoading loading, bool strict = false) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = strict;
+    opt.section_loading = loading;
+    return opt;
+}
+
+std::string dump(ini::SectionLoading loading, const std::string& text) {
+    ini::Parser p(options_for(loading));
+    p.read_string(text);
+    return p.write_to_string();
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    for (const char* name : {"rdpwrap.ini", "rdpwrap-arm-kb.ini"}) {
+        const auto path = corpus + "/" + name;
+        ini::Parser eager(options_for(ini::SectionLoading::Eager));
+        eager.read_file(path);
+        assert(eager.pending_section_count() == 0);
+
+        ini::Parser lazy(options_for(ini::SectionLoading::Lazy));
+        lazy.read_file(path);
+        const auto pending = lazy.pending_section_count();
+        assert(pending > 0);
+        assert(lazy.sections() == eager.sections());
+
+        // Touching one section parses that section only.
+        assert(lazy.get_raw("Main", "Updated") == eager.get_raw("Main", "Updated"));
+        assert(lazy.pending_section_count() == pending - 1);
+        assert(lazy.items("SLPolicy") == eager.items("SLPolicy"));
+        assert(lazy.pending_section_count() == pending - 2);
+
+        assert(lazy.write_to_string() == eager.write_to_string());
+        assert(lazy.pending_section_count() == 0);
+
+        // Sections touched up front, as the wrapper's Hook() does, are read
+        // from several threads without any of them parsing anything.
+        ini::Parser hooked(options_for(ini::SectionLoading::Lazy));
+        hooked.read_file(path);
+        hooked.section("SLPolicy");
+        hooked.section("SLInit");
+        const auto left = hooked.pending_section_count();
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; ++t) {
+            readers.emplace_back([&] {
+                for (int i = 0; i < 200; ++i) {
+                    (void)hooked.try_get_raw("SLPolicy", "TerminalServices-RemoteConnectionManager-AllowRemoteConnections");
+                    (void)hooked.find("SLInit", "bServerSku");
+                }
+            });
+        }
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        assert(hooked.pending_section_count() == left);
+    }
+
+    // Defaults, multi-line values and merged duplicate sections.
+    const std::string layout =
+        "top = 1\n"
+        "[a]\n"
+        "x = 1\n"
+        "multi = one\n"
+        "  two\n"
+        "\n"
+        "[DEFAULT]\n"
+        "d = 2\n"
+        "[b]\n"
+        "; comment\n"
+        "[a]\n"
+        "x = 3\n"
+        "y = 4";
+    {
+        ini::Parser p(options_for(ini::SectionLoading::Lazy));
+        bool threw = false;
+        try {
+            p.read_string(layout);
+        } catch (const ini::LocatedError& e) {
+            threw = e.code() == ini::ErrorCode::MissingSectionHeader;
+        }
+        assert(threw);
+    }
+    {
+        auto opt = options_for(ini::SectionLoading::Lazy);
+        opt.allow_unnamed_section = true;
+        ini::Parser lazy(opt);
+        lazy.read_string(layout);
+        opt.section_loading = ini::SectionLoading::Eager;
+        ini::Parser eager(opt);
+        eager.read_string(layout);
+
+        assert(lazy.pending_section_count() == 2);
+        assert(lazy.get_raw("b", "d") == "2");
+        assert(lazy.get_raw("a", "multi") == "one\ntwo");
+        assert(lazy.get_raw("a", "x") == "3");
+        assert(lazy.options("a") == eager.options("a"));
+        assert(lazy.write_to_string() == eager.write_to_string());
+    }
+
+    // An indented header can only be told apart from a continuation line by
+    // parsing what comes before it, so such input is read eagerly.
+    const std::string indented = "[a]\nk = v\n  [b]\n[c]\nx = 1\n";
+    {
+        ini::Parser p(options_for(ini::SectionLoading::Lazy));
+        p.read_string(indented);
+        assert(p.pending_section_count() == 0);
+        assert(!p.has_section("b"));
+        assert(p.get_raw("a", "k") == "v\n[b]");
+    }
+    assert(dump(ini::SectionLoading::Lazy, indented) == dump(ini::SectionLoading::Eager, indented));
+
+    // Syntax errors inside a section surface when the section is first used.
+    const std::string broken = "[a]\nk = v\nbroken line\n[b]\nk = w\n";
+    {
+        ini::Parser p(options_for(ini::SectionLoading::Lazy));
+        p.read_string(broken, "broken.ini");
+        assert(p.get_raw("b", "k") == "w");
+
+        bool threw = false;
+        try {
+            p.has_option("a", "k");
+        } catch (const ini::ParsingError& e) {
+            threw = e.source() == "broken.ini" && e.line() == 3 && e.entries().size() == 1;
+        }
+        assert(threw);
+        // The valid part is kept and the error is reported once.
+        assert(p.get_raw("a", "k") == "v");
+    }
+    {
+        ini::Parser p(options_for(ini::SectionLoading::Eager));
+        bool threw = false;
+        try {
+            p.read_string(broken);
+        } catch (const ini::ParsingError&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    // Duplicate sections are still caught while reading in strict mode.
+    {
+        ini::Parser p(options_for(ini::SectionLoading::Lazy, true));
+        bool threw = false;
+        try {
+            p.read_string("[a]\nx = 1\n[a]\ny = 2\n");
+        } catch (const ini::LocatedError& e) {
+            threw = e.code() == ini::ErrorCode::DuplicateSection && e.line() == 3;
+        }
+        assert(threw);
+    }
+
+    // Copies share the unparsed input; removing a section drops its spans.
+    {
+        ini::Parser p(options_for(ini::SectionLoading::Lazy));
+        p.read_string("[a]\nx = 1\n[b]\ny = 2\n");
+        ini::Parser copy(p);
+        assert(copy.pending_section_count() == 2);
+        assert(copy.get_raw("b", "y") == "2");
+        assert(p.pending_section_count() == 2);
+
+        assert(p.remove_section("a"));
+        assert(p.pending_section_count() == 1);
+        p.read_string("[b]\nz = 3\n");
+        assert(p.get_raw("b", "y") == "2");
+        assert(p.get_raw("b", "z") == "3");
+        assert(p.pending_section_count() == 0);
+
+        p.clear();
+        assert(p.sections().empty());
+    }
+
+    std::cout << "ini_configparser_lazy_test passed\n";
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "ini/mapped_file.hpp"
+#include "ini/parser.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string slurp(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+// `text` with every line ending replaced by `eol`.
+std::string with_line_endings(const std::string& text, const char* eol) {
+    std::string out;
+    for (const char c : text) {
+        if (c == '\n') {
+            out += eol;
+        } else if (c != '\r') {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string parse_with(ini::FileReadMode mode,
+                       const std::string& path,
+                       ini::SectionLoading loading = ini::SectionLoading::Eager) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.file_read_mode = mode;
+    opt.section_loading = loading;
+    ini::Parser p(opt);
+    p.read_file(path);
+    return p.write_to_string();
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    for (const char* name : {"rdpwrap.ini", "rdpwrap-arm-kb.ini"}) {
+        const auto path = corpus + "/" + name;
+
+        ini::MappedFile file(path);
+        assert(file.view() == slurp(path));
+
+        ini::MappedFile moved(std::move(file));
+        assert(file.view().empty());
+        assert(moved.size() == slurp(path).size());
+
+        assert(parse_with(ini::FileReadMode::Mapped, path) ==
+               parse_with(ini::FileReadMode::Buffered, path));
+    }
+
+    // The corpus is checked out with either line ending; both read the same
+    // way, eagerly or section by section.
+    const std::string lf_path = "ini_configparser_mapped_lf.ini";
+    const std::string crlf_path = "ini_configparser_mapped_crlf.ini";
+    const auto corpus_text = slurp(corpus + "/rdpwrap.ini");
+    std::ofstream(lf_path, std::ios::binary) << with_line_endings(corpus_text, "\n");
+    std::ofstream(crlf_path, std::ios::binary) << with_line_endings(corpus_text, "\r\n");
+    const auto expected = parse_with(ini::FileReadMode::Buffered, lf_path);
+    assert(expected.find('\r') == std::string::npos);
+    for (const auto mode : {ini::FileReadMode::Mapped, ini::FileReadMode::Buffered}) {
+        for (const auto loading : {ini::SectionLoading::Eager, ini::SectionLoading::Lazy}) {
+            assert(parse_with(mode, lf_path, loading) == expected);
+            assert(parse_with(mode, crlf_path, loading) == expected);
+        }
+    }
+    std::remove(lf_path.c_str());
+    std::remove(crlf_path.c_str());
+
+    const std::string empty_path = "ini_configparser_mapped_empty.ini";
+    std::ofstream(empty_path).close();
+    {
+        ini::MappedFile empty(empty_path);
+        assert(empty.view().empty());
+        ini::Parser p;
+        p.read_file(empty_path);
+        assert(p.sections().empty());
+    }
+    std::remove(empty_path.c_str());
+
+    bool threw = false;
+    try {
+        ini::MappedFile missing("does/not/exist.ini");
+    } catch (const ini::Error& e) {
+        threw = e.code() == ini::ErrorCode::Parsing;
+    }
+    assert(threw);
+
+    std::cout << "ini_configparser_mapped_file_test passed\n";
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include "ini/offset_table.hpp"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ini/decode.hpp"
+#include "ini/version_index.hpp"
+
+namespace {
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+constexpr ini::TargetArch kArchs[] = {ini::TargetArch::X86, ini::TargetArch::X64, ini::TargetArch::Arm,
+                                      ini::TargetArch::Arm64};
+
+// What the wrapper would read for one cell, through get_raw() and names
+// spelled out at run time.
+std::optional<std::uint64_t> expected_cell(const ini::Parser& p, std::uint64_t version, ini::TargetArch arch,
+                                          std::size_t column) {
+    std::string section = ini::format_version(version);
+    if (column >= std::size(ini::kWrapperOffsetKeys)) {
+        section += "-SLInit";
+    }
+    const std::string key = std::string(ini::OffsetTable::column_name(column)) + std::string(ini::arch_suffix(arch));
+    if (!p.has_section(section)) {
+        return std::nullopt;
+    }
+    const auto raw = p.try_get_raw(section, key);
+    std::uint64_t n = 0;
+    if (raw && ini::decode_hex(*raw, n)) {
+        return n;
+    }
+    return std::nullopt;
+}
+
+// Every cell, the row set and every query against plain loops.
+void check(const ini::Parser& p, const ini::OffsetTable& table) {
+    std::set<std::uint64_t> versions;
+    for (const auto& name : p.sections()) {
+        std::string_view build = name;
+        if (build.size() > 7 && build.substr(build.size() - 7) == "-SLInit") {
+            build.remove_suffix(7);
+        }
+        if (const auto v = ini::parse_version(build)) {
+            versions.insert(*v);
+        }
+    }
+    assert(table.versions() == std::vector<std::uint64_t>(versions.begin(), versions.end()));
+    assert(table.size() == versions.size());
+
+    for (const auto arch : kArchs) {
+        for (std::size_t c = 0; c < ini::OffsetTable::kColumnCount; ++c) {
+            const std::uint64_t* column = table.column(arch, c);
+            const std::uint8_t* set = table.present(arch, c);
+            std::vector<std::optional<std::uint64_t>> cells;
+            std::vector<std::size_t> changes;
+            std::size_t present = 0;
+            for (std::size_t row = 0; row < table.size(); ++row) {
+                cells.push_back(expected_cell(p, table.versions()[row], arch, c));
+                assert(table.at(row, arch, c) == cells[row]);
+                assert(set[row] == cells[row].has_value());
+                assert(column[row] == cells[row].value_or(0));
+                if (row > 0 && cells[row] != cells[row - 1]) {
+                    changes.push_back(row);
+                }
+                present += cells[row].has_value();
+            }
+            assert(table.changes(arch, c) == changes);
+            assert(table.count_present(arch, c) == present);
+            if (table.size() > 0) {
+                // Zero as well: absent cells hold it but must not match.
+                for (const std::uint64_t value : {column[table.size() / 2], std::uint64_t{0}}) {
+                    std::vector<std::size_t> rows;
+                    for (std::size_t row = 0; row < table.size(); ++row) {
+                        if (cells[row] == value) {
+                            rows.push_back(row);
+                        }
+                    }
+                    assert(table.rows_with(arch, c, value) == rows);
+                }
+            }
+        }
+    }
+
+    // Lookups by version, against a linear walk.
+    std::mt19937_64 rng(7);
+    std::vector<std::uint64_t> probes(table.versions());
+    for (const auto v : table.versions()) {
+        probes.push_back(v - 1);
+        probes.push_back(v + 1);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        probes.push_back(ini::pack_version(10, 0, static_cast<std::uint16_t>(rng() % 30000), static_cast<std::uint16_t>(rng())));
+    }
+    probes.push_back(0);
+    probes.push_back(~std::uint64_t{0});
+    const auto& keys = table.versions();
+    for (const auto v : probes) {
+        std::size_t exact = ini::OffsetTable::npos;
+        std::size_t floor = ini::OffsetTable::npos;
+        for (std::size_t row = 0; row < keys.size(); ++row) {
+            if (keys[row] == v) {
+                exact = row;
+            }
+            if (keys[row] <= v) {
+                floor = row;
+            }
+        }
+        assert(table.find(v) == exact);
+        assert(table.floor(v) == floor);
+        std::size_t nearest = ini::OffsetTable::npos;
+        for (std::size_t row = 0; row < keys.size(); ++row) {
+            const auto d = keys[row] > v ? keys[row] - v : v - keys[row];
+            if (nearest == ini::OffsetTable::npos) {
+                nearest = row;
+                continue;
+            }
+            const auto best = keys[nearest] > v ? keys[nearest] - v : v - keys[nearest];
+            if (d < best) {
+                nearest = row;
+            }
+        }
+        assert(table.nearest(v) == nearest);
+    }
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+
+    for (const char* name : {"/rdpwrap.ini", "/rdpwrap-arm-kb.ini"}) {
+        ini::Parser p(wrapper_options());
+        p.read_string(read_all(corpus + name));
+        const ini::OffsetTable table(p);
+        assert(!table.empty());
+        check(p, table);
+    }
+
+    // The shipped table: x64 DefPolicyOffset is set for nearly every build
+    // and moves with most of them.
+    {
+        ini::Parser p(wrapper_options());
+        p.read_string(read_all(corpus + "/rdpwrap.ini"));
+        const ini::OffsetTable table(p);
+        const auto column = ini::OffsetTable::find_column("DefPolicyOffset");
+        assert(column != ini::OffsetTable::npos);
+        assert(table.count_present(ini::TargetArch::X64, column) > table.size() / 2);
+        assert(!table.changes(ini::TargetArch::X64, column).empty());
+        const auto row = table.find(ini::pack_version(10, 0, 19041, 1));
+        assert(row != ini::OffsetTable::npos);
+        assert(table.nearest(ini::pack_version(10, 0, 19041, 1)) == row);
+    }
+
+    // Column names.
+    assert(ini::OffsetTable::find_column("localonlyoffset") == 0);
+    assert(ini::OffsetTable::column_name(ini::OffsetTable::find_column("BSERVERSKU")) == "bServerSku");
+    assert(ini::OffsetTable::find_column("LocalOnlyPatch") == ini::OffsetTable::npos);
+    assert(ini::OffsetTable::column_name(ini::OffsetTable::kColumnCount).empty());
+
+    // [DEFAULT] fallback, builds with only one of their sections, values
+    // that are not hex, and section names that are not builds.
+    {
+        ini::Parser p(wrapper_options());
+        p.read_string(
+            "[DEFAULT]\nSLPolicyOffset.x64 = 10\n"
+            "[Main]\nLocalOnlyOffset.x64 = 1\n"
+            "[6.1.7601.24000]\nLocalOnlyOffset.x64 = 2A\nDefPolicyOffset.x64 = nope\nLocalOnlyOffset.arm64 = ff\n"
+            "[10.0.1.1-SLInit]\nbServerSku.x64 = 0x40\n"
+            "[10.0.01.1]\nLocalOnlyOffset.x64 = 3\n"
+            "[6.1.7601.24000-SLInit]\nbInitialized.x86 = 7\n");
+        const ini::OffsetTable table(p);
+        check(p, table);
+        assert(table.size() == 2);
+        const auto win7 = table.find(ini::pack_version(6, 1, 7601, 24000));
+        const auto win10 = table.find(ini::pack_version(10, 0, 1, 1));
+        assert(win7 == 0 && win10 == 1);
+        assert(table.at(win7, ini::TargetArch::X64, 0) == 0x2A);
+        assert(table.at(win7, ini::TargetArch::Arm64, 0) == 0xFF);
+        assert(!table.at(win7, ini::TargetArch::X64, ini::OffsetTable::find_column("DefPolicyOffset")));
+        assert(table.at(win7, ini::TargetArch::X64, ini::OffsetTable::find_column("SLPolicyOffset")) == 0x10);
+        assert(!table.at(win10, ini::TargetArch::X64, 0));
+        assert(table.at(win10, ini::TargetArch::X64, ini::OffsetTable::find_column("bServerSku")) == 0x40);
+        // [DEFAULT] reaches the -SLInit section as well, but holds no
+        // SLInit column here.
+        assert(!table.at(win10, ini::TargetArch::X64, ini::OffsetTable::find_column("SLPolicyOffset")));
+        assert(table.changes(ini::TargetArch::X64, 0) == std::vector<std::size_t>{1});
+    }
+
+    // All-ones and zero are offsets like any other, not absence.
+    {
+        ini::Parser p(wrapper_options());
+        p.read_string(
+            "[6.1.7601.1]\nLocalOnlyOffset.x64 = FFFFFFFFFFFFFFFF\n"
+            "[6.1.7601.2]\nLocalOnlyOffset.x64 = 0\n"
+            "[6.1.7601.3]\nSingleUserOffset.x64 = 0\n"
+            "[6.1.7601.4]\nLocalOnlyOffset.x64 = FFFFFFFFFFFFFFFF\n");
+        const ini::OffsetTable table(p);
+        check(p, table);
+        const auto local = ini::OffsetTable::find_column("LocalOnlyOffset");
+        assert(table.at(0, ini::TargetArch::X64, local) == ~std::uint64_t{0});
+        assert(table.at(1, ini::TargetArch::X64, local) == std::uint64_t{0});
+        assert(!table.at(2, ini::TargetArch::X64, local));
+        assert(table.count_present(ini::TargetArch::X64, local) == 3);
+        assert(table.changes(ini::TargetArch::X64, local) == (std::vector<std::size_t>{1, 2, 3}));
+        assert(table.rows_with(ini::TargetArch::X64, local, ~std::uint64_t{0}) == (std::vector<std::size_t>{0, 3}));
+        assert(table.rows_with(ini::TargetArch::X64, local, 0) == std::vector<std::size_t>{1});
+    }
+
+    // More rows than one 64-row block, with changes on both sides of it.
+    {
+        std::string text;
+        for (int i = 0; i < 200; ++i) {
+            text += "[10.0.19041." + std::to_string(i) + "]\nDefPolicyOffset.x64 = " + std::to_string(i / 3) + "\n";
+        }
+        ini::Parser p(wrapper_options());
+        p.read_string(text);
+        const ini::OffsetTable table(p);
+        check(p, table);
+        const auto column = ini::OffsetTable::find_column("DefPolicyOffset");
+        assert(table.changes(ini::TargetArch::X64, column).size() == 66);
+        assert(table.rows_with(ini::TargetArch::X64, column, 0x10).size() == 3);
+    }
+
+    // Empty.
+    {
+        const ini::OffsetTable empty;
+        assert(empty.empty());
+        assert(empty.find(1) == ini::OffsetTable::npos);
+        assert(empty.floor(1) == ini::OffsetTable::npos);
+        assert(empty.nearest(1) == ini::OffsetTable::npos);
+        assert(empty.changes(ini::TargetArch::X64, 0).empty());
+        assert(empty.rows_with(ini::TargetArch::X64, 0, 0).empty());
+        assert(empty.count_present(ini::TargetArch::X64, 0) == 0);
+    }
+
+    std::cout << "offset_table_test passed\n";
+    return 0;
+}
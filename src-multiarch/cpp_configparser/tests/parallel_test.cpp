@@ -0,0 +1,172 @@
+#include "ini/parser.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// `text` with every section name prefixed, so that copies do not collide.
+std::string renamed(const std::string& text, const std::string& prefix) {
+    std::string out;
+    out.reserve(text.size() + 4096);
+    std::size_t line = 0;
+    while (line < text.size()) {
+        auto end = text.find('\n', line);
+        end = end == std::string::npos ? text.size() : end + 1;
+        if (text[line] == '[') {
+            out += "[" + prefix;
+            out.append(text, line + 1, end - line - 1);
+        } else {
+            out.append(text, line, end - line);
+        }
+        line = end;
+    }
+    return out;
+}
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+// Everything a read leaves behind: the stored sections, or the error.
+std::string outcome(const std::string& text, const ini::ParseOptions& opt, const std::string& before = {}) {
+    ini::Parser p(opt);
+    try {
+        if (!before.empty()) {
+            p.read_string(before, "before");
+        }
+        p.read_string(text, "corpus");
+    } catch (const ini::ParsingError& e) {
+        std::string out = std::string("parsing error: ") + e.what() + " at " + std::to_string(e.line());
+        for (const auto& entry : e.entries()) {
+            out += "\n" + std::to_string(entry.line) + ": " + entry.text;
+        }
+        return out;
+    } catch (const ini::LocatedError& e) {
+        return "error " + std::to_string(static_cast<int>(e.code())) + ": " + e.what() + " at " + e.source() + ":" +
+               std::to_string(e.line());
+    } catch (const ini::Error& e) {
+        return "error " + std::to_string(static_cast<int>(e.code())) + ": " + e.what();
+    }
+    std::string out = p.write_to_string();
+    for (const auto& section : p.sections()) {
+        out += section + "\n";
+    }
+    return out;
+}
+
+// Returns the sequential outcome after checking every thread count agrees.
+std::string check(const std::string& text, ini::ParseOptions opt, const std::string& before = {}) {
+    opt.parse_threads = 1;
+    const auto sequential = outcome(text, opt, before);
+    for (const unsigned threads : {2u, 3u, 8u}) {
+        opt.parse_threads = threads;
+        assert(outcome(text, opt, before) == sequential);
+    }
+    return sequential;
+}
+
+bool starts_with(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    const auto rdpwrap = read_all(corpus + "/rdpwrap.ini");
+    const auto arm = read_all(corpus + "/rdpwrap-arm-kb.ini");
+    assert(rdpwrap.size() > 256 * 1024);
+
+    // Large merged tables, in both storage modes and with inline comments.
+    std::string merged;
+    for (int i = 0; i < 4; ++i) {
+        merged += renamed(i % 2 == 0 ? rdpwrap : arm, "copy" + std::to_string(i) + ".");
+    }
+    {
+        auto opt = wrapper_options();
+        assert(!starts_with(check(merged, opt), "error"));
+        opt.storage = ini::StorageMode::Arena;
+        check(merged, opt);
+        opt.storage = ini::StorageMode::Heap;
+        opt.inline_comment_prefixes = {";"};
+        opt.allow_no_value = true;
+        check(merged, opt);
+    }
+
+    // The same sections several times over: merged when not strict, the
+    // first repeated header is the error when strict.
+    const std::string repeated = rdpwrap + "\n" + rdpwrap + "\n" + rdpwrap;
+    {
+        auto opt = wrapper_options();
+        assert(!starts_with(check(repeated, opt), "error"));
+        opt.strict = true;
+        assert(starts_with(check(repeated, opt), "error"));
+        assert(starts_with(check(merged, opt, "[copy3.Main]\n"), "error"));
+    }
+
+    // Values spanning several lines up to the next header, with trailing
+    // blank lines; a default section given twice; a section already present.
+    std::string layout = "top = 1\n";
+    for (int i = 0; i < 12000; ++i) {
+        const auto n = std::to_string(i);
+        layout += "[s" + n + "]\nkey = " + n + "\nmulti = a\n  b" + n + "\n\n  c\n\n\n";
+        if (i == 4000 || i == 9000) {
+            layout += "[DEFAULT]\nd" + n + " = " + n + "\nshared = " + n + "\n";
+        }
+        if (i % 3000 == 2999) {
+            layout += "[s" + std::to_string(i / 2) + "]\nkey = again\nextra = " + n + "\n";
+        }
+    }
+    {
+        auto opt = wrapper_options();
+        const auto missing = check(layout, opt);
+        assert(starts_with(missing, "error") && missing.find("corpus:1") != std::string::npos);
+        opt.allow_unnamed_section = true;
+        assert(!starts_with(check(layout, opt), "error"));
+        assert(!starts_with(check(layout, opt, "[s100]\nkept = 1\n[DEFAULT]\nd = 0\n"), "error"));
+        opt.strict = true;
+        assert(starts_with(check(layout, opt), "error"));
+    }
+
+    // Errors from several pieces combine exactly as in one read; a located
+    // error deep in the input wins over the syntax errors after it.
+    std::string broken = merged;
+    for (const std::size_t at : {std::size_t{1000}, broken.size() / 3, broken.size() / 2, broken.size() - 100}) {
+        const auto line = broken.find('\n', at);
+        broken.insert(line + 1, "no delimiter here\n");
+    }
+    {
+        auto opt = wrapper_options();
+        const auto combined = check(broken, opt);
+        assert(starts_with(combined, "parsing error") && std::count(combined.begin(), combined.end(), '\n') == 4);
+        opt.strict = true;
+        std::string duplicate = broken;
+        const auto header = duplicate.find("\n[", duplicate.size() * 2 / 3);
+        duplicate.insert(header + 1, "[dup]\nx = 1\nX = 2\n");
+        assert(starts_with(check(duplicate, opt), "error"));
+    }
+
+    // An indented header only a sequential read can place.
+    {
+        auto opt = wrapper_options();
+        check(merged + "[tail]\nkey = a\n  [not a section]\n", opt);
+    }
+
+    std::cout << "parallel_test passed\n";
+    return 0;
+}
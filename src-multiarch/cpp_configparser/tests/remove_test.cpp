@@ -0,0 +1,189 @@
+#include "ini/key_index.hpp"
+#include "ini/parser.hpp"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string slurp(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+ini::ParseOptions options_for(ini::StorageMode mode) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.storage = mode;
+    return opt;
+}
+
+bool is_build(const std::string& section) {
+    return !section.empty() && section[0] >= '0' && section[0] <= '9';
+}
+
+// Inserts and erases random keys, many sharing a home slot, and checks every
+// key against a std::map after each step.
+void index_erase() {
+    std::vector<std::string> keys;
+    for (int i = 0; i < 300; ++i) {
+        keys.push_back("k" + std::to_string(i));
+    }
+    ini::SectionIndex index;
+    std::map<std::size_t, bool> present;
+    auto key_at = [&](std::size_t pos) { return std::string_view(keys[pos]); };
+    std::mt19937 rng(7);
+    for (int step = 0; step < 20000; ++step) {
+        const std::size_t pos = rng() % keys.size();
+        if (present[pos]) {
+            index.erase(ini::SectionIndex::hash(keys[pos]), pos);
+            present[pos] = false;
+        } else {
+            index.insert(keys[pos], pos);
+            present[pos] = true;
+        }
+        if (step % 97 == 0) {
+            std::size_t live = 0;
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                assert(index.find(keys[i], key_at) == (present[i] ? i : ini::SectionIndex::npos));
+                live += present[i] ? 1 : 0;
+            }
+            assert(index.size() == live);
+        }
+    }
+    // Erasing what is not there changes nothing.
+    const auto size = index.size();
+    index.erase(ini::SectionIndex::hash("missing"), 12345);
+    assert(index.size() == size);
+}
+
+}  // namespace
+
+int main() {
+    index_erase();
+
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    const std::string text = slurp(corpus + "/rdpwrap.ini");
+
+    // Pruning every other build leaves the rest in file order, in every
+    // storage mode, exactly as if they had never been read.
+    for (const auto mode : {ini::StorageMode::Heap, ini::StorageMode::Arena, ini::StorageMode::Interned}) {
+        ini::Parser p(options_for(mode));
+        p.read_string(text);
+        const auto all = p.sections();
+        std::vector<std::string> kept;
+        bool drop = false;
+        for (const auto& section : all) {
+            if (is_build(section) && (drop = !drop)) {
+                const bool removed = p.remove_section(section);
+                const bool again = p.remove_section(section);
+                assert(removed && !again);
+                assert(!p.has_section(section));
+            } else {
+                kept.push_back(section);
+            }
+        }
+        assert(p.sections() == kept);
+
+        // The same sections copied over one by one.
+        ini::Parser full(options_for(mode));
+        full.read_string(text);
+        ini::Parser expected(options_for(mode));
+        for (const auto& section : kept) {
+            expected.add_section(section);
+            for (const auto& [key, value] : full.section(section).items()) {
+                expected.set(section, key, value);
+            }
+        }
+        assert(p.write_to_string() == expected.write_to_string());
+        assert(p.diff(expected).empty());
+        assert(ini::Parser(p).write_to_string() == p.write_to_string());
+
+        // Against the full file, the removed builds are gone and nothing
+        // else changed.
+        const auto d = full.diff(p);
+        assert(d.sections.size() == all.size() - kept.size());
+        for (const auto& change : d.sections) {
+            assert(change.kind == ini::ChangeKind::Removed);
+            assert(is_build(change.section) && !p.has_section(change.section));
+        }
+
+        // A removed name can come back, at the end and without its options.
+        const auto& back = d.sections.front().section;
+        p.add_section(back);
+        p.set(back, "again", std::string("1"));
+        assert(p.sections().back() == back);
+        assert(p.get_raw(back, "again") == std::string("1"));
+        assert(!p.has_option(back, "LocalOnlyPatch.x64"));
+    }
+
+    // Removing everything and adding as many again reuses the slots; every
+    // name keeps resolving throughout.
+    {
+        ini::Parser p(options_for(ini::StorageMode::Heap));
+        for (int round = 0; round < 5; ++round) {
+            for (int i = 0; i < 100; ++i) {
+                p.add_section("r" + std::to_string(round) + "s" + std::to_string(i));
+                p.set("r" + std::to_string(round) + "s" + std::to_string(i), "k", std::to_string(i));
+            }
+            for (int i = 0; i < 100; i += round == 4 ? 2 : 1) {
+                const bool removed = p.remove_section("r" + std::to_string(round) + "s" + std::to_string(i));
+                assert(removed);
+            }
+        }
+        const auto left = p.sections();
+        assert(left.size() == 50 && left.front() == "r4s1" && left.back() == "r4s99");
+        for (int i = 1; i < 100; i += 2) {
+            assert(p.get_raw("r4s" + std::to_string(i), "k") == std::to_string(i));
+        }
+        assert(!p.has_section("r0s0") && !p.has_section("r4s0"));
+    }
+
+    // Sections still waiting to be parsed can be removed too.
+    {
+        auto opt = options_for(ini::StorageMode::Heap);
+        opt.section_loading = ini::SectionLoading::Lazy;
+        ini::Parser p(opt);
+        p.read_string(text);
+        const auto pending = p.pending_section_count();
+        const bool removed = p.remove_section("10.0.19041.1");
+        assert(removed && p.pending_section_count() == pending - 1);
+        const bool loaded = p.has_option("10.0.19041.84", "LocalOnlyPatch.x64");
+        assert(loaded && p.pending_section_count() == pending - 2);
+        const bool removed_loaded = p.remove_section("10.0.19041.84");
+        assert(removed_loaded && p.pending_section_count() == pending - 2);
+        p.write_to_string();
+        assert(p.pending_section_count() == 0);
+    }
+
+    // A view of a section outlives any number of additions and the
+    // compactions they trigger, until that section itself is removed.
+    for (const auto mode : {ini::StorageMode::Heap, ini::StorageMode::Arena}) {
+        ini::Parser p(options_for(mode));
+        p.read_string(text);
+        const auto view = p.section("SLPolicy");
+        const auto expected = view.items();
+        for (int round = 0; round < 8; ++round) {
+            for (int i = 0; i < 200; ++i) {
+                p.add_section("extra" + std::to_string(round) + "." + std::to_string(i));
+            }
+            for (int i = 0; i < 200; ++i) {
+                p.remove_section("extra" + std::to_string(round) + "." + std::to_string(i));
+            }
+            assert(view.has_option("TerminalServices-RemoteConnectionManager-AllowRemoteConnections"));
+            assert(view.items() == expected);
+        }
+    }
+
+    std::cout << "remove_test passed\n";
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "ini/parser.hpp"
+#include "ini/scan.hpp"
+#include "ini/tokenizer.hpp"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+ini::ParseOptions with_scanning(ini::ParseOptions opt, ini::LineScanning scanning) {
+    opt.line_scanning = scanning;
+    return opt;
+}
+
+bool same_view(std::string_view a, std::string_view b) {
+    return a.data() == b.data() && a.size() == b.size();
+}
+
+// Tokens must agree field by field, down to where each view points.
+void check_tokens(const std::string& text, const ini::ParseOptions& opt) {
+    // The tokenizer keeps views of the option strings.
+    const auto vector_opt = with_scanning(opt, ini::LineScanning::Vector);
+    const auto scalar_opt = with_scanning(opt, ini::LineScanning::Scalar);
+    ini::Tokenizer vector(text, vector_opt);
+    ini::Tokenizer scalar(text, scalar_opt);
+    ini::Token v;
+    ini::Token s;
+    for (;;) {
+        const bool more = scalar.next(s);
+        assert(vector.next(v) == more);
+        if (!more) {
+            break;
+        }
+        assert(v.kind == s.kind && v.line_no == s.line_no);
+        assert(v.indented == s.indented && v.has_delimiter == s.has_delimiter);
+        assert(same_view(v.raw, s.raw) && same_view(v.cleaned, s.cleaned));
+        assert(same_view(v.name, s.name) && same_view(v.key, s.key) && same_view(v.value, s.value));
+    }
+}
+
+std::string dump(const std::string& text, const ini::ParseOptions& opt) {
+    ini::Parser p(opt);
+    std::string out;
+    try {
+        p.read_string(text, "corpus");
+    } catch (const ini::Error& e) {
+        out += std::string("error: ") + e.what() + "\n";
+    }
+    for (const auto& section : p.sections()) {
+        out += "[" + section + "]\n";
+        for (const auto& [key, value] : p.items(section, true)) {
+            out += key + (value ? " = " + *value : "") + "\n";
+        }
+    }
+    return out;
+}
+
+void check_parse(const std::string& text, const ini::ParseOptions& opt) {
+    check_tokens(text, opt);
+    assert(dump(text, with_scanning(opt, ini::LineScanning::Vector)) ==
+           dump(text, with_scanning(opt, ini::LineScanning::Scalar)));
+}
+
+std::vector<ini::ParseOptions> option_sets() {
+    std::vector<ini::ParseOptions> sets;
+    ini::ParseOptions wrapper;
+    wrapper.interpolation = ini::InterpolationMode::None;
+    wrapper.strict = false;
+    sets.push_back(wrapper);
+
+    ini::ParseOptions inline_comments = wrapper;
+    inline_comments.inline_comment_prefixes = {";", "#", "//"};
+    inline_comments.allow_no_value = true;
+    sets.push_back(inline_comments);
+
+    // Overlapping multi-byte delimiters, one of them listed after its prefix.
+    ini::ParseOptions delimiters = wrapper;
+    delimiters.delimiters = {"=", ":=", ":", " -> "};
+    delimiters.inline_comment_prefixes = {"; #", "#"};
+    sets.push_back(delimiters);
+
+    // More distinct first bytes than the vector path takes at once.
+    ini::ParseOptions many = wrapper;
+    many.delimiters = {"=", ":", "~", "!", "%", "^", "&", "*"};
+    many.inline_comment_prefixes = {";", "#", "@"};
+    sets.push_back(many);
+    return sets;
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "vector scan: " << ini::vector_scan_isa() << "\n";
+
+    // The scanner itself, over lines of every length and at every offset
+    // from the 64-byte blocks.
+    std::mt19937 rng(10);
+    const std::string alphabet = "ab =:;#\t\r\n[]";
+    std::string buffer;
+    for (int n = 0; n < 20000; ++n) {
+        ini::ByteSet delimiters;
+        ini::ByteSet comments;
+        for (auto* set : {&delimiters, &comments}) {
+            const auto count = rng() % 6;  // sometimes empty, sometimes too many together
+            for (std::size_t i = 0; i < count; ++i) {
+                const char c = alphabet[rng() % alphabet.size()];
+                if (c != '\n') {
+                    set->add(c);
+                }
+            }
+        }
+        buffer.clear();
+        const auto len = rng() % 300;
+        const auto density = 1 + rng() % 40;  // mostly plain text, sometimes dense
+        for (std::size_t i = 0; i < len; ++i) {
+            buffer.push_back(rng() % density == 0 ? alphabet[rng() % alphabet.size()] : 'x');
+        }
+        const std::string_view text(buffer);
+        ini::LineScanner vector(text, delimiters, comments, ini::LineScanning::Vector);
+        ini::LineScanner scalar(text, delimiters, comments, ini::LineScanning::Scalar);
+        const auto same = [](const ini::LineScan& a, const ini::LineScan& b) {
+            return a.length == b.length && a.first_delimiter == b.first_delimiter && a.first_comment == b.first_comment;
+        };
+        for (std::size_t pos = 0; pos < text.size();) {
+            const auto s = scalar.scan(pos);
+            assert(same(vector.scan(pos), s));
+            pos += s.length + 1;
+        }
+        if (!text.empty()) {
+            const auto from = rng() % text.size();
+            assert(same(vector.scan(from), scalar.scan(from)));  // out of order
+            assert(ini::find_first_of(text, from, delimiters, ini::LineScanning::Vector) ==
+                   ini::find_first_of(text, from, delimiters, ini::LineScanning::Scalar));
+        }
+    }
+
+    // Shipped configurations, byte-identical through the whole parser.
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    const auto sets = option_sets();
+    for (const char* name : {"rdpwrap.ini", "rdpwrap-arm-kb.ini", "rdpwrap-ini-kb.txt"}) {
+        const std::string text = read_all(corpus + "/" + name);
+        assert(!text.empty());
+        for (const auto& opt : sets) {
+            check_parse(text, opt);
+        }
+    }
+
+    // Random line soup that exercises comments, indentation and delimiters
+    // at line ends and block boundaries.
+    const char* const pieces[] = {
+        "[Main]", "[a.b]", " [indented]", "key", "key2 ", "=", ":", ":=", " -> ", ";", "#", "//",
+        "; #", " ", "\t", "\r", "value", "0x1F", "B8 00 01", "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx",
+    };
+    for (int n = 0; n < 2000; ++n) {
+        std::string text;
+        const auto lines = rng() % 30;
+        for (std::size_t l = 0; l < lines; ++l) {
+            const auto parts = rng() % 8;
+            for (std::size_t i = 0; i < parts; ++i) {
+                text += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+            }
+            if (l + 1 < lines || rng() % 2 == 0) {
+                text += "\n";
+            }
+        }
+        for (const auto& opt : sets) {
+            check_parse(text, opt);
+        }
+    }
+
+    std::cout << "scan_test passed\n";
+    return 0;
+}
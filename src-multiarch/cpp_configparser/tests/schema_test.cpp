@@ -0,0 +1,217 @@
+#include "ini/schema.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+ini::ParseOptions wrapper_options(ini::SectionLoading loading = ini::SectionLoading::Eager) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+    opt.section_loading = loading;
+    return opt;
+}
+
+// The wrapper's helpers, as they were written against get_raw.
+bool strtol_flag(const std::string& v) {
+    return std::strtol(v.c_str(), nullptr, 10) != 0;
+}
+
+bool strtoull_hex(const std::string& v, std::uint64_t& out) {
+    errno = 0;
+    char* end = nullptr;
+    const unsigned long long n = std::strtoull(v.c_str(), &end, 16);
+    if (errno == ERANGE || end == nullptr || *end != '\0') {
+        return false;
+    }
+    out = n;
+    return true;
+}
+
+bool reference_bytes(const std::string& raw, ini::ByteArray& out) {
+    std::string hex;
+    for (const char c : raw) {
+        if (c == ' ' || c == '\t' || c == ',' || c == '-') {
+            continue;
+        }
+        hex.push_back(c);
+    }
+    if (hex.size() % 2 != 0 || hex.size() > 2 * 255) {
+        return false;
+    }
+    ini::ByteArray tmp;
+    for (std::size_t i = 0; i < hex.size(); i += 2) {
+        const auto pair = hex.substr(i, 2);
+        if (pair.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+            return false;
+        }
+        tmp.data[i / 2] = static_cast<std::uint8_t>(std::stoul(pair, nullptr, 16));
+    }
+    tmp.size = static_cast<std::uint8_t>(hex.size() / 2);
+    out = tmp;
+    return true;
+}
+
+bool same(const ini::ByteArray& a, const ini::ByteArray& b) {
+    if (a.size != b.size) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size; ++i) {
+        if (a.data[i] != b.data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Patch {
+    bool enabled = false;
+    std::uint64_t offset = 0;
+    std::string_view code;
+    ini::ByteArray code_bytes;
+};
+
+}  // namespace
+
+int main() {
+    // Decoders against the C library on short strings over an alphabet that
+    // hits signs, prefixes, blanks, separators and overflow.
+    std::mt19937 rng(11);
+    const std::string alphabet = "0123456789abcdefABCDEFxX+- \t,g\n";
+    for (int n = 0; n < 200000; ++n) {
+        std::string s;
+        const auto len = rng() % (n % 100 == 0 ? 40 : 12);
+        for (std::size_t i = 0; i < len; ++i) {
+            s.push_back(alphabet[rng() % alphabet.size()]);
+        }
+
+        bool flag = false;
+        assert(ini::decode_flag(s, flag) && flag == strtol_flag(s));
+
+        // The wrapper never parses an empty value, which strtoull accepts.
+        std::uint64_t want = 7;
+        std::uint64_t got = 7;
+        const bool ok = !s.empty() && strtoull_hex(s, want);
+        assert(ini::decode_hex(s, got) == ok);
+        assert(got == want);
+
+        ini::ByteArray ref;
+        ini::ByteArray dec;
+        assert(ini::decode_bytes(s, dec) == reference_bytes(s, ref));
+        assert(same(dec, ref));
+    }
+    std::uint64_t v = 0;
+    assert(ini::decode_hex("FFFFFFFFFFFFFFFF", v) && v == ~std::uint64_t{0});
+    assert(!ini::decode_hex("10000000000000000", v));
+    assert(ini::decode_hex("0x1F", v) && v == 0x1F);
+    ini::ByteArray b;
+    assert(ini::decode_bytes(std::string(510, 'a'), b) && b.size == 255);
+    assert(!ini::decode_bytes(std::string(512, 'a'), b));
+
+    // Resolution: defaults survive missing, empty and malformed values.
+    const std::string text =
+        "[DEFAULT]\n"
+        "inherited = 1\n"
+        "[10.0.1.1]\n"
+        "LocalOnlyPatch.x64 = 1\n"
+        "LocalOnlyOffset.x64 = 0x1F\n"
+        "LocalOnlyCode.x64 = B8 00-01,02\n"
+        "bad = zz\n"
+        "empty =\n"
+        "novalue\n";
+    ini::ParseOptions opt = wrapper_options();
+    opt.allow_no_value = true;
+    ini::Parser p(opt);
+    p.read_string(text);
+
+    static const auto schema = ini::Schema<Patch>()
+        .flag("LocalOnlyPatch.x64", &Patch::enabled)
+        .hex("LocalOnlyOffset.x64", &Patch::offset)
+        .text("LocalOnlyCode.x64", &Patch::code)
+        .bytes("LocalOnlyCode.x64", &Patch::code_bytes);
+    assert(schema.size() == 4);
+    Patch patch;
+    assert(schema.resolve(p, "10.0.1.1", patch) == 0xF);
+    assert(patch.enabled && patch.offset == 0x1F && patch.code == "B8 00-01,02");
+    assert(patch.code_bytes.size == 4 && patch.code_bytes.data[0] == 0xB8 && patch.code_bytes.data[3] == 0x02);
+
+    struct Other {
+        std::uint64_t bad = 5;
+        std::uint64_t empty = 6;
+        std::string_view novalue = "default";
+        bool inherited = false;
+        bool missing = true;
+    };
+    static const auto other = ini::Schema<Other>()
+        .hex("BAD", &Other::bad)
+        .hex("empty", &Other::empty)
+        .text("novalue", &Other::novalue)
+        .flag("inherited", &Other::inherited)
+        .flag("missing", &Other::missing);
+    Other o;
+    assert(other.resolve(p, "10.0.1.1", o) == 0x8);
+    assert(o.bad == 5 && o.empty == 6 && o.novalue == "default" && o.inherited && o.missing);
+    Other none;
+    assert(other.resolve(p, "9.9.9.9", none) == 0 && !none.inherited);
+
+    // A deferred parse error reads as a missing section instead of throwing.
+    {
+        ini::Parser lazy(wrapper_options(ini::SectionLoading::Lazy));
+        lazy.read_string("[a]\nLocalOnlyPatch.x64 = 1\nbroken line\n[b]\nLocalOnlyPatch.x64 = 1\n");
+        Patch pa;
+        assert(schema.resolve(lazy, "a", pa) == 0 && !pa.enabled);
+        assert(schema.resolve(lazy, "b", pa) == 0x1 && pa.enabled);
+    }
+
+    // Every build of the shipped configuration resolves like the per-key reads.
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    for (const char* name : {"rdpwrap.ini", "rdpwrap-arm-kb.ini"}) {
+        ini::Parser ini_file(wrapper_options(ini::SectionLoading::Lazy));
+        ini_file.read_file(corpus + "/" + name);
+        for (const char* arch : {".x86", ".x64", ".arm", ".arm64"}) {
+            for (const char* prefix : {"LocalOnly", "SingleUser", "DefPolicy"}) {
+                const std::string base = prefix;
+                const auto s = ini::Schema<Patch>()
+                    .flag(base + "Patch" + arch, &Patch::enabled)
+                    .hex(base + "Offset" + arch, &Patch::offset)
+                    .text(base + "Code" + arch, &Patch::code)
+                    .bytes(base + "Code" + arch, &Patch::code_bytes);
+                for (const auto& section : ini_file.sections()) {
+                    Patch got;
+                    s.resolve(ini_file, section, got);
+
+                    auto raw = [&](const std::string& key) -> std::string {
+                        if (!ini_file.has_option(section, key)) {
+                            return "";
+                        }
+                        return ini_file.get_raw(section, key).value_or("");
+                    };
+                    const auto enabled = raw(base + "Patch" + arch);
+                    assert(got.enabled == (!enabled.empty() && strtol_flag(enabled)));
+                    std::uint64_t offset = 0;
+                    const auto offset_raw = raw(base + "Offset" + arch);
+                    if (!offset_raw.empty()) {
+                        strtoull_hex(offset_raw, offset);
+                    }
+                    assert(got.offset == offset);
+                    const auto code = raw(base + "Code" + arch);
+                    assert(got.code == code);
+                    ini::ByteArray bytes;
+                    if (!code.empty()) {
+                        reference_bytes(code, bytes);
+                    }
+                    assert(same(got.code_bytes, bytes));
+                }
+            }
+        }
+    }
+
+    std::cout << "ini_configparser_schema_test passed\n";
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "ini/schema.hpp"
+#include "ini/wrapper_keys.hpp"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using ini::TargetArch;
+
+static_assert(ini::arch_key<TargetArch::X64>("LocalOnlyPatch").name == "localonlypatch.x64");
+static_assert(ini::arch_key<TargetArch::X64>("LocalOnlyPatch").hash == ini::OptionIndex::hash("LocalOnlyPatch.x64"));
+static_assert(ini::arch_key<TargetArch::Arm64>("bServerSku").name == "bserversku.arm64");
+static_assert(ini::arch_key<TargetArch::X86>("SLInitHook").name == "slinithook.x86");
+static_assert(ini::arch_key<TargetArch::Arm>("DefPolicyCode").name == "defpolicycode.arm");
+static_assert(ini::wrapper_key("SLPolicyHookNT61").name == "slpolicyhooknt61");
+static_assert(ini::wrapper_key("ulMaxDebugSessions").hash == ini::OptionIndex::hash("ULMAXDEBUGSESSIONS"));
+
+std::string slurp(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    return oss.str();
+}
+
+ini::ParseOptions wrapper_options(ini::SectionLoading loading) {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+    opt.section_loading = loading;
+    return opt;
+}
+
+struct Named {
+    std::string name;
+    ini::StaticKey key;
+};
+
+template <TargetArch Arch>
+void arch_keys(std::vector<Named>& out) {
+    const std::string suffix(ini::arch_suffix(Arch));
+    auto add = [&](const auto& names) {
+        for (const char* name : names) {
+            out.push_back({name + suffix, ini::arch_key<Arch>(name)});
+        }
+    };
+    add(ini::kWrapperFlagKeys);
+    add(ini::kWrapperOffsetKeys);
+    add(ini::kWrapperCodeKeys);
+    add(ini::kWrapperSLInitKeys);
+}
+
+// Every key of every table, next to the name it stands for.
+std::vector<Named> all_keys() {
+    std::vector<Named> out;
+    for (const char* name : ini::kWrapperMainKeys) {
+        out.push_back({name, ini::wrapper_key(name)});
+    }
+    for (const char* name : ini::kWrapperSLInitKeys) {
+        out.push_back({name, ini::wrapper_key(name)});
+    }
+    arch_keys<TargetArch::X86>(out);
+    arch_keys<TargetArch::X64>(out);
+    arch_keys<TargetArch::Arm>(out);
+    arch_keys<TargetArch::Arm64>(out);
+    return out;
+}
+
+struct Patch {
+    bool enabled = false;
+    std::uint64_t offset = 0;
+    std::string_view code;
+    ini::ByteArray code_bytes;
+};
+
+}  // namespace
+
+int main() {
+    const auto keys = all_keys();
+    assert(keys.size() == 2 + 8 + 4 * 21);
+
+    // Static keys find exactly what their names find, in every section of
+    // both shipped files, including through [DEFAULT].
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    for (const char* file : {"/rdpwrap.ini", "/rdpwrap-arm-kb.ini"}) {
+        for (const auto loading : {ini::SectionLoading::Eager, ini::SectionLoading::Lazy}) {
+            ini::Parser p(wrapper_options(loading));
+            p.read_string(slurp(corpus + file) + "\n[DEFAULT]\nSLPolicyHookNT61=0\n");
+            std::vector<std::string_view> names;
+            std::vector<ini::StaticKey> statics;
+            for (const auto& k : keys) {
+                names.push_back(k.name);
+                statics.push_back(k.key);
+            }
+            std::vector<std::optional<std::string_view>> by_name(keys.size());
+            std::vector<std::optional<std::string_view>> by_key(keys.size());
+            std::size_t found = 0;
+            for (const auto& section : p.sections()) {
+                const bool a = p.get_raw_batch(section, names.data(), names.size(), by_name.data());
+                const bool b = p.get_raw_batch(section, statics.data(), statics.size(), by_key.data());
+                assert(a && b && by_name == by_key);
+                for (const auto& v : by_key) {
+                    found += v.has_value() ? 1 : 0;
+                }
+            }
+            assert(found > p.sections().size());
+            const bool missing = p.get_raw_batch("no such section", statics.data(), statics.size(), by_key.data());
+            assert(!missing && !by_key.front().has_value());
+        }
+    }
+
+    // Schemas built from static keys read what those built from names do.
+    {
+        ini::Parser p(wrapper_options(ini::SectionLoading::Eager));
+        p.read_string(slurp(corpus + "/rdpwrap.ini"));
+        constexpr ini::StaticKey kPatch = ini::arch_key<TargetArch::X64>("LocalOnlyPatch");
+        constexpr ini::StaticKey kOffset = ini::arch_key<TargetArch::X64>("LocalOnlyOffset");
+        constexpr ini::StaticKey kCode = ini::arch_key<TargetArch::X64>("LocalOnlyCode");
+        const auto by_key = ini::Schema<Patch>()
+            .flag(kPatch, &Patch::enabled)
+            .hex(kOffset, &Patch::offset)
+            .text(kCode, &Patch::code)
+            .bytes(kCode, &Patch::code_bytes);
+        const auto by_name = ini::Schema<Patch>()
+            .flag("LocalOnlyPatch.x64", &Patch::enabled)
+            .hex("LOCALONLYOFFSET.X64", &Patch::offset)
+            .text("LocalOnlyCode.x64", &Patch::code)
+            .bytes("localonlycode.x64", &Patch::code_bytes);
+        std::size_t enabled = 0;
+        for (const auto& section : p.sections()) {
+            Patch a;
+            Patch b;
+            const auto assigned = by_key.resolve(p, section, a);
+            assert(assigned == by_name.resolve(p, section, b));
+            assert(a.enabled == b.enabled && a.offset == b.offset && a.code == b.code);
+            assert(a.code_bytes.size == b.code_bytes.size);
+            enabled += a.enabled ? 1 : 0;
+        }
+        assert(enabled > 100);
+    }
+
+    // Outside a constant expression an unknown name throws instead.
+    bool threw = false;
+    try {
+        ini::arch_key<TargetArch::X64>(std::string("LocalOnlyPatch.x64"));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    threw = false;
+    try {
+        ini::wrapper_key(std::string("LocalOnlyPatch"));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::cout << "static_key_test passed\n";
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "ini/parser.hpp"
+#include "ini/tokenizer.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool points_into(std::string_view view, const std::string& buffer) {
+    return view.empty() ||
+        (view.data() >= buffer.data() && view.data() + view.size() <= buffer.data() + buffer.size());
+}
+
+}  // namespace
+
+int main() {
+    ini::ParseOptions opt;
+    opt.inline_comment_prefixes = {";"};
+
+    const std::string text =
+        "; header comment\r\n"
+        "[Main]\r\n"
+        "Updated=2026-08-15 ; date\r\n"
+        "  continued\r\n"
+        "\r\n"
+        "bare\r\n"
+        "key : value=with=equals\r\n"
+        "last=1";
+
+    std::vector<ini::Token> tokens;
+    ini::Tokenizer tokenizer(text, opt);
+    ini::Token tok;
+    while (tokenizer.next(tok)) {
+        assert(points_into(tok.raw, text));
+        assert(points_into(tok.cleaned, text));
+        assert(points_into(tok.key, text));
+        assert(points_into(tok.value, text));
+        tokens.push_back(tok);
+    }
+
+    assert(tokens.size() == 8);
+    assert(tokens[0].kind == ini::TokenKind::Blank);
+    assert(tokens[1].kind == ini::TokenKind::Section && tokens[1].name == "Main");
+    assert(tokens[2].kind == ini::TokenKind::Option);
+    assert(tokens[2].key == "Updated" && tokens[2].value == "2026-08-15");
+    assert(tokens[3].indented && tokens[3].cleaned == "continued");
+    assert(tokens[4].kind == ini::TokenKind::Blank && tokens[4].line_no == 5);
+    assert(tokens[5].kind == ini::TokenKind::Bare && tokens[5].key == "bare");
+    assert(tokens[6].key == "key" && tokens[6].value == "value=with=equals");
+    assert(tokens[7].key == "last" && tokens[7].value == "1" && tokens[7].raw == "last=1");
+    // The "\r" of a CRLF terminator is not part of the line.
+    assert(tokens[1].raw == "[Main]" && tokens[2].raw == "Updated=2026-08-15 ; date");
+    assert(tokens[3].raw == "  continued" && tokens[4].raw.empty());
+
+    // The parser must still see CRLF input and continuation lines the way
+    // the getline-based reader did.
+    opt.allow_no_value = true;
+    opt.interpolation = ini::InterpolationMode::None;
+    ini::Parser p(opt);
+    p.read_string(text);
+    assert(p.get_raw("Main", "updated") == std::string("2026-08-15\ncontinued"));
+    assert(p.has_option("Main", "bare") && !p.get_raw("Main", "bare").has_value());
+    assert(p.get("Main", "key") == "value=with=equals");
+
+    std::cout << "ini_configparser_tokenizer_test passed\n";
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "ini/parser.hpp"
+#include "ini/version_index.hpp"
+
+#include "rdpwrap_arm_kb_versions.hpp"
+#include "rdpwrap_versions.hpp"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The generated tables are usable in constant expressions.
+static_assert(rdpwrap_versions::kVersionIndex.find(ini::pack_version(10, 0, 19041, 1)) !=
+              ini::VersionIndexView::npos, "10.0.19041.1 is in rdpwrap.ini");
+static_assert(rdpwrap_versions::kVersionIndex.find(ini::pack_version(1, 2, 3, 4)) ==
+              ini::VersionIndexView::npos, "1.2.3.4 is not");
+static_assert(rdpwrap_arm_kb_versions::kVersionIndex.find(ini::pack_version(6, 2, 9200, 16384)) !=
+              ini::VersionIndexView::npos, "6.2.9200.16384 is in rdpwrap-arm-kb.ini");
+
+namespace {
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+void check_generated(const std::string& path, const ini::VersionIndexView& index, const std::uint64_t* keys,
+                     const std::uint32_t* build_offsets, const std::uint32_t* slinit_offsets,
+                     std::uint32_t no_section) {
+    const auto text = read_all(path);
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+    ini::Parser p(opt);
+    p.read_string(text);
+
+    std::vector<bool> seen(index.size, false);
+    std::size_t builds = 0;
+    for (const auto& name : p.sections()) {
+        const auto version = ini::parse_version(name);
+        if (!version) {
+            continue;
+        }
+        ++builds;
+        const auto slot = index.find(*version);
+        assert(slot < index.size && keys[slot] == *version && !seen[slot]);
+        seen[slot] = true;
+        assert(text.compare(build_offsets[slot], name.size() + 2, "[" + name + "]") == 0);
+        const auto slinit = name + "-SLInit";
+        if (p.has_section(slinit)) {
+            assert(text.compare(slinit_offsets[slot], slinit.size() + 2, "[" + slinit + "]") == 0);
+        }
+    }
+    // SLInit-only versions are indexed too, without a build section.
+    for (std::size_t slot = 0; slot < index.size; ++slot) {
+        if (!seen[slot]) {
+            assert(build_offsets[slot] == no_section);
+            assert(slinit_offsets[slot] != no_section);
+        }
+    }
+    assert(builds > 0);
+}
+
+}  // namespace
+
+int main() {
+    // Names.
+    assert(ini::parse_version("10.0.19041.1") == ini::pack_version(10, 0, 19041, 1));
+    assert(ini::parse_version("0.0.0.0") == 0u);
+    assert(ini::parse_version("65535.0.0.1").has_value());
+    assert(!ini::parse_version("65536.0.0.1"));
+    assert(!ini::parse_version("10.0.019041.1"));
+    assert(!ini::parse_version("10.0.19041"));
+    assert(!ini::parse_version("10.0.19041.1-SLInit"));
+    assert(!ini::parse_version("10.0.-1.1"));
+    assert(!ini::parse_version(""));
+    assert(ini::format_version(ini::pack_version(6, 1, 7601, 17514)) == "6.1.7601.17514");
+
+    // Every key gets its own slot in 0..n-1; anything else misses.
+    std::mt19937_64 rng(7);
+    for (const std::size_t n : {0u, 1u, 2u, 3u, 10u, 100u, 742u, 5000u}) {
+        std::vector<std::uint64_t> keys;
+        while (keys.size() < n) {
+            keys.push_back(rng() & 0xFFFF00FFFFFFFFFFull);  // sparse, version-like
+        }
+        keys.push_back(keys.empty() ? 1 : keys.front());  // duplicates collapse
+        const ini::VersionIndex index(keys);
+        const auto unique = n == 0 ? 1 : n;
+        assert(index.size() == unique);
+        std::vector<bool> seen(unique, false);
+        for (const auto k : keys) {
+            const auto slot = index.find(k);
+            assert(slot < unique && index.keys()[slot] == k);
+            seen[slot] = true;
+        }
+        for (const bool s : seen) {
+            assert(s);
+        }
+        for (int i = 0; i < 1000; ++i) {
+            const auto k = rng() | (1ull << 40);  // outside the key mask
+            assert(index.find(k) == ini::VersionIndexView::npos);
+        }
+    }
+    assert(ini::VersionIndex().find(0) == ini::VersionIndexView::npos);
+
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    check_generated(corpus + "/rdpwrap.ini", rdpwrap_versions::kVersionIndex, rdpwrap_versions::kVersions,
+                    rdpwrap_versions::kBuildSectionOffsets, rdpwrap_versions::kSLInitSectionOffsets,
+                    rdpwrap_versions::kNoSection);
+    check_generated(corpus + "/rdpwrap-arm-kb.ini", rdpwrap_arm_kb_versions::kVersionIndex,
+                    rdpwrap_arm_kb_versions::kVersions, rdpwrap_arm_kb_versions::kBuildSectionOffsets,
+                    rdpwrap_arm_kb_versions::kSLInitSectionOffsets, rdpwrap_arm_kb_versions::kNoSection);
+
+    std::cout << "ini_configparser_version_index_test passed\n";
+    return 0;
+}
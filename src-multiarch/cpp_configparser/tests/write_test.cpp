@@ -0,0 +1,212 @@
+#include "ini/parser.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// The ostringstream serialiser write_to_string() used to be, on top of the
+// public API.
+std::string reference_write(const ini::Parser& p, bool space) {
+    const auto& opt = p.parse_options();
+    const std::string delim = space ? " " + opt.delimiters.front() + " " : opt.delimiters.front();
+    std::ostringstream oss;
+    auto write_items = [&](const ini::SectionItems& items, bool fold) {
+        for (const auto& [key, value] : items) {
+            if (value.has_value() || !opt.allow_no_value) {
+                if (key.find('[') == 0) {
+                    throw ini::Error(ini::ErrorCode::InvalidWrite, "Cannot write key; begins with section pattern");
+                }
+                for (const auto& d : opt.delimiters) {
+                    if (key.find(d) != std::string::npos) {
+                        throw ini::Error(ini::ErrorCode::InvalidWrite, "Cannot write key; contains delimiter");
+                    }
+                }
+                std::string v = value.value_or("");
+                std::string::size_type pos = 0;
+                while (fold && (pos = v.find('\n', pos)) != std::string::npos) {
+                    v.replace(pos, 1, "\n\t");
+                    pos += 2;
+                }
+                oss << key << delim << v << '\n';
+            } else {
+                oss << key << '\n';
+            }
+        }
+        oss << '\n';
+    };
+    const auto defaults = p.section(opt.default_section).items();
+    if (!defaults.empty()) {
+        oss << '[' << opt.default_section << "]\n";
+        write_items(defaults, false);
+    }
+    for (const auto& name : p.sections()) {
+        if (name != ini::kUnnamedSectionName) {
+            oss << '[' << name << "]\n";
+        }
+        write_items(p.section(name).items(), true);
+    }
+    return oss.str();
+}
+
+std::string outcome(const std::function<std::string()>& write) {
+    try {
+        return write();
+    } catch (const ini::Error& e) {
+        return std::string("error: ") + e.what();
+    }
+}
+
+std::string via_sink(const ini::Parser& p, bool space, std::size_t* chunks = nullptr) {
+    std::string out;
+    p.write([&](std::string_view chunk) {
+        assert(!chunk.empty());
+        out.append(chunk);
+        if (chunks != nullptr) {
+            ++*chunks;
+        }
+    }, space);
+    return out;
+}
+
+// Every way of writing `p` produces the old output, byte for byte.
+void check(const ini::Parser& p) {
+    for (const bool space : {true, false}) {
+        const auto expected = outcome([&] { return reference_write(p, space); });
+        assert(outcome([&] { return p.write_to_string(space); }) == expected);
+        assert(outcome([&] { return via_sink(p, space); }) == expected);
+    }
+}
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = INI_CONFIGPARSER_CORPUS_DIR;
+    const auto rdpwrap = read_all(corpus + "/rdpwrap.ini");
+
+    // Shipped files in every storage mode, and the round trip back.
+    for (const char* name : {"/rdpwrap.ini", "/rdpwrap-arm-kb.ini"}) {
+        for (const auto mode : {ini::StorageMode::Heap, ini::StorageMode::Arena, ini::StorageMode::Interned}) {
+            auto opt = wrapper_options();
+            opt.storage = mode;
+            ini::Parser p(opt);
+            p.read_string(read_all(corpus + name));
+            check(p);
+
+            ini::Parser again(opt);
+            again.read_string(p.write_to_string());
+            assert(p.diff(again).empty());
+            assert(again.write_to_string() == p.write_to_string());
+        }
+    }
+
+    // Large output reaches the sink in bounded chunks.
+    {
+        ini::Parser p(wrapper_options());
+        p.read_string(rdpwrap);
+        std::size_t chunks = 0;
+        const auto text = via_sink(p, true, &chunks);
+        assert(text == p.write_to_string());
+        assert(chunks >= text.size() / (64 * 1024) && chunks <= text.size() / (64 * 1024) + 1);
+
+        // A value longer than a chunk goes through on its own.
+        p.set("Main", "huge", std::string(200 * 1024, 'x'));
+        check(p);
+    }
+
+    // Multi-line values (folded in named sections only), no-value options,
+    // the unnamed section, other delimiters and an empty parser.
+    {
+        auto opt = wrapper_options();
+        opt.allow_no_value = true;
+        opt.allow_unnamed_section = true;
+        opt.delimiters = {"=>", ":"};
+        ini::Parser p(opt);
+        p.read_string("top => 1\n[DEFAULT]\nd => a\n  b\n[s]\nm => one\n  two\n\n  three\nflag\nempty =>\n[t]\n");
+        p.set("DEFAULT", "multi", std::string("x\ny"));
+        check(p);
+        assert(p.write_to_string().find("multi => x\ny\n") != std::string::npos);
+        assert(p.write_to_string().find("m => one\n\ttwo\n\t\n\tthree\n") != std::string::npos);
+
+        ini::Parser empty(opt);
+        check(empty);
+        assert(empty.write_to_string().empty());
+    }
+
+    // Keys that cannot be read back fail before anything is written, with the
+    // same error for the first offending key.
+    {
+        ini::Parser p(wrapper_options());
+        p.read_string("[a]\nx = 1\n[b]\ny = 2\n");
+        p.set("a", "bad:key", std::string("1"));
+        p.set("b", "[bracket", std::string("1"));
+        check(p);
+        bool called = false;
+        try {
+            p.write([&](std::string_view) { called = true; });
+            assert(false);
+        } catch (const ini::Error& e) {
+            assert(e.code() == ini::ErrorCode::InvalidWrite);
+        }
+        assert(!called);
+        assert(p.remove_option("a", "bad:key"));
+        check(p);
+
+        auto opt = wrapper_options();
+        opt.allow_no_value = true;
+        ini::Parser q(opt);
+        q.read_string("[a]\n[no value = here\n");
+        check(q);  // keys without a value are not checked
+    }
+
+    // write_file() writes what write_to_string() returns and leaves an
+    // existing file alone when the output is invalid.
+    {
+        const std::string path = "ini_configparser_write_test.ini";
+        ini::Parser p(wrapper_options());
+        p.read_string(rdpwrap);
+        p.write_file(path);
+        assert(read_all(path) == p.write_to_string());
+
+        ini::Parser bad(wrapper_options());
+        bad.read_string("[a]\nx = 1\n");
+        bad.set("a", "k=v", std::string("1"));
+        try {
+            bad.write_file(path);
+            assert(false);
+        } catch (const ini::Error& e) {
+            assert(e.code() == ini::ErrorCode::InvalidWrite);
+        }
+        assert(read_all(path) == p.write_to_string());
+        std::remove(path.c_str());
+
+        try {
+            p.write_file("no-such-directory/out.ini");
+            assert(false);
+        } catch (const ini::Error& e) {
+            assert(e.code() == ini::ErrorCode::InvalidWrite);
+        }
+    }
+
+    std::cout << "write_test passed\n";
+    return 0;
+}
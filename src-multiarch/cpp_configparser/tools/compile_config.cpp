@@ -0,0 +1,45 @@
+// Host-side compiler for the wrapper's binary configuration:
+//
+//   ini_configparser_compile <rdpwrap.ini> [output]
+//
+// writes <rdpwrap.ini>.bin unless an output path is given. The wrapper only
+// uses the result while it matches the INI next to it byte for byte.
+#include "ini/compiled_config.hpp"
+#include "ini/mapped_file.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "usage: " << argv[0] << " <input.ini> [output]\n";
+        return 2;
+    }
+    const std::string input = argv[1];
+    const std::string output = argc > 2 ? argv[2] : input + ".bin";
+
+    // The options Hook() reads the INI with.
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+
+    try {
+        const ini::MappedFile file(input);
+        const std::string blob = ini::compile_config(file.view(), opt);
+        const ini::CompiledConfig check(blob);
+
+        std::ofstream out(output, std::ios::binary | std::ios::trunc);
+        if (!out.write(blob.data(), static_cast<std::streamsize>(blob.size())) || !out.flush()) {
+            std::cerr << "cannot write " << output << "\n";
+            return 1;
+        }
+        std::cout << output << ": " << blob.size() << " bytes, "
+                  << check.version_count() << " builds\n";
+    } catch (const std::exception& e) {
+        std::cerr << input << ": " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
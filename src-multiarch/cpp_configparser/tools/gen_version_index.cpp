@@ -0,0 +1,140 @@
+// Build-time generator of a constexpr version index:
+//
+//   ini_configparser_gen_version_index <rdpwrap.ini> <output.hpp> <namespace>
+//
+// writes a header holding a minimal perfect hash over the "[a.b.c.d]" build
+// sections of the INI, plus per slot the byte offsets of the build section's
+// and its "-SLInit" section's header lines (kNoSection when absent).
+#include "ini/mapped_file.hpp"
+#include "ini/parser.hpp"
+#include "ini/tokenizer.hpp"
+#include "ini/version_index.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t kNoSection = 0xFFFFFFFFu;
+
+struct Offsets {
+    std::uint32_t build = kNoSection;
+    std::uint32_t slinit = kNoSection;
+};
+
+template <class T, class Fn>
+void put_array(std::ostream& out, const char* type, const char* name, const std::vector<T>& values, Fn format) {
+    out << "inline constexpr " << type << " " << name << "[] = {";
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        out << (i % 4 == 0 ? "\n    " : " ") << format(values[i]) << ",";
+    }
+    if (values.empty()) {
+        out << "0";  // zero-length arrays are ill-formed
+    }
+    out << "\n};\n";
+}
+
+std::string hex(std::uint64_t v, int digits) {
+    char buf[24];
+    std::snprintf(buf, sizeof(buf), "0x%0*llX", digits, static_cast<unsigned long long>(v));
+    return buf;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 4) {
+        std::cerr << "usage: " << argv[0] << " <input.ini> <output.hpp> <namespace>\n";
+        return 2;
+    }
+    const std::string input = argv[1];
+    const std::string output = argv[2];
+    const std::string ns = argv[3];
+
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    opt.empty_lines_in_values = true;
+
+    std::unordered_map<std::uint64_t, Offsets> sections;
+    std::vector<std::uint64_t> versions;
+    try {
+        const ini::MappedFile file(input);
+        const auto text = file.view();
+        ini::Tokenizer tok(text, opt);
+        ini::Token t;
+        const std::string_view suffix = "-SLInit";
+        while (tok.next_header(t)) {
+            if (t.indented) {
+                continue;
+            }
+            auto name = t.name;
+            const bool slinit = name.size() > suffix.size() &&
+                                name.substr(name.size() - suffix.size()) == suffix;
+            if (slinit) {
+                name.remove_suffix(suffix.size());
+            }
+            const auto version = ini::parse_version(name);
+            if (!version) {
+                continue;
+            }
+            const auto offset = static_cast<std::uint32_t>(t.raw.data() - text.data());
+            auto [it, inserted] = sections.emplace(*version, Offsets{});
+            if (inserted) {
+                versions.push_back(*version);
+            }
+            auto& slot = slinit ? it->second.slinit : it->second.build;
+            if (slot == kNoSection) {
+                slot = offset;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << input << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    const ini::VersionIndex index(versions);
+    std::vector<std::uint32_t> build_offsets;
+    std::vector<std::uint32_t> slinit_offsets;
+    for (const auto v : index.keys()) {
+        build_offsets.push_back(sections[v].build);
+        slinit_offsets.push_back(sections[v].slinit);
+    }
+
+    std::ostringstream out;
+    out << "// Generated by ini_configparser_gen_version_index; do not edit.\n"
+        << "#pragma once\n\n"
+        << "#include <cstdint>\n\n"
+        << "#include \"ini/version_index.hpp\"\n\n"
+        << "namespace " << ns << " {\n\n"
+        << "inline constexpr std::uint32_t kNoSection = " << hex(kNoSection, 8) << ";\n"
+        << "inline constexpr std::size_t kVersionCount = " << index.size() << ";\n\n";
+    put_array(out, "std::uint32_t", "kDisplacements", index.displacements(), [](std::uint32_t v) {
+        return std::to_string(v);
+    });
+    put_array(out, "std::uint64_t", "kVersions", index.keys(), [](std::uint64_t v) {
+        return hex(v, 16);
+    });
+    put_array(out, "std::uint32_t", "kBuildSectionOffsets", build_offsets, [](std::uint32_t v) {
+        return hex(v, 8);
+    });
+    put_array(out, "std::uint32_t", "kSLInitSectionOffsets", slinit_offsets, [](std::uint32_t v) {
+        return hex(v, 8);
+    });
+    out << "\ninline constexpr ini::VersionIndexView kVersionIndex{\n"
+        << "    kDisplacements, " << index.displacements().size() << ", kVersions, kVersionCount};\n\n"
+        << "}  // namespace " << ns << "\n";
+
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    const auto text = out.str();
+    if (!file.write(text.data(), static_cast<std::streamsize>(text.size())) || !file.flush()) {
+        std::cerr << "cannot write " << output << "\n";
+        return 1;
+    }
+    return 0;
+}
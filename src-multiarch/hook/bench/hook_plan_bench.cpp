@@ -0,0 +1,53 @@
+#include "bench.hpp"
+
+#include <string>
+#include <vector>
+
+#include "rdpwrap/hook/hook_plan.hpp"
+#include "ini/parser.hpp"
+#include "ini/version_index.hpp"
+
+namespace {
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+// Hook() builds one plan, for the running termsrv.dll, before suspending
+// any thread; here a plan for every build of a shipped file, per plan.
+void hook_plan_workloads(ini_bench::Runner& r) {
+    const struct {
+        const char* corpus;
+        const char* arch_name;
+        ini::TargetArch arch;
+    } cases[] = {
+        {"rdpwrap.ini", "x64", ini::TargetArch::X64},
+        {"rdpwrap.ini", "x86", ini::TargetArch::X86},
+        {"rdpwrap-arm-kb.ini", "arm64", ini::TargetArch::Arm64},
+        {"rdpwrap-arm-kb.ini", "arm", ini::TargetArch::Arm},
+    };
+    for (const auto& c : cases) {
+        ini::Parser parser(wrapper_options());
+        parser.read_string(ini_bench::load_corpus(c.corpus), c.corpus);
+        std::vector<std::uint64_t> versions;
+        for (const auto& name : parser.sections()) {
+            if (const auto v = ini::parse_version(name)) {
+                versions.push_back(*v);
+            }
+        }
+        r.run(std::string("hook_plan/") + c.corpus + "/" + c.arch_name, versions.size(), [&] {
+            std::size_t patches = 0;
+            for (const auto v : versions) {
+                patches += rdpwrap::hook::build_hook_plan(parser, v, c.arch, 0x1000000, 16).patches.size();
+            }
+            ini_bench::do_not_optimize(patches);
+        });
+    }
+}
+
+INI_BENCH_WORKLOAD("hook_plan", hook_plan_workloads);
+
+}  // namespace
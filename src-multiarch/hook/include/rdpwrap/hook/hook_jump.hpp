@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "ini/wrapper_keys.hpp"
+
+namespace rdpwrap::hook {
+
+// Largest relative branch a hook writes: jmp rel32 (5 bytes) on x86/x64,
+// B (4) on ARM64, B.W (4) on Thumb-2.
+constexpr std::size_t kMaxBranchSize = 5;
+
+// Size of that branch on `arch`.
+std::size_t branch_size(ini::TargetArch arch) noexcept;
+
+// How far the branch reaches either way: 2 GiB on x64, 128 MiB on ARM64,
+// 16 MiB on Thumb-2. 0 on x86, where rel32 wraps around the address space
+// and reaches everything.
+std::uint64_t branch_reach(ini::TargetArch arch) noexcept;
+
+// Encodes the branch at `from` to `to` into `out` (branch_size() bytes).
+// False when it does not reach, or on ARM64 when an address is not 4-byte
+// aligned. On ARM bit 0 of both addresses, the Thumb bit, is ignored.
+bool encode_branch(ini::TargetArch arch, std::uint64_t from, std::uint64_t to, std::uint8_t* out) noexcept;
+
+enum class JumpRoute : std::uint8_t {
+    Branch,    // a branch straight to the replacement
+    Thunk,     // a branch to a thunk holding the absolute jump
+    Absolute,  // the absolute jump (FARJMP) in place
+    None,      // misaligned site, or bytes that do not decode
+};
+
+// "branch", "branch to thunk", ... for the log.
+std::string_view jump_route_name(JumpRoute route) noexcept;
+
+// The jump written at a hook site.
+struct HookJump {
+    JumpRoute route = JumpRoute::None;
+    std::size_t size = 0;     // bytes of the jump itself
+    std::size_t patched = 0;  // `size` out to the next instruction boundary
+    std::uint8_t branch[kMaxBranchSize] = {};  // Branch and Thunk routes
+};
+
+// Picks the shortest safe jump from the site at address `site`, whose first
+// `size` bytes are `code`, to `target`: a branch when one reaches, else a
+// branch to the thunk at `thunk` (0 for none), else the `absolute_size`
+// bytes of the absolute jump. On ARM that last one needs a 4-byte aligned
+// site for its PC-relative literal load.
+//
+// `patched` covers every instruction the jump cuts into; the caller fills
+// the bytes past `size` with fill_padding() so that no partial instruction
+// is left behind.
+HookJump plan_hook_jump(ini::TargetArch arch,
+                        const std::uint8_t* code,
+                        std::size_t size,
+                        std::uint64_t site,
+                        std::uint64_t target,
+                        std::uint64_t thunk,
+                        std::size_t absolute_size) noexcept;
+
+// int3 on x86/x64, NOP on ARM and ARM64, over `size` bytes.
+void fill_padding(ini::TargetArch arch, std::uint8_t* out, std::size_t size) noexcept;
+
+}  // namespace rdpwrap::hook
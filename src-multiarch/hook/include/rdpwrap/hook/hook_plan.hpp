@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ini/decode.hpp"
+#include "ini/parser.hpp"
+#include "ini/wrapper_keys.hpp"
+
+namespace rdpwrap::hook {
+
+// Everything Hook() takes from the configuration for one termsrv.dll build,
+// resolved up front so that nothing is looked up or decoded while the
+// service's threads are suspended: the [Main] switches, the byte patches of
+// "[a.b.c.d]" with their codes decoded, and the offsets of the jumps to the
+// wrapper's SLPolicy and CSLQuery::Initialize replacements.
+//
+// Offsets are from the module base and already checked against its size.
+// Whatever could not be planned is listed in `skipped`, one entry per
+// patch or jump, for the log.
+struct HookPlan {
+    struct Patch {
+        std::string_view label;  // "LocalOnly", "SingleUser" or "DefPolicy"
+        std::uint64_t offset = 0;
+        ini::ByteArray bytes;
+        std::string_view code;  // the *Code value, a [PatchCodes] name or hex
+    };
+
+    enum class JumpTarget : std::uint8_t {
+        SLPolicy,  // SLPolicyInternal/SLPolicyOffset
+        SLInit,    // SLInitHook/SLInitOffset
+    };
+    struct Jump {
+        JumpTarget target;
+        std::uint64_t offset = 0;
+    };
+
+    enum class SkipReason : std::uint8_t {
+        MissingOffset,  // none, zero, or wider than the architecture's pointers
+        InvalidCode,    // neither a [PatchCodes] entry nor hex bytes
+        OutOfRange,     // not inside the module
+    };
+    struct Skipped {
+        std::string_view label;  // a Patch label, "SLPolicy" or "SLInit"
+        SkipReason reason;
+        std::uint64_t offset = 0;
+        std::size_t size = 0;
+    };
+
+    std::string section;     // "a.b.c.d"
+    bool has_build = false;  // whether the configuration has that section
+    bool sl_policy_hook_nt60 = true;
+    bool sl_policy_hook_nt61 = true;
+    std::vector<Patch> patches;
+    std::vector<Jump> jumps;
+    std::vector<Skipped> skipped;
+};
+
+// Label of a jump target, as Skipped::label gives it.
+std::string_view jump_label(HookPlan::JumpTarget target) noexcept;
+
+// The plan for build `version` (pack_version()) on `arch`, for a module of
+// `module_size` bytes and jumps of `jump_size` bytes (sizeof(FARJMP)).
+// The jumps are only planned on ARM, where the wrapper hooks SLPolicy and
+// CSLQuery::Initialize. String views in the plan point into `config`.
+// A jump is only checked to fit `jump_size` bytes: rounded up to whole
+// instructions the write can be longer, which the caller checks again.
+HookPlan build_hook_plan(const ini::Parser& config,
+                         std::uint64_t version,
+                         ini::TargetArch arch,
+                         std::uint64_t module_size,
+                         std::size_t jump_size);
+
+}  // namespace rdpwrap::hook
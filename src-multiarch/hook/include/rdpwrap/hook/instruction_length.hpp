@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ini/wrapper_keys.hpp"
+
+namespace rdpwrap::hook {
+
+// How an instruction transfers control through a relative operand.
+enum class X86Branch : std::uint8_t {
+    None,
+    Jump,             // EB, E9
+    ConditionalJump,  // 70-7F, 0F 80-8F
+    Call,             // E8
+    Loop,             // E0-E3: loop*, jcxz (rel8 only)
+};
+
+// One decoded x86 or x64 instruction: its length and what relocating it
+// needs to know. Offsets are from the first byte of the instruction.
+struct X86Instruction {
+    std::uint8_t length = 0;
+    std::uint8_t opcode_offset = 0;  // first opcode byte, after the prefixes
+    X86Branch branch = X86Branch::None;
+    // Relative branch operand (rel8, rel16 or rel32); size 0 when none.
+    std::uint8_t rel_offset = 0;
+    std::uint8_t rel_size = 0;
+    // disp32 of a RIP-relative memory operand (x64 only); 0 when none.
+    std::uint8_t rip_offset = 0;
+    // ret, jmp, int3, ud2: what follows need not be code of this function.
+    bool ends_flow = false;
+};
+
+// Decodes the instruction at `code`, of which `size` bytes are readable.
+// Table driven: legacy, REX and VEX prefixes, the one-, two- and
+// three-byte opcode maps, ModRM/SIB and every displacement and immediate
+// form. False for bytes that are not a valid instruction in that mode, for
+// EVEX-encoded instructions, and when the instruction runs past `size` or
+// the 15-byte limit.
+bool decode_x86(const std::uint8_t* code, std::size_t size, bool x64, X86Instruction& out) noexcept;
+
+// Length of a Thumb-2 instruction from its first halfword: 4 when its top
+// five bits are 11101, 11110 or 11111, else 2.
+constexpr std::size_t thumb2_length(std::uint16_t first_halfword) noexcept {
+    return (first_halfword >> 11) >= 0x1D ? 4 : 2;
+}
+
+// Length of the instruction at `code` on `arch`: decode_x86() on x86/x64,
+// thumb2_length() on ARM (Windows runs ARM code in Thumb state only), 4 on
+// ARM64. 0 when it does not decode within `size` bytes.
+std::size_t instruction_length(const std::uint8_t* code, std::size_t size, ini::TargetArch arch) noexcept;
+
+// End of the first instruction that ends at or past `min_length`, decoding
+// from `code`: how many bytes a patch of `min_length` bytes has to cover for
+// no instruction to be left cut in two. 0 when an instruction on the way does
+// not decode within `size` bytes.
+std::size_t instruction_boundary(const std::uint8_t* code,
+                                 std::size_t size,
+                                 ini::TargetArch arch,
+                                 std::size_t min_length) noexcept;
+
+}  // namespace rdpwrap::hook
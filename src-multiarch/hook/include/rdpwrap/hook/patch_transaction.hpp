@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rdpwrap::hook {
+
+// Page protection and memory access a PatchTransaction goes through:
+// VirtualProtectEx/WriteProcessMemory in the wrapper, mprotect over an
+// in-memory image in the tests. Protections are opaque values the backend
+// hands out from protection() and takes back in restore().
+class PatchMemory {
+public:
+    virtual ~PatchMemory() = default;
+
+    virtual std::size_t page_size() const noexcept = 0;
+    // Current protection of the page starting at `page`.
+    virtual bool protection(std::uintptr_t page, std::uint32_t& out) = 0;
+    // Makes whole pages [addr, addr + size) writable, keeping them executable.
+    virtual bool make_writable(std::uintptr_t addr, std::size_t size) = 0;
+    // Puts `protection` back on whole pages [addr, addr + size).
+    virtual bool restore(std::uintptr_t addr, std::size_t size, std::uint32_t protection) = 0;
+    virtual bool read(std::uintptr_t addr, void* out, std::size_t size) = 0;
+    virtual bool write(std::uintptr_t addr, const void* data, std::size_t size) = 0;
+    virtual void flush_instructions(std::uintptr_t addr, std::size_t size) = 0;
+};
+
+// A set of code patches applied all at once. Writes are queued, then
+// commit() merges them into contiguous extents, makes each run of pages
+// sharing one protection writable with a single call, writes every extent,
+// puts the protections back and flushes the instruction cache once per span
+// of neighbouring pages written.
+//
+// Either every write lands or none does: when a page cannot be made
+// writable or an extent cannot be written, the bytes already replaced are
+// written back before commit() returns false. A committed transaction can
+// be undone with rollback().
+class PatchTransaction {
+public:
+    explicit PatchTransaction(PatchMemory& memory) noexcept : memory_(&memory) {}
+
+    // Queues `size` bytes of `data` (copied) for address `addr`. Where
+    // queued writes overlap, the later one wins. False, and nothing queued,
+    // for a null range or one that wraps around the address space, or once
+    // the transaction has been committed.
+    bool write(std::uintptr_t addr, const void* data, std::size_t size);
+
+    // Number of write() calls queued.
+    std::size_t size() const noexcept { return writes_.size(); }
+    bool empty() const noexcept { return writes_.empty(); }
+    bool committed() const noexcept { return committed_; }
+
+    // Everything commit() does short of changing memory: merges the writes,
+    // looks up page protections and reads the bytes to be replaced, so that
+    // it can be done before other threads are suspended. commit() calls it
+    // itself unless nothing was queued since the last prepare(). False when
+    // a protection or the original bytes cannot be read.
+    bool prepare();
+    // Applies every queued write. True with nothing queued. On false the
+    // memory is as it was and failed_address() tells where it went wrong.
+    bool commit();
+    // After a successful commit(), writes back the bytes it replaced, under
+    // the same page batching. False when not committed or when restoring
+    // failed part way (the transaction then stays committed).
+    bool rollback();
+
+    // First address of the page or extent the last prepare(), commit() or
+    // rollback() failed on; 0 after a success.
+    std::uintptr_t failed_address() const noexcept { return failed_address_; }
+
+    // Contiguous byte ranges and page runs of the last prepare(), for
+    // logging; both empty before.
+    std::size_t extent_count() const noexcept { return extents_.size(); }
+    std::size_t page_run_count() const noexcept { return runs_.size(); }
+
+private:
+    struct Write {
+        std::uintptr_t addr;
+        std::size_t offset;  // into data_
+        std::size_t size;
+    };
+    struct Extent {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+        std::string bytes;     // what commit() writes
+        std::string original;  // what it replaced
+    };
+    struct PageRun {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+        std::uint32_t protection;
+    };
+
+    void build_extents();
+    bool build_runs();
+    // Writes `bytes` (or `original`) of every extent; on failure puts back
+    // the extents already written.
+    bool apply(bool originals);
+    // Flushes the instruction cache over the first `count` extents.
+    void flush(std::size_t count);
+
+    PatchMemory* memory_;
+    std::vector<Write> writes_;
+    std::string data_;
+    std::vector<Extent> extents_;
+    std::vector<PageRun> runs_;
+    std::uintptr_t failed_address_ = 0;
+    bool prepared_ = false;
+    bool committed_ = false;
+};
+
+}  // namespace rdpwrap::hook
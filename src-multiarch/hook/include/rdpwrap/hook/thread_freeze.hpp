@@ -0,0 +1,140 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rdpwrap::hook {
+
+class ThreadList;
+
+// Listing, suspending and resuming the threads of the current process:
+// NtGetNextThread or a Toolhelp snapshot in the wrapper, a fake in the
+// tests. `handle` is whatever the backend needs to act on the thread.
+class ThreadControl {
+public:
+    struct Thread {
+        std::uint32_t id;
+        std::uintptr_t handle;
+    };
+
+    virtual ~ThreadControl() = default;
+
+    // Appends every thread of this process but the calling one, opened for
+    // suspend() and resume(). A thread that does not fit in `out` is closed
+    // again by the backend. list_threads() only looks at this process;
+    // false when the backend cannot do that, and then nothing was appended.
+    virtual bool list_threads(ThreadList& out) = 0;
+    // The same through a system-wide snapshot filtered by process.
+    virtual bool list_threads_snapshot(ThreadList& out) = 0;
+
+    virtual bool suspend(const Thread& thread) = 0;
+    virtual bool resume(const Thread& thread) = 0;
+    // Releases a handle list_threads*() handed out.
+    virtual void close(const Thread& thread) = 0;
+};
+
+// Threads, up to a capacity set when the list is made. Filling it never
+// allocates: once some threads are suspended, one of them may be holding
+// the heap lock.
+class ThreadList {
+public:
+    explicit ThreadList(std::size_t capacity) { threads_.reserve(capacity); }
+
+    // Appends `thread`; false, and counted in dropped(), when the list is
+    // full.
+    bool push_back(const ThreadControl::Thread& thread) noexcept {
+        if (threads_.size() == threads_.capacity()) {
+            ++dropped_;
+            return false;
+        }
+        threads_.push_back(thread);
+        return true;
+    }
+    // Drops the threads past the first `size`.
+    void truncate(std::size_t size) noexcept {
+        if (size < threads_.size()) {
+            threads_.erase(threads_.begin() + static_cast<std::ptrdiff_t>(size), threads_.end());
+        }
+    }
+    void clear() noexcept {
+        threads_.clear();
+        dropped_ = 0;
+    }
+
+    std::size_t size() const noexcept { return threads_.size(); }
+    bool empty() const noexcept { return threads_.empty(); }
+    std::size_t capacity() const noexcept { return threads_.capacity(); }
+    // push_back() calls refused since the last clear().
+    std::size_t dropped() const noexcept { return dropped_; }
+
+    const ThreadControl::Thread& operator[](std::size_t i) const noexcept { return threads_[i]; }
+    std::vector<ThreadControl::Thread>::const_iterator begin() const noexcept { return threads_.begin(); }
+    std::vector<ThreadControl::Thread>::const_iterator end() const noexcept { return threads_.end(); }
+
+private:
+    std::vector<ThreadControl::Thread> threads_;
+    std::size_t dropped_ = 0;
+};
+
+// Suspends the other threads of the process while code is being patched,
+// and resumes exactly the threads it suspended: threads that exit or start
+// in between are not touched, and nothing is listed again on thaw().
+//
+// freeze() lists the threads again after suspending them, until a pass
+// finds no thread it has not seen, so a thread started while the first
+// pass ran is caught as well.
+//
+// Room for kMaxThreads threads is allocated by the constructor; nothing is
+// allocated between the first suspend and the end of thaw().
+class ThreadFreeze {
+public:
+    static constexpr int kMaxPasses = 4;
+    // Threads one freeze() tracks; TermService's svchost runs a few dozen.
+    static constexpr std::size_t kMaxThreads = 1024;
+
+    explicit ThreadFreeze(ThreadControl& control);
+    ~ThreadFreeze() { thaw(); }
+
+    ThreadFreeze(const ThreadFreeze&) = delete;
+    ThreadFreeze& operator=(const ThreadFreeze&) = delete;
+
+    // Suspends every other thread it can. False when the threads could not
+    // be listed at all, or when already frozen.
+    bool freeze();
+    // Resumes the threads freeze() suspended. Does nothing when not frozen.
+    void thaw();
+
+    bool frozen() const noexcept { return frozen_; }
+    // Threads suspended by the last freeze().
+    std::size_t suspended() const noexcept { return suspended_count_; }
+    // Threads listed by the last freeze() that could not be suspended,
+    // usually because they exited in between, or that found no room left
+    // past kMaxThreads.
+    std::size_t failed() const noexcept { return failed_; }
+    // Listing passes of the last freeze().
+    int passes() const noexcept { return passes_; }
+    // Whether the last freeze() fell back to list_threads_snapshot().
+    bool used_snapshot() const noexcept { return used_snapshot_; }
+    // From the start of freeze() to the end of thaw(), for the last freeze
+    // window; zero until thaw() ends one.
+    std::chrono::steady_clock::duration window() const noexcept { return window_; }
+
+private:
+    ThreadControl* control_;
+    ThreadList listed_;
+    ThreadList suspended_;
+    // IDs of every thread the current freeze() has seen, suspended or not,
+    // sorted; its capacity is never exceeded.
+    std::vector<std::uint32_t> seen_;
+    std::chrono::steady_clock::time_point started_{};
+    std::chrono::steady_clock::duration window_{};
+    std::size_t suspended_count_ = 0;
+    std::size_t failed_ = 0;
+    int passes_ = 0;
+    bool used_snapshot_ = false;
+    bool frozen_ = false;
+};
+
+}  // namespace rdpwrap::hook
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "ini/wrapper_keys.hpp"
+
+namespace rdpwrap::hook {
+
+// Bytes of the original function relocate_prologue() needs to see: enough
+// whole instructions to cover any of the wrapper's jumps.
+constexpr std::size_t kPrologueReadSize = 32;
+
+// Upper bound on RelocatedPrologue::code for kPrologueReadSize bytes of
+// input, to allocate the thunk before relocating into it.
+constexpr std::size_t kMaxThunkSize = 128;
+
+// The start of a function, moved to a thunk: the whole instructions the
+// hook's jump overwrites, rewritten to run from the thunk's address,
+// followed by a jump back to the first instruction left in place. Calling
+// the thunk calls the original function, without touching its patched
+// entry.
+struct RelocatedPrologue {
+    std::vector<std::uint8_t> code;
+    std::size_t replaced = 0;  // bytes of the original taken, >= min_length
+};
+
+enum class RelocateStatus : std::uint8_t {
+    Ok,
+    Undecodable,         // an instruction the decoder does not know
+    TooShort,            // the function returns or jumps away first
+    OutOfReach,          // a relative operand cannot reach from the thunk
+    BranchIntoPrologue,  // a branch to bytes the jump overwrites
+    Unsupported,         // loop/jcxz, rel16, or not x86/x64
+};
+
+// "ok", "undecodable", ... for the log.
+std::string_view relocate_status_name(RelocateStatus status) noexcept;
+
+// Relocates the instructions covering the first `min_length` bytes of the
+// function at address `from`, whose first `size` bytes are `code`, to a
+// thunk at address `to`. Short branches become rel32 ones, rel32 and
+// RIP-relative operands are adjusted to the new address and the jump back
+// is an absolute "jmp [rip]" on x64, so no register is clobbered mid
+// prologue. x86 and x64 only.
+RelocateStatus relocate_prologue(const std::uint8_t* code,
+                                 std::size_t size,
+                                 std::uint64_t from,
+                                 std::uint64_t to,
+                                 ini::TargetArch arch,
+                                 std::size_t min_length,
+                                 RelocatedPrologue& out);
+
+}  // namespace rdpwrap::hook
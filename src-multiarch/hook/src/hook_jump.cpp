@@ -0,0 +1,154 @@
+#include "rdpwrap/hook/hook_jump.hpp"
+
+#include <cstring>
+
+#include "rdpwrap/hook/instruction_length.hpp"
+
+namespace rdpwrap::hook {
+
+using ini::TargetArch;
+
+namespace {
+
+void put16(std::uint8_t* out, std::uint16_t v) noexcept {
+    out[0] = static_cast<std::uint8_t>(v);
+    out[1] = static_cast<std::uint8_t>(v >> 8);
+}
+
+void put32(std::uint8_t* out, std::uint32_t v) noexcept {
+    put16(out, static_cast<std::uint16_t>(v));
+    put16(out + 2, static_cast<std::uint16_t>(v >> 16));
+}
+
+// Whether `delta` fits a signed field covering [-reach, reach).
+bool within(std::int64_t delta, std::uint64_t reach) noexcept {
+    return delta >= -static_cast<std::int64_t>(reach) && delta < static_cast<std::int64_t>(reach);
+}
+
+}  // namespace
+
+std::size_t branch_size(TargetArch arch) noexcept {
+    return arch == TargetArch::X86 || arch == TargetArch::X64 ? 5 : 4;
+}
+
+std::uint64_t branch_reach(TargetArch arch) noexcept {
+    switch (arch) {
+    case TargetArch::X86:
+        return 0;
+    case TargetArch::X64:
+        return 1ull << 31;
+    case TargetArch::Arm:
+        return 1ull << 24;
+    case TargetArch::Arm64:
+        break;
+    }
+    return 1ull << 27;
+}
+
+bool encode_branch(TargetArch arch, std::uint64_t from, std::uint64_t to, std::uint8_t* out) noexcept {
+    switch (arch) {
+    case TargetArch::X86:
+    case TargetArch::X64: {
+        // E9 rel32, relative to the end of the jump.
+        const auto delta = static_cast<std::int64_t>(to - (from + 5));
+        if (arch == TargetArch::X64 && !within(delta, branch_reach(arch))) {
+            return false;
+        }
+        out[0] = 0xE9;
+        put32(out + 1, static_cast<std::uint32_t>(delta));
+        return true;
+    }
+    case TargetArch::Arm: {
+        // B.W (T4), relative to the jump + 4: S:I1:I2:imm10:imm11:'0' with
+        // J1 = !I1 ^ S and J2 = !I2 ^ S.
+        from &= ~1ull;
+        to &= ~1ull;
+        const auto delta = static_cast<std::int64_t>(to - (from + 4));
+        if (!within(delta, branch_reach(arch))) {
+            return false;
+        }
+        const auto u = static_cast<std::uint32_t>(delta);
+        const std::uint32_t s = (u >> 24) & 1;
+        const std::uint32_t j1 = (~(u >> 23) & 1) ^ s;
+        const std::uint32_t j2 = (~(u >> 22) & 1) ^ s;
+        put16(out, static_cast<std::uint16_t>(0xF000 | s << 10 | ((u >> 12) & 0x3FF)));
+        put16(out + 2, static_cast<std::uint16_t>(0x9000 | j1 << 13 | j2 << 11 | ((u >> 1) & 0x7FF)));
+        return true;
+    }
+    case TargetArch::Arm64:
+        break;
+    }
+    // B imm26, relative to the jump itself.
+    const auto delta = static_cast<std::int64_t>(to - from);
+    if ((from & 3) != 0 || (to & 3) != 0 || !within(delta, branch_reach(arch))) {
+        return false;
+    }
+    put32(out, 0x14000000u | ((static_cast<std::uint32_t>(delta) >> 2) & 0x03FFFFFFu));
+    return true;
+}
+
+std::string_view jump_route_name(JumpRoute route) noexcept {
+    switch (route) {
+    case JumpRoute::Branch:
+        return "branch";
+    case JumpRoute::Thunk:
+        return "branch to thunk";
+    case JumpRoute::Absolute:
+        return "absolute";
+    case JumpRoute::None:
+        break;
+    }
+    return "none";
+}
+
+HookJump plan_hook_jump(TargetArch arch,
+                        const std::uint8_t* code,
+                        std::size_t size,
+                        std::uint64_t site,
+                        std::uint64_t target,
+                        std::uint64_t thunk,
+                        std::size_t absolute_size) noexcept {
+    HookJump jump;
+    if (arch == TargetArch::Arm64 && (site & 3) != 0) {
+        return jump;
+    }
+    if (encode_branch(arch, site, target, jump.branch)) {
+        jump.route = JumpRoute::Branch;
+        jump.size = branch_size(arch);
+    } else if (thunk != 0 && encode_branch(arch, site, thunk, jump.branch)) {
+        jump.route = JumpRoute::Thunk;
+        jump.size = branch_size(arch);
+    } else if (arch == TargetArch::Arm && (site & 2) != 0) {
+        // ldr r0, [pc] reads from Align(pc, 4); bit 0 is the Thumb bit.
+        return HookJump();
+    } else {
+        jump.route = JumpRoute::Absolute;
+        jump.size = absolute_size;
+    }
+    jump.patched = instruction_boundary(code, size, arch, jump.size);
+    if (jump.patched == 0) {
+        return HookJump();
+    }
+    return jump;
+}
+
+void fill_padding(TargetArch arch, std::uint8_t* out, std::size_t size) noexcept {
+    switch (arch) {
+    case TargetArch::X86:
+    case TargetArch::X64:
+        std::memset(out, 0xCC, size);
+        return;
+    case TargetArch::Arm:
+        for (std::size_t i = 0; i + 2 <= size; i += 2) {
+            put16(out + i, 0xBF00);
+        }
+        return;
+    case TargetArch::Arm64:
+        break;
+    }
+    for (std::size_t i = 0; i + 4 <= size; i += 4) {
+        put32(out + i, 0xD503201F);
+    }
+}
+
+}  // namespace rdpwrap::hook
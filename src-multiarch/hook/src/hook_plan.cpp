@@ -0,0 +1,257 @@
+#include "rdpwrap/hook/hook_plan.hpp"
+
+#include <limits>
+#include <optional>
+
+#include "ini/schema.hpp"
+#include "ini/version_index.hpp"
+
+namespace rdpwrap::hook {
+
+using ini::arch_key;
+using ini::ByteArray;
+using ini::decode_bytes;
+using ini::format_version;
+using ini::OptionIndex;
+using ini::Parser;
+using ini::Schema;
+using ini::StaticKey;
+using ini::TargetArch;
+using ini::wrapper_key;
+
+namespace {
+
+struct MainFlags {
+    bool sl_policy_hook_nt60 = true;
+    bool sl_policy_hook_nt61 = true;
+};
+
+// One "<Name>Patch/Offset/Code" group of a build section.
+struct PatchFields {
+    bool enabled = false;
+    std::uint64_t offset = 0;
+    std::string_view code;  // name of a [PatchCodes] entry...
+    ByteArray code_bytes;   // ...or the bytes themselves
+};
+
+struct JumpFields {
+    bool policy_internal = false;
+    std::uint64_t policy_offset = 0;
+    bool init_hook = false;
+    std::uint64_t init_offset = 0;
+};
+
+// Keys of one "<Name>Patch/Offset/Code" group, for one architecture.
+struct PatchKeys {
+    StaticKey patch;
+    StaticKey offset;
+    StaticKey code;
+};
+
+template <TargetArch Arch>
+constexpr PatchKeys patch_keys(const char* patch, const char* offset, const char* code) {
+    return {arch_key<Arch>(patch), arch_key<Arch>(offset), arch_key<Arch>(code)};
+}
+
+// Every key the plan reads, looked up in the wrapper_keys.hpp tables when
+// this file is compiled: a name missing from them does not build.
+template <TargetArch Arch>
+constexpr PatchKeys kPatchKeys[] = {
+    patch_keys<Arch>("LocalOnlyPatch", "LocalOnlyOffset", "LocalOnlyCode"),
+    patch_keys<Arch>("SingleUserPatch", "SingleUserOffset", "SingleUserCode"),
+    patch_keys<Arch>("DefPolicyPatch", "DefPolicyOffset", "DefPolicyCode"),
+};
+constexpr std::string_view kPatchLabels[] = {"LocalOnly", "SingleUser", "DefPolicy"};
+constexpr std::size_t kPatchCount = std::size(kPatchLabels);
+static_assert(std::size(kPatchKeys<TargetArch::X64>) == kPatchCount);
+
+constexpr StaticKey kMainKeys[] = {wrapper_key("SLPolicyHookNT60"), wrapper_key("SLPolicyHookNT61")};
+
+// SLPolicyInternal, SLPolicyOffset, SLInitHook, SLInitOffset.
+template <TargetArch Arch>
+constexpr StaticKey kJumpKeys[] = {
+    arch_key<Arch>("SLPolicyInternal"),
+    arch_key<Arch>("SLPolicyOffset"),
+    arch_key<Arch>("SLInitHook"),
+    arch_key<Arch>("SLInitOffset"),
+};
+
+constexpr bool hashed(const StaticKey& key) noexcept {
+    return !key.name.empty() && key.hash == OptionIndex::hash(key.name);
+}
+
+template <TargetArch Arch>
+constexpr bool keys_hashed() noexcept {
+    for (const auto& keys : kPatchKeys<Arch>) {
+        if (!hashed(keys.patch) || !hashed(keys.offset) || !hashed(keys.code)) {
+            return false;
+        }
+    }
+    for (const auto& key : kJumpKeys<Arch>) {
+        if (!hashed(key)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(hashed(kMainKeys[0]) && hashed(kMainKeys[1]));
+static_assert(keys_hashed<TargetArch::X86>() && keys_hashed<TargetArch::X64>() &&
+              keys_hashed<TargetArch::Arm>() && keys_hashed<TargetArch::Arm64>());
+static_assert(kPatchKeys<TargetArch::Arm64>[2].code.name == "defpolicycode.arm64");
+static_assert(kJumpKeys<TargetArch::X86>[3].name == "slinitoffset.x86");
+
+struct Schemas {
+    Schema<MainFlags> main;
+    Schema<PatchFields> patches[kPatchCount];
+    Schema<JumpFields> jumps;
+};
+
+template <TargetArch Arch>
+Schemas make_schemas() {
+    Schemas s;
+    s.main.flag(kMainKeys[0], &MainFlags::sl_policy_hook_nt60).flag(kMainKeys[1], &MainFlags::sl_policy_hook_nt61);
+    for (std::size_t i = 0; i < kPatchCount; ++i) {
+        const PatchKeys& keys = kPatchKeys<Arch>[i];
+        s.patches[i]
+            .flag(keys.patch, &PatchFields::enabled)
+            .hex(keys.offset, &PatchFields::offset)
+            .text(keys.code, &PatchFields::code)
+            .bytes(keys.code, &PatchFields::code_bytes);
+    }
+    const StaticKey* jump = kJumpKeys<Arch>;
+    s.jumps.flag(jump[0], &JumpFields::policy_internal)
+        .hex(jump[1], &JumpFields::policy_offset)
+        .flag(jump[2], &JumpFields::init_hook)
+        .hex(jump[3], &JumpFields::init_offset);
+    return s;
+}
+
+template <TargetArch Arch>
+const Schemas& schemas_for() {
+    static const Schemas schemas = make_schemas<Arch>();
+    return schemas;
+}
+
+const Schemas& schemas(TargetArch arch) {
+    switch (arch) {
+    case TargetArch::X86:
+        return schemas_for<TargetArch::X86>();
+    case TargetArch::X64:
+        return schemas_for<TargetArch::X64>();
+    case TargetArch::Arm:
+        return schemas_for<TargetArch::Arm>();
+    case TargetArch::Arm64:
+        break;
+    }
+    return schemas_for<TargetArch::Arm64>();
+}
+
+bool is_arm(TargetArch arch) noexcept {
+    return arch == TargetArch::Arm || arch == TargetArch::Arm64;
+}
+
+// The wrapper reads offsets into pointer-sized integers; wider values read
+// as zero, that is as missing.
+std::uint64_t pointer_value(std::uint64_t value, TargetArch arch) noexcept {
+    const bool wide = arch == TargetArch::X64 || arch == TargetArch::Arm64;
+    return wide || value <= std::numeric_limits<std::uint32_t>::max() ? value : 0;
+}
+
+bool in_module(std::uint64_t offset, std::size_t size, std::uint64_t module_size) noexcept {
+    return offset < module_size && size <= module_size - offset;
+}
+
+// The [PatchCodes] entry named by the code, else the code read as hex
+// (empty when it is neither).
+ByteArray patch_bytes(const Parser& config, const PatchFields& patch) {
+    ByteArray named;
+    std::optional<std::string_view> value;
+    if (!patch.code.empty() && config.get_raw_batch("PatchCodes", &patch.code, 1, &value) && value &&
+        !value->empty() && decode_bytes(*value, named)) {
+        return named;
+    }
+    return patch.code_bytes;
+}
+
+}  // namespace
+
+std::string_view jump_label(HookPlan::JumpTarget target) noexcept {
+    return target == HookPlan::JumpTarget::SLPolicy ? "SLPolicy" : "SLInit";
+}
+
+HookPlan build_hook_plan(const Parser& config,
+                         std::uint64_t version,
+                         TargetArch arch,
+                         std::uint64_t module_size,
+                         std::size_t jump_size) {
+    const Schemas& s = schemas(arch);
+    HookPlan plan;
+
+    MainFlags main;
+    s.main.resolve(config, "Main", main);
+    plan.sl_policy_hook_nt60 = main.sl_policy_hook_nt60;
+    plan.sl_policy_hook_nt61 = main.sl_policy_hook_nt61;
+
+    plan.section = format_version(version);
+    plan.has_build = config.has_section(plan.section);
+    if (!plan.has_build) {
+        return plan;
+    }
+
+    for (std::size_t i = 0; i < kPatchCount; ++i) {
+        PatchFields fields;
+        s.patches[i].resolve(config, plan.section, fields);
+        if (!fields.enabled) {
+            continue;
+        }
+        const std::string_view label = kPatchLabels[i];
+        const std::uint64_t offset = pointer_value(fields.offset, arch);
+        if (offset == 0) {
+            plan.skipped.push_back({label, HookPlan::SkipReason::MissingOffset, 0, 0});
+            continue;
+        }
+        HookPlan::Patch patch;
+        patch.label = label;
+        patch.offset = offset;
+        patch.bytes = patch_bytes(config, fields);
+        patch.code = fields.code;
+        if (patch.bytes.size == 0) {
+            plan.skipped.push_back({label, HookPlan::SkipReason::InvalidCode, offset, 0});
+        } else if (!in_module(offset, patch.bytes.size, module_size)) {
+            plan.skipped.push_back({label, HookPlan::SkipReason::OutOfRange, offset, patch.bytes.size});
+        } else {
+            plan.patches.push_back(patch);
+        }
+    }
+
+    if (!is_arm(arch)) {
+        return plan;
+    }
+    JumpFields jumps;
+    s.jumps.resolve(config, plan.section, jumps);
+    const struct {
+        bool enabled;
+        std::uint64_t offset;
+        HookPlan::JumpTarget target;
+    } wanted[] = {
+        {jumps.policy_internal, jumps.policy_offset, HookPlan::JumpTarget::SLPolicy},
+        {jumps.init_hook, jumps.init_offset, HookPlan::JumpTarget::SLInit},
+    };
+    for (const auto& jump : wanted) {
+        if (!jump.enabled) {
+            continue;
+        }
+        const std::uint64_t offset = pointer_value(jump.offset, arch);
+        if (offset == 0) {
+            plan.skipped.push_back({jump_label(jump.target), HookPlan::SkipReason::MissingOffset, 0, 0});
+        } else if (!in_module(offset, jump_size, module_size)) {
+            plan.skipped.push_back({jump_label(jump.target), HookPlan::SkipReason::OutOfRange, offset, jump_size});
+        } else {
+            plan.jumps.push_back({jump.target, offset});
+        }
+    }
+    return plan;
+}
+
+}  // namespace rdpwrap::hook
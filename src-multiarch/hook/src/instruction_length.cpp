@@ -0,0 +1,382 @@
+#include "rdpwrap/hook/instruction_length.hpp"
+
+#include <array>
+
+namespace rdpwrap::hook {
+
+using ini::TargetArch;
+
+namespace {
+
+// Operand layout of an opcode, one entry per byte of each map.
+enum OpFlags : std::uint16_t {
+    kModRM = 1 << 0,
+    kImm8 = 1 << 1,
+    kImmZ = 1 << 2,       // imm16 with 66, else imm32
+    kImmV = 1 << 3,       // kImmZ, or imm64 with REX.W (B8-BF)
+    kImm16 = 1 << 4,      // ret/retf imm16; enter adds kImm8
+    kMoffs = 1 << 5,      // A0-A3: an address-size offset
+    kRel8 = 1 << 6,
+    kRelZ = 1 << 7,       // rel16 with 66, else rel32
+    kFarPtr = 1 << 8,     // 9A, EA: ptr16:16/32
+    kGroup3 = 1 << 9,     // F6/F7: the immediate only for /0 and /1
+    kEnds = 1 << 10,      // ret, jmp, int3, ud2
+    kInvalid64 = 1 << 11,
+    kInvalid = 1 << 12,
+};
+
+using OpTable = std::array<std::uint16_t, 256>;
+
+constexpr void set(OpTable& t, unsigned first, unsigned last, std::uint16_t flags) {
+    for (unsigned op = first; op <= last; ++op) {
+        t[op] = flags;
+    }
+}
+
+constexpr OpTable make_one_byte() {
+    OpTable t{};
+    // The eight ALU rows: r/m forms, then AL/eAX immediates, then the
+    // segment push/pop or prefix/BCD byte pairs.
+    for (unsigned row = 0x00; row < 0x40; row += 0x08) {
+        set(t, row, row + 3, kModRM);
+        t[row + 4] = kImm8;
+        t[row + 5] = kImmZ;
+    }
+    set(t, 0x06, 0x07, kInvalid64);
+    t[0x0E] = kInvalid64;
+    set(t, 0x16, 0x17, kInvalid64);
+    set(t, 0x1E, 0x1F, kInvalid64);
+    t[0x27] = kInvalid64;
+    t[0x2F] = kInvalid64;
+    t[0x37] = kInvalid64;
+    t[0x3F] = kInvalid64;
+    set(t, 0x60, 0x61, kInvalid64);
+    t[0x62] = kModRM | kInvalid64;  // bound; EVEX in 64-bit mode
+    t[0x63] = kModRM;
+    t[0x68] = kImmZ;
+    t[0x69] = kModRM | kImmZ;
+    t[0x6A] = kImm8;
+    t[0x6B] = kModRM | kImm8;
+    set(t, 0x70, 0x7F, kRel8);
+    t[0x80] = kModRM | kImm8;
+    t[0x81] = kModRM | kImmZ;
+    t[0x82] = kModRM | kImm8 | kInvalid64;
+    t[0x83] = kModRM | kImm8;
+    set(t, 0x84, 0x8F, kModRM);
+    t[0x9A] = kFarPtr | kInvalid64;
+    set(t, 0xA0, 0xA3, kMoffs);
+    t[0xA8] = kImm8;
+    t[0xA9] = kImmZ;
+    set(t, 0xB0, 0xB7, kImm8);
+    set(t, 0xB8, 0xBF, kImmV);
+    set(t, 0xC0, 0xC1, kModRM | kImm8);
+    t[0xC2] = kImm16 | kEnds;
+    t[0xC3] = kEnds;
+    set(t, 0xC4, 0xC5, kModRM | kInvalid64);  // les/lds; VEX in 64-bit mode
+    t[0xC6] = kModRM | kImm8;
+    t[0xC7] = kModRM | kImmZ;
+    t[0xC8] = kImm16 | kImm8;
+    t[0xCA] = kImm16 | kEnds;
+    t[0xCB] = kEnds;
+    t[0xCC] = kEnds;
+    t[0xCD] = kImm8;
+    t[0xCE] = kInvalid64;
+    t[0xCF] = kEnds;
+    set(t, 0xD0, 0xD3, kModRM);
+    set(t, 0xD4, 0xD5, kImm8 | kInvalid64);
+    t[0xD6] = kInvalid;
+    set(t, 0xD8, 0xDF, kModRM);
+    set(t, 0xE0, 0xE3, kRel8);
+    set(t, 0xE4, 0xE7, kImm8);
+    t[0xE8] = kRelZ;
+    t[0xE9] = kRelZ | kEnds;
+    t[0xEA] = kFarPtr | kEnds | kInvalid64;
+    t[0xEB] = kRel8 | kEnds;
+    t[0xF6] = kModRM | kGroup3 | kImm8;
+    t[0xF7] = kModRM | kGroup3 | kImmZ;
+    set(t, 0xFE, 0xFF, kModRM);
+    return t;
+}
+
+// 0F xx. Most of the map takes a ModRM byte and nothing else.
+constexpr OpTable make_two_byte() {
+    OpTable t{};
+    set(t, 0x00, 0xFF, kModRM);
+    for (unsigned op : {0x04u, 0x0Au, 0x0Cu, 0x24u, 0x25u, 0x26u, 0x27u, 0x36u, 0x39u, 0x3Bu, 0x3Cu, 0x3Du,
+                        0x3Eu, 0x3Fu, 0x7Au, 0x7Bu, 0xA6u, 0xA7u}) {
+        t[op] = kInvalid;
+    }
+    for (unsigned op : {0x05u, 0x06u, 0x07u, 0x08u, 0x09u, 0x0Eu, 0x77u, 0xA0u, 0xA1u, 0xA2u, 0xA8u, 0xA9u, 0xAAu}) {
+        t[op] = 0;
+    }
+    set(t, 0x30, 0x35, 0);
+    t[0x37] = 0;
+    t[0x0B] = kEnds;  // ud2
+    t[0x0F] = kModRM | kImm8;  // 3DNow!, the opcode in the immediate
+    set(t, 0x70, 0x73, kModRM | kImm8);
+    set(t, 0x80, 0x8F, kRelZ);
+    for (unsigned op : {0xA4u, 0xACu, 0xBAu, 0xC2u, 0xC4u, 0xC5u, 0xC6u}) {
+        t[op] = kModRM | kImm8;
+    }
+    set(t, 0xC8, 0xCF, 0);
+    return t;
+}
+
+constexpr OpTable kOneByte = make_one_byte();
+constexpr OpTable kTwoByte = make_two_byte();
+
+constexpr std::size_t kMaxLength = 15;
+
+bool is_legacy_prefix(std::uint8_t b) noexcept {
+    switch (b) {
+    case 0x26:
+    case 0x2E:
+    case 0x36:
+    case 0x3E:
+    case 0x64:
+    case 0x65:
+    case 0x66:
+    case 0x67:
+    case 0xF0:
+    case 0xF2:
+    case 0xF3:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Bytes after the ModRM byte at code[pos]: SIB and displacement. Sets
+// `rip` when the operand is [rip+disp32].
+std::size_t modrm_tail(const std::uint8_t* code, std::size_t pos, std::size_t size, bool x64, bool addr16,
+                       bool& rip) noexcept {
+    const std::uint8_t modrm = code[pos];
+    const unsigned mod = modrm >> 6;
+    const unsigned rm = modrm & 7;
+    rip = false;
+    if (mod == 3) {
+        return 0;
+    }
+    if (addr16) {
+        if (mod == 0) {
+            return rm == 6 ? 2 : 0;
+        }
+        return mod == 1 ? 1 : 2;
+    }
+    std::size_t tail = 0;
+    unsigned base = rm;
+    if (rm == 4) {
+        if (pos + 1 >= size) {
+            return kMaxLength;  // truncated: longer than anything valid
+        }
+        tail = 1;
+        base = code[pos + 1] & 7;
+    }
+    if (mod == 1) {
+        return tail + 1;
+    }
+    if (mod == 2) {
+        return tail + 4;
+    }
+    if (rm == 5) {
+        rip = x64;
+        return 4;
+    }
+    return base == 5 ? tail + 4 : tail;
+}
+
+}  // namespace
+
+bool decode_x86(const std::uint8_t* code, std::size_t size, bool x64, X86Instruction& out) noexcept {
+    out = X86Instruction();
+    const std::size_t limit = size < kMaxLength ? size : kMaxLength;
+    std::size_t pos = 0;
+    bool opsize16 = false;
+    bool addrsize = false;
+    bool legacy = false;
+    while (pos < limit && is_legacy_prefix(code[pos])) {
+        opsize16 |= code[pos] == 0x66;
+        addrsize |= code[pos] == 0x67;
+        legacy = true;
+        ++pos;
+    }
+    bool rex_w = false;
+    bool rex = false;
+    if (x64 && pos < limit && (code[pos] & 0xF0) == 0x40) {
+        rex_w = (code[pos] & 0x08) != 0;
+        rex = true;
+        ++pos;
+    }
+    if (pos >= limit) {
+        return false;
+    }
+
+    out.opcode_offset = static_cast<std::uint8_t>(pos);
+    std::uint8_t op = code[pos++];
+    std::uint16_t flags = 0;
+    bool one_byte = false;
+    bool vex = false;
+    if (op == 0xC4 || op == 0xC5) {
+        // VEX in 64-bit mode; in 32-bit mode only when the next byte could
+        // not be a memory ModRM of les/lds.
+        vex = x64 || (pos < limit && (code[pos] >> 6) == 3);
+    }
+    if (vex) {
+        if (legacy || rex) {
+            return false;
+        }
+        unsigned map = 1;
+        if (op == 0xC5) {
+            pos += 1;
+        } else {
+            if (pos >= limit) {
+                return false;
+            }
+            map = code[pos] & 0x1F;
+            pos += 2;
+        }
+        if (pos >= limit || map < 1 || map > 3) {
+            return false;
+        }
+        op = code[pos++];
+        if (map == 1) {
+            flags = kTwoByte[op];
+            if (flags & (kRelZ | kInvalid)) {
+                return false;
+            }
+        } else {
+            flags = map == 3 ? kModRM | kImm8 : kModRM;
+        }
+    } else if (op == 0x62 && x64) {
+        return false;  // EVEX
+    } else if (op == 0x0F) {
+        if (pos >= limit) {
+            return false;
+        }
+        op = code[pos++];
+        if (op == 0x38 || op == 0x3A) {
+            flags = op == 0x3A ? kModRM | kImm8 : kModRM;
+            if (pos >= limit) {
+                return false;
+            }
+            ++pos;
+        } else {
+            flags = kTwoByte[op];
+            if (op >= 0x80 && op <= 0x8F) {
+                out.branch = X86Branch::ConditionalJump;
+            }
+        }
+    } else {
+        one_byte = true;
+        flags = kOneByte[op];
+        if (x64 && (flags & kInvalid64)) {
+            return false;
+        }
+        if (!x64 && op >= 0x40 && op <= 0x4F) {
+            flags = 0;  // inc/dec r32
+        }
+        if (op >= 0x70 && op <= 0x7F) {
+            out.branch = X86Branch::ConditionalJump;
+        } else if (op >= 0xE0 && op <= 0xE3) {
+            out.branch = X86Branch::Loop;
+        } else if (op == 0xE8) {
+            out.branch = X86Branch::Call;
+        } else if (op == 0xE9 || op == 0xEB) {
+            out.branch = X86Branch::Jump;
+        }
+    }
+    if (flags & kInvalid) {
+        return false;
+    }
+
+    const bool addr16 = addrsize && !x64;
+    if (flags & kModRM) {
+        if (pos >= limit) {
+            return false;
+        }
+        const std::uint8_t modrm = code[pos];
+        const unsigned reg = (modrm >> 3) & 7;
+        bool rip = false;
+        const std::size_t tail = modrm_tail(code, pos, limit, x64, addr16, rip);
+        if (rip) {
+            out.rip_offset = static_cast<std::uint8_t>(pos + 1);
+        }
+        if ((flags & kGroup3) && reg > 1) {
+            flags &= ~(kImm8 | kImmZ);
+        }
+        // FF /4 and /5: jmp near and far through memory or a register.
+        if (one_byte && op == 0xFF && (reg == 4 || reg == 5)) {
+            flags |= kEnds;
+        }
+        pos += 1 + tail;
+    }
+
+    const std::size_t immz = opsize16 ? 2 : 4;
+    if (flags & (kRel8 | kRelZ)) {
+        out.rel_offset = static_cast<std::uint8_t>(pos);
+        // 66 has no effect on near branches in 64-bit mode.
+        out.rel_size = static_cast<std::uint8_t>((flags & kRel8) ? 1 : (opsize16 && !x64) ? 2 : 4);
+        pos += out.rel_size;
+    }
+    if (flags & kImm16) {
+        pos += 2;
+    }
+    if (flags & kImm8) {
+        pos += 1;
+    }
+    if (flags & kImmZ) {
+        pos += immz;
+    }
+    if (flags & kImmV) {
+        pos += rex_w ? 8 : immz;
+    }
+    if (flags & kMoffs) {
+        pos += x64 ? (addrsize ? 4 : 8) : (addrsize ? 2 : 4);
+    }
+    if (flags & kFarPtr) {
+        pos += immz + 2;
+    }
+    if (pos > limit) {
+        return false;
+    }
+    out.length = static_cast<std::uint8_t>(pos);
+    out.ends_flow = (flags & kEnds) != 0;
+    return true;
+}
+
+std::size_t instruction_length(const std::uint8_t* code, std::size_t size, TargetArch arch) noexcept {
+    switch (arch) {
+    case TargetArch::X86:
+    case TargetArch::X64: {
+        X86Instruction insn;
+        return decode_x86(code, size, arch == TargetArch::X64, insn) ? insn.length : 0;
+    }
+    case TargetArch::Arm: {
+        if (size < 2) {
+            return 0;
+        }
+        const std::size_t length = thumb2_length(static_cast<std::uint16_t>(code[0] | code[1] << 8));
+        return length <= size ? length : 0;
+    }
+    case TargetArch::Arm64:
+        break;
+    }
+    return size >= 4 ? 4 : 0;
+}
+
+std::size_t instruction_boundary(const std::uint8_t* code,
+                                 std::size_t size,
+                                 TargetArch arch,
+                                 std::size_t min_length) noexcept {
+    std::size_t at = 0;
+    while (at < min_length) {
+        const std::size_t length = instruction_length(code + at, size - at, arch);
+        if (length == 0) {
+            return 0;
+        }
+        at += length;
+    }
+    return at;
+}
+
+}  // namespace rdpwrap::hook
@@ -0,0 +1,183 @@
+#include "rdpwrap/hook/patch_transaction.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace rdpwrap::hook {
+
+bool PatchTransaction::write(std::uintptr_t addr, const void* data, std::size_t size) {
+    if (committed_ || addr == 0 || data == nullptr || size == 0 || size > UINTPTR_MAX - addr) {
+        return false;
+    }
+    writes_.push_back({addr, data_.size(), size});
+    prepared_ = false;
+    data_.append(static_cast<const char*>(data), size);
+    return true;
+}
+
+void PatchTransaction::build_extents() {
+    std::vector<std::size_t> order(writes_.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(),
+                     [this](std::size_t a, std::size_t b) { return writes_[a].addr < writes_[b].addr; });
+
+    // Overlapping and touching writes share an extent.
+    extents_.clear();
+    for (const auto i : order) {
+        const Write& w = writes_[i];
+        const std::uintptr_t end = w.addr + w.size;
+        if (!extents_.empty() && w.addr <= extents_.back().end) {
+            extents_.back().end = std::max(extents_.back().end, end);
+        } else {
+            extents_.push_back({w.addr, end, {}, {}});
+        }
+    }
+    for (auto& e : extents_) {
+        e.bytes.resize(e.end - e.begin);
+    }
+
+    // Queue order, so that the later of two overlapping writes wins.
+    for (const Write& w : writes_) {
+        auto it = std::upper_bound(extents_.begin(), extents_.end(), w.addr,
+                                   [](std::uintptr_t addr, const Extent& e) { return addr < e.begin; });
+        --it;
+        std::memcpy(&it->bytes[w.addr - it->begin], data_.data() + w.offset, w.size);
+    }
+}
+
+bool PatchTransaction::build_runs() {
+    runs_.clear();
+    const std::uintptr_t page = memory_->page_size();
+    for (const auto& e : extents_) {
+        const std::uintptr_t last = (e.end - 1) / page * page;
+        for (std::uintptr_t p = e.begin / page * page;; p += page) {
+            // Extents close together share their boundary page.
+            if (runs_.empty() || runs_.back().end <= p) {
+                std::uint32_t protection = 0;
+                if (!memory_->protection(p, protection)) {
+                    failed_address_ = p;
+                    return false;
+                }
+                if (!runs_.empty() && runs_.back().end == p && runs_.back().protection == protection) {
+                    runs_.back().end = p + page;
+                } else {
+                    runs_.push_back({p, p + page, protection});
+                }
+            }
+            if (p == last) {
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool PatchTransaction::apply(bool originals) {
+    std::size_t opened = 0;
+    for (; opened < runs_.size(); ++opened) {
+        const PageRun& run = runs_[opened];
+        if (!memory_->make_writable(run.begin, run.end - run.begin)) {
+            failed_address_ = run.begin;
+            break;
+        }
+    }
+
+    bool ok = opened == runs_.size();
+    std::size_t touched = 0;
+    if (ok) {
+        for (; touched < extents_.size(); ++touched) {
+            const Extent& e = extents_[touched];
+            const std::string& bytes = originals ? e.original : e.bytes;
+            if (!memory_->write(e.begin, bytes.data(), bytes.size())) {
+                failed_address_ = e.begin;
+                ok = false;
+                ++touched;  // it may have been written in part
+                break;
+            }
+        }
+    }
+    if (!ok) {
+        for (std::size_t i = 0; i < touched; ++i) {
+            const Extent& e = extents_[i];
+            const std::string& bytes = originals ? e.bytes : e.original;
+            memory_->write(e.begin, bytes.data(), bytes.size());
+        }
+    }
+
+    for (std::size_t i = 0; i < opened; ++i) {
+        const PageRun& run = runs_[i];
+        memory_->restore(run.begin, run.end - run.begin, run.protection);
+    }
+    flush(touched);
+    return ok;
+}
+
+void PatchTransaction::flush(std::size_t count) {
+    // One flush per span of neighbouring pages. Extents can sit in different
+    // modules (slc.dll and termsrv.dll on NT 6.0/6.1), and the range between
+    // them need not be mapped at all.
+    const std::uintptr_t page = memory_->page_size();
+    std::size_t i = 0;
+    while (i < count) {
+        const std::uintptr_t begin = extents_[i].begin;
+        std::uintptr_t end = extents_[i].end;
+        for (++i; i < count && extents_[i].begin / page <= (end - 1) / page + 1; ++i) {
+            end = extents_[i].end;
+        }
+        memory_->flush_instructions(begin, end - begin);
+    }
+}
+
+bool PatchTransaction::prepare() {
+    failed_address_ = 0;
+    if (committed_) {
+        return false;
+    }
+    build_extents();
+    if (!build_runs()) {
+        return false;
+    }
+    for (auto& e : extents_) {
+        e.original.resize(e.bytes.size());
+        if (!memory_->read(e.begin, e.original.data(), e.original.size())) {
+            failed_address_ = e.begin;
+            return false;
+        }
+    }
+    prepared_ = true;
+    return true;
+}
+
+bool PatchTransaction::commit() {
+    failed_address_ = 0;
+    if (committed_) {
+        return false;
+    }
+    if (writes_.empty()) {
+        committed_ = true;
+        return true;
+    }
+    if (!prepared_ && !prepare()) {
+        return false;
+    }
+    if (!apply(false)) {
+        return false;
+    }
+    committed_ = true;
+    return true;
+}
+
+bool PatchTransaction::rollback() {
+    failed_address_ = 0;
+    if (!committed_) {
+        return false;
+    }
+    if (!extents_.empty() && !apply(true)) {
+        return false;
+    }
+    committed_ = false;
+    return true;
+}
+
+}  // namespace rdpwrap::hook
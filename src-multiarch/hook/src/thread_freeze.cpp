@@ -0,0 +1,86 @@
+#include "rdpwrap/hook/thread_freeze.hpp"
+
+#include <algorithm>
+
+namespace rdpwrap::hook {
+
+ThreadFreeze::ThreadFreeze(ThreadControl& control) : control_(&control), listed_(kMaxThreads), suspended_(kMaxThreads) {
+    seen_.reserve(kMaxThreads);
+}
+
+bool ThreadFreeze::freeze() {
+    if (frozen_) {
+        return false;
+    }
+    started_ = std::chrono::steady_clock::now();
+    window_ = {};
+    suspended_.clear();
+    seen_.clear();
+    suspended_count_ = 0;
+    failed_ = 0;
+    passes_ = 0;
+    used_snapshot_ = false;
+
+    for (int pass = 0; pass < kMaxPasses; ++pass) {
+        listed_.clear();
+        if (!used_snapshot_ && !control_->list_threads(listed_)) {
+            listed_.clear();
+            used_snapshot_ = true;
+        }
+        if (used_snapshot_ && !control_->list_threads_snapshot(listed_)) {
+            if (pass == 0) {
+                return false;
+            }
+            break;
+        }
+        ++passes_;
+        failed_ += listed_.dropped();
+
+        bool found_new = false;
+        for (const auto& thread : listed_) {
+            const auto at = std::lower_bound(seen_.begin(), seen_.end(), thread.id);
+            if (at != seen_.end() && *at == thread.id) {
+                control_->close(thread);
+                continue;
+            }
+            if (seen_.size() == seen_.capacity() || suspended_.size() == suspended_.capacity()) {
+                // No room to remember it, so it is left running: suspended,
+                // it could not be resumed.
+                control_->close(thread);
+                ++failed_;
+                continue;
+            }
+            seen_.insert(at, thread.id);
+            found_new = true;
+            if (control_->suspend(thread)) {
+                suspended_.push_back(thread);
+            } else {
+                control_->close(thread);
+                ++failed_;
+            }
+        }
+        if (!found_new) {
+            break;
+        }
+    }
+
+    suspended_count_ = suspended_.size();
+    frozen_ = true;
+    return true;
+}
+
+void ThreadFreeze::thaw() {
+    if (!frozen_) {
+        return;
+    }
+    // Newest first, the reverse of suspending.
+    for (std::size_t i = suspended_.size(); i-- > 0;) {
+        control_->resume(suspended_[i]);
+        control_->close(suspended_[i]);
+    }
+    suspended_.clear();
+    frozen_ = false;
+    window_ = std::chrono::steady_clock::now() - started_;
+}
+
+}  // namespace rdpwrap::hook
@@ -0,0 +1,175 @@
+#include "rdpwrap/hook/trampoline.hpp"
+
+#include <cstring>
+#include <limits>
+
+#include "rdpwrap/hook/instruction_length.hpp"
+
+namespace rdpwrap::hook {
+
+using ini::TargetArch;
+
+namespace {
+
+std::int64_t read_signed(const std::uint8_t* p, std::size_t size) noexcept {
+    if (size == 1) {
+        return static_cast<std::int8_t>(p[0]);
+    }
+    std::int32_t v = 0;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+void put32(std::vector<std::uint8_t>& out, std::size_t at, std::uint32_t v) {
+    std::memcpy(out.data() + at, &v, sizeof(v));
+}
+
+// disp32 for an operand whose instruction ends at `end` to reach `target`.
+// 32-bit code wraps around the address space; x64 code has to be within
+// +-2 GiB.
+bool fit_disp32(std::uint64_t target, std::uint64_t end, bool x64, std::uint32_t& out) noexcept {
+    if (!x64) {
+        out = static_cast<std::uint32_t>(target - end);
+        return true;
+    }
+    const auto delta = static_cast<std::int64_t>(target - end);
+    if (delta < std::numeric_limits<std::int32_t>::min() || delta > std::numeric_limits<std::int32_t>::max()) {
+        return false;
+    }
+    out = static_cast<std::uint32_t>(delta);
+    return true;
+}
+
+std::uint64_t wrap(std::uint64_t address, bool x64) noexcept {
+    return x64 ? address : address & 0xFFFFFFFFu;
+}
+
+}  // namespace
+
+std::string_view relocate_status_name(RelocateStatus status) noexcept {
+    switch (status) {
+    case RelocateStatus::Ok:
+        return "ok";
+    case RelocateStatus::Undecodable:
+        return "undecodable";
+    case RelocateStatus::TooShort:
+        return "too short";
+    case RelocateStatus::OutOfReach:
+        return "out of reach";
+    case RelocateStatus::BranchIntoPrologue:
+        return "branch into prologue";
+    case RelocateStatus::Unsupported:
+        break;
+    }
+    return "unsupported";
+}
+
+RelocateStatus relocate_prologue(const std::uint8_t* code,
+                                 std::size_t size,
+                                 std::uint64_t from,
+                                 std::uint64_t to,
+                                 TargetArch arch,
+                                 std::size_t min_length,
+                                 RelocatedPrologue& out) {
+    out = RelocatedPrologue();
+    if (arch != TargetArch::X86 && arch != TargetArch::X64) {
+        return RelocateStatus::Unsupported;
+    }
+    const bool x64 = arch == TargetArch::X64;
+
+    // First pass: the instructions to move, ending on an instruction
+    // boundary at or past min_length.
+    X86Instruction insns[kPrologueReadSize];
+    std::size_t count = 0;
+    std::size_t replaced = 0;
+    bool flow_ends = false;
+    while (replaced < min_length) {
+        if (count == kPrologueReadSize || !decode_x86(code + replaced, size - replaced, x64, insns[count])) {
+            return RelocateStatus::Undecodable;
+        }
+        const X86Instruction& insn = insns[count++];
+        if (insn.branch == X86Branch::Loop || insn.rel_size == 2) {
+            return RelocateStatus::Unsupported;
+        }
+        replaced += insn.length;
+        if (insn.ends_flow) {
+            if (replaced < min_length) {
+                return RelocateStatus::TooShort;
+            }
+            flow_ends = true;
+        }
+    }
+
+    // Second pass: copy, retargeting relative operands.
+    std::vector<std::uint8_t>& thunk = out.code;
+    thunk.reserve(kMaxThunkSize);
+    std::size_t at = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        const X86Instruction& insn = insns[i];
+        const std::uint8_t* src = code + at;
+        const std::uint64_t old_end = from + at + insn.length;
+        at += insn.length;
+
+        if (insn.rel_size != 0) {
+            const std::uint64_t target = wrap(old_end + read_signed(src + insn.rel_offset, insn.rel_size), x64);
+            if (target > from && target < from + replaced) {
+                return RelocateStatus::BranchIntoPrologue;
+            }
+            std::size_t rel_at = 0;
+            if (insn.rel_size == 1) {
+                // jmp rel8 -> E9 rel32, jcc rel8 -> 0F 8x rel32; branch hint
+                // prefixes are dropped.
+                const std::uint8_t op = src[insn.opcode_offset];
+                if (insn.branch == X86Branch::Jump) {
+                    thunk.push_back(0xE9);
+                } else {
+                    thunk.push_back(0x0F);
+                    thunk.push_back(static_cast<std::uint8_t>(0x80 | (op & 0x0F)));
+                }
+                rel_at = thunk.size();
+                thunk.resize(thunk.size() + 4);
+            } else {
+                thunk.insert(thunk.end(), src, src + insn.length);
+                rel_at = thunk.size() - insn.length + insn.rel_offset;
+            }
+            std::uint32_t rel = 0;
+            if (!fit_disp32(target, to + thunk.size(), x64, rel)) {
+                return RelocateStatus::OutOfReach;
+            }
+            put32(thunk, rel_at, rel);
+            continue;
+        }
+
+        thunk.insert(thunk.end(), src, src + insn.length);
+        if (insn.rip_offset != 0) {
+            const std::uint64_t target = old_end + read_signed(src + insn.rip_offset, 4);
+            std::uint32_t disp = 0;
+            if (!fit_disp32(target, to + thunk.size(), x64, disp)) {
+                return RelocateStatus::OutOfReach;
+            }
+            put32(thunk, thunk.size() - insn.length + insn.rip_offset, disp);
+        }
+    }
+
+    if (!flow_ends) {
+        const std::uint64_t back = from + replaced;
+        if (x64) {
+            // jmp qword ptr [rip+0], then the address.
+            const std::uint8_t jump[] = {0xFF, 0x25, 0, 0, 0, 0};
+            thunk.insert(thunk.end(), jump, jump + sizeof(jump));
+            const std::size_t abs_at = thunk.size();
+            thunk.resize(thunk.size() + 8);
+            std::memcpy(thunk.data() + abs_at, &back, sizeof(back));
+        } else {
+            thunk.push_back(0xE9);
+            thunk.resize(thunk.size() + 4);
+            std::uint32_t rel = 0;
+            fit_disp32(back, to + thunk.size(), false, rel);
+            put32(thunk, thunk.size() - 4, rel);
+        }
+    }
+    out.replaced = replaced;
+    return RelocateStatus::Ok;
+}
+
+}  // namespace rdpwrap::hook
@@ -0,0 +1,189 @@
+#include "rdpwrap/hook/hook_jump.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+namespace {
+
+std::uint32_t get32(const std::uint8_t* p) {
+    return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 |
+           static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+}
+
+std::uint16_t get16(const std::uint8_t* p) {
+    return static_cast<std::uint16_t>(p[0] | p[1] << 8);
+}
+
+// Where an encoded branch at `from` goes, decoded the way the CPU does.
+std::uint64_t branch_target(ini::TargetArch arch, std::uint64_t from, const std::uint8_t* b) {
+    switch (arch) {
+    case ini::TargetArch::X86:
+        assert(b[0] == 0xE9);
+        return (from + 5 + get32(b + 1)) & 0xFFFFFFFFu;
+    case ini::TargetArch::X64:
+        assert(b[0] == 0xE9);
+        return from + 5 + static_cast<std::int32_t>(get32(b + 1));
+    case ini::TargetArch::Arm: {
+        const std::uint32_t hw1 = get16(b);
+        const std::uint32_t hw2 = get16(b + 2);
+        assert((hw1 & 0xF800) == 0xF000 && (hw2 & 0xD000) == 0x9000);
+        const std::uint32_t s = (hw1 >> 10) & 1;
+        const std::uint32_t i1 = ~((hw2 >> 13) ^ s) & 1;
+        const std::uint32_t i2 = ~((hw2 >> 11) ^ s) & 1;
+        std::uint32_t imm = s << 24 | i1 << 23 | i2 << 22 | (hw1 & 0x3FF) << 12 | (hw2 & 0x7FF) << 1;
+        if (s) {
+            imm |= 0xFE000000u;
+        }
+        return (from & ~1ull) + 4 + static_cast<std::int32_t>(imm);
+    }
+    case ini::TargetArch::Arm64:
+        break;
+    }
+    const std::uint32_t insn = get32(b);
+    assert((insn & 0xFC000000u) == 0x14000000u);
+    const auto imm26 = static_cast<std::int32_t>(insn << 6) >> 6;
+    return from + static_cast<std::int64_t>(imm26) * 4;
+}
+
+bool encodes_to(ini::TargetArch arch, std::uint64_t from, std::uint64_t to) {
+    std::uint8_t b[rdpwrap::hook::kMaxBranchSize] = {};
+    if (!rdpwrap::hook::encode_branch(arch, from, to, b)) {
+        return false;
+    }
+    const std::uint64_t mask =
+        arch == ini::TargetArch::Arm ? ~1ull : arch == ini::TargetArch::X86 ? 0xFFFFFFFFull : ~0ull;
+    return branch_target(arch, from, b) == (to & mask);
+}
+
+void check_encoding() {
+    using A = ini::TargetArch;
+    std::uint8_t b[rdpwrap::hook::kMaxBranchSize] = {};
+    bool ok = false;
+
+    // Known encodings.
+    ok = rdpwrap::hook::encode_branch(A::X86, 0x1000, 0x2000, b);
+    assert(ok && b[0] == 0xE9 && get32(b + 1) == 0xFFB);
+    ok = rdpwrap::hook::encode_branch(A::Arm64, 0x1000, 0x1000, b);
+    assert(ok && get32(b) == 0x14000000u);  // b .
+    ok = rdpwrap::hook::encode_branch(A::Arm64, 0x1000, 0xFFC, b);
+    assert(ok && get32(b) == 0x17FFFFFFu);
+    ok = rdpwrap::hook::encode_branch(A::Arm, 0x1000, 0x1004, b);
+    assert(ok && get16(b) == 0xF000 && get16(b + 2) == 0xB800);  // b.w +0
+    ok = rdpwrap::hook::encode_branch(A::Arm, 0x1001, 0x1001, b);
+    assert(ok && get16(b) == 0xF7FF && get16(b + 2) == 0xBFFE);  // b.w .
+    (void)ok;
+
+    // x86 reaches everything, wrapping around.
+    assert(encodes_to(A::X86, 0xFFFFF000, 0x1000));
+    assert(encodes_to(A::X86, 0x1000, 0xFFFFF000));
+    assert(rdpwrap::hook::branch_reach(A::X86) == 0);
+
+    // The edges of each range.
+    const std::uint64_t from = 0x7FF600000000;
+    assert(encodes_to(A::X64, from, from + 5 + 0x7FFFFFFF));
+    assert(!encodes_to(A::X64, from, from + 5 + 0x80000000));
+    assert(encodes_to(A::X64, from, from + 5 - 0x80000000));
+    assert(!encodes_to(A::X64, from, from + 4 - 0x80000000));
+    assert(encodes_to(A::Arm64, from, from + (1 << 27) - 4));
+    assert(!encodes_to(A::Arm64, from, from + (1 << 27)));
+    assert(encodes_to(A::Arm64, from, from - (1 << 27)));
+    assert(!encodes_to(A::Arm64, from, from - (1 << 27) - 4));
+    assert(!encodes_to(A::Arm64, from + 2, from + 0x100));
+    assert(!encodes_to(A::Arm64, from, from + 0x102));
+    assert(encodes_to(A::Arm, 0x400000, 0x400004 + (1 << 24) - 2));
+    assert(!encodes_to(A::Arm, 0x400000, 0x400004 + (1 << 24)));
+    assert(encodes_to(A::Arm, 0x1400000, 0x1400004 - (1 << 24)));
+    assert(!encodes_to(A::Arm, 0x1400000, 0x1400002 - (1 << 24)));
+
+    // Random distances within reach decode back to their targets.
+    std::mt19937_64 rng(24);
+    for (int i = 0; i < 20000; ++i) {
+        const std::uint64_t base = 0x40000000 + (rng() & 0x0FFFFFFE);
+        const std::int64_t delta = static_cast<std::int64_t>(rng() % (1ull << 25)) - (1ll << 24);
+        const std::uint64_t even = base + 4 + static_cast<std::uint64_t>(delta & ~1ll);
+        assert(encodes_to(A::Arm, base | 1, even | 1));
+        const std::uint64_t aligned = (base & ~3ull) + static_cast<std::uint64_t>(delta * 4 & ~3ll);
+        assert(encodes_to(A::Arm64, base & ~3ull, aligned));
+        assert(encodes_to(A::X64, base, base + static_cast<std::uint64_t>(delta * 64)));
+        assert(encodes_to(A::X86, base, base + static_cast<std::uint64_t>(delta * 128)));
+        (void)even;
+        (void)aligned;
+    }
+}
+
+void check_plan() {
+    using A = ini::TargetArch;
+    using R = rdpwrap::hook::JumpRoute;
+
+    // x64: mov [rsp+8],rbx / push rdi / sub rsp,20h. The 5-byte branch
+    // ends on a boundary; the 12-byte absolute jump cuts sub rsp, 20h.
+    const std::uint8_t x64[] = {0x48, 0x89, 0x5C, 0x24, 0x08, 0x57, 0x48, 0x83, 0xEC, 0x20, 0x48, 0x8B, 0xF2, 0x90};
+    const std::uint64_t site = 0x7FFB12340000;
+    auto j = rdpwrap::hook::plan_hook_jump(A::X64, x64, sizeof(x64), site, site + 0x1000, 0, 12);
+    assert(j.route == R::Branch && j.size == 5 && j.patched == 5);
+    j = rdpwrap::hook::plan_hook_jump(A::X64, x64, sizeof(x64), site, site + 0x100000000, site - 0x10000, 12);
+    assert(j.route == R::Thunk && j.patched == 5);
+    assert(branch_target(A::X64, site, j.branch) == site - 0x10000);
+    j = rdpwrap::hook::plan_hook_jump(A::X64, x64, sizeof(x64), site, site + 0x100000000, site - 0x100000000, 12);
+    assert(j.route == R::Absolute && j.size == 12 && j.patched == 13);
+
+    // x86: mov edi,edi / push ebp / mov ebp,esp is exactly five bytes.
+    const std::uint8_t x86[] = {0x8B, 0xFF, 0x55, 0x8B, 0xEC, 0x83, 0xEC, 0x10};
+    j = rdpwrap::hook::plan_hook_jump(A::X86, x86, sizeof(x86), 0x6BC41000, 0x10001000, 0, 6);
+    assert(j.route == R::Branch && j.patched == 5);
+
+    // Thumb: push {r7,lr} then a 32-bit instruction, cut by B.W.
+    const std::uint8_t thumb[] = {0x80, 0xB5, 0x0D, 0xF1, 0x08, 0x0B, 0x00, 0x23, 0x00, 0x23};
+    j = rdpwrap::hook::plan_hook_jump(A::Arm, thumb, sizeof(thumb), 0x00F90001, 0x00FA0001, 0, 8);
+    assert(j.route == R::Branch && j.size == 4 && j.patched == 6);
+    j = rdpwrap::hook::plan_hook_jump(A::Arm, thumb, sizeof(thumb), 0x00F90000, 0x20000000, 0, 8);
+    assert(j.route == R::Absolute && j.patched == 8);
+    // Absolute needs a 4-byte aligned site for its literal load.
+    j = rdpwrap::hook::plan_hook_jump(A::Arm, thumb, sizeof(thumb), 0x00F90002, 0x20000000, 0, 8);
+    assert(j.route == R::None && j.patched == 0);
+    assert(rdpwrap::hook::jump_route_name(j.route) == "none");
+
+    // ARM64 sites are 4-byte aligned.
+    const std::uint8_t arm64[] = {0xFD, 0x7B, 0xBF, 0xA9, 0xFD, 0x03, 0x00, 0x91, 0x1F, 0x20, 0x03, 0xD5,
+                                  0x1F, 0x20, 0x03, 0xD5};
+    j = rdpwrap::hook::plan_hook_jump(A::Arm64, arm64, sizeof(arm64), 0x140001002, 0x140002000, 0, 16);
+    assert(j.route == R::None);
+    j = rdpwrap::hook::plan_hook_jump(A::Arm64, arm64, sizeof(arm64), 0x140001000, 0x7FF812340000, 0x140000000, 16);
+    assert(j.route == R::Thunk && j.patched == 4);
+    assert(get32(j.branch) == (0x14000000u | (0x3FFFFFFu & static_cast<std::uint32_t>(-0x1000 >> 2))));
+
+    // Bytes that do not decode: only jumps that stop before them.
+    const std::uint8_t bad[] = {0x48, 0x83, 0xEC, 0x28, 0x90, 0x06, 0x90};
+    j = rdpwrap::hook::plan_hook_jump(A::X64, bad, sizeof(bad), site, site + 0x1000, 0, 12);
+    assert(j.route == R::Branch && j.patched == 5);
+    j = rdpwrap::hook::plan_hook_jump(A::X64, bad, sizeof(bad), site, site + 0x100000000, 0, 12);
+    assert(j.route == R::None);
+    j = rdpwrap::hook::plan_hook_jump(A::X64, bad, 4, site, site + 0x1000, 0, 12);
+    assert(j.route == R::None);
+    (void)j;
+}
+
+void check_padding() {
+    std::uint8_t out[8];
+    std::memset(out, 0, sizeof(out));
+    rdpwrap::hook::fill_padding(ini::TargetArch::X64, out, 3);
+    assert(out[0] == 0xCC && out[2] == 0xCC && out[3] == 0);
+    std::memset(out, 0, sizeof(out));
+    rdpwrap::hook::fill_padding(ini::TargetArch::Arm, out, 4);
+    assert(get16(out) == 0xBF00 && get16(out + 2) == 0xBF00 && out[4] == 0);
+    std::memset(out, 0, sizeof(out));
+    rdpwrap::hook::fill_padding(ini::TargetArch::Arm64, out, 8);
+    assert(get32(out) == 0xD503201Fu && get32(out + 4) == 0xD503201Fu);
+}
+
+}  // namespace
+
+int main() {
+    check_encoding();
+    check_plan();
+    check_padding();
+    std::cout << "hook_jump_test passed\n";
+    return 0;
+}
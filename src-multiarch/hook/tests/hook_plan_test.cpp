@@ -0,0 +1,218 @@
+#include "rdpwrap/hook/hook_plan.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ini/version_index.hpp"
+
+namespace {
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+constexpr ini::TargetArch kArchs[] = {ini::TargetArch::X86, ini::TargetArch::X64, ini::TargetArch::Arm,
+                                      ini::TargetArch::Arm64};
+constexpr std::uint64_t kModuleSize = 0x100000;
+constexpr std::size_t kJumpSize = 16;
+
+bool same_bytes(const ini::ByteArray& a, const ini::ByteArray& b) {
+    return a.size == b.size && std::memcmp(a.data, b.data, a.size) == 0;
+}
+
+// The plan as the wrapper used to work it out inline, one read_*() per key
+// with names spelled out at run time.
+void check_against_reads(const ini::Parser& p, std::uint64_t version, ini::TargetArch arch) {
+    const rdpwrap::hook::HookPlan plan = rdpwrap::hook::build_hook_plan(p, version, arch, kModuleSize, kJumpSize);
+    const std::string suffix(ini::arch_suffix(arch));
+    const std::string section = ini::format_version(version);
+    const bool wide = arch == ini::TargetArch::X64 || arch == ini::TargetArch::Arm64;
+    auto narrow = [wide](std::uint64_t v) { return wide || v <= 0xFFFFFFFFu ? v : 0; };
+
+    assert(plan.section == section);
+    assert(plan.has_build == p.has_section(section));
+    assert(plan.sl_policy_hook_nt60 == ini::read_flag(p, "Main", "SLPolicyHookNT60").value_or(true));
+    assert(plan.sl_policy_hook_nt61 == ini::read_flag(p, "Main", "SLPolicyHookNT61").value_or(true));
+    if (!plan.has_build) {
+        assert(plan.patches.empty() && plan.jumps.empty() && plan.skipped.empty());
+        return;
+    }
+
+    std::size_t patch = 0;
+    std::size_t skipped = 0;
+    for (const char* name : {"LocalOnly", "SingleUser", "DefPolicy"}) {
+        const std::string base(name);
+        if (!ini::read_flag(p, section, base + "Patch" + suffix).value_or(false)) {
+            continue;
+        }
+        const std::uint64_t offset = narrow(ini::read_hex(p, section, base + "Offset" + suffix).value_or(0));
+        const auto code = p.try_get_raw(section, base + "Code" + suffix);
+        ini::ByteArray bytes;
+        if (!(code && !code->empty() && ini::read_bytes(p, "PatchCodes", *code, bytes))) {
+            bytes = ini::ByteArray();
+            ini::read_bytes(p, section, base + "Code" + suffix, bytes);
+        }
+
+        if (offset == 0) {
+            assert(plan.skipped.at(skipped).reason == rdpwrap::hook::HookPlan::SkipReason::MissingOffset);
+            assert(plan.skipped.at(skipped++).label == name);
+        } else if (bytes.size == 0) {
+            assert(plan.skipped.at(skipped).reason == rdpwrap::hook::HookPlan::SkipReason::InvalidCode);
+            assert(plan.skipped.at(skipped++).label == name);
+        } else if (offset >= kModuleSize || bytes.size > kModuleSize - offset) {
+            assert(plan.skipped.at(skipped).reason == rdpwrap::hook::HookPlan::SkipReason::OutOfRange);
+            assert(plan.skipped.at(skipped).offset == offset);
+            assert(plan.skipped.at(skipped++).label == name);
+        } else {
+            const auto& planned = plan.patches.at(patch++);
+            assert(planned.label == name);
+            assert(planned.offset == offset);
+            assert(same_bytes(planned.bytes, bytes));
+            assert(planned.code == (code && !code->empty() ? *code : std::string_view()));
+        }
+    }
+    assert(patch == plan.patches.size());
+
+    std::size_t jump = 0;
+    const bool arm = arch == ini::TargetArch::Arm || arch == ini::TargetArch::Arm64;
+    const struct {
+        const char* flag;
+        const char* offset;
+        rdpwrap::hook::HookPlan::JumpTarget target;
+    } jumps[] = {
+        {"SLPolicyInternal", "SLPolicyOffset", rdpwrap::hook::HookPlan::JumpTarget::SLPolicy},
+        {"SLInitHook", "SLInitOffset", rdpwrap::hook::HookPlan::JumpTarget::SLInit},
+    };
+    for (const auto& j : jumps) {
+        if (!arm || !ini::read_flag(p, section, j.flag + suffix).value_or(false)) {
+            continue;
+        }
+        const std::uint64_t offset = narrow(ini::read_hex(p, section, j.offset + suffix).value_or(0));
+        if (offset == 0 || offset >= kModuleSize || kJumpSize > kModuleSize - offset) {
+            assert(plan.skipped.at(skipped++).label == rdpwrap::hook::jump_label(j.target));
+        } else {
+            assert(plan.jumps.at(jump).target == j.target);
+            assert(plan.jumps.at(jump++).offset == offset);
+        }
+    }
+    assert(jump == plan.jumps.size());
+    assert(skipped == plan.skipped.size());
+}
+
+}  // namespace
+
+int main() {
+    const std::string corpus = RDPWRAP_HOOK_CORPUS_DIR;
+
+    // Every build of both shipped files, on every architecture, plus a
+    // version neither has.
+    for (const char* name : {"/rdpwrap.ini", "/rdpwrap-arm-kb.ini"}) {
+        ini::Parser p(wrapper_options());
+        p.read_string(read_all(corpus + name));
+        std::size_t planned = 0;
+        for (const auto& section : p.sections()) {
+            const auto version = ini::parse_version(section);
+            if (!version) {
+                continue;
+            }
+            for (const auto arch : kArchs) {
+                check_against_reads(p, *version, arch);
+                planned += rdpwrap::hook::build_hook_plan(p, *version, arch, kModuleSize, kJumpSize).patches.size();
+            }
+        }
+        assert(planned > 0);
+        check_against_reads(p, ini::pack_version(1, 2, 3, 4), ini::TargetArch::X64);
+    }
+
+    // The shipped x64 table patches 10.0.19041.1 and plans no jump.
+    {
+        ini::Parser p(wrapper_options());
+        p.read_string(read_all(corpus + "/rdpwrap.ini"));
+        const auto plan = rdpwrap::hook::build_hook_plan(p, ini::pack_version(10, 0, 19041, 1), ini::TargetArch::X64,
+                                                         0x1000000, kJumpSize);
+        assert(plan.has_build);
+        assert(!plan.patches.empty());
+        assert(plan.jumps.empty());
+    }
+
+    // Each way of skipping, [PatchCodes] against inline hex, 32-bit
+    // offsets, and jumps only on ARM.
+    {
+        ini::Parser p(wrapper_options());
+        p.read_string(
+            "[Main]\nSLPolicyHookNT60 = 0\n"
+            "[PatchCodes]\nnop = 9090\nbad = zz\n"
+            "[10.0.1.1]\n"
+            "LocalOnlyPatch.x64 = 1\nLocalOnlyOffset.x64 = 100\nLocalOnlyCode.x64 = nop\n"
+            "SingleUserPatch.x64 = 1\nSingleUserOffset.x64 = 200\nSingleUserCode.x64 = EB0C\n"
+            "DefPolicyPatch.x64 = 1\nDefPolicyCode.x64 = nop\n"
+            "LocalOnlyPatch.x86 = 1\nLocalOnlyOffset.x86 = 100000000\nLocalOnlyCode.x86 = nop\n"
+            "SingleUserPatch.x86 = 1\nSingleUserOffset.x86 = 300\nSingleUserCode.x86 = bad\n"
+            "DefPolicyPatch.x86 = 1\nDefPolicyOffset.x86 = FFF\nDefPolicyCode.x86 = nop\n"
+            "SLPolicyInternal.x64 = 1\nSLPolicyOffset.x64 = 400\n"
+            "SLPolicyInternal.arm64 = 1\nSLPolicyOffset.arm64 = 400\n"
+            "SLInitHook.arm64 = 1\nSLInitOffset.arm64 = FF8\n");
+        const auto version = ini::pack_version(10, 0, 1, 1);
+        for (const auto arch : kArchs) {
+            check_against_reads(p, version, arch);
+        }
+
+        const auto x64 = rdpwrap::hook::build_hook_plan(p, version, ini::TargetArch::X64, 0x1000, kJumpSize);
+        assert(!x64.sl_policy_hook_nt60 && x64.sl_policy_hook_nt61);
+        assert(x64.patches.size() == 2);
+        assert(x64.patches[0].label == "LocalOnly" && x64.patches[0].offset == 0x100);
+        assert(x64.patches[0].bytes.size == 2 && x64.patches[0].bytes.data[0] == 0x90);
+        assert(x64.patches[0].code == "nop");
+        assert(x64.patches[1].label == "SingleUser" && x64.patches[1].bytes.size == 2);
+        assert(x64.patches[1].bytes.data[0] == 0xEB && x64.patches[1].bytes.data[1] == 0x0C);
+        assert(x64.skipped.size() == 1);
+        assert(x64.skipped[0].label == "DefPolicy");
+        assert(x64.skipped[0].reason == rdpwrap::hook::HookPlan::SkipReason::MissingOffset);
+        assert(x64.jumps.empty());
+
+        const auto x86 = rdpwrap::hook::build_hook_plan(p, version, ini::TargetArch::X86, 0x1000, kJumpSize);
+        assert(x86.patches.empty());
+        assert(x86.skipped.size() == 3);
+        assert(x86.skipped[0].reason == rdpwrap::hook::HookPlan::SkipReason::MissingOffset);  // wider than 32 bits
+        assert(x86.skipped[1].reason == rdpwrap::hook::HookPlan::SkipReason::InvalidCode);
+        assert(x86.skipped[2].reason == rdpwrap::hook::HookPlan::SkipReason::OutOfRange);
+        assert(x86.skipped[2].offset == 0xFFF && x86.skipped[2].size == 2);
+
+        const auto arm64 = rdpwrap::hook::build_hook_plan(p, version, ini::TargetArch::Arm64, 0x1000, kJumpSize);
+        assert(arm64.jumps.size() == 1);
+        assert(arm64.jumps[0].target == rdpwrap::hook::HookPlan::JumpTarget::SLPolicy);
+        assert(arm64.jumps[0].offset == 0x400);
+        assert(arm64.skipped.size() == 1);
+        assert(arm64.skipped[0].label == "SLInit");
+        assert(arm64.skipped[0].reason == rdpwrap::hook::HookPlan::SkipReason::OutOfRange);
+    }
+
+    // No build section and no [Main]: the switches keep their defaults.
+    {
+        ini::Parser p(wrapper_options());
+        const auto plan = rdpwrap::hook::build_hook_plan(p, ini::pack_version(6, 1, 7601, 1), ini::TargetArch::X86,
+                                                         0x1000, kJumpSize);
+        assert(plan.section == "6.1.7601.1");
+        assert(!plan.has_build);
+        assert(plan.sl_policy_hook_nt60 && plan.sl_policy_hook_nt61);
+        assert(plan.patches.empty() && plan.skipped.empty());
+    }
+
+    std::cout << "hook_plan_test passed\n";
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include "rdpwrap/hook/instruction_length.hpp"
+
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rdpwrap/hook/hook_jump.hpp"
+#include "rdpwrap/hook/hook_plan.hpp"
+#include "ini/version_index.hpp"
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+std::string read_all(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+ini::ParseOptions wrapper_options() {
+    ini::ParseOptions opt;
+    opt.interpolation = ini::InterpolationMode::None;
+    opt.strict = false;
+    return opt;
+}
+
+// A function entry and the lengths of its instructions.
+struct Prologue {
+    const char* name;
+    ini::TargetArch arch;
+    Bytes bytes;
+    std::vector<std::size_t> lengths;
+};
+
+// The entry sequences MSVC emits for the functions the wrapper hooks. The
+// termsrv.dll images themselves are not part of the repository, so the
+// corpus is these shapes, checked at every site rdpwrap-arm-kb.ini names.
+const std::vector<Prologue>& prologues() {
+    static const std::vector<Prologue> corpus = {
+        {"x86 hotpatch frame", ini::TargetArch::X86,
+         {0x8B, 0xFF, 0x55, 0x8B, 0xEC, 0x83, 0xEC, 0x10, 0x53, 0x56, 0x57},
+         {2, 1, 2, 3, 1, 1, 1}},
+        {"x86 frame with SEH", ini::TargetArch::X86,
+         {0x6A, 0x14, 0x68, 0x10, 0x20, 0x30, 0x40, 0xE8, 0x00, 0x01, 0x00, 0x00, 0x33, 0xDB},
+         {2, 5, 5, 2}},
+        {"x64 saved registers", ini::TargetArch::X64,
+         {0x48, 0x89, 0x5C, 0x24, 0x08, 0x48, 0x89, 0x74, 0x24, 0x10, 0x57, 0x48, 0x83, 0xEC, 0x20, 0x48, 0x8B, 0xF2},
+         {5, 5, 1, 4, 3}},
+        {"x64 rax frame", ini::TargetArch::X64,
+         {0x48, 0x8B, 0xC4, 0x48, 0x89, 0x58, 0x08, 0x55, 0x48, 0x8D, 0x68, 0xA1, 0x48, 0x81, 0xEC, 0xB0, 0x00,
+          0x00, 0x00, 0x48, 0x8B, 0x05, 0x10, 0x20, 0x30, 0x00},
+         {3, 4, 1, 4, 7, 7}},
+        {"x64 security cookie", ini::TargetArch::X64,
+         {0x40, 0x53, 0x48, 0x83, 0xEC, 0x40, 0x48, 0x8B, 0x05, 0x00, 0x10, 0x00, 0x00, 0x48, 0x33, 0xC4, 0x48,
+          0x89, 0x44, 0x24, 0x38},
+         {2, 4, 7, 3, 5}},
+        {"arm64 frame record", ini::TargetArch::Arm64,
+         {0xFD, 0x7B, 0xBF, 0xA9, 0xFD, 0x03, 0x00, 0x91, 0xF3, 0x53, 0xBF, 0xA9, 0xFF, 0x43, 0x00, 0xD1,
+          0xF3, 0x03, 0x00, 0xAA},
+         {4, 4, 4, 4, 4}},
+        {"arm64 pac frame", ini::TargetArch::Arm64,
+         {0x7F, 0x23, 0x03, 0xD5, 0xF3, 0x53, 0xBE, 0xA9, 0xFD, 0x7B, 0x01, 0xA9, 0xFD, 0x43, 0x00, 0x91},
+         {4, 4, 4, 4}},
+        {"thumb push.w", ini::TargetArch::Arm,
+         {0x2D, 0xE9, 0xF0, 0x4F, 0x85, 0xB0, 0xDF, 0xF8, 0x10, 0x30, 0x04, 0x46},
+         {4, 2, 4, 2}},
+        {"thumb push", ini::TargetArch::Arm,
+         {0x80, 0xB5, 0x6F, 0x46, 0x84, 0xB0, 0x0D, 0xF1, 0x08, 0x0B, 0x00, 0x23},
+         {2, 2, 2, 4, 2}},
+        {"thumb cut by a 32-bit instruction", ini::TargetArch::Arm,
+         {0x10, 0xB5, 0x04, 0x46, 0x00, 0xF0, 0x10, 0xF8, 0x20, 0x46, 0x10, 0xBD},
+         {2, 2, 4, 2, 2}},
+    };
+    return corpus;
+}
+
+void check_lengths() {
+    for (const auto& p : prologues()) {
+        std::size_t at = 0;
+        for (const std::size_t expected : p.lengths) {
+            assert(rdpwrap::hook::instruction_length(p.bytes.data() + at, p.bytes.size() - at, p.arch) == expected);
+            // One byte short of the instruction, it does not decode.
+            assert(rdpwrap::hook::instruction_length(p.bytes.data() + at, expected - 1, p.arch) == 0);
+            at += expected;
+        }
+        assert(at == p.bytes.size());
+
+        // Every boundary is its own boundary; a length between two is
+        // rounded up to the next.
+        std::size_t boundary = 0;
+        for (const std::size_t length : p.lengths) {
+            for (std::size_t min = boundary + 1; min <= boundary + length; ++min) {
+                assert(rdpwrap::hook::instruction_boundary(p.bytes.data(), p.bytes.size(), p.arch, min) ==
+                       boundary + length);
+            }
+            boundary += length;
+        }
+        assert(rdpwrap::hook::instruction_boundary(p.bytes.data(), p.bytes.size(), p.arch, boundary + 1) == 0);
+    }
+
+    assert(rdpwrap::hook::thumb2_length(0xB580) == 2);  // push {r7, lr}
+    assert(rdpwrap::hook::thumb2_length(0x4770) == 2);  // bx lr
+    assert(rdpwrap::hook::thumb2_length(0xBF00) == 2);  // nop
+    assert(rdpwrap::hook::thumb2_length(0xE92D) == 4);  // push.w
+    assert(rdpwrap::hook::thumb2_length(0xF000) == 4);  // b.w/bl
+    assert(rdpwrap::hook::thumb2_length(0xF8DF) == 4);  // ldr.w
+    assert(rdpwrap::hook::thumb2_length(0xE7FE) == 2);  // b . (16-bit, 11100)
+    const std::uint8_t x64_undecodable[] = {0x06, 0x90};
+    assert(rdpwrap::hook::instruction_length(x64_undecodable, sizeof(x64_undecodable), ini::TargetArch::X64) == 0);
+    assert(rdpwrap::hook::instruction_length(x64_undecodable, sizeof(x64_undecodable), ini::TargetArch::X86) == 1);
+    assert(rdpwrap::hook::instruction_boundary(x64_undecodable, sizeof(x64_undecodable), ini::TargetArch::X64, 1) == 0);
+}
+
+// Every SLPolicy/SLInit jump rdpwrap-arm-kb.ini plans, against each
+// prologue of its architecture at that site, as Hook() would choose: a
+// branch to the wrapper when it is near, through a thunk near the site
+// when not, the absolute jump when no thunk could be placed.
+void check_corpus_sites(const std::string& corpus) {
+    ini::Parser p(wrapper_options());
+    p.read_string(read_all(corpus + "/rdpwrap-arm-kb.ini"));
+    const struct {
+        ini::TargetArch arch;
+        std::uint64_t base;
+        std::size_t farjmp;
+    } archs[] = {
+        {ini::TargetArch::Arm, 0x00F80000, 8},
+        {ini::TargetArch::Arm64, 0x7FF712340000, 16},
+    };
+
+    std::size_t sites = 0;
+    for (const auto& a : archs) {
+        for (const auto& section : p.sections()) {
+            const auto version = ini::parse_version(section);
+            if (!version) {
+                continue;
+            }
+            const auto plan = rdpwrap::hook::build_hook_plan(p, *version, a.arch, 0x200000, a.farjmp);
+            for (const auto& jump : plan.jumps) {
+                const std::uint64_t site = a.base + jump.offset;
+                assert(jump.offset % (a.arch == ini::TargetArch::Arm64 ? 4 : 2) == 0);
+                for (const auto& prologue : prologues()) {
+                    if (prologue.arch != a.arch) {
+                        continue;
+                    }
+                    const std::uint8_t* code = prologue.bytes.data();
+                    const std::size_t size = prologue.bytes.size();
+                    const std::uint64_t near_target = site + 0x100000;
+                    const std::uint64_t far_target = site + 0x40000000;
+                    const std::uint64_t thunk = site - 0x10000 - jump.offset;
+
+                    auto j = rdpwrap::hook::plan_hook_jump(a.arch, code, size, site, near_target, 0, a.farjmp);
+                    assert(j.route == rdpwrap::hook::JumpRoute::Branch && j.size == 4);
+                    assert(j.patched == rdpwrap::hook::instruction_boundary(code, size, a.arch, 4));
+
+                    j = rdpwrap::hook::plan_hook_jump(a.arch, code, size, site, far_target, thunk, a.farjmp);
+                    assert(j.route == rdpwrap::hook::JumpRoute::Thunk && j.size == 4);
+
+                    j = rdpwrap::hook::plan_hook_jump(a.arch, code, size, site, far_target, 0, a.farjmp);
+                    assert(j.route == rdpwrap::hook::JumpRoute::Absolute && j.size == a.farjmp);
+                    assert(j.patched >= a.farjmp && j.patched < a.farjmp + 4);
+                    assert(j.patched == rdpwrap::hook::instruction_boundary(code, size, a.arch, a.farjmp));
+                    ++sites;
+                }
+            }
+        }
+    }
+    assert(sites > 0);
+    (void)sites;
+}
+
+}  // namespace
+
+int main() {
+    check_lengths();
+    check_corpus_sites(RDPWRAP_HOOK_CORPUS_DIR);
+    std::cout << "instruction_length_test passed\n";
+    return 0;
+}
@@ -0,0 +1,410 @@
+#include "rdpwrap/hook/patch_transaction.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+
+int main() {
+    std::cout << "patch_transaction_test skipped (mprotect backend)\n";
+    return 0;
+}
+
+#else
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+// An anonymous mapping standing in for a loaded module, with the
+// protection of every page tracked so that the test can see what the
+// transaction left behind. Read-only pages play the code section; writes
+// through write() to a page that was not made writable crash the test.
+class ImageMemory : public rdpwrap::hook::PatchMemory {
+public:
+    explicit ImageMemory(std::size_t pages)
+        : page_(static_cast<std::size_t>(sysconf(_SC_PAGESIZE))), protections_(pages, PROT_READ) {
+        void* p = mmap(nullptr, pages * page_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        assert(p != MAP_FAILED);
+        base_ = static_cast<unsigned char*>(p);
+        for (std::size_t i = 0; i < pages * page_; ++i) {
+            base_[i] = static_cast<unsigned char>(i * 7 + 3);
+        }
+        const int rc = mprotect(base_, pages * page_, PROT_READ);
+        assert(rc == 0);
+        (void)rc;
+    }
+    ~ImageMemory() override { munmap(base_, protections_.size() * page_); }
+
+    std::uintptr_t at(std::size_t offset) const { return reinterpret_cast<std::uintptr_t>(base_) + offset; }
+    std::string bytes() const {
+        return std::string(reinterpret_cast<const char*>(base_), protections_.size() * page_);
+    }
+    // Gives page `index` a protection of its own, e.g. a data page.
+    void set_page(std::size_t index, int protection) {
+        const int rc = mprotect(base_ + index * page_, page_, protection);
+        assert(rc == 0);
+        (void)rc;
+        protections_[index] = protection;
+    }
+    const std::vector<int>& protections() const { return protections_; }
+
+    std::size_t page_size() const noexcept override { return page_; }
+
+    bool protection(std::uintptr_t page, std::uint32_t& out) override {
+        ++queries;
+        out = static_cast<std::uint32_t>(protections_[index_of(page)]);
+        return true;
+    }
+
+    bool make_writable(std::uintptr_t addr, std::size_t size) override {
+        ++unprotects;
+        if (fail_unprotect_at == addr) {
+            return false;
+        }
+        return set(addr, size, PROT_READ | PROT_WRITE);
+    }
+
+    bool restore(std::uintptr_t addr, std::size_t size, std::uint32_t protection) override {
+        ++restores;
+        return set(addr, size, static_cast<int>(protection));
+    }
+
+    bool read(std::uintptr_t addr, void* out, std::size_t size) override {
+        ++reads;
+        std::memcpy(out, reinterpret_cast<const void*>(addr), size);
+        return true;
+    }
+
+    bool write(std::uintptr_t addr, const void* data, std::size_t size) override {
+        ++writes;
+        if (fail_write_at == addr && fail_write_countdown-- == 0) {
+            // Half of it lands before the failure.
+            std::memcpy(reinterpret_cast<void*>(addr), data, size / 2);
+            return false;
+        }
+        std::memcpy(reinterpret_cast<void*>(addr), data, size);
+        return true;
+    }
+
+    void flush_instructions(std::uintptr_t addr, std::size_t size) override {
+        ++flushes;
+        flushed.push_back({addr, size});
+    }
+
+    int queries = 0;
+    int reads = 0;
+    int unprotects = 0;
+    int restores = 0;
+    int writes = 0;
+    int flushes = 0;
+    std::vector<std::pair<std::uintptr_t, std::size_t>> flushed;
+    std::uintptr_t fail_unprotect_at = 0;
+    std::uintptr_t fail_write_at = 0;
+    int fail_write_countdown = 0;  // matching writes to let through first
+
+private:
+    std::size_t index_of(std::uintptr_t addr) const {
+        assert(addr % page_ == 0);
+        return (addr - reinterpret_cast<std::uintptr_t>(base_)) / page_;
+    }
+
+    bool set(std::uintptr_t addr, std::size_t size, int protection) {
+        assert(size % page_ == 0);
+        if (mprotect(reinterpret_cast<void*>(addr), size, protection) != 0) {
+            return false;
+        }
+        for (std::size_t i = 0; i < size / page_; ++i) {
+            protections_[index_of(addr) + i] = protection;
+        }
+        return true;
+    }
+
+    std::size_t page_;
+    std::vector<int> protections_;
+    unsigned char* base_ = nullptr;
+};
+
+void reset_counts(ImageMemory& m) {
+    m.queries = m.reads = m.unprotects = m.restores = m.writes = m.flushes = 0;
+    m.flushed.clear();
+}
+
+void queue(rdpwrap::hook::PatchTransaction& t, std::uintptr_t addr, const char* bytes, std::size_t size) {
+    const bool ok = t.write(addr, bytes, size);
+    assert(ok);
+    (void)ok;
+}
+
+void reject(rdpwrap::hook::PatchTransaction& t, std::uintptr_t addr, const char* bytes, std::size_t size) {
+    const bool ok = t.write(addr, bytes, size);
+    assert(!ok);
+    (void)ok;
+}
+
+void put(std::string& image, std::size_t offset, const std::string& bytes) {
+    image.replace(offset, bytes.size(), bytes);
+}
+
+}  // namespace
+
+int main() {
+    bool ok = false;
+
+    // LocalOnly, SingleUser and DefPolicy on one page: one protection flip
+    // there and back, one flush; touching writes merge into one extent.
+    {
+        ImageMemory m(4);
+        const std::string before = m.bytes();
+        const std::vector<int> protections = m.protections();
+        rdpwrap::hook::PatchTransaction t(m);
+        queue(t, m.at(0x100), "\x90\x90", 2);
+        queue(t, m.at(0x102), "\xEB", 1);
+        queue(t, m.at(0x300), "\x31\xC0\xC3", 3);
+        assert(t.size() == 3);
+        ok = t.commit();
+        assert(ok);
+        assert(t.committed());
+        assert(t.extent_count() == 2);
+        assert(t.page_run_count() == 1);
+        assert(m.unprotects == 1 && m.restores == 1 && m.writes == 2 && m.flushes == 1);
+        assert(m.protections() == protections);
+
+        std::string expected = before;
+        put(expected, 0x100, "\x90\x90\xEB");
+        put(expected, 0x300, "\x31\xC0\xC3");
+        assert(m.bytes() == expected);
+
+        reset_counts(m);
+        ok = t.rollback();
+        assert(ok);
+        assert(!t.committed());
+        assert(m.bytes() == before);
+        assert(m.unprotects == 1 && m.restores == 1 && m.flushes == 1);
+        assert(m.protections() == protections);
+        ok = t.rollback();
+        assert(!ok);
+    }
+
+    // Page runs: neighbouring pages of one protection share a call, a gap
+    // or a different protection starts another, and a write across a page
+    // boundary covers both pages.
+    {
+        ImageMemory m(8);
+        m.set_page(5, PROT_READ | PROT_WRITE);
+        const std::size_t page = m.page_size();
+        const std::vector<int> protections = m.protections();
+        rdpwrap::hook::PatchTransaction t(m);
+        queue(t, m.at(page - 2), "\x01\x02\x03\x04", 4);  // pages 0 and 1
+        queue(t, m.at(page * 3 + 8), "\x05", 1);         // page 3
+        queue(t, m.at(page * 4 + 8), "\x06", 1);         // page 4
+        queue(t, m.at(page * 5 + 8), "\x07", 1);         // page 5, data
+        ok = t.commit();
+        assert(ok);
+        assert(t.extent_count() == 4);
+        assert(t.page_run_count() == 3);  // 0-1, 3-4, 5
+        // Pages 3 to 5 are flushed together, apart from 0-1 across the gap.
+        assert(m.unprotects == 3 && m.restores == 3 && m.flushes == 2);
+        assert(m.flushed[0].first == m.at(page - 2) && m.flushed[0].second == 4);
+        assert(m.flushed[1].first == m.at(page * 3 + 8) && m.flushed[1].second == page * 2 + 1);
+        assert(m.queries == 5);
+        assert(m.protections() == protections);
+    }
+
+    // Overlapping writes: the later one wins, in queue order rather than
+    // address order.
+    {
+        ImageMemory m(2);
+        std::string expected = m.bytes();
+        rdpwrap::hook::PatchTransaction t(m);
+        queue(t, m.at(0x10), "AAAAAAAA", 8);
+        queue(t, m.at(0x0C), "BBBBBB", 6);
+        queue(t, m.at(0x14), "CC", 2);
+        ok = t.commit();
+        assert(ok);
+        assert(t.extent_count() == 1);
+        put(expected, 0x0C, "BBBBBBAACCAA");
+        assert(m.bytes() == expected);
+        reject(t, m.at(0), "x", 1);  // already committed
+    }
+
+    // A write failing part way: everything written so far, the failed
+    // extent included, is put back and every page gets its protection back.
+    {
+        ImageMemory m(6);
+        m.set_page(2, PROT_READ | PROT_WRITE);
+        const std::size_t page = m.page_size();
+        const std::string before = m.bytes();
+        const std::vector<int> protections = m.protections();
+        rdpwrap::hook::PatchTransaction t(m);
+        queue(t, m.at(0x40), "\x11\x22\x33\x44", 4);
+        queue(t, m.at(page * 2 + 0x40), "\x55\x66\x77\x88", 4);
+        queue(t, m.at(page * 4 + 0x40), "\x99\xAA\xBB\xCC", 4);
+        m.fail_write_at = m.at(page * 2 + 0x40);
+        ok = t.commit();
+        assert(!ok);
+        assert(!t.committed());
+        assert(t.failed_address() == m.at(page * 2 + 0x40));
+        assert(m.bytes() == before);
+        assert(m.protections() == protections);
+        assert(m.unprotects == 3 && m.restores == 3 && m.flushes == 2);
+
+        // Fixed, the same transaction commits.
+        m.fail_write_at = 0;
+        ok = t.commit();
+        assert(ok);
+        assert(t.failed_address() == 0);
+        assert(m.bytes() != before);
+        ok = t.rollback();
+        assert(ok);
+        assert(m.bytes() == before);
+    }
+
+    // A page that cannot be made writable: nothing is written, the runs
+    // opened before it are closed again.
+    {
+        ImageMemory m(6);
+        const std::size_t page = m.page_size();
+        const std::string before = m.bytes();
+        const std::vector<int> protections = m.protections();
+        rdpwrap::hook::PatchTransaction t(m);
+        queue(t, m.at(0x10), "\x01", 1);
+        queue(t, m.at(page * 3 + 0x10), "\x02", 1);
+        m.fail_unprotect_at = m.at(page * 3);
+        ok = t.commit();
+        assert(!ok);
+        assert(t.failed_address() == m.at(page * 3));
+        assert(m.writes == 0 && m.flushes == 0);
+        assert(m.unprotects == 2 && m.restores == 1);
+        assert(m.bytes() == before);
+        assert(m.protections() == protections);
+    }
+
+    // A rollback failing part way leaves the patch in place.
+    {
+        ImageMemory m(4);
+        const std::size_t page = m.page_size();
+        rdpwrap::hook::PatchTransaction t(m);
+        queue(t, m.at(0x20), "\xAA\xBB", 2);
+        queue(t, m.at(page * 2 + 0x20), "\xCC\xDD", 2);
+        ok = t.commit();
+        assert(ok);
+        const std::string patched = m.bytes();
+        m.fail_write_at = m.at(page * 2 + 0x20);
+        ok = t.rollback();
+        assert(!ok);
+        assert(t.committed());
+        assert(m.bytes() == patched);
+    }
+
+    // prepare() does the lookups and reads up front; commit() then only
+    // flips protections and writes. A write queued after it prepares again.
+    {
+        ImageMemory m(4);
+        const std::size_t page = m.page_size();
+        rdpwrap::hook::PatchTransaction t(m);
+        queue(t, m.at(0x10), "\x01\x02", 2);
+        queue(t, m.at(page * 2 + 0x10), "\x03", 1);
+        ok = t.prepare();
+        assert(ok);
+        assert(m.queries == 2 && m.reads == 2);
+        assert(m.unprotects == 0 && m.writes == 0);
+        reset_counts(m);
+        ok = t.commit();
+        assert(ok);
+        assert(m.queries == 0 && m.reads == 0);
+        assert(m.unprotects == 2 && m.writes == 2 && m.restores == 2 && m.flushes == 2);
+
+        rdpwrap::hook::PatchTransaction u(m);
+        queue(u, m.at(0x10), "\x04", 1);
+        ok = u.prepare();
+        assert(ok);
+        queue(u, m.at(page * 3), "\x05", 1);
+        reset_counts(m);
+        ok = u.commit();
+        assert(ok);
+        assert(m.queries == 2 && m.reads == 2);
+        assert(u.extent_count() == 2);
+        ok = u.prepare();
+        assert(!ok);  // already committed
+    }
+
+    // Rejected writes and the empty transaction.
+    {
+        ImageMemory m(1);
+        rdpwrap::hook::PatchTransaction t(m);
+        reject(t, 0, "x", 1);
+        reject(t, m.at(0), nullptr, 1);
+        reject(t, m.at(0), "x", 0);
+        reject(t, UINTPTR_MAX - 1, "xyz", 3);
+        assert(t.empty());
+        ok = t.commit();
+        assert(ok);
+        assert(m.queries == 0 && m.unprotects == 0 && m.writes == 0 && m.flushes == 0);
+        ok = t.rollback();
+        assert(ok);
+    }
+
+    // Random writes against a plain byte array.
+    {
+        std::mt19937 rng(21);
+        for (int round = 0; round < 200; ++round) {
+            ImageMemory m(6);
+            if (round % 3 == 0) {
+                m.set_page(rng() % 6, PROT_READ | PROT_WRITE);
+            }
+            const std::string before = m.bytes();
+            const std::vector<int> protections = m.protections();
+            std::string expected = before;
+            rdpwrap::hook::PatchTransaction t(m);
+            const int count = 1 + static_cast<int>(rng() % 12);
+            std::vector<std::size_t> offsets;
+            for (int i = 0; i < count; ++i) {
+                const std::size_t size = 1 + rng() % 24;
+                const std::size_t offset = rng() % (before.size() - size);
+                std::string bytes(size, '\0');
+                for (auto& c : bytes) {
+                    c = static_cast<char>(rng());
+                }
+                queue(t, m.at(offset), bytes.data(), bytes.size());
+                put(expected, offset, bytes);
+                offsets.push_back(offset);
+            }
+            // Fails the commit when the chosen write starts an extent, one
+            // round in four.
+            const bool fail = round % 4 == 1;
+            if (fail) {
+                m.fail_write_at = m.at(offsets[rng() % offsets.size()]);
+            }
+            ok = t.commit();
+            assert(m.protections() == protections);
+            assert(static_cast<std::size_t>(m.flushes) <= t.extent_count());
+            for (const auto& range : m.flushed) {
+                assert(range.first >= m.at(0) && range.first + range.second <= m.at(before.size()));
+            }
+            if (fail && !ok) {
+                assert(m.bytes() == before);
+                continue;
+            }
+            assert(ok);
+            assert(m.bytes() == expected);
+            assert(static_cast<std::size_t>(m.unprotects) == t.page_run_count());
+            assert(static_cast<std::size_t>(m.writes) == t.extent_count());
+            ok = t.rollback();
+            assert(ok);
+            assert(m.bytes() == before);
+            assert(m.protections() == protections);
+        }
+    }
+
+    std::cout << "patch_transaction_test passed\n";
+    return 0;
+}
+
+#endif
@@ -0,0 +1,306 @@
+#include "rdpwrap/hook/thread_freeze.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A process's threads as a table: which exist, how often each is
+// suspended, which handles are open. Threads can exit between being listed
+// and being suspended, and new ones can start while suspend() runs.
+class FakeThreads : public rdpwrap::hook::ThreadControl {
+public:
+    struct State {
+        int suspend_count = 0;
+        bool alive = true;
+    };
+
+    explicit FakeThreads(std::uint32_t count) {
+        for (std::uint32_t id = 1; id <= count; ++id) {
+            threads[id * 4] = {};
+        }
+    }
+
+    void start(std::uint32_t id) { threads[id] = {}; }
+
+    bool list_threads(rdpwrap::hook::ThreadList& out) override {
+        ++process_lists;
+        if (!per_process) {
+            return false;
+        }
+        append(out);
+        return true;
+    }
+
+    bool list_threads_snapshot(rdpwrap::hook::ThreadList& out) override {
+        ++snapshot_lists;
+        if (!snapshot) {
+            return false;
+        }
+        append(out);
+        return true;
+    }
+
+    bool suspend(const Thread& thread) override {
+        check_open(thread);
+        ++suspends;
+        if (on_suspend) {
+            on_suspend(thread.id);
+        }
+        auto& t = threads.at(thread.id);
+        if (!t.alive) {
+            return false;
+        }
+        ++t.suspend_count;
+        return true;
+    }
+
+    bool resume(const Thread& thread) override {
+        check_open(thread);
+        ++resumes;
+        auto& t = threads.at(thread.id);
+        assert(t.suspend_count > 0);
+        --t.suspend_count;
+        return true;
+    }
+
+    void close(const Thread& thread) override {
+        check_open(thread);
+        open.erase(thread.handle);
+    }
+
+    std::map<std::uint32_t, State> threads;
+    std::set<std::uintptr_t> open;
+    std::function<void(std::uint32_t)> on_suspend;
+    bool per_process = true;
+    bool snapshot = true;
+    int process_lists = 0;
+    int snapshot_lists = 0;
+    int suspends = 0;
+    int resumes = 0;
+
+private:
+    void append(rdpwrap::hook::ThreadList& out) {
+        const std::size_t capacity = out.capacity();
+        for (const auto& [id, state] : threads) {
+            if (state.alive && out.push_back({id, ++next_handle_})) {
+                open.insert(next_handle_);
+            }
+        }
+        // Full or not, the list never grew.
+        assert(out.capacity() == capacity);
+        (void)capacity;
+    }
+
+    void check_open(const Thread& thread) const {
+        assert(open.count(thread.handle) == 1);
+        (void)thread;
+    }
+
+    std::uintptr_t next_handle_ = 0x100;
+};
+
+bool all_suspended(const FakeThreads& f, int count) {
+    for (const auto& [id, state] : f.threads) {
+        if (state.alive && state.suspend_count != count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main() {
+    bool ok = false;
+
+    // Per-process listing: every thread suspended once, a second pass finds
+    // nothing new, thaw resumes them all and closes every handle.
+    {
+        FakeThreads f(50);
+        rdpwrap::hook::ThreadFreeze freeze(f);
+        ok = freeze.freeze();
+        assert(ok);
+        assert(freeze.frozen());
+        assert(freeze.suspended() == 50 && freeze.failed() == 0);
+        assert(freeze.passes() == 2);
+        assert(!freeze.used_snapshot());
+        assert(f.process_lists == 2 && f.snapshot_lists == 0);
+        assert(all_suspended(f, 1));
+        assert(f.open.size() == 50);  // the second pass's handles are closed
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        freeze.thaw();
+        assert(!freeze.frozen());
+        assert(all_suspended(f, 0));
+        assert(f.resumes == 50);
+        assert(f.open.empty());
+        assert(freeze.window() >= std::chrono::milliseconds(2));
+        // Nothing is listed to resume.
+        assert(f.process_lists == 2);
+
+        freeze.thaw();
+        assert(f.resumes == 50);
+    }
+
+    // No per-process listing: the snapshot is used for every pass.
+    {
+        FakeThreads f(10);
+        f.per_process = false;
+        rdpwrap::hook::ThreadFreeze freeze(f);
+        ok = freeze.freeze();
+        assert(ok);
+        assert(freeze.used_snapshot());
+        assert(freeze.suspended() == 10);
+        assert(f.process_lists == 1 && f.snapshot_lists == 2);
+        freeze.thaw();
+        assert(all_suspended(f, 0));
+        assert(f.open.empty());
+    }
+
+    // Neither: nothing happens.
+    {
+        FakeThreads f(3);
+        f.per_process = false;
+        f.snapshot = false;
+        rdpwrap::hook::ThreadFreeze freeze(f);
+        ok = freeze.freeze();
+        assert(!ok);
+        assert(!freeze.frozen());
+        assert(f.suspends == 0);
+        freeze.thaw();
+        assert(f.resumes == 0);
+    }
+
+    // A thread exiting before it is suspended is not resumed; one exiting
+    // while suspended is resumed as recorded.
+    {
+        FakeThreads f(6);
+        f.on_suspend = [&f](std::uint32_t id) {
+            if (id == 8) {
+                f.threads[8].alive = false;
+            }
+        };
+        rdpwrap::hook::ThreadFreeze freeze(f);
+        ok = freeze.freeze();
+        assert(ok);
+        assert(freeze.suspended() == 5 && freeze.failed() == 1);
+        f.threads[12].alive = false;
+        freeze.thaw();
+        assert(f.resumes == 5);
+        assert(f.threads[8].suspend_count == 0);
+        assert(f.threads[12].suspend_count == 0);
+        assert(f.open.empty());
+    }
+
+    // Threads started during the first pass are caught by the next one.
+    {
+        FakeThreads f(4);
+        f.on_suspend = [&f](std::uint32_t id) {
+            if (id == 4) {
+                f.start(100);
+                f.start(101);
+            }
+        };
+        rdpwrap::hook::ThreadFreeze freeze(f);
+        ok = freeze.freeze();
+        assert(ok);
+        assert(freeze.suspended() == 6);
+        assert(freeze.passes() == 3);
+        assert(all_suspended(f, 1));
+        freeze.thaw();
+        assert(all_suspended(f, 0));
+        assert(f.open.empty());
+    }
+
+    // A thread starting on every pass: listing stops after kMaxPasses.
+    {
+        FakeThreads f(2);
+        std::uint32_t next = 1000;
+        f.on_suspend = [&f, &next](std::uint32_t) { f.start(next++); };
+        rdpwrap::hook::ThreadFreeze freeze(f);
+        ok = freeze.freeze();
+        assert(ok);
+        assert(freeze.passes() == rdpwrap::hook::ThreadFreeze::kMaxPasses);
+        assert(freeze.suspended() == 2 * rdpwrap::hook::ThreadFreeze::kMaxPasses);  // each suspend starts one
+        freeze.thaw();
+        for (const auto& [id, state] : f.threads) {
+            assert(state.suspend_count == 0);
+            (void)id;
+        }
+        assert(f.open.empty());
+    }
+
+    // Freezing twice does nothing the second time; the destructor thaws.
+    {
+        FakeThreads f(5);
+        {
+            rdpwrap::hook::ThreadFreeze freeze(f);
+            ok = freeze.freeze();
+            assert(ok);
+            ok = freeze.freeze();
+            assert(!ok);
+            assert(freeze.frozen());
+            assert(all_suspended(f, 1));
+        }
+        assert(all_suspended(f, 0));
+        assert(f.open.empty());
+    }
+
+    // More threads than fit: the ones past kMaxThreads are left running and
+    // counted as failed, and every one suspended is resumed.
+    {
+        constexpr std::size_t kMax = rdpwrap::hook::ThreadFreeze::kMaxThreads;
+        FakeThreads f(static_cast<std::uint32_t>(kMax + 5));
+        rdpwrap::hook::ThreadFreeze freeze(f);
+        ok = freeze.freeze();
+        assert(ok);
+        assert(freeze.suspended() == kMax);
+        assert(freeze.failed() >= 5);
+        std::size_t running = 0;
+        for (const auto& [id, state] : f.threads) {
+            running += state.suspend_count == 0;
+            (void)id;
+        }
+        assert(running == 5);
+        freeze.thaw();
+        assert(all_suspended(f, 0));
+        assert(f.open.empty());
+    }
+
+    // ThreadList on its own.
+    {
+        rdpwrap::hook::ThreadList list(2);
+        const std::size_t capacity = list.capacity();
+        for (std::uint32_t id = 1; id <= capacity + 3; ++id) {
+            ok = list.push_back({id, id});
+            assert(ok == (id <= capacity));
+        }
+        assert(list.size() == capacity && list.dropped() == 3);
+        assert(list[0].id == 1);
+        list.truncate(1);
+        assert(list.size() == 1 && list.capacity() == capacity);
+        list.clear();
+        assert(list.empty() && list.dropped() == 0);
+    }
+
+    // No other threads at all.
+    {
+        FakeThreads f(0);
+        rdpwrap::hook::ThreadFreeze freeze(f);
+        ok = freeze.freeze();
+        assert(ok);
+        assert(freeze.suspended() == 0 && freeze.passes() == 1);
+        freeze.thaw();
+        assert(freeze.window().count() >= 0);
+    }
+
+    std::cout << "thread_freeze_test passed\n";
+    return 0;
+}
@@ -0,0 +1,342 @@
+#include "rdpwrap/hook/trampoline.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "rdpwrap/hook/instruction_length.hpp"
+
+#if !defined(_WIN32) && defined(__x86_64__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Bytes = std::vector<std::uint8_t>;
+
+struct Case {
+    Bytes bytes;
+    int length;  // 0: does not decode
+    rdpwrap::hook::X86Branch branch = rdpwrap::hook::X86Branch::None;
+    int rip_offset = 0;
+    bool ends_flow = false;
+};
+
+void check_decode(const Case& c, bool x64) {
+    rdpwrap::hook::X86Instruction insn;
+    const bool ok = rdpwrap::hook::decode_x86(c.bytes.data(), c.bytes.size(), x64, insn);
+    if (c.length == 0) {
+        assert(!ok);
+        return;
+    }
+    assert(ok);
+    assert(insn.length == c.length);
+    assert(insn.branch == c.branch);
+    assert(insn.rip_offset == c.rip_offset);
+    assert(insn.ends_flow == c.ends_flow);
+    // Cut short by a byte, the same instruction does not decode.
+    const bool truncated = rdpwrap::hook::decode_x86(c.bytes.data(), static_cast<std::size_t>(c.length) - 1, x64, insn);
+    assert(!truncated);
+    (void)ok;
+    (void)truncated;
+}
+
+void check_decoder() {
+    using B = rdpwrap::hook::X86Branch;
+    const Case x86[] = {
+        {{0x8B, 0xFF}, 2},                                      // mov edi, edi
+        {{0x55}, 1},                                            // push ebp
+        {{0x8B, 0xEC}, 2},                                      // mov ebp, esp
+        {{0x83, 0xEC, 0x10}, 3},                                // sub esp, 10h
+        {{0x81, 0xEC, 0x00, 0x01, 0x00, 0x00}, 6},              // sub esp, 100h
+        {{0x6A, 0x00}, 2},                                      // push 0
+        {{0x68, 0x78, 0x56, 0x34, 0x12}, 5},                    // push imm32
+        {{0x64, 0xA1, 0x18, 0x00, 0x00, 0x00}, 6},              // mov eax, fs:[18h]
+        {{0x8B, 0x45, 0x08}, 3},                                // mov eax, [ebp+8]
+        {{0x8B, 0x84, 0x24, 0x00, 0x01, 0x00, 0x00}, 7},        // mov eax, [esp+100h]
+        {{0x8B, 0x04, 0x25, 0x00, 0x10, 0x00, 0x00}, 7},        // mov eax, [disp32] via SIB
+        {{0x66, 0xB8, 0x34, 0x12}, 4},                          // mov ax, 1234h
+        {{0x40}, 1},                                            // inc eax
+        {{0x06}, 1},                                            // push es
+        {{0xE8, 0x10, 0x00, 0x00, 0x00}, 5, B::Call},
+        {{0x66, 0xE8, 0x10, 0x00}, 4, B::Call},                 // call rel16
+        {{0x0F, 0x84, 0x10, 0x00, 0x00, 0x00}, 6, B::ConditionalJump},
+        {{0xEB, 0xFE}, 2, B::Jump, 0, true},
+        {{0xC2, 0x08, 0x00}, 3, B::None, 0, true},              // ret 8
+        {{0xC8, 0x10, 0x00, 0x00}, 4},                          // enter 10h, 0
+        {{0xF6, 0x45, 0x08, 0x01}, 4},                          // test byte [ebp+8], 1
+        {{0xF7, 0xD8}, 2},                                      // neg eax
+        {{0xF7, 0xC1, 0x00, 0x00, 0x01, 0x00}, 6},              // test ecx, 10000h
+        {{0x67, 0x8B, 0x46, 0x08}, 4},                          // mov eax, [bp+8]
+        {{0x67, 0x8B, 0x06, 0x34, 0x12}, 5},                    // mov eax, [1234h]
+        {{0x0F, 0xB6, 0x45, 0x08}, 4},                          // movzx eax, byte [ebp+8]
+        {{0x0F, 0x1F, 0x44, 0x00, 0x00}, 5},                    // nop dword [eax+eax]
+        {{0x66, 0x0F, 0x38, 0x00, 0xC1}, 5},                    // pshufb xmm0, xmm1
+        {{0x66, 0x0F, 0x3A, 0x0F, 0xC1, 0x08}, 6},              // palignr xmm0, xmm1, 8
+        {{0xC5, 0xF8, 0x77}, 3},                                // vzeroupper
+        {{0xC4, 0xE2, 0x79, 0x18, 0x45, 0x08}, 6},              // vbroadcastss xmm0, [ebp+8]
+        {{0xC5, 0x45, 0x08}, 3},                                // lds eax, [ebp+8]
+        {{0xD9, 0xEE}, 2},                                      // fldz
+        {{0x9A, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00}, 7},        // call far
+        {{0xCC}, 1, B::None, 0, true},
+        {{0xD6}, 0},
+        {{0x0F, 0xA4, 0xC1}, 0},                                // shld without its imm8
+    };
+    for (const auto& c : x86) {
+        check_decode(c, false);
+    }
+
+    const Case x64[] = {
+        {{0x48, 0x89, 0x5C, 0x24, 0x08}, 5},                    // mov [rsp+8], rbx
+        {{0x48, 0x83, 0xEC, 0x28}, 4},                          // sub rsp, 28h
+        {{0x40, 0x53}, 2},                                      // push rbx
+        {{0x4C, 0x8B, 0xDC}, 3},                                // mov r11, rsp
+        {{0x48, 0x8B, 0x05, 0x10, 0x00, 0x00, 0x00}, 7, B::None, 3},  // mov rax, [rip+10h]
+        {{0x48, 0x8D, 0x0D, 0xF0, 0xFF, 0xFF, 0xFF}, 7, B::None, 3},  // lea rcx, [rip-10h]
+        {{0xC7, 0x05, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00}, 10, B::None, 2},
+        {{0xFF, 0x15, 0x10, 0x00, 0x00, 0x00}, 6, B::None, 2},  // call [rip+10h]
+        {{0xFF, 0x25, 0x10, 0x00, 0x00, 0x00}, 6, B::None, 2, true},
+        {{0xFF, 0xE0}, 2, B::None, 0, true},                    // jmp rax
+        {{0x41, 0xFF, 0xD3}, 3},                                // call r11
+        {{0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8}, 10},             // mov rax, imm64
+        {{0xB8, 1, 2, 3, 4}, 5},
+        {{0x66, 0xB8, 1, 2}, 4},
+        {{0x48, 0xC7, 0xC0, 1, 2, 3, 4}, 7},                    // mov rax, imm32
+        {{0x48, 0xA1, 1, 2, 3, 4, 5, 6, 7, 8}, 10},             // mov rax, [moffs64]
+        {{0x65, 0x48, 0x8B, 0x04, 0x25, 0x30, 0x00, 0x00, 0x00}, 9},  // mov rax, gs:[30h]
+        {{0x0F, 0x05}, 2},                                      // syscall
+        {{0x0F, 0x0B}, 2, B::None, 0, true},                    // ud2
+        {{0xC4, 0xE3, 0x79, 0x0F, 0xC1, 0x08}, 6},              // vpalignr
+        {{0xC5, 0xF8, 0x77}, 3},                                // vzeroupper
+        {{0xF3, 0xC3}, 2, B::None, 0, true},                    // rep ret
+        {{0x74, 0x05}, 2, B::ConditionalJump},
+        {{0xE3, 0x10}, 2, B::Loop},                             // jrcxz
+        {{0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x90}, 15},
+        {{0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x90}, 0},
+        {{0x62, 0xF1, 0x7C, 0x48, 0x10, 0x00}, 0},              // EVEX
+        {{0x06}, 0},                                            // push es
+        {{0x48}, 0},                                            // REX alone
+        {{0xC5, 0xF8}, 0},
+    };
+    for (const auto& c : x64) {
+        check_decode(c, true);
+    }
+}
+
+std::int64_t disp_at(const Bytes& code, std::size_t at, std::size_t size) {
+    if (size == 1) {
+        return static_cast<std::int8_t>(code[at]);
+    }
+    std::int32_t v = 0;
+    std::memcpy(&v, code.data() + at, sizeof(v));
+    return v;
+}
+
+// Walks the thunk and checks that every instruction refers to what the
+// matching original one did, and that it ends with a jump back.
+void check_equivalent(const Bytes& original,
+                      std::uint64_t from,
+                      const rdpwrap::hook::RelocatedPrologue& r,
+                      std::uint64_t to,
+                      bool x64) {
+    const std::uint64_t mask = x64 ? ~0ull : 0xFFFFFFFFull;
+    std::size_t a = 0;
+    std::size_t b = 0;
+    while (a < r.replaced) {
+        rdpwrap::hook::X86Instruction old_insn;
+        rdpwrap::hook::X86Instruction new_insn;
+        bool ok = rdpwrap::hook::decode_x86(original.data() + a, original.size() - a, x64, old_insn);
+        assert(ok);
+        ok = rdpwrap::hook::decode_x86(r.code.data() + b, r.code.size() - b, x64, new_insn);
+        assert(ok);
+        (void)ok;
+        assert(old_insn.branch == new_insn.branch);
+        if (old_insn.rel_size != 0) {
+            const std::uint64_t old_target =
+                (from + a + old_insn.length + disp_at(original, a + old_insn.rel_offset, old_insn.rel_size)) & mask;
+            const std::uint64_t new_target =
+                (to + b + new_insn.length + disp_at(r.code, b + new_insn.rel_offset, new_insn.rel_size)) & mask;
+            assert(new_insn.rel_size == 4);
+            assert(old_target == new_target);
+        } else if (old_insn.rip_offset != 0) {
+            assert(old_insn.length == new_insn.length);
+            const std::uint64_t old_target = from + a + old_insn.length + disp_at(original, a + old_insn.rip_offset, 4);
+            const std::uint64_t new_target = to + b + new_insn.length + disp_at(r.code, b + new_insn.rip_offset, 4);
+            assert(old_target == new_target);
+        } else {
+            assert(std::memcmp(original.data() + a, r.code.data() + b, old_insn.length) == 0);
+        }
+        a += old_insn.length;
+        b += new_insn.length;
+    }
+    assert(a == r.replaced);
+
+    const Bytes tail(r.code.begin() + static_cast<std::ptrdiff_t>(b), r.code.end());
+    if (x64) {
+        assert(tail.size() == 14);
+        assert(tail[0] == 0xFF && tail[1] == 0x25 && disp_at(tail, 2, 4) == 0);
+        std::uint64_t back = 0;
+        std::memcpy(&back, tail.data() + 6, sizeof(back));
+        assert(back == from + r.replaced);
+    } else {
+        assert(tail.size() == 5 && tail[0] == 0xE9);
+        assert(((to + b + 5 + disp_at(tail, 1, 4)) & mask) == ((from + r.replaced) & mask));
+    }
+    assert(r.code.size() <= rdpwrap::hook::kMaxThunkSize);
+    (void)mask;
+}
+
+rdpwrap::hook::RelocateStatus relocate(const Bytes& code, std::uint64_t from, std::uint64_t to, ini::TargetArch arch,
+                                       std::size_t min_length, rdpwrap::hook::RelocatedPrologue& out) {
+    Bytes padded = code;
+    padded.resize(rdpwrap::hook::kPrologueReadSize, 0xCC);
+    return rdpwrap::hook::relocate_prologue(padded.data(), padded.size(), from, to, arch, min_length, out);
+}
+
+// Prologues as found at the entry of SLGetWindowsInformationDWORD and of
+// the other exports of slc.dll the hook could land on.
+void check_relocation() {
+    using S = rdpwrap::hook::RelocateStatus;
+    rdpwrap::hook::RelocatedPrologue r;
+    S status;
+
+    // x86, hot-patchable: mov edi,edi / push ebp / mov ebp,esp / sub esp,10h.
+    // The 6-byte push/ret jump covers the first three and half the sub.
+    {
+        const Bytes code = {0x8B, 0xFF, 0x55, 0x8B, 0xEC, 0x83, 0xEC, 0x10, 0x53, 0x56};
+        status = relocate(code, 0x6BC41000, 0x00A30000, ini::TargetArch::X86, 6, r);
+        assert(status == S::Ok);
+        assert(r.replaced == 8);
+        assert(r.code.size() == 13);
+        check_equivalent(code, 0x6BC41000, r, 0x00A30000, false);
+    }
+
+    // x86 with a call and a short jcc, the thunk below the original so
+    // that the rel32 values wrap.
+    {
+        const Bytes code = {0x8B, 0xFF, 0x55, 0x8B, 0xEC, 0x75, 0x10, 0xE8, 0x00, 0x01, 0x00, 0x00};
+        status = relocate(code, 0x00401000, 0xFFFF0000, ini::TargetArch::X86, 6, r);
+        assert(status == S::Ok);
+        assert(r.replaced == 7);
+        assert(r.code[5] == 0x0F && r.code[6] == 0x85);  // jnz rel8 -> jnz rel32
+        check_equivalent(code, 0x00401000, r, 0xFFFF0000, false);
+    }
+
+    // x64: mov [rsp+8],rbx / mov [rsp+10h],rsi / push rdi / sub rsp,20h.
+    {
+        const Bytes code = {0x48, 0x89, 0x5C, 0x24, 0x08, 0x48, 0x89, 0x74, 0x24, 0x10,
+                            0x57, 0x48, 0x83, 0xEC, 0x20, 0x48, 0x8B, 0xF2};
+        status = relocate(code, 0x7FFB12340000, 0x7FFB10000000, ini::TargetArch::X64, 12, r);
+        assert(status == S::Ok);
+        assert(r.replaced == 15);
+        assert(r.code.size() == 15 + 14);
+        check_equivalent(code, 0x7FFB12340000, r, 0x7FFB10000000, true);
+    }
+
+    // x64: mov rax,rsp then RIP-relative loads, a call and a short je, the
+    // thunk 1 GiB below.
+    {
+        const Bytes code = {0x48, 0x8B, 0xC4,                          // mov rax, rsp
+                            0x48, 0x8B, 0x0D, 0x00, 0x20, 0x00, 0x00,  // mov rcx, [rip+2000h]
+                            0x74, 0x20,                                // je +20h
+                            0xE8, 0x00, 0x10, 0x00, 0x00,              // call +1000h
+                            0x90};
+        status = relocate(code, 0x7FFB52340000, 0x7FFB12340000, ini::TargetArch::X64, 16, r);
+        assert(status == S::Ok);
+        assert(r.replaced == 17);
+        check_equivalent(code, 0x7FFB52340000, r, 0x7FFB12340000, true);
+
+        // 3 GiB away the RIP-relative load cannot reach.
+        status = relocate(code, 0x7FFB52340000, 0x7FFA92340000, ini::TargetArch::X64, 16, r);
+        assert(status == S::OutOfReach);
+    }
+
+    // An x64 prologue ending in a jmp: nothing to jump back to.
+    {
+        const Bytes code = {0x48, 0x83, 0xEC, 0x28, 0x48, 0x8B, 0xC1, 0x33, 0xD2, 0xE9, 0x00, 0x01, 0x00, 0x00};
+        status = relocate(code, 0x10000000, 0x10010000, ini::TargetArch::X64, 12, r);
+        assert(status == S::Ok);
+        assert(r.replaced == 14);
+        assert(r.code.size() == 14);
+    }
+
+    // What cannot be relocated.
+    status = relocate({0x33, 0xC0, 0xC3}, 0x10000000, 0x10010000, ini::TargetArch::X64, 12, r);
+    assert(status == S::TooShort);
+    status = relocate({0x48, 0x85, 0xC9, 0x74, 0x02, 0x33, 0xC0, 0x48, 0x83, 0xEC, 0x28}, 0x10000000, 0x10010000,
+                      ini::TargetArch::X64, 12, r);
+    assert(status == S::BranchIntoPrologue);
+    status = relocate({0x48, 0x85, 0xC9, 0xE3, 0x10}, 0x10000000, 0x10010000, ini::TargetArch::X64, 12, r);
+    assert(status == S::Unsupported);
+    status = relocate({0x8B, 0xFF, 0x66, 0xE9, 0x00, 0x10}, 0x10000000, 0x10010000, ini::TargetArch::X86, 6, r);
+    assert(status == S::Unsupported);
+    status = relocate({0x48, 0x83, 0xEC, 0x28, 0x06}, 0x10000000, 0x10010000, ini::TargetArch::X64, 12, r);
+    assert(status == S::Undecodable);
+    status = relocate({0x08, 0xB5, 0x00, 0xAF}, 0x10000000, 0x10010000, ini::TargetArch::Arm, 8, r);
+    assert(status == S::Unsupported);
+    assert(r.code.empty() && r.replaced == 0);
+    assert(rdpwrap::hook::relocate_status_name(S::OutOfReach) == "out of reach");
+    (void)status;
+}
+
+#if !defined(_WIN32) && defined(__x86_64__)
+// Runs a relocated x64 prologue. The function computes
+// f(x) = k + x, plus 1 unless that is zero, with k loaded RIP-relative,
+// and its first bytes are overwritten with int3 after relocation, so only
+// the thunk can be running them.
+void check_execution() {
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    void* p = mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(p != MAP_FAILED);
+    auto* original = static_cast<std::uint8_t*>(p);
+    std::uint8_t* thunk = original + page;
+
+    const Bytes code = {0x48, 0x8B, 0x05, 0x39, 0x00, 0x00, 0x00,  // mov rax, [rip+39h] (k at +64)
+                        0x48, 0x01, 0xF8,                          // add rax, rdi
+                        0x74, 0x03,                                // je +3
+                        0x48, 0xFF, 0xC0,                          // inc rax
+                        0xC3};                                     // ret
+    std::memcpy(original, code.data(), code.size());
+    const std::int64_t k = 100;
+    std::memcpy(original + 64, &k, sizeof(k));
+
+    rdpwrap::hook::RelocatedPrologue r;
+    const auto status =
+        rdpwrap::hook::relocate_prologue(original, rdpwrap::hook::kPrologueReadSize,
+                                         reinterpret_cast<std::uintptr_t>(original),
+                                         reinterpret_cast<std::uintptr_t>(thunk), ini::TargetArch::X64, 12, r);
+    assert(status == rdpwrap::hook::RelocateStatus::Ok);
+    assert(r.replaced == 12);
+    std::memcpy(thunk, r.code.data(), r.code.size());
+    std::memset(original, 0xCC, r.replaced);
+
+    if (mprotect(p, 2 * page, PROT_READ | PROT_EXEC) != 0) {
+        std::cout << "trampoline_test: executable mappings not allowed, not running the thunk\n";
+    } else {
+        using Fn = std::int64_t (*)(std::int64_t);
+        const auto fn = reinterpret_cast<Fn>(thunk);
+        const std::int64_t a = fn(5);
+        const std::int64_t b = fn(-100);
+        assert(a == 106);
+        assert(b == 0);
+        (void)a;
+        (void)b;
+    }
+    munmap(p, 2 * page);
+    (void)status;
+}
+#else
+void check_execution() {}
+#endif
+
+}  // namespace
+
+int main() {
+    check_decoder();
+    check_relocation();
+    check_execution();
+    std::cout << "trampoline_test passed\n";
+    return 0;
+}
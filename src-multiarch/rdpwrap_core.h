@@ -6,6 +6,8 @@
 #include <string>
 
 #include "cpp_configparser/include/ini/parser.hpp"
+#include "hook/include/rdpwrap/hook/patch_transaction.hpp"
+#include "hook/include/rdpwrap/hook/thread_freeze.hpp"
 
 typedef HRESULT(WINAPI* SLGETWINDOWSINFORMATIONDWORD)(PWSTR pwszValueName,
                                                       DWORD* pdwValue);
@@ -82,8 +84,6 @@ static_assert(alignof(FARJMP) == 1, "ARM32 FARJMP must be byte-packed");
 #error Unsupported architecture.
 #endif
 
-extern FARJMP Old_SLGetWindowsInformationDWORD;
-extern FARJMP Stub_SLGetWindowsInformationDWORD;
 extern SLGETWINDOWSINFORMATIONDWORD _SLGetWindowsInformationDWORD;
 
 extern ini::Parser* g_IniParser;
@@ -96,30 +96,6 @@ extern SERVICEMAIN _ServiceMain;
 extern SVCHOSTPUSHSERVICEGLOBALS _SvchostPushServiceGlobals;
 extern LONG AlreadyHooked;
 
-std::string IniGetRaw(const ini::Parser& parser,
-                      const char* sect,
-                      const char* key,
-                      const char* def_val);
-PLATFORM_DWORD INIReadDWordHex(const ini::Parser& parser,
-                               const char* sect,
-                               const char* key,
-                               PLATFORM_DWORD def_val);
-void INIReadString(const ini::Parser& parser,
-                   const char* sect,
-                   const char* key,
-                   const char* def_val,
-                   char* ret,
-                   DWORD ret_size);
-bool GetBoolFromIni(const ini::Parser& parser,
-                    const char* sect,
-                    const char* key,
-                    bool def_val);
-bool GetByteArrayFromIni(const ini::Parser& parser,
-                         const char* sect,
-                         const char* key,
-                         char* out_buf,
-                         BYTE& out_size,
-                         BYTE max_len);
 bool WideToAnsi(const wchar_t* src, char* dst, size_t dst_size);
 
 void WriteToLog(const char* text);
@@ -129,9 +105,19 @@ HMODULE GetCurrentModule();
 bool GetModuleCodeSectionInfo(HMODULE hModule,
                               PLATFORM_DWORD* base_addr,
                               PLATFORM_DWORD* base_size);
-bool PatchMemoryWrite(LPVOID addr, LPCVOID data, SIZE_T size);
+// This process's memory, for rdpwrap::hook::PatchTransaction.
+rdpwrap::hook::PatchMemory& ProcessPatchMemory();
+// Logs the failures ProcessPatchMemory() recorded; call with no thread
+// suspended.
+void LogPatchMemoryErrors();
 bool PatchMemoryRead(LPVOID addr, LPVOID buf, SIZE_T size);
-void SetThreadsState(bool resume);
+// Memory for a thunk within `reach` bytes of near_addr, anywhere when reach
+// is 0. Filled and made executable (and no longer writable) by SealThunk().
+LPVOID AllocateThunk(LPCVOID near_addr, SIZE_T size, ULONG_PTR reach);
+bool SealThunk(LPVOID thunk, LPCVOID code, SIZE_T size);
+void FreeThunk(LPVOID thunk);
+// The other threads of this process, for rdpwrap::hook::ThreadFreeze.
+rdpwrap::hook::ThreadControl& ProcessThreadControl();
 BOOL __stdcall GetModuleVersion(LPCWSTR lptstrModuleName,
                                 FILE_VERSION* file_version);
 BOOL __stdcall GetFileVersion(LPCWSTR lptstrFilename, FILE_VERSION* file_version);
@@ -2,8 +2,6 @@
 
 #include "rdpwrap_core.h"
 
-FARJMP Old_SLGetWindowsInformationDWORD = {};
-FARJMP Stub_SLGetWindowsInformationDWORD = {};
 SLGETWINDOWSINFORMATIONDWORD _SLGetWindowsInformationDWORD = nullptr;
 
 ini::Parser* g_IniParser = nullptr;
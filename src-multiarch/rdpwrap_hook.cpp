@@ -7,6 +7,18 @@
 #endif
 
 #include "rdpwrap_core.h"
+#include "cpp_configparser/include/ini/compiled_config.hpp"
+#include "cpp_configparser/include/ini/mapped_file.hpp"
+#include "cpp_configparser/include/ini/schema.hpp"
+#include "cpp_configparser/include/ini/wrapper_keys.hpp"
+#include "hook/include/rdpwrap/hook/hook_jump.hpp"
+#include "hook/include/rdpwrap/hook/hook_plan.hpp"
+#include "hook/include/rdpwrap/hook/trampoline.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <string>
 
 #if defined(_M_ARM) || defined(_M_ARM64)
 #define RDPWRAP_INI_FILE_NAME L"rdpwrap-arm-kb.ini"
@@ -16,194 +28,177 @@
 #error Unsupported architecture for RDPWRAP_INI_FILE_NAME
 #endif
 
-namespace {
-
-bool ResolvePatchBytes(const ini::Parser& parser,
-                       const char* build_section,
-                       const char* code_key,
-                       char* patch_name,
-                       size_t patch_name_size,
-                       char* patch_buf,
-                       BYTE* patch_size) {
-  if (!patch_name || patch_name_size == 0 || !patch_buf || !patch_size) {
-    return false;
-  }
-
-  patch_name[0] = '\0';
-  *patch_size = 0;
-
-  INIReadString(parser, build_section, code_key, "", patch_name,
-                static_cast<DWORD>(patch_name_size));
-  if (patch_name[0] == '\0') {
-    return false;
-  }
+// Build sections suffix every key with the architecture, e.g.
+// "LocalOnlyPatch.x64". Keys are looked up through the compile-time tables
+// of wrapper_keys.hpp, so a misspelt name does not build.
+#if defined(_M_ARM64)
+#define RDPWRAP_CONFIG_ARCH ini::TargetArch::Arm64
+#define RDPWRAP_ARCH_SUFFIX ".arm64"
+#elif defined(_M_ARM)
+#define RDPWRAP_CONFIG_ARCH ini::TargetArch::Arm
+#define RDPWRAP_ARCH_SUFFIX ".arm"
+#elif defined(_M_X64)
+#define RDPWRAP_CONFIG_ARCH ini::TargetArch::X64
+#define RDPWRAP_ARCH_SUFFIX ".x64"
+#else
+#define RDPWRAP_CONFIG_ARCH ini::TargetArch::X86
+#define RDPWRAP_ARCH_SUFFIX ".x86"
+#endif
 
-  BYTE parsed_size = 0;
-  if (GetByteArrayFromIni(parser, "PatchCodes", patch_name, patch_buf, parsed_size,
-                          255)) {
-    *patch_size = parsed_size;
-    return true;
-  }
+namespace {
 
-  if (GetByteArrayFromIni(parser, build_section, code_key, patch_buf, parsed_size,
-                          255)) {
-    *patch_size = parsed_size;
-    return true;
+// Hex values wider than the platform's pointers read as the default.
+PLATFORM_DWORD PlatformValue(std::uint64_t value, PLATFORM_DWORD def_val) {
+  if (value > (std::numeric_limits<PLATFORM_DWORD>::max)()) {
+    return def_val;
   }
+  return static_cast<PLATFORM_DWORD>(value);
+}
 
-  return false;
+// A build-section key of this architecture.
+constexpr ini::StaticKey ArchKey(std::string_view name) {
+  return ini::arch_key<RDPWRAP_CONFIG_ARCH>(name);
 }
 
-void ApplyConfiguredPatch(const ini::Parser& parser,
-                          const char* build_section,
-                          const char* patch_enabled_key,
-                          const char* patch_offset_key,
-                          const char* patch_code_key,
-                          const char* patch_label,
-                          PLATFORM_DWORD module_base,
-                          PLATFORM_DWORD module_size) {
-  if (!GetBoolFromIni(parser, build_section, patch_enabled_key, false)) {
-    return;
-  }
+// CSLQuery members New_CSLQuery_Initialize overrides: their offsets come from
+// "[<version>-SLInit]", their values from [SLInit].
+struct SLInitDwords {
+  std::uint64_t bServerSku = 0;
+  std::uint64_t bRemoteConnAllowed = 0;
+  std::uint64_t bFUSEnabled = 0;
+  std::uint64_t bAppServerAllowed = 0;
+  std::uint64_t bMultimonAllowed = 0;
+  std::uint64_t lMaxUserSessions = 0;
+  std::uint64_t ulMaxDebugSessions = 0;
+  std::uint64_t bInitialized = 0;
+};
+
+struct SLInitMember {
+  const char* name;
+  std::uint64_t SLInitDwords::*field;
+  PLATFORM_DWORD defaultValue;  // when [SLInit] has no usable value
+  ini::StaticKey valueKey;      // in [SLInit]
+  ini::StaticKey offsetKey;     // in "[<version>-SLInit]"
+};
+
+constexpr SLInitMember SLInit(const char* name,
+                              std::uint64_t SLInitDwords::*field,
+                              PLATFORM_DWORD defaultValue) {
+  return {name, field, defaultValue, ini::wrapper_key(name), ArchKey(name)};
+}
 
-  PLATFORM_DWORD offset = INIReadDWordHex(parser, build_section, patch_offset_key, 0);
-  if (offset == 0) {
-    WriteLogFormat("Patch %s: missing offset\r\n", patch_label);
-    return;
+constexpr SLInitMember kSLInitMembers[] = {
+    SLInit("bServerSku", &SLInitDwords::bServerSku, 1),
+    SLInit("bRemoteConnAllowed", &SLInitDwords::bRemoteConnAllowed, 1),
+    SLInit("bFUSEnabled", &SLInitDwords::bFUSEnabled, 1),
+    SLInit("bAppServerAllowed", &SLInitDwords::bAppServerAllowed, 1),
+    SLInit("bMultimonAllowed", &SLInitDwords::bMultimonAllowed, 1),
+    SLInit("lMaxUserSessions", &SLInitDwords::lMaxUserSessions, 0),
+    SLInit("ulMaxDebugSessions", &SLInitDwords::ulMaxDebugSessions, 0),
+    SLInit("bInitialized", &SLInitDwords::bInitialized, 1),
+};
+
+ini::Schema<SLInitDwords> SLInitSchema(bool offsets) {
+  ini::Schema<SLInitDwords> schema;
+  for (const auto& member : kSLInitMembers) {
+    schema.hex(offsets ? member.offsetKey : member.valueKey, member.field);
   }
+  return schema;
+}
 
-  char patch_name[255] = {0};
-  char patch_buf[255] = {0};
-  BYTE patch_size = 0;
-  if (!ResolvePatchBytes(parser, build_section, patch_code_key, patch_name,
-                         _countof(patch_name), patch_buf, &patch_size) ||
-      patch_size == 0) {
-    WriteLogFormat("Patch %s: invalid code (%s)\r\n", patch_label,
-                   patch_code_key);
-    return;
-  }
+// An absolute jump to `target`, the same sequence for every hook.
+FARJMP MakeJump(PLATFORM_DWORD target) {
+  FARJMP jump = {};
+#ifdef _M_ARM64
+  jump.LdrOp = 0x58000050;
+  jump.BrOp = 0xD61F0200;
+  jump.Target = (DWORD64)target;
+#elif defined(_M_ARM)
+  jump.LdrOp = 0x4800;
+  jump.BlxOp = 0x4700;
+  jump.Target = (DWORD)target;
+#elif defined(_M_X64)
+  jump.MovOp = 0x48;
+  jump.MovRegArg = 0xB8;
+  jump.MovArg = (DWORD64)target;
+  jump.PushRaxOp = 0x50;
+  jump.RetOp = 0xC3;
+#elif defined(_M_IX86)
+  jump.PushOp = 0x68;
+  jump.PushArg = (DWORD)target;
+  jump.RetOp = 0xC3;
+#else
+#error Unsupported architecture
+#endif
+  return jump;
+}
 
-  if (offset >= module_size || patch_size > module_size - offset) {
-    WriteLogFormat("Patch %s: range 0x%llX+%u is outside termsrv.dll\r\n",
-                   patch_label, static_cast<ULONGLONG>(offset), patch_size);
-    return;
+// Where the absolute jump sits in the SLGetWindowsInformationDWORD thunk,
+// ahead of the relocated prologue.
+constexpr std::size_t kThunkJumpSlot = (sizeof(FARJMP) + 15) & ~std::size_t(15);
+
+// What Hook() writes at a site for `jump`: the branch or `absolute`, then
+// padding over the rest of the instructions it cuts (jump.patched bytes).
+void SiteBytes(const rdpwrap::hook::HookJump& jump, const FARJMP& absolute, BYTE* out) {
+  if (jump.route == rdpwrap::hook::JumpRoute::Absolute) {
+    memcpy(out, &absolute, sizeof(absolute));
+  } else {
+    memcpy(out, jump.branch, jump.size);
   }
+  rdpwrap::hook::fill_padding(RDPWRAP_CONFIG_ARCH, out + jump.size, jump.patched - jump.size);
+}
 
-  PLATFORM_DWORD patch_addr = module_base + offset;
-  if (!PatchMemoryWrite(reinterpret_cast<LPVOID>(patch_addr), patch_buf, patch_size)) {
-    WriteLogFormat("Patch %s: write failed at termsrv.dll+0x%X\r\n",
-                   patch_label, offset);
-    return;
+void LogSkipped(const rdpwrap::hook::HookPlan::Skipped& skipped) {
+  const int length = static_cast<int>(skipped.label.size());
+  const char* label = skipped.label.data();
+  switch (skipped.reason) {
+    case rdpwrap::hook::HookPlan::SkipReason::MissingOffset:
+      WriteLogFormat("Patch %.*s: missing offset\r\n", length, label);
+      break;
+    case rdpwrap::hook::HookPlan::SkipReason::InvalidCode:
+      WriteLogFormat("Patch %.*s: invalid code (%.*sCode" RDPWRAP_ARCH_SUFFIX ")\r\n",
+                     length, label, length, label);
+      break;
+    case rdpwrap::hook::HookPlan::SkipReason::OutOfRange:
+      WriteLogFormat("Patch %.*s: range 0x%llX+%u is outside termsrv.dll\r\n",
+                     length, label, static_cast<ULONGLONG>(skipped.offset),
+                     static_cast<unsigned>(skipped.size));
+      break;
   }
-
-  WriteLogFormat("Patch %s: termsrv.dll+0x%X (%u bytes, code=%s)\r\n",
-                 patch_label, offset, patch_size, patch_name);
 }
 
 }  // namespace
 
 HRESULT WINAPI New_CSLQuery_Initialize() {
-  DWORD* bServerSku = NULL;
-  DWORD* bRemoteConnAllowed = NULL;
-  DWORD* bFUSEnabled = NULL;
-  DWORD* bAppServerAllowed = NULL;
-  DWORD* bMultimonAllowed = NULL;
-  DWORD* lMaxUserSessions = NULL;
-  DWORD* ulMaxDebugSessions = NULL;
-  DWORD* bInitialized = NULL;
-
   WriteToLog(">>> CSLQuery::Initialize\r\n");
 
   char sect[256] = {0};
   wsprintfA(sect, "%d.%d.%d.%d-SLInit", FV.wVersion.Major, FV.wVersion.Minor,
             FV.Release, FV.Build);
 
+#if defined(_M_ARM64) || defined(_M_ARM)
   if (g_IniParser->has_section(sect)) {
-#if defined(_M_ARM64)
-    bServerSku = (DWORD*)(TermSrvBase +
-                          INIReadDWordHex(*g_IniParser, sect, "bServerSku.arm64", 0));
-    bRemoteConnAllowed = (DWORD*)(
-        TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bRemoteConnAllowed.arm64", 0));
-    bFUSEnabled =
-        (DWORD*)(TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bFUSEnabled.arm64", 0));
-    bAppServerAllowed = (DWORD*)(
-        TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bAppServerAllowed.arm64", 0));
-    bMultimonAllowed = (DWORD*)(
-        TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bMultimonAllowed.arm64", 0));
-    lMaxUserSessions = (DWORD*)(
-        TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "lMaxUserSessions.arm64", 0));
-    ulMaxDebugSessions =
-        (DWORD*)(TermSrvBase +
-                 INIReadDWordHex(*g_IniParser, sect, "ulMaxDebugSessions.arm64", 0));
-    bInitialized =
-        (DWORD*)(TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bInitialized.arm64", 0));
-#elif defined(_M_ARM)
-    bServerSku =
-        (DWORD*)(TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bServerSku.arm", 0));
-    bRemoteConnAllowed = (DWORD*)(
-        TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bRemoteConnAllowed.arm", 0));
-    bFUSEnabled =
-        (DWORD*)(TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bFUSEnabled.arm", 0));
-    bAppServerAllowed = (DWORD*)(
-        TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bAppServerAllowed.arm", 0));
-    bMultimonAllowed = (DWORD*)(
-        TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bMultimonAllowed.arm", 0));
-    lMaxUserSessions = (DWORD*)(
-        TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "lMaxUserSessions.arm", 0));
-    ulMaxDebugSessions =
-        (DWORD*)(TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "ulMaxDebugSessions.arm", 0));
-    bInitialized =
-        (DWORD*)(TermSrvBase + INIReadDWordHex(*g_IniParser, sect, "bInitialized.arm", 0));
+    static const auto offsetSchema = SLInitSchema(true);
+    static const auto valueSchema = SLInitSchema(false);
+    SLInitDwords offsets;
+    SLInitDwords values;
+    for (const auto& member : kSLInitMembers) {
+      values.*member.field = member.defaultValue;
+    }
+    offsetSchema.resolve(*g_IniParser, sect, offsets);
+    valueSchema.resolve(*g_IniParser, "SLInit", values);
+
+    for (const auto& member : kSLInitMembers) {
+      DWORD* target =
+          (DWORD*)(TermSrvBase + PlatformValue(offsets.*member.field, 0));
+      *target = static_cast<DWORD>(
+          PlatformValue(values.*member.field, member.defaultValue));
+      WriteLogFormat("SLInit [0x%p] %s = %d\r\n", target, member.name, *target);
+    }
+  }
 #else
-    // x86/x64: SLInit hook not used; keep all pointers NULL
+  // x86/x64: SLInit hook not used
 #endif
-  }
-
-  if (bServerSku) {
-    *bServerSku = static_cast<DWORD>(
-        INIReadDWordHex(*g_IniParser, "SLInit", "bServerSku", 1));
-    WriteLogFormat("SLInit [0x%p] bServerSku = %d\r\n", bServerSku, *bServerSku);
-  }
-  if (bRemoteConnAllowed) {
-    *bRemoteConnAllowed = static_cast<DWORD>(
-        INIReadDWordHex(*g_IniParser, "SLInit", "bRemoteConnAllowed", 1));
-    WriteLogFormat("SLInit [0x%p] bRemoteConnAllowed = %d\r\n", bRemoteConnAllowed,
-                   *bRemoteConnAllowed);
-  }
-  if (bFUSEnabled) {
-    *bFUSEnabled = static_cast<DWORD>(
-        INIReadDWordHex(*g_IniParser, "SLInit", "bFUSEnabled", 1));
-    WriteLogFormat("SLInit [0x%p] bFUSEnabled = %d\r\n", bFUSEnabled, *bFUSEnabled);
-  }
-  if (bAppServerAllowed) {
-    *bAppServerAllowed = static_cast<DWORD>(
-        INIReadDWordHex(*g_IniParser, "SLInit", "bAppServerAllowed", 1));
-    WriteLogFormat("SLInit [0x%p] bAppServerAllowed = %d\r\n", bAppServerAllowed,
-                   *bAppServerAllowed);
-  }
-  if (bMultimonAllowed) {
-    *bMultimonAllowed = static_cast<DWORD>(
-        INIReadDWordHex(*g_IniParser, "SLInit", "bMultimonAllowed", 1));
-    WriteLogFormat("SLInit [0x%p] bMultimonAllowed = %d\r\n", bMultimonAllowed,
-                   *bMultimonAllowed);
-  }
-  if (lMaxUserSessions) {
-    *lMaxUserSessions = static_cast<DWORD>(
-        INIReadDWordHex(*g_IniParser, "SLInit", "lMaxUserSessions", 0));
-    WriteLogFormat("SLInit [0x%p] lMaxUserSessions = %d\r\n", lMaxUserSessions,
-                   *lMaxUserSessions);
-  }
-  if (ulMaxDebugSessions) {
-    *ulMaxDebugSessions = static_cast<DWORD>(
-        INIReadDWordHex(*g_IniParser, "SLInit", "ulMaxDebugSessions", 0));
-    WriteLogFormat("SLInit [0x%p] ulMaxDebugSessions = %d\r\n", ulMaxDebugSessions,
-                   *ulMaxDebugSessions);
-  }
-  if (bInitialized) {
-    *bInitialized = static_cast<DWORD>(
-        INIReadDWordHex(*g_IniParser, "SLInit", "bInitialized", 1));
-    WriteLogFormat("SLInit [0x%p] bInitialized = %d\r\n", bInitialized, *bInitialized);
-  }
 
   WriteToLog("<<< CSLQuery::Initialize\r\n");
   return S_OK;
@@ -231,20 +226,40 @@ void Hook() {
   parseOptions.interpolation = ini::InterpolationMode::None;
   parseOptions.strict = false;
   parseOptions.empty_lines_in_values = true;
+  // Hook() reads only a handful of the file's sections; parse those on use.
+  // The ones the hooks read later are parsed before any hook is written.
+  parseOptions.section_loading = ini::SectionLoading::Lazy;
   g_IniParser = new ini::Parser(parseOptions);
 
+  // "<ini>.bin" from ini_configparser_compile replaces parsing the INI while
+  // it was compiled from this exact file. Which build to load is only known
+  // once termsrv.dll's version is, so the blob stays mapped until then.
+  ini::MappedFile compiledConfig;
+  bool useCompiled = false;
   try {
-    g_IniParser->read_file(configAnsi);
+    ini::MappedFile source(configAnsi);
+    ini::MappedFile blob(std::string(configAnsi) + ".bin");
+    if (ini::CompiledConfig(blob.view()).matches_source(source.view())) {
+      compiledConfig = std::move(blob);
+      useCompiled = true;
+    }
   } catch (...) {
-    WriteToLog("Error: Failed to load configuration\r\n");
-    return;
+    useCompiled = false;
+  }
+
+  if (useCompiled) {
+    WriteToLog("Using compiled configuration\r\n");
+  } else {
+    try {
+      g_IniParser->read_file(configAnsi);
+    } catch (...) {
+      WriteToLog("Error: Failed to load configuration\r\n");
+      return;
+    }
   }
 
   WORD ver = 0;
   PLATFORM_DWORD termSrvSize = 0;
-  PLATFORM_DWORD signPtr = 0;
-  PLATFORM_DWORD hookOffset = 0;
-  FARJMP jump = {};
 
   WriteToLog("Initializing RDP Wrapper...\r\n");
 
@@ -280,105 +295,124 @@ void Hook() {
   WriteLogFormat("Version:    %d.%d.%d.%d\r\n", FV.wVersion.Major,
                  FV.wVersion.Minor, FV.Release, FV.Build);
 
-  WriteToLog("Freezing threads...\r\n");
-  SetThreadsState(false);
+  if (useCompiled) {
+    try {
+      ini::CompiledConfig(compiledConfig.view())
+          .load(*g_IniParser,
+                ini::pack_version(FV.wVersion.Major, FV.wVersion.Minor, FV.Release, FV.Build),
+                RDPWRAP_CONFIG_ARCH);
+    } catch (...) {
+      WriteToLog("Error: Failed to load compiled configuration, reading INI\r\n");
+      g_IniParser->clear();
+      try {
+        g_IniParser->read_file(configAnsi);
+      } catch (...) {
+        WriteToLog("Error: Failed to load configuration\r\n");
+        return;
+      }
+    }
+    compiledConfig = ini::MappedFile();
+  }
 
-  bool enabled = true;
-  bool boolValue = true;
+  // The hooks read [SLPolicy], [SLInit] and "<version>-SLInit" from the
+  // service's threads, concurrently, and filling in a deferred section is
+  // not safe then. Parse those three now, while Hook() is the only reader;
+  // a section that fails to parse is not retried later either.
+  char slInitSection[256] = {0};
+  wsprintfA(slInitSection, "%d.%d.%d.%d-SLInit", FV.wVersion.Major, FV.wVersion.Minor,
+            FV.Release, FV.Build);
+  for (const char* section : {"SLPolicy", "SLInit", static_cast<const char*>(slInitSection)}) {
+    try {
+      g_IniParser->section(section);
+    } catch (...) {
+      WriteLogFormat("Error: Failed to parse [%s]\r\n", section);
+    }
+  }
+
+  // Everything up to freezing the threads runs with the service's other
+  // threads still going: reading the configuration, loading slc.dll,
+  // building the jumps and reading the bytes they replace. While they are
+  // suspended only the prepared writes happen.
+  if (!GetModuleCodeSectionInfo(hTermSrv, &TermSrvBase, &termSrvSize)) {
+    WriteToLog("Error: Failed to read termsrv.dll image size\r\n");
+  }
+  const rdpwrap::hook::HookPlan plan = rdpwrap::hook::build_hook_plan(
+      *g_IniParser,
+      ini::pack_version(FV.wVersion.Major, FV.wVersion.Minor, FV.Release, FV.Build),
+      RDPWRAP_CONFIG_ARCH, termSrvSize, sizeof(FARJMP));
 
-  boolValue = GetBoolFromIni(*g_IniParser, "Main", "SLPolicyHookNT60", true);
-  if ((ver == 0x0600) && boolValue) {
+  rdpwrap::hook::PatchTransaction patches(ProcessPatchMemory());
+
+  if ((ver == 0x0600 && plan.sl_policy_hook_nt60) ||
+      (ver == 0x0601 && plan.sl_policy_hook_nt61)) {
+    const char* nt = ver == 0x0601 ? " (NT61)" : "";
     hSLC = LoadLibrary(L"slc.dll");
     _SLGetWindowsInformationDWORD =
         (SLGETWINDOWSINFORMATIONDWORD)GetProcAddress(hSLC,
                                                      "SLGetWindowsInformationDWORD");
     if (_SLGetWindowsInformationDWORD != NULL) {
       WriteToLog("Hook SLGetWindowsInformationDWORD\r\n");
-#ifdef _M_ARM64
-      Stub_SLGetWindowsInformationDWORD.LdrOp = 0x58000050;
-      Stub_SLGetWindowsInformationDWORD.BrOp = 0xD61F0200;
-      Stub_SLGetWindowsInformationDWORD.Target =
-          (DWORD64)New_SLGetWindowsInformationDWORD;
-#elif defined(_M_ARM)
-      Stub_SLGetWindowsInformationDWORD.LdrOp = 0x4800;
-      Stub_SLGetWindowsInformationDWORD.BlxOp = 0x4700;
-      Stub_SLGetWindowsInformationDWORD.Target =
-          (DWORD)New_SLGetWindowsInformationDWORD;
-#elif defined(_M_X64)
-      Stub_SLGetWindowsInformationDWORD.MovOp = 0x48;
-      Stub_SLGetWindowsInformationDWORD.MovRegArg = 0xB8;
-      Stub_SLGetWindowsInformationDWORD.MovArg =
-          (DWORD64)New_SLGetWindowsInformationDWORD;
-      Stub_SLGetWindowsInformationDWORD.PushRaxOp = 0x50;
-      Stub_SLGetWindowsInformationDWORD.RetOp = 0xC3;
-#elif defined(_M_IX86)
-      Stub_SLGetWindowsInformationDWORD.PushOp = 0x68;
-      Stub_SLGetWindowsInformationDWORD.PushArg =
-          (DWORD)New_SLGetWindowsInformationDWORD;
-      Stub_SLGetWindowsInformationDWORD.RetOp = 0xC3;
-#else
-#error Unsupported architecture
-#endif
-      if (!PatchMemoryRead(reinterpret_cast<LPVOID>(_SLGetWindowsInformationDWORD),
-                          &Old_SLGetWindowsInformationDWORD, sizeof(FARJMP))) {
-        WriteToLog("Error: Failed to read old bytes for SLGetWindowsInformationDWORD\r\n");
-        SetThreadsState(true);
+      // The original stays callable through a thunk holding its first
+      // instructions, relocated, so the jump is never taken out again. The
+      // thunk starts with the absolute jump to the replacement, for an entry
+      // whose branch cannot reach the wrapper directly; the relocated code
+      // keeps operands pointing back into slc.dll, hence the margin.
+      const LPVOID original = reinterpret_cast<LPVOID>(_SLGetWindowsInformationDWORD);
+      BYTE prologue[rdpwrap::hook::kPrologueReadSize] = {};
+      if (!PatchMemoryRead(original, prologue, sizeof(prologue))) {
+        WriteLogFormat("Error: Failed to read old bytes for SLGetWindowsInformationDWORD%s\r\n", nt);
         return;
       }
-      if (!PatchMemoryWrite(reinterpret_cast<LPVOID>(_SLGetWindowsInformationDWORD),
-                           &Stub_SLGetWindowsInformationDWORD, sizeof(FARJMP))) {
-        WriteToLog("Error: Failed to write hook for SLGetWindowsInformationDWORD\r\n");
-        SetThreadsState(true);
+      const ULONG_PTR reach =
+          static_cast<ULONG_PTR>(rdpwrap::hook::branch_reach(RDPWRAP_CONFIG_ARCH) / 8 * 7);
+      const LPVOID thunk =
+          AllocateThunk(original, kThunkJumpSlot + rdpwrap::hook::kMaxThunkSize, reach);
+      if (thunk == NULL) {
+        WriteLogFormat("Error: Failed to allocate a thunk for SLGetWindowsInformationDWORD%s\r\n", nt);
         return;
       }
-    }
-  }
-
-  boolValue = GetBoolFromIni(*g_IniParser, "Main", "SLPolicyHookNT61", true);
-  if ((ver == 0x0601) && boolValue) {
-    hSLC = LoadLibrary(L"slc.dll");
-    _SLGetWindowsInformationDWORD =
-        (SLGETWINDOWSINFORMATIONDWORD)GetProcAddress(hSLC,
-                                                     "SLGetWindowsInformationDWORD");
-    if (_SLGetWindowsInformationDWORD != NULL) {
-      WriteToLog("Hook SLGetWindowsInformationDWORD\r\n");
-#ifdef _M_ARM64
-      Stub_SLGetWindowsInformationDWORD.LdrOp = 0x58000050;
-      Stub_SLGetWindowsInformationDWORD.BrOp = 0xD61F0200;
-      Stub_SLGetWindowsInformationDWORD.Target =
-          (DWORD64)New_SLGetWindowsInformationDWORD;
-#elif defined(_M_ARM)
-      Stub_SLGetWindowsInformationDWORD.LdrOp = 0x4800;
-      Stub_SLGetWindowsInformationDWORD.BlxOp = 0x4700;
-      Stub_SLGetWindowsInformationDWORD.Target =
-          (DWORD)New_SLGetWindowsInformationDWORD;
-#elif defined(_M_X64)
-      Stub_SLGetWindowsInformationDWORD.MovOp = 0x48;
-      Stub_SLGetWindowsInformationDWORD.MovRegArg = 0xB8;
-      Stub_SLGetWindowsInformationDWORD.MovArg =
-          (DWORD64)New_SLGetWindowsInformationDWORD;
-      Stub_SLGetWindowsInformationDWORD.PushRaxOp = 0x50;
-      Stub_SLGetWindowsInformationDWORD.RetOp = 0xC3;
-#elif defined(_M_IX86)
-      Stub_SLGetWindowsInformationDWORD.PushOp = 0x68;
-      Stub_SLGetWindowsInformationDWORD.PushArg =
-          (DWORD)New_SLGetWindowsInformationDWORD;
-      Stub_SLGetWindowsInformationDWORD.RetOp = 0xC3;
-#else
-#error Unsupported architecture
-#endif
-      if (!PatchMemoryRead(reinterpret_cast<LPVOID>(_SLGetWindowsInformationDWORD),
-                          &Old_SLGetWindowsInformationDWORD, sizeof(FARJMP))) {
-        WriteToLog("Error: Failed to read old bytes for SLGetWindowsInformationDWORD (NT61)\r\n");
-        SetThreadsState(true);
+      const std::uintptr_t entry = reinterpret_cast<std::uintptr_t>(original);
+      const std::uintptr_t thunkBase = reinterpret_cast<std::uintptr_t>(thunk);
+      const FARJMP absolute = MakeJump((PLATFORM_DWORD)New_SLGetWindowsInformationDWORD);
+      const rdpwrap::hook::HookJump jump = rdpwrap::hook::plan_hook_jump(
+          RDPWRAP_CONFIG_ARCH, prologue, sizeof(prologue), entry,
+          (PLATFORM_DWORD)New_SLGetWindowsInformationDWORD, thunkBase, sizeof(FARJMP));
+      rdpwrap::hook::RelocatedPrologue relocated;
+      rdpwrap::hook::RelocateStatus status = rdpwrap::hook::RelocateStatus::Undecodable;
+      if (jump.route != rdpwrap::hook::JumpRoute::None) {
+        status = rdpwrap::hook::relocate_prologue(prologue, sizeof(prologue), entry,
+                                                  thunkBase + kThunkJumpSlot, RDPWRAP_CONFIG_ARCH,
+                                                  jump.patched, relocated);
+      }
+      if (status != rdpwrap::hook::RelocateStatus::Ok) {
+        const std::string_view reason = rdpwrap::hook::relocate_status_name(status);
+        WriteLogFormat("Error: Failed to relocate SLGetWindowsInformationDWORD%s (%.*s)\r\n", nt,
+                       static_cast<int>(reason.size()), reason.data());
+        FreeThunk(thunk);
+        return;
+      }
+      BYTE code[kThunkJumpSlot + rdpwrap::hook::kMaxThunkSize];
+      rdpwrap::hook::fill_padding(RDPWRAP_CONFIG_ARCH, code, kThunkJumpSlot);
+      memcpy(code, &absolute, sizeof(absolute));
+      memcpy(code + kThunkJumpSlot, relocated.code.data(), relocated.code.size());
+      if (!SealThunk(thunk, code, kThunkJumpSlot + relocated.code.size())) {
+        FreeThunk(thunk);
         return;
       }
-      if (!PatchMemoryWrite(reinterpret_cast<LPVOID>(_SLGetWindowsInformationDWORD),
-                           &Stub_SLGetWindowsInformationDWORD, sizeof(FARJMP))) {
-        WriteToLog("Error: Failed to write hook for SLGetWindowsInformationDWORD (NT61)\r\n");
-        SetThreadsState(true);
+      BYTE site[rdpwrap::hook::kPrologueReadSize];
+      SiteBytes(jump, absolute, site);
+      if (!patches.write(entry, site, jump.patched)) {
+        WriteLogFormat("Error: Failed to queue hook for SLGetWindowsInformationDWORD%s\r\n", nt);
+        FreeThunk(thunk);
         return;
       }
+      _SLGetWindowsInformationDWORD =
+          reinterpret_cast<SLGETWINDOWSINFORMATIONDWORD>(thunkBase + kThunkJumpSlot);
+      const std::string_view route = rdpwrap::hook::jump_route_name(jump.route);
+      WriteLogFormat("Relocated %u bytes of SLGetWindowsInformationDWORD to 0x%p (%.*s)\r\n",
+                     static_cast<unsigned>(relocated.replaced),
+                     reinterpret_cast<LPVOID>(thunkBase + kThunkJumpSlot),
+                     static_cast<int>(route.size()), route.data());
     }
   }
 
@@ -386,7 +420,6 @@ void Hook() {
     hSLC = LoadLibrary(L"slc.dll");
     if (hSLC == 0) {
       WriteToLog("Error: Failed to load slc.dll for NT6.2\r\n");
-      SetThreadsState(true);
       return;
     }
     _SLGetWindowsInformationDWORD =
@@ -398,162 +431,123 @@ void Hook() {
     }
   }
 
-  char sect[256] = {0};
-  wsprintfA(sect, "%d.%d.%d.%d", FV.wVersion.Major, FV.wVersion.Minor,
-            FV.Release, FV.Build);
-
-  if (g_IniParser->has_section(sect) &&
-      GetModuleCodeSectionInfo(hTermSrv, &TermSrvBase, &termSrvSize)) {
-#if defined(_M_ARM64)
-    ApplyConfiguredPatch(*g_IniParser, sect, "LocalOnlyPatch.arm64",
-                         "LocalOnlyOffset.arm64", "LocalOnlyCode.arm64",
-                         "LocalOnly", TermSrvBase, termSrvSize);
-    ApplyConfiguredPatch(*g_IniParser, sect, "SingleUserPatch.arm64",
-                         "SingleUserOffset.arm64", "SingleUserCode.arm64",
-                         "SingleUser", TermSrvBase, termSrvSize);
-    ApplyConfiguredPatch(*g_IniParser, sect, "DefPolicyPatch.arm64",
-                         "DefPolicyOffset.arm64", "DefPolicyCode.arm64",
-                         "DefPolicy", TermSrvBase, termSrvSize);
-#elif defined(_M_ARM)
-    ApplyConfiguredPatch(*g_IniParser, sect, "LocalOnlyPatch.arm",
-                         "LocalOnlyOffset.arm", "LocalOnlyCode.arm",
-                         "LocalOnly", TermSrvBase, termSrvSize);
-    ApplyConfiguredPatch(*g_IniParser, sect, "SingleUserPatch.arm",
-                         "SingleUserOffset.arm", "SingleUserCode.arm",
-                         "SingleUser", TermSrvBase, termSrvSize);
-    ApplyConfiguredPatch(*g_IniParser, sect, "DefPolicyPatch.arm",
-                         "DefPolicyOffset.arm", "DefPolicyCode.arm",
-                         "DefPolicy", TermSrvBase, termSrvSize);
-#elif defined(_M_X64)
-    ApplyConfiguredPatch(*g_IniParser, sect, "LocalOnlyPatch.x64",
-                         "LocalOnlyOffset.x64", "LocalOnlyCode.x64",
-                         "LocalOnly", TermSrvBase, termSrvSize);
-    ApplyConfiguredPatch(*g_IniParser, sect, "SingleUserPatch.x64",
-                         "SingleUserOffset.x64", "SingleUserCode.x64",
-                         "SingleUser", TermSrvBase, termSrvSize);
-    ApplyConfiguredPatch(*g_IniParser, sect, "DefPolicyPatch.x64",
-                         "DefPolicyOffset.x64", "DefPolicyCode.x64",
-                         "DefPolicy", TermSrvBase, termSrvSize);
-#elif defined(_M_IX86)
-    ApplyConfiguredPatch(*g_IniParser, sect, "LocalOnlyPatch.x86",
-                         "LocalOnlyOffset.x86", "LocalOnlyCode.x86",
-                         "LocalOnly", TermSrvBase, termSrvSize);
-    ApplyConfiguredPatch(*g_IniParser, sect, "SingleUserPatch.x86",
-                         "SingleUserOffset.x86", "SingleUserCode.x86",
-                         "SingleUser", TermSrvBase, termSrvSize);
-    ApplyConfiguredPatch(*g_IniParser, sect, "DefPolicyPatch.x86",
-                         "DefPolicyOffset.x86", "DefPolicyCode.x86",
-                         "DefPolicy", TermSrvBase, termSrvSize);
-#else
-#error Unsupported architecture
-#endif
-#ifdef _M_ARM64
-    enabled = GetBoolFromIni(*g_IniParser, sect, "SLPolicyInternal.arm64", false);
-#elif defined(_M_ARM)
-    enabled = GetBoolFromIni(*g_IniParser, sect, "SLPolicyInternal.arm", false);
-#else
-    // x86/x64: SLPolicyInternal hook not applicable
-    enabled = false;
-#endif
-    if (enabled) {
-      WriteToLog("Hook SLGetWindowsInformationDWORDWrapper\r\n");
-#ifdef _M_ARM64
-      hookOffset = INIReadDWordHex(*g_IniParser, sect, "SLPolicyOffset.arm64", 0);
-      signPtr = TermSrvBase + hookOffset;
-      jump.LdrOp = 0x58000050;
-      jump.BrOp = 0xD61F0200;
-      jump.Target = (DWORD64)New_Win8SL;
-#elif defined(_M_ARM)
-      hookOffset = INIReadDWordHex(*g_IniParser, sect, "SLPolicyOffset.arm", 0);
-      signPtr = TermSrvBase + hookOffset;
-      jump.LdrOp = 0x4800;
-      jump.BlxOp = 0x4700;
-      jump.Target = (DWORD)New_Win8SL;
-#elif defined(_M_X64)
-      hookOffset = INIReadDWordHex(*g_IniParser, sect, "SLPolicyOffset.x64", 0);
-      signPtr = TermSrvBase + hookOffset;
-      jump.MovOp = 0x48;
-      jump.MovRegArg = 0xB8;
-      jump.MovArg = (DWORD64)New_Win8SL;
-      jump.PushRaxOp = 0x50;
-      jump.RetOp = 0xC3;
-#elif defined(_M_IX86)
-      hookOffset = INIReadDWordHex(*g_IniParser, sect, "SLPolicyOffset.x86", 0);
-      signPtr = TermSrvBase + hookOffset;
-      jump.PushOp = 0x68;
-      jump.PushArg = (DWORD)New_Win8SL;
-      jump.RetOp = 0xC3;
-#else
-#error Unsupported architecture
-#endif
-      if (hookOffset > 0 && hookOffset < termSrvSize &&
-          sizeof(FARJMP) <= termSrvSize - hookOffset) {
-        if (!PatchMemoryWrite((LPVOID)signPtr, &jump, sizeof(FARJMP))) {
-          WriteToLog("Error: Failed to write SLPolicy hook\r\n");
-        }
-      } else {
-        WriteLogFormat(
-            "Warning: SLPolicy offset 0x%llX out of code range [0x%llX, 0x%llX)\r\n",
-            (ULONGLONG)signPtr,
-            (ULONGLONG)TermSrvBase,
-            (ULONGLONG)(TermSrvBase + termSrvSize));
+  if (plan.has_build) {
+    for (const auto& skipped : plan.skipped) {
+      LogSkipped(skipped);
+    }
+    for (const auto& patch : plan.patches) {
+      const int label = static_cast<int>(patch.label.size());
+      if (!patches.write(TermSrvBase + patch.offset, patch.bytes.data, patch.bytes.size)) {
+        WriteLogFormat("Patch %.*s: failed to queue write at termsrv.dll+0x%llX\r\n",
+                       label, patch.label.data(), static_cast<ULONGLONG>(patch.offset));
+        continue;
       }
+      WriteLogFormat("Patch %.*s: queued termsrv.dll+0x%llX (%u bytes, code=%.*s)\r\n",
+                     label, patch.label.data(), static_cast<ULONGLONG>(patch.offset),
+                     static_cast<unsigned>(patch.bytes.size),
+                     static_cast<int>(patch.code.size()), patch.code.data());
     }
-
-#ifdef _M_ARM64
-    enabled = GetBoolFromIni(*g_IniParser, sect, "SLInitHook.arm64", false);
-#elif defined(_M_ARM)
-    enabled = GetBoolFromIni(*g_IniParser, sect, "SLInitHook.arm", false);
-#else
-    // x86/x64: SLInitHook hook not applicable
-    enabled = false;
-#endif
-    if (enabled) {
-      WriteToLog("Hook CSLQuery::Initialize\r\n");
-#ifdef _M_ARM64
-      hookOffset = INIReadDWordHex(*g_IniParser, sect, "SLInitOffset.arm64", 0);
-      signPtr = TermSrvBase + hookOffset;
-      jump.LdrOp = 0x58000050;
-      jump.BrOp = 0xD61F0200;
-      jump.Target = (DWORD64)New_CSLQuery_Initialize;
-#elif defined(_M_ARM)
-      hookOffset = INIReadDWordHex(*g_IniParser, sect, "SLInitOffset.arm", 0);
-      signPtr = TermSrvBase + hookOffset;
-      jump.LdrOp = 0x4800;
-      jump.BlxOp = 0x4700;
-      jump.Target = (DWORD)New_CSLQuery_Initialize;
-#elif defined(_M_X64)
-      hookOffset = INIReadDWordHex(*g_IniParser, sect, "SLInitOffset.x64", 0);
-      signPtr = TermSrvBase + hookOffset;
-      jump.MovOp = 0x48;
-      jump.MovRegArg = 0xB8;
-      jump.MovArg = (DWORD64)New_CSLQuery_Initialize;
-      jump.PushRaxOp = 0x50;
-      jump.RetOp = 0xC3;
-#elif defined(_M_IX86)
-      hookOffset = INIReadDWordHex(*g_IniParser, sect, "SLInitOffset.x86", 0);
-      signPtr = TermSrvBase + hookOffset;
-      jump.PushOp = 0x68;
-      jump.PushArg = (DWORD)New_CSLQuery_Initialize;
-      jump.RetOp = 0xC3;
-#else
-#error Unsupported architecture
-#endif
-      if (hookOffset > 0 && hookOffset < termSrvSize &&
-          sizeof(FARJMP) <= termSrvSize - hookOffset) {
-        if (!PatchMemoryWrite((LPVOID)signPtr, &jump, sizeof(FARJMP))) {
-          WriteToLog("Error: Failed to write CSLQuery::Initialize hook\r\n");
+    for (const auto& jump : plan.jumps) {
+      const bool policy = jump.target == rdpwrap::hook::HookPlan::JumpTarget::SLPolicy;
+      const char* name = policy ? "SLPolicy" : "CSLQuery::Initialize";
+      WriteToLog(policy ? "Hook SLGetWindowsInformationDWORDWrapper\r\n"
+                        : "Hook CSLQuery::Initialize\r\n");
+      const PLATFORM_DWORD target = policy ? (PLATFORM_DWORD)New_Win8SL
+                                           : (PLATFORM_DWORD)New_CSLQuery_Initialize;
+      const std::uintptr_t site = TermSrvBase + jump.offset;
+      const FARJMP absolute = MakeJump(target);
+      // The plan only checked sizeof(FARJMP) bytes; read no further than
+      // the end of termsrv.dll.
+      BYTE code[rdpwrap::hook::kPrologueReadSize] = {};
+      const ULONGLONG left = static_cast<ULONGLONG>(termSrvSize) - jump.offset;
+      const std::size_t codeSize =
+          left < sizeof(code) ? static_cast<std::size_t>(left) : sizeof(code);
+      if (!PatchMemoryRead(reinterpret_cast<LPVOID>(site), code, codeSize)) {
+        WriteLogFormat("Error: Failed to read %s hook site\r\n", name);
+        continue;
+      }
+      // The absolute jump goes in a thunk next to termsrv.dll when a branch
+      // cannot reach the wrapper itself, so the site still gets a branch.
+      LPVOID thunk = NULL;
+      BYTE branch[rdpwrap::hook::kMaxBranchSize];
+      if (!rdpwrap::hook::encode_branch(RDPWRAP_CONFIG_ARCH, site, target, branch)) {
+        const ULONG_PTR reach =
+            static_cast<ULONG_PTR>(rdpwrap::hook::branch_reach(RDPWRAP_CONFIG_ARCH));
+        thunk = AllocateThunk(reinterpret_cast<LPCVOID>(site), sizeof(FARJMP), reach);
+        if (thunk != NULL && !SealThunk(thunk, &absolute, sizeof(absolute))) {
+          FreeThunk(thunk);
+          thunk = NULL;
         }
-      } else {
-        WriteLogFormat(
-            "Warning: SLInit offset 0x%llX out of code range [0x%llX, 0x%llX)\r\n",
-            (ULONGLONG)signPtr,
-            (ULONGLONG)TermSrvBase,
-            (ULONGLONG)(TermSrvBase + termSrvSize));
       }
+      const rdpwrap::hook::HookJump placed = rdpwrap::hook::plan_hook_jump(
+          RDPWRAP_CONFIG_ARCH, code, codeSize, site, target,
+          reinterpret_cast<std::uintptr_t>(thunk), sizeof(FARJMP));
+      if (placed.route != rdpwrap::hook::JumpRoute::Thunk) {
+        FreeThunk(thunk);
+      }
+      if (placed.route == rdpwrap::hook::JumpRoute::None) {
+        WriteLogFormat("Error: No safe jump for %s hook at termsrv.dll+0x%llX\r\n", name,
+                       static_cast<ULONGLONG>(jump.offset));
+        continue;
+      }
+      // Rounded up to whole instructions, the write can be longer than the
+      // jump the plan checked.
+      if (placed.patched > left) {
+        if (placed.route == rdpwrap::hook::JumpRoute::Thunk) {
+          FreeThunk(thunk);
+        }
+        LogSkipped({rdpwrap::hook::jump_label(jump.target),
+                    rdpwrap::hook::HookPlan::SkipReason::OutOfRange, jump.offset,
+                    placed.patched});
+        continue;
+      }
+      BYTE bytes[rdpwrap::hook::kPrologueReadSize];
+      SiteBytes(placed, absolute, bytes);
+      if (!patches.write(site, bytes, placed.patched)) {
+        WriteLogFormat("Error: Failed to queue %s hook\r\n", name);
+        continue;
+      }
+      const std::string_view route = rdpwrap::hook::jump_route_name(placed.route);
+      WriteLogFormat("Hook %s: queued %.*s, %u bytes at termsrv.dll+0x%llX\r\n", name,
+                     static_cast<int>(route.size()), route.data(),
+                     static_cast<unsigned>(placed.patched), static_cast<ULONGLONG>(jump.offset));
     }
   }
 
-  WriteToLog("Resumimg threads...\r\n");
-  SetThreadsState(true);
+  if (!patches.empty() && !patches.prepare()) {
+    LogPatchMemoryErrors();
+    WriteLogFormat("Error: Failed to prepare patches at 0x%p, nothing was changed\r\n",
+                   reinterpret_cast<LPVOID>(patches.failed_address()));
+    return;
+  }
+
+  WriteToLog("Freezing threads...\r\n");
+  rdpwrap::hook::ThreadFreeze threads(ProcessThreadControl());
+  const bool frozen = threads.freeze();
+  const bool committed = patches.empty() || patches.commit();
+  threads.thaw();
+
+  // Logged only now, so that no file is written with the threads suspended.
+  LogPatchMemoryErrors();
+  if (frozen) {
+    WriteLogFormat("Suspended %u threads (%s, %d passes) for %llu us\r\n",
+                   static_cast<unsigned>(threads.suspended()),
+                   threads.used_snapshot() ? "snapshot" : "per process",
+                   threads.passes(),
+                   static_cast<unsigned long long>(
+                       std::chrono::duration_cast<std::chrono::microseconds>(
+                           threads.window())
+                           .count()));
+  } else {
+    WriteToLog("Warning: Failed to list threads, patched without freezing\r\n");
+  }
+  if (committed) {
+    WriteLogFormat("Applied all %u queued writes (%u ranges, %u page runs)\r\n",
+                   static_cast<unsigned>(patches.size()),
+                   static_cast<unsigned>(patches.extent_count()),
+                   static_cast<unsigned>(patches.page_run_count()));
+  } else {
+    WriteLogFormat("Error: Patching failed at 0x%p, nothing was changed\r\n",
+                   reinterpret_cast<LPVOID>(patches.failed_address()));
+  }
 }
@@ -2,6 +2,8 @@
 
 #include "rdpwrap_core.h"
 
+#include "cpp_configparser/include/ini/decode.hpp"
+
 bool OverrideSL(LPWSTR value_name, DWORD* value) {
   if (!g_IniParser) return false;
 
@@ -10,13 +12,8 @@ bool OverrideSL(LPWSTR value_name, DWORD* value) {
     return false;
   }
 
-  std::string val_str = IniGetRaw(*g_IniParser, "SLPolicy", value_name_ansi, "");
-  if (val_str.empty()) {
-    *value = 0;
-    return true;
-  }
-
-  *value = static_cast<DWORD>(strtoul(val_str.c_str(), nullptr, 10));
+  *value = ini::read_decimal(*g_IniParser, "SLPolicy", value_name_ansi)
+               .value_or(0);
   return true;
 }
 
@@ -32,12 +29,8 @@ HRESULT WINAPI New_SLGetWindowsInformationDWORD(PWSTR pwszValueName,
     return S_OK;
   }
 
-  if (!PatchMemoryWrite(reinterpret_cast<LPVOID>(_SLGetWindowsInformationDWORD),
-                        &Old_SLGetWindowsInformationDWORD, sizeof(FARJMP))) {
-    WriteToLog("Error: Failed to restore Original Bytes\r\n");
-    return E_FAIL;
-  }
-
+  // The thunk Hook() built: the original's first instructions, relocated,
+  // then a jump back into it past the hook.
   HRESULT result = _SLGetWindowsInformationDWORD(pwszValueName, pdwValue);
   if (result == S_OK) {
     WriteLogFormat("Policy result: %i\r\n", dw);
@@ -45,11 +38,6 @@ HRESULT WINAPI New_SLGetWindowsInformationDWORD(PWSTR pwszValueName,
     WriteToLog("Policy request failed\r\n");
   }
 
-  if (!PatchMemoryWrite(reinterpret_cast<LPVOID>(_SLGetWindowsInformationDWORD),
-                        &Stub_SLGetWindowsInformationDWORD, sizeof(FARJMP))) {
-    WriteToLog("Error: Failed to restore Stub\r\n");
-  }
-
   return result;
 }
 
@@ -7,7 +7,6 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <limits>
 #include <vector>
 
 #include <tlhelp32.h>
@@ -16,60 +15,7 @@
 #pragma comment(lib, "Version.lib")
 #endif
 
-std::string IniGetRaw(const ini::Parser& parser,
-                      const char* sect,
-                      const char* key,
-                      const char* def_val) {
-  try {
-    if (!parser.has_section(sect) || !parser.has_option(sect, key)) {
-      return def_val ? def_val : "";
-    }
-    ini::OptionValue ov = parser.get_raw(sect, key);
-    if (!ov.has_value()) {
-      return def_val ? def_val : "";
-    }
-    return ov.value();
-  } catch (...) {
-    return def_val ? def_val : "";
-  }
-}
-
-PLATFORM_DWORD INIReadDWordHex(const ini::Parser& parser,
-                            const char* sect,
-                            const char* key,
-                            PLATFORM_DWORD def_val) {
-  std::string val_str = IniGetRaw(parser, sect, key, "");
-  if (val_str.empty()) {
-    return def_val;
-  }
-  errno = 0;
-  char* end = nullptr;
-  const unsigned long long value = strtoull(val_str.c_str(), &end, 16);
-  if (errno == ERANGE || !end || *end != '\0' ||
-      value > (std::numeric_limits<PLATFORM_DWORD>::max)()) {
-    return def_val;
-  }
-  return static_cast<PLATFORM_DWORD>(value);
-}
-
-void INIReadString(const ini::Parser& parser,
-                   const char* sect,
-                   const char* key,
-                   const char* def_val,
-                   char* ret,
-                   DWORD ret_size) {
-  std::string val_str = IniGetRaw(parser, sect, key, def_val ? def_val : "");
-  strncpy_s(ret, ret_size, val_str.c_str(), _TRUNCATE);
-}
-
 namespace {
-int HexNibble(char c) {
-  if (c >= '0' && c <= '9') return c - '0';
-  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-  return -1;
-}
-
 bool QueryProductVersion(const wchar_t* filename, FILE_VERSION* file_version) {
   if (!filename || !*filename || !file_version) return false;
 
@@ -99,51 +45,6 @@ bool QueryProductVersion(const wchar_t* filename, FILE_VERSION* file_version) {
 }
 }  // namespace
 
-bool GetBoolFromIni(const ini::Parser& parser,
-                    const char* sect,
-                    const char* key,
-                    bool def_val) {
-  std::string val_str = IniGetRaw(parser, sect, key, "");
-  if (val_str.empty()) {
-    return def_val;
-  }
-  return (strtol(val_str.c_str(), nullptr, 10) != 0);
-}
-
-bool GetByteArrayFromIni(const ini::Parser& parser,
-                         const char* sect,
-                         const char* key,
-                         char* out_buf,
-                         BYTE& out_size,
-                         BYTE max_len) {
-  std::string raw = IniGetRaw(parser, sect, key, "");
-  if (raw.empty()) {
-    return false;
-  }
-
-  std::string hex;
-  hex.reserve(raw.size());
-  for (size_t i = 0; i < raw.size(); ++i) {
-    char c = raw[i];
-    if (c == ' ' || c == '\t' || c == ',' || c == '-') continue;
-    hex.push_back(c);
-  }
-
-  if ((hex.size() % 2) != 0) return false;
-  const size_t max_characters = static_cast<size_t>(max_len) * 2;
-  if (hex.size() > max_characters) return false;
-
-  for (size_t i = 0; i < hex.size(); i += 2) {
-    int hi = HexNibble(hex[i]);
-    int lo = HexNibble(hex[i + 1]);
-    if (hi < 0 || lo < 0) return false;
-    out_buf[i / 2] = static_cast<char>((hi << 4) | lo);
-  }
-
-  out_size = static_cast<BYTE>(hex.size() / 2);
-  return true;
-}
-
 bool WideToAnsi(const wchar_t* src, char* dst, size_t dst_size) {
   if (!src || !dst || dst_size == 0) return false;
   size_t converted = 0;
@@ -203,62 +104,223 @@ bool GetModuleCodeSectionInfo(HMODULE h_module,
   return true;
 }
 
-void SetThreadsState(bool resume) {
-  HANDLE h = NULL;
-  HANDLE h_thread = NULL;
-  DWORD curr_thread_id = GetCurrentThreadId();
-  DWORD curr_proc_id = GetCurrentProcessId();
-  THREADENTRY32 thread = {};
+namespace {
+// NtGetNextThread walks the threads of one process (Vista and later);
+// older systems fall back to a Toolhelp snapshot of every thread on the
+// machine.
+typedef LONG(WINAPI* NTGETNEXTTHREAD)(HANDLE ProcessHandle,
+                                       HANDLE ThreadHandle,
+                                       DWORD DesiredAccess,
+                                       ULONG HandleAttributes,
+                                       ULONG Flags,
+                                       PHANDLE NewThreadHandle);
+
+const LONG kStatusNoMoreEntries = static_cast<LONG>(0x8000001A);
+const DWORD kThreadAccess = THREAD_SUSPEND_RESUME | THREAD_QUERY_LIMITED_INFORMATION;
+
+class ProcessThreads : public rdpwrap::hook::ThreadControl {
+ public:
+  ProcessThreads()
+      : get_next_thread_(reinterpret_cast<NTGETNEXTTHREAD>(GetProcAddress(
+            GetModuleHandleW(L"ntdll.dll"), "NtGetNextThread"))) {}
+
+  bool list_threads(rdpwrap::hook::ThreadList& out) override {
+    if (!get_next_thread_) return false;
+
+    const DWORD self = GetCurrentThreadId();
+    const size_t first = out.size();
+    HANDLE prev = NULL;
+    bool keep_prev = false;
+    LONG status = 0;
+    for (;;) {
+      HANDLE next = NULL;
+      status = get_next_thread_(GetCurrentProcess(), prev, kThreadAccess, 0, 0,
+                                &next);
+      if (prev != NULL && !keep_prev) CloseHandle(prev);
+      if (status != 0) break;
+      const DWORD id = GetThreadId(next);
+      // A thread that does not fit is closed with the next step.
+      keep_prev = id != self &&
+                  out.push_back({static_cast<std::uint32_t>(id),
+                                 reinterpret_cast<std::uintptr_t>(next)});
+      prev = next;
+    }
+    if (status == kStatusNoMoreEntries) return true;
 
-  h = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
-  if (h != INVALID_HANDLE_VALUE) {
+    for (size_t i = first; i < out.size(); ++i) close(out[i]);
+    out.truncate(first);
+    return false;
+  }
+
+  bool list_threads_snapshot(rdpwrap::hook::ThreadList& out) override {
+    HANDLE h = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    const DWORD self = GetCurrentThreadId();
+    const DWORD process = GetCurrentProcessId();
+    THREADENTRY32 thread = {};
     thread.dwSize = sizeof(THREADENTRY32);
-    Thread32First(h, &thread);
-    do {
-      if (thread.th32ThreadID != curr_thread_id &&
-          thread.th32OwnerProcessID == curr_proc_id) {
-        h_thread = OpenThread(THREAD_SUSPEND_RESUME, false, thread.th32ThreadID);
-        if (h_thread != NULL) {
-          if (resume) {
-            ResumeThread(h_thread);
-          } else {
-            SuspendThread(h_thread);
+    if (Thread32First(h, &thread)) {
+      do {
+        if (thread.th32ThreadID != self &&
+            thread.th32OwnerProcessID == process) {
+          HANDLE h_thread = OpenThread(kThreadAccess, false, thread.th32ThreadID);
+          if (h_thread != NULL &&
+              !out.push_back({static_cast<std::uint32_t>(thread.th32ThreadID),
+                              reinterpret_cast<std::uintptr_t>(h_thread)})) {
+            CloseHandle(h_thread);
           }
-          CloseHandle(h_thread);
         }
-      }
-    } while (Thread32Next(h, &thread));
+      } while (Thread32Next(h, &thread));
+    }
     CloseHandle(h);
+    return true;
+  }
+
+  bool suspend(const Thread& thread) override {
+    return SuspendThread(reinterpret_cast<HANDLE>(thread.handle)) !=
+           static_cast<DWORD>(-1);
   }
+
+  bool resume(const Thread& thread) override {
+    return ResumeThread(reinterpret_cast<HANDLE>(thread.handle)) !=
+           static_cast<DWORD>(-1);
+  }
+
+  void close(const Thread& thread) override {
+    CloseHandle(reinterpret_cast<HANDLE>(thread.handle));
+  }
+
+ private:
+  NTGETNEXTTHREAD get_next_thread_;
+};
+}  // namespace
+
+rdpwrap::hook::ThreadControl& ProcessThreadControl() {
+  static ProcessThreads threads;
+  return threads;
 }
 
-bool PatchMemoryWrite(LPVOID addr, LPCVOID data, SIZE_T size) {
-  if (!addr || !data || size == 0) return false;
+namespace {
+// VirtualProtectEx/WriteProcessMemory on the current process.
+//
+// Failures are only recorded, in a fixed buffer: commit() runs with the
+// other threads suspended, and one of them may hold the heap or the log
+// file. LogErrors() writes them out once the threads run again.
+class ProcessMemory : public rdpwrap::hook::PatchMemory {
+ public:
+  ProcessMemory() {
+    SYSTEM_INFO info = {};
+    GetSystemInfo(&info);
+    page_size_ = info.dwPageSize;
+  }
+
+  std::size_t page_size() const noexcept override { return page_size_; }
 
-  HANDLE hProc = GetCurrentProcess();
-  DWORD oldProtect = 0;
+  bool protection(std::uintptr_t page, std::uint32_t& out) override {
+    MEMORY_BASIC_INFORMATION info = {};
+    if (VirtualQuery(reinterpret_cast<LPCVOID>(page), &info, sizeof(info)) !=
+        sizeof(info)) {
+      Record("VirtualQuery", page, 0, 0);
+      return false;
+    }
+    out = info.Protect;
+    return true;
+  }
 
-  if (!VirtualProtectEx(hProc, addr, size, PAGE_EXECUTE_READWRITE, &oldProtect)) {
-    WriteLogFormat("PatchMemoryWrite: VirtualProtect failed at 0x%p (error %lu)\r\n",
-                   addr, GetLastError());
-    return false;
+  bool make_writable(std::uintptr_t addr, std::size_t size) override {
+    return Protect(addr, size, PAGE_EXECUTE_READWRITE);
   }
 
-  SIZE_T bytesWritten = 0;
-  BOOL ok = WriteProcessMemory(hProc, addr, data, size, &bytesWritten);
+  bool restore(std::uintptr_t addr, std::size_t size,
+               std::uint32_t protection) override {
+    return Protect(addr, size, protection);
+  }
 
-  DWORD restored = 0;
-  VirtualProtectEx(hProc, addr, size, oldProtect, &restored);
+  bool read(std::uintptr_t addr, void* out, std::size_t size) override {
+    return PatchMemoryRead(reinterpret_cast<LPVOID>(addr), out, size);
+  }
 
-  if (!ok || bytesWritten != size) {
-    WriteLogFormat("PatchMemoryWrite: WriteProcessMemory failed at 0x%p (%lu/%llu bytes, error %lu)\r\n",
-                   addr, (ULONG_PTR)bytesWritten, (ULONGLONG)size, GetLastError());
-    return false;
+  bool write(std::uintptr_t addr, const void* data, std::size_t size) override {
+    SIZE_T bytesWritten = 0;
+    if (!WriteProcessMemory(GetCurrentProcess(), reinterpret_cast<LPVOID>(addr),
+                            data, size, &bytesWritten) ||
+        bytesWritten != size) {
+      Record("WriteProcessMemory", addr, size, bytesWritten);
+      return false;
+    }
+    return true;
   }
 
-  FlushInstructionCache(hProc, addr, size);
-  return true;
+  void flush_instructions(std::uintptr_t addr, std::size_t size) override {
+    FlushInstructionCache(GetCurrentProcess(), reinterpret_cast<LPCVOID>(addr),
+                          size);
+  }
+
+  // Writes the failures recorded since the last call to the log.
+  void LogErrors() {
+    const std::size_t shown = error_count_ < kMaxErrors ? error_count_ : kMaxErrors;
+    for (std::size_t i = 0; i < shown; ++i) {
+      const Error& e = errors_[i];
+      if (e.size != 0) {
+        WriteLogFormat("PatchMemoryWrite: %s failed at 0x%p (%llu/%llu bytes, error %lu)\r\n",
+                       e.call, reinterpret_cast<LPVOID>(e.addr), (ULONGLONG)e.done,
+                       (ULONGLONG)e.size, e.code);
+      } else {
+        WriteLogFormat("PatchMemoryWrite: %s failed at 0x%p (error %lu)\r\n",
+                       e.call, reinterpret_cast<LPVOID>(e.addr), e.code);
+      }
+    }
+    if (error_count_ > shown) {
+      WriteLogFormat("PatchMemoryWrite: %llu more failures not shown\r\n",
+                     (ULONGLONG)(error_count_ - shown));
+    }
+    error_count_ = 0;
+  }
+
+ private:
+  struct Error {
+    const char* call;
+    std::uintptr_t addr;
+    std::size_t size;  // bytes to write, 0 for protection calls
+    std::size_t done;  // bytes written
+    DWORD code;        // GetLastError()
+  };
+  static const std::size_t kMaxErrors = 16;
+
+  void Record(const char* call, std::uintptr_t addr, std::size_t size,
+              std::size_t done) {
+    const DWORD code = GetLastError();
+    if (error_count_ < kMaxErrors) {
+      errors_[error_count_] = {call, addr, size, done, code};
+    }
+    ++error_count_;
+  }
+
+  bool Protect(std::uintptr_t addr, std::size_t size, DWORD protection) {
+    DWORD oldProtect = 0;
+    if (!VirtualProtectEx(GetCurrentProcess(), reinterpret_cast<LPVOID>(addr),
+                          size, protection, &oldProtect)) {
+      Record("VirtualProtect", addr, 0, 0);
+      return false;
+    }
+    return true;
+  }
+
+  std::size_t page_size_ = 4096;
+  Error errors_[kMaxErrors] = {};
+  std::size_t error_count_ = 0;
+};
+
+ProcessMemory& Memory() {
+  static ProcessMemory memory;
+  return memory;
 }
+}  // namespace
+
+rdpwrap::hook::PatchMemory& ProcessPatchMemory() { return Memory(); }
+
+void LogPatchMemoryErrors() { Memory().LogErrors(); }
 
 bool PatchMemoryRead(LPVOID addr, LPVOID buf, SIZE_T size) {
   if (!addr || !buf || size == 0) return false;
@@ -266,14 +328,78 @@ bool PatchMemoryRead(LPVOID addr, LPVOID buf, SIZE_T size) {
   SIZE_T bytesRead = 0;
   if (!ReadProcessMemory(GetCurrentProcess(), addr, buf, size, &bytesRead) ||
       bytesRead != size) {
-    WriteLogFormat("PatchMemoryRead: ReadProcessMemory failed at 0x%p (%lu/%llu bytes, error %lu)\r\n",
-                   addr, (ULONG_PTR)bytesRead, (ULONGLONG)size, GetLastError());
+    WriteLogFormat("PatchMemoryRead: ReadProcessMemory failed at 0x%p (%llu/%llu bytes, error %lu)\r\n",
+                   addr, (ULONGLONG)bytesRead, (ULONGLONG)size, GetLastError());
     return false;
   }
 
   return true;
 }
 
+LPVOID AllocateThunk(LPCVOID near_addr, SIZE_T size, ULONG_PTR reach) {
+  if (reach == 0) {
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  }
+  // The nearest free allocation unit below near_addr, then above it, with
+  // the whole thunk inside the reach.
+  SYSTEM_INFO info = {};
+  GetSystemInfo(&info);
+  const ULONG_PTR granularity = info.dwAllocationGranularity;
+  const ULONG_PTR window = reach - granularity;
+  const ULONG_PTR origin =
+      reinterpret_cast<ULONG_PTR>(near_addr) & ~(granularity - 1);
+  const ULONG_PTR low = origin > window ? origin - window : granularity;
+  MEMORY_BASIC_INFORMATION mbi = {};
+  for (ULONG_PTR addr = origin - granularity; addr >= low && addr < origin;) {
+    if (VirtualQuery(reinterpret_cast<LPCVOID>(addr), &mbi, sizeof(mbi)) !=
+        sizeof(mbi)) {
+      break;
+    }
+    if (mbi.State == MEM_FREE) {
+      LPVOID thunk = VirtualAlloc(reinterpret_cast<LPVOID>(addr), size,
+                                  MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+      if (thunk != NULL) return thunk;
+    }
+    const ULONG_PTR base = mbi.State == MEM_FREE
+                               ? addr
+                               : reinterpret_cast<ULONG_PTR>(mbi.AllocationBase);
+    addr = (base & ~(granularity - 1)) - granularity;
+  }
+  for (ULONG_PTR addr = origin + granularity; addr < origin + window;) {
+    if (VirtualQuery(reinterpret_cast<LPCVOID>(addr), &mbi, sizeof(mbi)) !=
+        sizeof(mbi)) {
+      break;
+    }
+    if (mbi.State == MEM_FREE) {
+      LPVOID thunk = VirtualAlloc(reinterpret_cast<LPVOID>(addr), size,
+                                  MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+      if (thunk != NULL) return thunk;
+    }
+    const ULONG_PTR end =
+        reinterpret_cast<ULONG_PTR>(mbi.BaseAddress) + mbi.RegionSize;
+    addr = (end + granularity - 1) & ~(granularity - 1);
+  }
+  WriteLogFormat("AllocateThunk: no free memory within reach of 0x%p\r\n",
+                 near_addr);
+  return NULL;
+}
+
+bool SealThunk(LPVOID thunk, LPCVOID code, SIZE_T size) {
+  memcpy(thunk, code, size);
+  DWORD oldProtect = 0;
+  if (!VirtualProtect(thunk, size, PAGE_EXECUTE_READ, &oldProtect)) {
+    WriteLogFormat("SealThunk: VirtualProtect failed at 0x%p (error %lu)\r\n",
+                   thunk, GetLastError());
+    return false;
+  }
+  FlushInstructionCache(GetCurrentProcess(), thunk, size);
+  return true;
+}
+
+void FreeThunk(LPVOID thunk) {
+  if (thunk != NULL) VirtualFree(thunk, 0, MEM_RELEASE);
+}
+
 BOOL __stdcall GetModuleVersion(LPCWSTR lptstrModuleName,
                                 FILE_VERSION* file_version) {
   if (!lptstrModuleName || !file_version) return false;